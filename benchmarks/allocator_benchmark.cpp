@@ -0,0 +1,105 @@
+#include "engine.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using melkior::engine::Buffer;
+using melkior::engine::Engine;
+
+namespace {
+
+constexpr int kIterations = 10;
+constexpr int kBuffersPerFrame = 256;
+
+// tensor-sized intermediates: 4 KB .. 1 MB
+VkDeviceSize bufferSize(int i) { return VkDeviceSize(4096) << (i % 9); }
+
+template <typename Create>
+void benchmark_allocations(Engine &engine, const char *name, Create create) {
+  double createMs = 0.0;
+  double destroyMs = 0.0;
+  std::vector<Buffer> buffers;
+  buffers.reserve(kBuffersPerFrame);
+
+  for (int it = 0; it < kIterations; it++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kBuffersPerFrame; i++) {
+      auto result = create(bufferSize(i));
+      if (!result.isValid()) {
+        std::cout << name << ": allocation failed (" << result.getError()
+                  << ") after " << i << " buffers" << std::endl;
+        break;
+      }
+      buffers.push_back(result.getValue());
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (auto &buffer : buffers) {
+      engine.destroyBuffer(buffer);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    buffers.clear();
+
+    createMs += std::chrono::duration<double, std::milli>(mid - start).count();
+    destroyMs += std::chrono::duration<double, std::milli>(end - mid).count();
+  }
+
+  const double count = double(kIterations) * kBuffersPerFrame;
+  std::cout << name << ": create " << createMs * 1000.0 / count
+            << " us/buffer, destroy " << destroyMs * 1000.0 / count
+            << " us/buffer" << std::endl;
+}
+
+} // namespace
+
+int main() {
+  Engine engine("bench_allocator");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+  engine.printDeviceInfo();
+
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                   melkior::engine::USAGE_TRANSFER_SRC_DST;
+
+  for (auto memProps : {melkior::engine::MEM_GPU_ONLY,
+                        melkior::engine::MEM_CPU_VISIBLE_COHERENT}) {
+    std::cout << (memProps == melkior::engine::MEM_GPU_ONLY
+                      ? "--- GPU only ---"
+                      : "--- CPU visible coherent ---")
+              << std::endl;
+
+    benchmark_allocations(engine, "vkAllocateMemory per buffer",
+                          [&](VkDeviceSize size) {
+                            return engine.createDedicatedBuffer(size, usage,
+                                                                memProps);
+                          });
+    benchmark_allocations(engine, "Arena sub-allocation       ",
+                          [&](VkDeviceSize size) {
+                            return engine.createBuffer(size, usage, memProps);
+                          });
+  }
+
+  // interleaved lifetimes to show how the free list copes with holes
+  std::vector<Buffer> live;
+  for (int i = 0; i < 4 * kBuffersPerFrame; i++) {
+    auto result = engine.createBuffer(bufferSize(i * 7), usage,
+                                      melkior::engine::MEM_GPU_ONLY);
+    if (result.isValid()) {
+      live.push_back(result.getValue());
+    }
+  }
+  for (size_t i = 0; i < live.size(); i += 2) {
+    engine.destroyBuffer(live[i]);
+  }
+  std::cout << "\nAfter freeing every other buffer:\n";
+  engine.printAllocatorStats();
+
+  for (size_t i = 1; i < live.size(); i += 2) {
+    engine.destroyBuffer(live[i]);
+  }
+  std::cout << "\nAfter freeing everything:\n";
+  engine.printAllocatorStats();
+  return 0;
+}
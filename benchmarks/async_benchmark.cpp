@@ -0,0 +1,154 @@
+#include "engine.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace melkior::engine;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+struct PushConstants {
+  uint32_t N;
+  float a;
+  float b;
+};
+
+constexpr uint32_t kN = 1 << 20;
+constexpr int kFrames = 100;
+constexpr int kOpsPerFrame = 8;
+
+// stands in for decoding / converting the next input on the CPU
+void preprocess(float *dst, const std::vector<uint8_t> &raw, int frame) {
+  for (uint32_t i = 0; i < kN; i++) {
+    dst[i] = float(raw[i]) + float(frame);
+  }
+}
+
+} // namespace
+
+int main() {
+  Engine engine("bench_async");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const KernelSignature signature{
+      {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ},
+       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::WRITE}},
+      sizeof(PushConstants)};
+  auto kernelResult = engine.createKernel("axpb.spv", signature);
+  if (!kernelResult.isValid()) {
+    std::cout << "createKernel failed: " << kernelResult.getError()
+              << std::endl;
+    return 1;
+  }
+  Kernel axpb = kernelResult.getValue();
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  // double buffered: the CPU fills one input while the GPU reads the other
+  Buffer inputs[2];
+  Buffer outputs[2];
+  Buffer scratch[2];
+  for (int i = 0; i < 2; i++) {
+    inputs[i] = engine.createBuffer(kN * sizeof(float), usage,
+                                    MEM_CPU_VISIBLE_COHERENT)
+                    .getValue();
+    outputs[i] = engine.createBuffer(kN * sizeof(float), usage,
+                                     MEM_CPU_VISIBLE_COHERENT)
+                     .getValue();
+    scratch[i] =
+        engine.createBuffer(kN * sizeof(float), usage, MEM_GPU_ONLY)
+            .getValue();
+  }
+
+  std::vector<uint8_t> raw(kN);
+  for (uint32_t i = 0; i < kN; i++) {
+    raw[i] = uint8_t(i);
+  }
+
+  const PushConstants pc{kN, 1.0f, 1.0f};
+  const WorkGroups groups{groupCount(kN, 256)};
+
+  // in -> scratch -> ... -> out, each step adds one
+  auto record = [&](CommandStream &stream, int slot) {
+    stream.dispatch(axpb, {inputs[slot], scratch[slot]}, pc, groups);
+    for (int i = 1; i < kOpsPerFrame - 1; i++) {
+      stream.dispatch(axpb, {scratch[slot], scratch[slot]}, pc, groups);
+    }
+    stream.dispatch(axpb, {scratch[slot], outputs[slot]}, pc, groups);
+  };
+  auto check = [&](int slot, int frame) {
+    return std::fabs(static_cast<const float *>(outputs[slot]._mapped)[kN - 1] -
+                     float(raw[kN - 1] + frame + kOpsPerFrame)) < 1e-3f;
+  };
+
+  CommandStream stream(engine);
+  bool ok = true;
+
+  // preprocess -> submit -> wait, the GPU idles while the CPU works
+  auto start = Clock::now();
+  for (int frame = 0; frame < kFrames; frame++) {
+    preprocess(static_cast<float *>(inputs[0]._mapped), raw, frame);
+    record(stream, 0);
+    ok &= stream.submit() == VK_SUCCESS && check(0, frame);
+  }
+  double syncMs = msSince(start);
+
+  // frame N runs on the GPU while frame N + 1 is prepared
+  Ticket inFlight[2];
+  start = Clock::now();
+  for (int frame = 0; frame < kFrames; frame++) {
+    int slot = frame % 2;
+    // the input and output of this slot were last used two frames ago
+    if (inFlight[slot]._value != 0) {
+      ok &= engine.wait(inFlight[slot]) == VK_SUCCESS &&
+            check(slot, frame - 2);
+    }
+    preprocess(static_cast<float *>(inputs[slot]._mapped), raw, frame);
+    record(stream, slot);
+    // depends only on the slot's previous frame, so it may overlap the
+    // other slot's
+    auto ticket = stream.submitAsync({inFlight[slot]});
+    if (!ticket.isValid()) {
+      std::cout << "submitAsync failed: " << ticket.getError() << std::endl;
+      return 1;
+    }
+    inFlight[slot] = ticket.getValue();
+  }
+  for (int slot = 0; slot < 2; slot++) {
+    ok &= engine.wait(inFlight[slot]) == VK_SUCCESS &&
+          check(slot, kFrames - 2 + slot);
+  }
+  double asyncMs = msSince(start);
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << kFrames << " frames, " << kOpsPerFrame << " dispatches each, "
+            << kN << " floats\n";
+  std::cout << "  sync     " << std::setw(10) << syncMs << " ms  "
+            << std::setw(8) << syncMs / kFrames << " ms/frame\n";
+  std::cout << "  pipelined" << std::setw(10) << asyncMs << " ms  "
+            << std::setw(8) << asyncMs / kFrames << " ms/frame  ("
+            << syncMs / asyncMs << "x)\n";
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    engine.destroyBuffer(inputs[i]);
+    engine.destroyBuffer(outputs[i]);
+    engine.destroyBuffer(scratch[i]);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#include "engine.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <tuple>
+
+using namespace melkior::engine;
+
+namespace {
+
+struct PushConstants {
+  uint32_t N;
+  uint32_t stride;
+};
+
+enum Mode : uint32_t { COPY = 0, STRIDED = 1, GATHER = 2 };
+
+constexpr VkDeviceSize kMinBytes = 4 * 1024;
+constexpr uint32_t kDefaultLocalSize = 256;
+// enough repetitions that every measurement moves at least this much
+constexpr VkDeviceSize kBytesPerMeasurement = 256ull * 1024 * 1024;
+constexpr uint32_t kMinReps = 3;
+constexpr uint32_t kMaxReps = 200;
+
+struct Row {
+  std::string _op;
+  std::string _elem;
+  VkDeviceSize _bytes;
+  uint32_t _stride;
+  uint32_t _localSize;
+  uint32_t _reps;
+  KernelProfile _profile;
+};
+
+uint32_t repsFor(VkDeviceSize bytes) {
+  return static_cast<uint32_t>(std::clamp<VkDeviceSize>(
+      kBytesPerMeasurement / bytes, kMinReps, kMaxReps));
+}
+
+WorkGroups groupsFor(uint32_t n, uint32_t localSize, uint32_t maxX) {
+  uint32_t total = groupCount(n, localSize);
+  uint32_t x = std::min(total, maxX);
+  return {x, groupCount(total, x)};
+}
+
+} // namespace
+
+// Practical memory bandwidth of the device: shader copy, strided copy and
+// gather of u32 / vec4 elements, swept over buffer size, stride and
+// local_size_x, next to vkCmdCopyBuffer and vkCmdFillBuffer. Times come from
+// GPU timestamps and one CSV row is written per configuration.
+//
+//   bench_bandwidth [out.csv] [max MB]
+int main(int argc, char **argv) {
+  const std::string csvPath = argc > 1 ? argv[1] : "bandwidth.csv";
+  const VkDeviceSize maxBytes =
+      (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 512) * 1024 * 1024;
+
+  Engine engine("bench_bandwidth");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+  Profiler &profiler = engine.profiler();
+  if (!profiler.supported()) {
+    std::cout << "Timestamps are not supported on this queue" << std::endl;
+    return 1;
+  }
+  profiler.setEnabled(true);
+
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+  const auto &limits = props.limits;
+  const std::string device = props.deviceName;
+
+  const KernelSignature signature{
+      {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ},
+       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::WRITE},
+       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ}},
+      sizeof(PushConstants)};
+
+  std::map<std::tuple<std::string, uint32_t, uint32_t>, Kernel> kernels;
+  auto kernelFor = [&](const std::string &spv, uint32_t mode,
+                       uint32_t localSize) -> Kernel * {
+    auto key = std::make_tuple(spv, mode, localSize);
+    auto found = kernels.find(key);
+    if (found != kernels.end()) {
+      return &found->second;
+    }
+    Specialization spec;
+    spec.set(0, localSize).set(1, mode);
+    auto kernel = engine.createKernel(spv, signature, spec);
+    if (!kernel.isValid()) {
+      return nullptr;
+    }
+    return &kernels.emplace(key, kernel.getValue()).first->second;
+  };
+
+  std::vector<Row> rows;
+  CommandStream stream(engine);
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  std::mt19937 rng(42);
+
+  // runs what record() puts into the stream reps times, one GPU scope each
+  auto measure = [&](uint32_t reps, const auto &record) {
+    profiler.clear();
+    for (uint32_t r = 0; r < reps; r++) {
+      record();
+    }
+    stream.submit();
+    auto profiles = profiler.summary();
+    return profiles.empty() ? KernelProfile{} : profiles[0];
+  };
+
+  for (VkDeviceSize bytes = kMinBytes; bytes <= maxBytes; bytes *= 2) {
+    auto srcResult = engine.createBuffer(bytes, usage, MEM_GPU_ONLY);
+    auto dstResult = engine.createBuffer(bytes, usage, MEM_GPU_ONLY);
+    if (!srcResult.isValid() || !dstResult.isValid()) {
+      std::cout << "out of memory at " << bytes << " bytes" << std::endl;
+      break;
+    }
+    Buffer src = srcResult.getValue();
+    Buffer dst = dstResult.getValue();
+    const uint32_t reps = repsFor(bytes);
+
+    stream.fill(src, 0x3f800000);
+    stream.submit();
+
+    rows.push_back({"vkCmdCopyBuffer", "-", bytes, 1, 0, reps,
+                    measure(reps, [&] { stream.copy(src, dst); })});
+    rows.push_back({"vkCmdFillBuffer", "-", bytes, 1, 0, reps,
+                    measure(reps, [&] { stream.fill(dst, 0); })});
+
+    // a single binding can't be larger than maxStorageBufferRange
+    if (bytes > limits.maxStorageBufferRange) {
+      engine.destroyBuffer(src);
+      engine.destroyBuffer(dst);
+      continue;
+    }
+
+    for (const auto &[elem, elemSize] :
+         {std::pair<std::string, uint32_t>{"u32", 4},
+          std::pair<std::string, uint32_t>{"vec4", 16}}) {
+      const std::string spv = "bandwidth_" + elem + ".spv";
+      const uint32_t n = static_cast<uint32_t>(bytes / elemSize);
+
+      auto run = [&](const char *op, uint32_t mode, uint32_t stride,
+                     uint32_t localSize, const Buffer &indices,
+                     VkDeviceSize extraBytes) {
+        Kernel *kernel = kernelFor(spv, mode, localSize);
+        if (kernel == nullptr) {
+          std::cout << "createKernel failed for " << spv << std::endl;
+          return;
+        }
+        const PushConstants pc{n, stride};
+        const WorkGroups groups =
+            groupsFor(n, localSize, limits.maxComputeWorkGroupCount[0]);
+        const Cost cost{2 * bytes + extraBytes, 0};
+        rows.push_back({op, elem, bytes, stride, localSize, reps,
+                        measure(reps, [&] {
+                          stream.dispatch(*kernel, {src, dst, indices}, pc,
+                                          groups, cost);
+                        })});
+      };
+
+      // coalesced copy across work group sizes
+      for (uint32_t localSize : {32u, 64u, 128u, 256u, 512u, 1024u}) {
+        if (localSize <= limits.maxComputeWorkGroupInvocations &&
+            localSize <= limits.maxComputeWorkGroupSize[0]) {
+          run("copy", COPY, 1, localSize, src, 0);
+        }
+      }
+      for (uint32_t stride : {2u, 4u, 8u, 16u, 32u, 64u}) {
+        if (stride < n) {
+          run("strided", STRIDED, stride, kDefaultLocalSize, src, 0);
+        }
+      }
+
+      // random permutation, every element read exactly once
+      auto indicesResult = engine.createBuffer(
+          VkDeviceSize(n) * sizeof(uint32_t),
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MEM_CPU_VISIBLE_COHERENT);
+      if (!indicesResult.isValid()) {
+        continue;
+      }
+      Buffer indices = indicesResult.getValue();
+      auto *idx = static_cast<uint32_t *>(indices._mapped);
+      std::iota(idx, idx + n, 0u);
+      std::shuffle(idx, idx + n, rng);
+      run("gather", GATHER, 1, kDefaultLocalSize, indices,
+          VkDeviceSize(n) * sizeof(uint32_t));
+      engine.destroyBuffer(indices);
+    }
+
+    engine.destroyBuffer(src);
+    engine.destroyBuffer(dst);
+    std::cout << "." << std::flush;
+  }
+  std::cout << "\n";
+
+  std::ofstream csv(csvPath, std::ios::trunc);
+  if (!csv) {
+    std::cout << "cannot write " << csvPath << std::endl;
+    return 1;
+  }
+  csv << "device,op,elem,bytes,stride,local_size,reps,min_ms,mean_ms,p99_ms,"
+         "peak_gbps,mean_gbps\n";
+  std::map<std::string, double> peak;
+  for (const auto &row : rows) {
+    const auto &p = row._profile;
+    if (p._count == 0) {
+      continue;
+    }
+    // the profiler's rate is over the total time, report the best run too
+    double bytesPerRun = double(p._bytes) / p._count;
+    double peakGbps = p._minMs > 0.0 ? bytesPerRun / (p._minMs * 1e6) : 0.0;
+    csv << '"' << device << "\"," << row._op << "," << row._elem << ","
+        << row._bytes << "," << row._stride << "," << row._localSize << ","
+        << row._reps << "," << p._minMs << "," << p._meanMs << ","
+        << p._p99Ms << "," << peakGbps << "," << p._gbps << "\n";
+
+    std::string key = row._op + (row._elem == "-" ? "" : " " + row._elem);
+    peak[key] = std::max(peak[key], peakGbps);
+  }
+
+  std::cout << device << ", peak GB/s:\n" << std::fixed
+            << std::setprecision(2);
+  for (const auto &entry : peak) {
+    std::cout << "  " << std::left << std::setw(20) << entry.first
+              << std::right << std::setw(10) << entry.second << "\n";
+  }
+  std::cout << "results written to " << csvPath << "\n";
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include "engine.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+using namespace melkior::engine;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+struct PushConstants {
+  uint32_t N;
+  float a;
+  float b;
+};
+
+constexpr uint32_t kN = 4096;
+
+} // namespace
+
+int main() {
+  Engine engine("bench_command_stream");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const KernelSignature signature{
+      {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ},
+       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::WRITE}},
+      sizeof(PushConstants)};
+  auto kernelResult = engine.createKernel("axpb.spv", signature);
+  if (!kernelResult.isValid()) {
+    std::cout << "createKernel failed: " << kernelResult.getError()
+              << std::endl;
+    return 1;
+  }
+  Kernel axpb = kernelResult.getValue();
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  Buffer a = engine.createBuffer(kN * sizeof(float), usage,
+                                 MEM_CPU_VISIBLE_COHERENT)
+                 .getValue();
+  Buffer b = engine.createBuffer(kN * sizeof(float), usage,
+                                 MEM_CPU_VISIBLE_COHERENT)
+                 .getValue();
+
+  // x -> x + 1 per op, so the result of a chain of n ops is n
+  const PushConstants pc{kN, 1.0f, 1.0f};
+  const WorkGroups groups{groupCount(kN, 256)};
+
+  auto check = [&](int chain) {
+    const Buffer &last = chain % 2 ? b : a;
+    return std::fabs(static_cast<const float *>(last._mapped)[kN - 1] -
+                     float(chain)) < 1e-3f;
+  };
+
+  CommandStream stream(engine);
+
+  std::cout << std::setw(6) << "ops" << std::setw(14) << "per-op ms"
+            << std::setw(14) << "batched ms" << std::setw(10) << "speedup"
+            << std::setw(10) << "barriers" << "\n";
+
+  for (int chain : {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000}) {
+    // one vkQueueSubmit + vkWaitForFences per op
+    stream.fill(a, 0);
+    stream.submit();
+    auto start = Clock::now();
+    for (int i = 0; i < chain; i++) {
+      axpb.dispatch(i % 2 ? std::vector<Buffer>{b, a}
+                          : std::vector<Buffer>{a, b},
+                    pc, groups);
+    }
+    double perOpMs = msSince(start);
+    bool perOpOk = check(chain);
+
+    // the whole chain in one command buffer, one submit
+    stream.fill(a, 0);
+    stream.submit();
+    start = Clock::now();
+    for (int i = 0; i < chain; i++) {
+      stream.dispatch(axpb, i % 2 ? std::vector<Buffer>{b, a}
+                                  : std::vector<Buffer>{a, b},
+                      pc, groups);
+    }
+    uint32_t barriers = stream.barrierCount();
+    VkResult result = stream.submit();
+    double batchedMs = msSince(start);
+    bool batchedOk = result == VK_SUCCESS && check(chain);
+
+    std::cout << std::setw(6) << chain << std::setw(14) << perOpMs
+              << std::setw(14) << batchedMs << std::setw(9)
+              << perOpMs / batchedMs << "x" << std::setw(10) << barriers
+              << ((perOpOk && batchedOk) ? "" : "  MISMATCH") << "\n";
+  }
+
+  engine.destroyBuffer(a);
+  engine.destroyBuffer(b);
+  return 0;
+}
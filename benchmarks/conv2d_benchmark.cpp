@@ -0,0 +1,128 @@
+#include "conv2d.hpp"
+#include "engine.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+struct Layer {
+  std::string _name;
+  Conv2dShape _shape;
+};
+
+} // namespace
+
+// Image filters on a 1080p RGB frame and typical small-CNN layers, every
+// one with bias + ReLU fused, through each weight path that holds its
+// weights. Prints ms per call and GFLOP/s.
+int main() {
+  Engine engine("bench_conv2d");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  std::vector<Layer> layers;
+  for (uint32_t k : {3u, 5u, 9u}) {
+    Conv2dShape s = Conv2dShape::same(3, 1080, 1920, 3, k, 3);
+    s._layout = TensorLayout::NHWC;
+    layers.push_back(
+        {"rgb 1080p " + std::to_string(k) + "x" + std::to_string(k), s});
+  }
+  layers.push_back({"3x3 16->16 224", Conv2dShape::same(16, 224, 224, 16, 3)});
+  layers.push_back({"3x3 32->32 112", Conv2dShape::same(32, 112, 112, 32, 3)});
+  layers.push_back({"3x3 64->64 56", Conv2dShape::same(64, 56, 56, 64, 3)});
+  layers.push_back({"1x1 128->128 28", Conv2dShape::same(128, 28, 28, 128, 1)});
+  {
+    Conv2dShape s = Conv2dShape::same(32, 112, 112, 64, 3);
+    s._strideY = 2;
+    s._strideX = 2;
+    layers.push_back({"3x3/2 32->64 112", s});
+  }
+  {
+    Conv2dShape s = Conv2dShape::same(64, 56, 56, 64, 3);
+    s._layout = TensorLayout::NHWC;
+    layers.push_back({"3x3 64->64 56 nhwc", s});
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  const WeightStorage storages[] = {WeightStorage::PUSH_CONSTANTS,
+                                    WeightStorage::UNIFORM,
+                                    WeightStorage::STORAGE};
+  std::cout << std::setw(22) << "layer" << std::setw(18) << "push"
+            << std::setw(18) << "uniform" << std::setw(18) << "storage"
+            << "   ms (GFLOP/s)\n"
+            << std::fixed << std::setprecision(2);
+
+  for (const Layer &layer : layers) {
+    const Conv2dShape &s = layer._shape;
+    std::vector<float> weights(s.weightCount(), 0.01f);
+    std::vector<float> bias(s._filters, 0.1f);
+    Buffer input = engine
+                       .createBuffer(s.inputCount() * sizeof(float), usage,
+                                     MEM_GPU_ONLY)
+                       .getValue();
+    Buffer output = engine
+                        .createBuffer(s.outputCount() * sizeof(float), usage,
+                                      MEM_GPU_ONLY)
+                        .getValue();
+    stream.fill(input, 0);
+
+    std::cout << std::setw(22) << layer._name;
+    for (WeightStorage storage : storages) {
+      auto convResult = Conv2d::create(engine, s, weights, bias,
+                                       {Activation::RELU}, storage);
+      if (!convResult.isValid()) {
+        // weights don't fit this path
+        std::cout << std::setw(18) << "-";
+        continue;
+      }
+      Conv2d conv = convResult.getValue();
+      double ms = time([&] { conv.record(stream, input, output); });
+      std::cout << std::setw(8) << ms << " (" << std::setw(7)
+                << s.flops() / (ms * 1e6) << ")";
+      conv.destroy();
+    }
+    std::cout << "\n";
+
+    engine.destroyBuffer(input);
+    engine.destroyBuffer(output);
+  }
+
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include "elementwise.hpp"
+#include "engine.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+} // namespace
+
+// Every elementwise op on 16M elements of each type, plain and masked, as
+// ms per call, effective GB/s (inputs, mask and output touched once) and
+// the share of the bandwidth ceiling, measured as a 64 MiB buffer copy.
+int main() {
+  Engine engine("bench_elementwise");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const uint32_t count = 1u << 24;
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const VkDeviceSize bytes = Elementwise::bufferSize(ElementType::FLOAT32,
+                                                     count);
+  Buffer a = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer b = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer out = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer mask = engine
+                    .createBuffer(Elementwise::bufferSize(ElementType::UINT8,
+                                                          count),
+                                  usage, MEM_GPU_ONLY)
+                    .getValue();
+  CommandStream stream(engine);
+  bool ok = true;
+  // 0.5f and 1.0f; the other types just see the bit patterns
+  stream.fill(a, 0x3f000000u);
+  stream.fill(b, 0x3f800000u);
+  stream.fill(mask, 0x01000100u); // every other element
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  const double copyMs = time([&] { stream.copy(a, out, bytes); });
+  const double ceiling = 2.0 * bytes / (copyMs * 1e6);
+  std::cout << std::fixed << std::setprecision(2) << "ceiling (copy): "
+            << ceiling << " GB/s\n"
+            << std::setw(16) << "op" << std::setw(26) << "plain"
+            << std::setw(26) << "masked"
+            << "   ms (GB/s, % of ceiling)\n";
+
+  const char *opNames[] = {"add", "saxpy", "relu", "clamp", "tanh", "sigmoid"};
+  const char *typeNames[] = {"fp32", "fp16", "int32", "uint8"};
+  for (ElementType type : {ElementType::FLOAT32, ElementType::FLOAT16,
+                           ElementType::INT32, ElementType::UINT8}) {
+    for (ElementwiseOp op :
+         {ElementwiseOp::ADD, ElementwiseOp::SAXPY, ElementwiseOp::RELU,
+          ElementwiseOp::CLAMP, ElementwiseOp::TANH, ElementwiseOp::SIGMOID}) {
+      if (!Elementwise::supports(op, type)) {
+        continue;
+      }
+      auto created = Elementwise::create(engine, op, type);
+      if (!created.isValid()) {
+        std::cout << "Elementwise::create failed" << std::endl;
+        return 1;
+      }
+      Elementwise elementwise = created.getValue();
+      std::cout << std::setw(16)
+                << (std::string(opNames[int(op)]) + " " +
+                    typeNames[int(type)]);
+      for (bool masked : {false, true}) {
+        const bool binary = Elementwise::binary(op);
+        double ms = time([&] {
+          if (masked && binary) {
+            elementwise.recordMasked(stream, a, b, mask, out, count);
+          } else if (masked) {
+            elementwise.recordMasked(stream, a, mask, out, count);
+          } else if (binary) {
+            elementwise.record(stream, a, b, out, count);
+          } else {
+            elementwise.record(stream, a, out, count);
+          }
+        });
+        const double gbs = elementwise.bytes(count, masked) / (ms * 1e6);
+        std::cout << std::setw(8) << ms << " (" << std::setw(6) << gbs << ", "
+                  << std::setw(5) << 100.0 * gbs / ceiling << "%)";
+      }
+      std::cout << "\n";
+    }
+  }
+
+  for (Buffer buffer : {a, b, out, mask}) {
+    engine.destroyBuffer(buffer);
+  }
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+#include "engine.hpp"
+#include "fft.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+// output bins checked against the double precision DFT per size
+constexpr uint32_t kCheckedBins = 64;
+
+// max |gpu - dft| / max |dft| over kCheckedBins bins of one transform
+double relativeError(const std::complex<float> *x,
+                     const std::complex<float> *y, uint32_t n) {
+  double maxError = 0.0;
+  double maxValue = 0.0;
+  const uint32_t step = std::max(1u, n / kCheckedBins);
+  for (uint32_t k = 0; k < n; k += step) {
+    std::complex<double> sum = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+      double angle = -2.0 * 3.14159265358979323846 * (uint64_t(i) * k % n) / n;
+      sum += std::complex<double>(x[i]) *
+             std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+    maxError = std::max(maxError, std::abs(std::complex<double>(y[k]) - sum));
+    maxValue = std::max(maxValue, std::abs(sum));
+  }
+  return maxError / maxValue;
+}
+
+} // namespace
+
+// Forward complex fp32 FFTs: batches of 1024 points, the signal processing
+// case, then a sweep up to sizes that need one dispatch per Stockham pass,
+// each with radix 2, 4 and 8. GFLOP/s counts 5 N log2(N) per transform,
+// the error is relative to a double precision DFT of the last transform.
+int main() {
+  Engine engine("bench_fft");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+  auto fftResult = Fft::create(engine);
+  if (!fftResult.isValid()) {
+    std::cout << "Fft::create failed" << std::endl;
+    return 1;
+  }
+  Fft fft = fftResult.getValue();
+  std::cout << "single dispatch up to " << fft.maxSharedSize() << " points\n";
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  std::cout << std::setw(9) << "size" << std::setw(7) << "batch"
+            << std::setw(7) << "radix" << std::setw(11) << "dispatches"
+            << std::setw(10) << "ms" << std::setw(10) << "GFLOP/s"
+            << std::setw(12) << "FFTs/s" << std::setw(11) << "rel error"
+            << "\n";
+
+  struct Case {
+    uint32_t _size;
+    uint32_t _batch;
+  };
+  const Case cases[] = {{1024, 1},       {1024, 64},      {1024, 4096},
+                        {64, 65536},     {256, 16384},    {4096, 1024},
+                        {1u << 14, 256}, {1u << 16, 64},  {1u << 20, 4},
+                        {1u << 22, 1}};
+
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<std::complex<float>> signal;
+  std::vector<std::complex<float>> result;
+  for (const Case &c : cases) {
+    signal.resize(size_t(c._size) * c._batch);
+    for (auto &x : signal) {
+      x = {dist(rng), dist(rng)};
+    }
+    const VkDeviceSize bytes = signal.size() * sizeof(signal[0]);
+    Buffer in = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer out = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer scratch = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    stream.upload(in, signal.data(), bytes);
+
+    for (uint32_t radix : {2u, 4u, 8u}) {
+      auto planResult =
+          fft.plan(c._size, c._batch, FftDirection::FORWARD, radix);
+      if (!planResult.isValid()) {
+        std::cout << "Fft::plan failed" << std::endl;
+        return 1;
+      }
+      FftPlan plan = planResult.getValue();
+      double ms = time([&] { plan.record(stream, in, out, scratch); });
+
+      result.resize(signal.size());
+      stream.readback(out, result.data(), bytes);
+      ok &= stream.submit() == VK_SUCCESS;
+      const size_t last = size_t(c._size) * (c._batch - 1);
+      double error =
+          relativeError(signal.data() + last, result.data() + last, c._size);
+      ok &= error < 1e-5;
+
+      std::cout << std::setw(9) << c._size << std::setw(7) << c._batch
+                << std::setw(7) << radix << std::setw(11)
+                << (plan.singleDispatch() ? 1 : plan.radices().size())
+                << std::fixed << std::setprecision(3) << std::setw(10) << ms
+                << std::setprecision(2) << std::setw(10)
+                << plan.flops() / (ms * 1e6) << std::setprecision(0)
+                << std::setw(12) << c._batch / (ms * 1e-3)
+                << std::scientific << std::setprecision(2) << std::setw(11)
+                << error << std::defaultfloat << "\n";
+    }
+
+    engine.destroyBuffer(in);
+    engine.destroyBuffer(out);
+    engine.destroyBuffer(scratch);
+  }
+
+  fft.destroy();
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+#include "elementwise.hpp"
+#include "engine.hpp"
+#include "fusion.hpp"
+#include "reduce.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+// the chain cycles through these, the first op is always a SAXPY
+const ElementwiseOp kChain[] = {ElementwiseOp::SAXPY, ElementwiseOp::RELU,
+                                ElementwiseOp::CLAMP, ElementwiseOp::TANH};
+
+// the same chain as one expression; params are alpha, lo, hi
+Expr chainExpr(uint32_t depth) {
+  const Expr b = Expr::input(1);
+  Expr y = Expr::input(0);
+  for (uint32_t k = 0; k < depth; k++) {
+    switch (kChain[k % 4]) {
+    case ElementwiseOp::SAXPY:
+      y = Expr::param(0) * y + b;
+      break;
+    case ElementwiseOp::RELU:
+      y = relu(y);
+      break;
+    case ElementwiseOp::CLAMP:
+      y = clamp(y, Expr::param(1), Expr::param(2));
+      break;
+    default:
+      y = tanh(y);
+      break;
+    }
+  }
+  return y;
+}
+
+} // namespace
+
+// Elementwise chains of depth 2-16 on 16M fp32 elements (SAXPY, ReLU,
+// clamp, tanh, repeating), once as one Elementwise kernel per op and once
+// as a single FusedKernel, plain and followed by a sum. Reports ms per
+// chain, the fused speedup and the fused kernel's GB/s against the copy
+// ceiling, and checks both give the same result.
+int main() {
+  Engine engine("bench_fusion");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const uint32_t count = 1u << 24;
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const VkDeviceSize bytes = FusedKernel::bufferSize(count);
+  Buffer a = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer b = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer chained = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer fusedOut = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer pairs =
+      engine.createBuffer(sizeof(ReducePair), usage, MEM_GPU_ONLY).getValue();
+  Buffer scratch = engine
+                       .createBuffer(std::max<VkDeviceSize>(
+                                         Reduction::scratchSize(count), 16),
+                                     usage, MEM_GPU_ONLY)
+                       .getValue();
+  CommandStream stream(engine);
+  bool ok = true;
+  stream.fill(a, 0x3f000000u); // 0.5f
+  stream.fill(b, 0xbe800000u); // -0.25f
+
+  const ElementwiseScalars scalars{1.5, -0.5, 0.75};
+  const std::vector<float> params = {1.5f, -0.5f, 0.75f};
+  Elementwise ops[4];
+  for (uint32_t i = 0; i < 4; i++) {
+    auto created = Elementwise::create(engine, kChain[i], ElementType::FLOAT32);
+    if (!created.isValid()) {
+      std::cout << "Elementwise::create failed" << std::endl;
+      return 1;
+    }
+    ops[i] = created.getValue();
+  }
+  auto sumCreated = Reduction::create(engine, ReduceOp::SUM);
+  if (!sumCreated.isValid()) {
+    std::cout << "Reduction::create failed" << std::endl;
+    return 1;
+  }
+  const Reduction sum = sumCreated.getValue();
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  // one kernel per op, the first reads a and b, the rest work in place
+  auto recordChain = [&](uint32_t depth) {
+    for (uint32_t k = 0; k < depth; k++) {
+      const Elementwise &op = ops[k % 4];
+      const Buffer &in = k == 0 ? a : chained;
+      if (Elementwise::binary(op.op())) {
+        op.record(stream, in, b, chained, count, scalars);
+      } else {
+        op.record(stream, in, chained, count, scalars);
+      }
+    }
+  };
+
+  const double copyMs = time([&] { stream.copy(a, chained, bytes); });
+  const double ceiling = 2.0 * bytes / (copyMs * 1e6);
+  std::cout << std::fixed << std::setprecision(2) << "ceiling (copy): "
+            << ceiling << " GB/s\n"
+            << std::setw(6) << "depth" << std::setw(12) << "unfused"
+            << std::setw(12) << "fused" << std::setw(10) << "speedup"
+            << std::setw(12) << "+sum unf." << std::setw(12) << "+sum fused"
+            << std::setw(10) << "speedup" << std::setw(16) << "fused GB/s"
+            << std::setw(12) << "compile" << "\n";
+
+  for (uint32_t depth : {2u, 4u, 6u, 8u, 10u, 12u, 14u, 16u}) {
+    const Expr expr = chainExpr(depth);
+    const FusionCacheStats before = FusedKernel::cacheStats();
+    auto fusedCreated = FusedKernel::create(engine, expr);
+    auto fusedSumCreated = FusedKernel::create(engine, expr, FusedReduce::SUM);
+    if (!fusedCreated.isValid() || !fusedSumCreated.isValid()) {
+      std::cout << "FusedKernel::create failed" << std::endl;
+      return 1;
+    }
+    const FusionCacheStats after = FusedKernel::cacheStats();
+    FusedKernel fused = fusedCreated.getValue();
+    FusedKernel fusedSum = fusedSumCreated.getValue();
+
+    const double unfusedMs = time([&] { recordChain(depth); });
+    const double fusedMs =
+        time([&] { fused.record(stream, {a, b}, fusedOut, count, params); });
+    const double unfusedSumMs = time([&] {
+      recordChain(depth);
+      sum.record(stream, chained, pairs, scratch, count);
+    });
+    const double fusedSumMs = time(
+        [&] { fusedSum.record(stream, {a, b}, pairs, count, params); });
+
+    // both versions once more, the results side by side
+    std::vector<float> chainResult(bytes / 4);
+    std::vector<float> fusedResult(bytes / 4);
+    ReducePair sums[2] = {};
+    recordChain(depth);
+    sum.record(stream, chained, pairs, scratch, count);
+    fused.record(stream, {a, b}, fusedOut, count, params);
+    stream.readback(pairs, &sums[0], sizeof(ReducePair));
+    fusedSum.record(stream, {a, b}, pairs, count, params);
+    stream.readback(pairs, &sums[1], sizeof(ReducePair));
+    stream.readback(chained, chainResult.data(), bytes);
+    stream.readback(fusedOut, fusedResult.data(), bytes);
+    ok &= stream.submit() == VK_SUCCESS;
+    double maxError = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+      maxError = std::max(maxError,
+                          double(std::abs(chainResult[i] - fusedResult[i])));
+    }
+    // the sums fold in different orders
+    const double sumError = std::abs(sums[0]._value - sums[1]._value) /
+                            std::max(1.0f, std::abs(sums[0]._value));
+    ok &= maxError < 1e-5 && sumError < 1e-3;
+
+    const double gbs = fused.bytes(count) / (fusedMs * 1e6);
+    std::cout << std::setw(6) << depth << std::setw(12) << unfusedMs
+              << std::setw(12) << fusedMs << std::setw(9)
+              << unfusedMs / fusedMs << "x" << std::setw(12) << unfusedSumMs
+              << std::setw(12) << fusedSumMs << std::setw(9)
+              << unfusedSumMs / fusedSumMs << "x" << std::setw(8) << gbs
+              << " (" << std::setw(3) << int(100.0 * gbs / ceiling) << "%)"
+              << std::setw(9) << after._compileMs - before._compileMs
+              << " ms\n";
+    fused.destroy();
+    fusedSum.destroy();
+  }
+
+  const FusionCacheStats stats = FusedKernel::cacheStats();
+  std::cout << "kernels compiled: " << stats._compiled << ", from disk "
+            << stats._diskHits << ", from memory " << stats._memoryHits
+            << "\n";
+  for (Buffer buffer : {a, b, chained, fusedOut, pairs, scratch}) {
+    engine.destroyBuffer(buffer);
+  }
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
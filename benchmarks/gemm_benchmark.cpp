@@ -0,0 +1,275 @@
+#include "engine.hpp"
+#include "gemm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// same layout as gemm.comp and gemm_naive.comp
+struct PushConstants {
+  uint32_t M;
+  uint32_t N;
+  uint32_t K;
+  uint32_t lda;
+  uint32_t ldb;
+  uint32_t ldc;
+  uint32_t strideA;
+  uint32_t strideB;
+  uint32_t strideC;
+  float alpha;
+  float beta;
+};
+
+constexpr int kIterations = 10;
+// the CPU reference gets slow quickly, larger sizes are only checked on
+// a few rows
+constexpr uint32_t kCpuMax = 512;
+
+uint16_t toHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+  uint32_t mantissa = bits & 0x7FFFFFu;
+  if (exponent <= 0) {
+    return static_cast<uint16_t>(sign);
+  }
+  if (exponent >= 31) {
+    return static_cast<uint16_t>(sign | 0x7C00u);
+  }
+  // round to nearest
+  uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+  return static_cast<uint16_t>(half + ((mantissa >> 12) & 1u));
+}
+
+float fromHalf(uint16_t value) {
+  uint32_t sign = uint32_t(value & 0x8000u) << 16;
+  uint32_t exponent = (value >> 10) & 0x1Fu;
+  uint32_t mantissa = value & 0x3FFu;
+  uint32_t bits = sign;
+  if (exponent == 31) {
+    bits |= 0x7F800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits |= ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+// i-k-j order, rows [0, rows) only
+void cpuGemm(const float *a, const float *b, float *c, uint32_t n,
+             uint32_t rows) {
+  for (uint32_t i = 0; i < rows; i++) {
+    std::fill(c + size_t(i) * n, c + size_t(i + 1) * n, 0.0f);
+    for (uint32_t k = 0; k < n; k++) {
+      float aik = a[size_t(i) * n + k];
+      const float *bk = b + size_t(k) * n;
+      float *ci = c + size_t(i) * n;
+      for (uint32_t j = 0; j < n; j++) {
+        ci[j] += aik * bk[j];
+      }
+    }
+  }
+}
+
+double gflops(uint64_t flops, double ms) { return flops / (ms * 1e6); }
+
+} // namespace
+
+// GFLOP/s of the tuned GEMM (fp32, and fp16 where supported) next to a
+// one-thread-per-output kernel and a single threaded CPU loop, for square
+// matrices and a batch of small ones. Every GPU result is checked against
+// the CPU on its first rows.
+int main() {
+  Engine engine("bench_gemm");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  // tuning is explicit, create() only reads the stored tile
+  Gemm::autotune(engine, GemmPrecision::FP32);
+  if (engine.float16Supported()) {
+    Gemm::autotune(engine, GemmPrecision::FP16);
+  }
+  auto gemm32 = Gemm::create(engine, GemmPrecision::FP32);
+  if (!gemm32.isValid()) {
+    std::cout << "Gemm::create failed: " << gemm32.getError() << std::endl;
+    return 1;
+  }
+  auto gemm16 = Gemm::create(engine, GemmPrecision::FP16);
+
+  const KernelSignature signature{
+      {STORAGE_READ, STORAGE_READ, STORAGE_READ_WRITE}, sizeof(PushConstants)};
+  auto naiveResult = engine.createKernel("gemm_naive.spv", signature);
+  if (!naiveResult.isValid()) {
+    std::cout << "createKernel failed: " << naiveResult.getError()
+              << std::endl;
+    return 1;
+  }
+  Kernel naive = naiveResult.getValue();
+
+  const GemmTile &tile = gemm32.getValue().tile();
+  std::cout << "fp32 tile " << tile._m << "x" << tile._n << "x" << tile._k
+            << ", micro-tile " << tile._threadM << "x" << tile._threadN
+            << "\n";
+  if (gemm16.isValid()) {
+    const GemmTile &tile16 = gemm16.getValue().tile();
+    std::cout << "fp16 tile " << tile16._m << "x" << tile16._n << "x"
+              << tile16._k << ", micro-tile " << tile16._threadM << "x"
+              << tile16._threadN << "\n";
+  } else {
+    std::cout << "fp16 not supported on this device\n";
+  }
+
+  std::cout << "\n"
+            << std::setw(6) << "n" << std::setw(7) << "batch" << std::setw(12)
+            << "tiled f32" << std::setw(12) << "tiled f16" << std::setw(12)
+            << "naive" << std::setw(12) << "cpu" << std::setw(12)
+            << "max err"
+            << "   GFLOP/s\n";
+  std::cout << std::fixed;
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  bool ok = true;
+
+  struct Case {
+    uint32_t _n;
+    uint32_t _batch;
+  };
+  for (Case test : {Case{128, 1}, Case{256, 1}, Case{512, 1}, Case{1024, 1},
+                    Case{2048, 1}, Case{64, 256}}) {
+    const uint32_t n = test._n;
+    const uint32_t batch = test._batch;
+    const size_t count = size_t(n) * n * batch;
+    const uint64_t flops = 2ull * n * n * n * batch;
+    const GemmShape shape = GemmShape::packed(n, n, n, batch);
+    const PushConstants pc{shape._m,       shape._n,       shape._k,
+                           shape._lda,     shape._ldb,     shape._ldc,
+                           shape._strideA, shape._strideB, shape._strideC,
+                           shape._alpha,   shape._beta};
+
+    std::vector<float> a(count);
+    std::vector<float> b(count);
+    for (size_t i = 0; i < count; i++) {
+      a[i] = float((i * 7) % 13) / 13.0f - 0.5f;
+      b[i] = float((i * 5) % 11) / 11.0f - 0.5f;
+    }
+
+    // CPU on the first matrix of the batch; its time is scaled up to the
+    // whole problem when only some rows were computed
+    const uint32_t rows = n <= kCpuMax ? n : 8;
+    std::vector<float> reference(size_t(n) * rows);
+    auto cpuStart = Clock::now();
+    cpuGemm(a.data(), b.data(), reference.data(), n, rows);
+    double cpuMs = msSince(cpuStart) * (double(n) / rows) * batch;
+
+    const VkDeviceSize bytes = count * sizeof(float);
+    Buffer bufA = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer bufB = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer bufC = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    std::vector<float> c(size_t(n) * rows);
+
+    double maxErr = 0.0;
+    auto check = [&](const std::vector<float> &got) {
+      for (size_t i = 0; i < got.size(); i++) {
+        maxErr = std::max(maxErr, double(std::fabs(got[i] - reference[i])));
+      }
+    };
+    auto time = [&](const std::function<void()> &record) {
+      record();
+      ok &= stream.submit() == VK_SUCCESS;
+      auto start = Clock::now();
+      for (int i = 0; i < kIterations; i++) {
+        record();
+      }
+      ok &= stream.submit() == VK_SUCCESS;
+      return msSince(start) / kIterations;
+    };
+
+    stream.upload(bufA, a.data(), bufA._size);
+    stream.upload(bufB, b.data(), bufB._size);
+    double tiledMs = time([&] {
+      gemm32.getValue().record(stream, bufA, bufB, bufC, shape);
+    });
+    stream.readback(bufC, c.data(), c.size() * 4);
+    ok &= stream.submit() == VK_SUCCESS;
+    check(c);
+
+    double naiveMs = time([&] {
+      stream.dispatch(naive, {bufA, bufB, bufC}, pc,
+                      {groupCount(n, 16), groupCount(n, 16), batch});
+    });
+    stream.readback(bufC, c.data(), c.size() * 4);
+    ok &= stream.submit() == VK_SUCCESS;
+    check(c);
+
+    double halfMs = 0.0;
+    double halfErr = 0.0;
+    if (gemm16.isValid()) {
+      std::vector<uint16_t> a16(count);
+      std::vector<uint16_t> b16(count);
+      for (size_t i = 0; i < count; i++) {
+        a16[i] = toHalf(a[i]);
+        b16[i] = toHalf(b[i]);
+      }
+      std::vector<uint16_t> c16(c.size());
+      stream.upload(bufA, a16.data(), count * 2);
+      stream.upload(bufB, b16.data(), count * 2);
+      halfMs = time([&] {
+        gemm16.getValue().record(stream, bufA, bufB, bufC, shape);
+      });
+      stream.readback(bufC, c16.data(), c16.size() * 2);
+      ok &= stream.submit() == VK_SUCCESS;
+      // rounding the inputs and the output to fp16 loses far more than
+      // the fp32 paths, so this is only reported
+      for (size_t i = 0; i < c16.size(); i++) {
+        halfErr = std::max(
+            halfErr, double(std::fabs(fromHalf(c16[i]) - reference[i])));
+      }
+    }
+
+    std::cout << std::setw(6) << n << std::setw(7) << batch
+              << std::setprecision(2) << std::setw(12)
+              << gflops(flops, tiledMs) << std::setw(12)
+              << (halfMs > 0.0 ? gflops(flops, halfMs) : 0.0)
+              << std::setw(12) << gflops(flops, naiveMs) << std::setw(12)
+              << gflops(flops, cpuMs) << std::setprecision(6)
+              << std::setw(12) << maxErr;
+    if (halfMs > 0.0) {
+      std::cout << "   f16 err " << std::setprecision(4) << halfErr;
+    }
+    std::cout << "\n";
+    // fp32 sums of n products of magnitude <= 0.25 in a different order
+    ok &= maxErr <= 1e-5 * n;
+
+    engine.destroyBuffer(bufA);
+    engine.destroyBuffer(bufB);
+    engine.destroyBuffer(bufC);
+  }
+
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
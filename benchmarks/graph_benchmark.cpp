@@ -0,0 +1,167 @@
+#include "engine.hpp"
+#include "graph.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+} // namespace
+
+// BFS, connected components and PageRank on a power-law graph of 1M
+// vertices and ~8M edges. BFS is timed with a submission per level, per 8
+// and per 32 levels, and with the whole search in one command buffer, as ms
+// and million traversed edges per second. PageRank is timed at a fixed 20
+// iterations (tolerance 0) as ms per iteration and GB/s, then to
+// convergence in one submission.
+int main() {
+  Engine engine("bench_graph");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const uint32_t vertices = 1u << 20;
+  std::mt19937 rng(22);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<uint32_t> sources;
+  std::vector<uint32_t> targets;
+  for (uint32_t v = 0; v < vertices; v++) {
+    // mean degree ~8, a few hubs with tens of thousands of edges
+    const uint32_t degree = uint32_t(std::pow(unit(rng), 8.0) * 72.0);
+    for (uint32_t i = 0; i < degree; i++) {
+      sources.push_back(v);
+      targets.push_back(uint32_t(std::pow(unit(rng), 3.0) * vertices));
+    }
+  }
+  auto graphResult = Graph::upload(engine, vertices, sources, targets);
+  if (!graphResult.isValid()) {
+    std::cout << "Graph::upload failed" << std::endl;
+    return 1;
+  }
+  Graph graph = graphResult.getValue();
+  auto bfsResult = Bfs::create(engine, graph);
+  auto ccResult = ConnectedComponents::create(engine, graph);
+  auto tolerantResult = PageRank::create(engine, graph);
+  auto fixedResult = PageRank::create(engine, graph, 0.85f, 0.0f);
+  if (!bfsResult.isValid() || !ccResult.isValid() ||
+      !tolerantResult.isValid() || !fixedResult.isValid()) {
+    std::cout << "graph kernel setup failed" << std::endl;
+    return 1;
+  }
+  Bfs bfs = bfsResult.getValue();
+  ConnectedComponents cc = ccResult.getValue();
+  PageRank tolerant = tolerantResult.getValue();
+  PageRank fixed = fixedResult.getValue();
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  Buffer levels =
+      engine.createBuffer(vertices * 4ull, usage, MEM_GPU_ONLY).getValue();
+  Buffer labels =
+      engine.createBuffer(vertices * 4ull, usage, MEM_GPU_ONLY).getValue();
+  Buffer ranks =
+      engine.createBuffer(vertices * 4ull, usage, MEM_GPU_ONLY).getValue();
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+  // runs that read state back in between submit on their own
+  auto timeRuns = [&](const std::function<void()> &run) {
+    run();
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      run();
+    }
+    return msSince(start) / kIterations;
+  };
+
+  std::cout << std::fixed << std::setprecision(2) << "graph: " << vertices
+            << " vertices, " << graph._edges << " edges\n";
+
+  auto bfsState = bfs.run(stream, 0, levels);
+  ok &= bfsState.isValid();
+  const BfsState searched = bfsState.isValid() ? bfsState.getValue()
+                                               : BfsState{};
+  std::cout << "bfs: depth " << searched._depth << ", " << searched._visited
+            << " reached\n";
+  for (uint32_t batch : {1u, 8u, 32u}) {
+    double ms = timeRuns(
+        [&] { ok &= bfs.run(stream, 0, levels, batch).isValid(); });
+    std::cout << std::setw(28)
+              << ("levels per submission " + std::to_string(batch))
+              << std::setw(10) << ms << " ms" << std::setw(10)
+              << graph._edges / (ms * 1e3) << " MTEPS\n";
+  }
+  {
+    // every level the search needs plus slack, recorded up front
+    const uint32_t depth = searched._depth + 4;
+    double ms = time([&] { bfs.record(stream, 0, levels, depth); });
+    std::cout << std::setw(28) << "one submission" << std::setw(10) << ms
+              << " ms" << std::setw(10) << graph._edges / (ms * 1e3)
+              << " MTEPS\n";
+  }
+
+  {
+    auto ccState = cc.run(stream, labels);
+    ok &= ccState.isValid();
+    const uint32_t passes =
+        ccState.isValid() ? ccState.getValue()._iterations : 0;
+    double ms = time([&] { cc.record(stream, labels, passes + 1); });
+    std::cout << "components: " << passes << " passes, " << ms << " ms\n";
+  }
+
+  {
+    double ms = time([&] { fixed.record(stream, ranks, 20); }) / 20;
+    std::cout << "pagerank: " << ms << " ms per iteration, "
+              << fixed.bytesPerIteration() / (ms * 1e6) << " GB/s\n";
+    PageRankState state{};
+    ms = time([&] { tolerant.record(stream, ranks, 100); });
+    stream.readback(tolerant.state(), &state, sizeof(state));
+    ok &= stream.submit() == VK_SUCCESS;
+    ok &= state._converged != 0;
+    std::cout << "pagerank to 1e-6: " << state._iterations << " iterations, "
+              << ms << " ms in one submission\n";
+  }
+
+  for (Buffer buffer : {levels, labels, ranks}) {
+    engine.destroyBuffer(buffer);
+  }
+  bfs.destroy();
+  cc.destroy();
+  tolerant.destroy();
+  fixed.destroy();
+  graph.destroy(engine);
+
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
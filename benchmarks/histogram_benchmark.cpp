@@ -0,0 +1,136 @@
+#include "engine.hpp"
+#include "histogram.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+double gbps(uint64_t bytes, double ms) { return bytes / (ms * 1e6); }
+
+} // namespace
+
+// Histograms of a 4K RGBA frame and of 4K fp32 luma in 256 and 4096 bins,
+// on uniform random input and on an image of one single value, where every
+// count lands in the same bin. Global atomics, privatized and privatized +
+// aggregated, as ms per frame and GB/s of input.
+int main() {
+  Engine engine("bench_histogram");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+  const HistogramMode modes[] = {HistogramMode::GLOBAL_ATOMICS,
+                                 HistogramMode::PRIVATIZED,
+                                 HistogramMode::AGGREGATED};
+  std::vector<Histogram> histograms;
+  for (HistogramMode mode : modes) {
+    auto histogram = Histogram::create(engine, mode);
+    if (!histogram.isValid()) {
+      std::cout << "Histogram::create failed" << std::endl;
+      return 1;
+    }
+    histograms.push_back(histogram.getValue());
+  }
+
+  const uint32_t W = 3840;
+  const uint32_t H = 2160;
+  const uint32_t pixels = W * H;
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  Buffer image =
+      engine.createBuffer(pixels * 4, usage, MEM_GPU_ONLY).getValue();
+  Buffer luma = engine.createBuffer(pixels * sizeof(float), usage, MEM_GPU_ONLY)
+                    .getValue();
+  Buffer counts =
+      engine.createBuffer(4096 * sizeof(uint32_t), usage, MEM_GPU_ONLY)
+          .getValue();
+
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  std::cout << std::setw(16) << "input" << std::setw(10) << "bins"
+            << std::setw(14) << "global" << std::setw(14) << "privatized"
+            << std::setw(14) << "aggregated" << "   ms (GB/s)\n"
+            << std::fixed << std::setprecision(2);
+
+  std::mt19937 rng(17);
+  std::vector<uint32_t> rgba(pixels);
+  std::vector<float> values(pixels);
+  for (bool skewed : {false, true}) {
+    for (uint32_t i = 0; i < pixels; i++) {
+      rgba[i] = skewed ? 0x80808080u : rng();
+      values[i] = skewed ? 0.5f : float(rng() % 100000) / 100000.0f;
+    }
+    stream.upload(image, rgba.data(), pixels * 4);
+    stream.upload(luma, values.data(), pixels * sizeof(float));
+    const char *name = skewed ? "single value" : "uniform";
+
+    for (uint32_t bins : {0u, 256u, 4096u}) {
+      // 0: the RGBA image, 4 x 256 bins; either input is 4 bytes a pixel
+      const uint64_t bytes = pixels * 4ull;
+      std::cout << std::setw(16) << name << std::setw(10)
+                << (bins == 0 ? "rgba" : std::to_string(bins));
+      std::vector<uint32_t> reference;
+      for (const Histogram &histogram : histograms) {
+        double ms = time([&] {
+          if (bins == 0) {
+            histogram.recordImage(stream, image, counts, W, H, 4);
+          } else {
+            histogram.record(stream, luma, counts, pixels, bins, 0.0f, 1.0f);
+          }
+        });
+        std::cout << std::setw(7) << ms << " (" << std::setw(4)
+                  << gbps(bytes, ms) << ")";
+
+        // every mode has to agree with the first
+        std::vector<uint32_t> result(bins == 0 ? 1024 : bins);
+        stream.readback(counts, result.data(),
+                        result.size() * sizeof(uint32_t));
+        ok &= stream.submit() == VK_SUCCESS;
+        if (reference.empty()) {
+          reference = result;
+        } else {
+          ok &= result == reference;
+        }
+      }
+      std::cout << "\n";
+    }
+  }
+
+  engine.destroyBuffer(image);
+  engine.destroyBuffer(luma);
+  engine.destroyBuffer(counts);
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
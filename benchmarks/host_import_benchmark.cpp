@@ -0,0 +1,155 @@
+#include "engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+using namespace melkior::engine;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+struct PushConstants {
+  uint32_t N;
+};
+
+constexpr int kWidth = 3840;
+constexpr int kHeight = 2160;
+constexpr uint32_t kPixels = kWidth * kHeight;
+constexpr int kFrames = 30;
+
+WorkGroups groupsFor(uint32_t n, uint32_t maxX) {
+  uint32_t total = groupCount(n, 256);
+  uint32_t x = std::min(total, maxX);
+  return {x, groupCount(total, x)};
+}
+
+} // namespace
+
+// A 4K RGBA cv::Mat in, a cv::Mat out, one kernel in between. The Mats'
+// pixels live in page aligned memory from the engine, so with
+// VK_EXT_external_memory_host the kernel reads and writes them in place;
+// the other paths pay a memcpy (unified memory) or a staging copy per side.
+int main() {
+  Engine engine("bench_host_import");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const KernelSignature signature{
+      {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ},
+       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::WRITE}},
+      sizeof(PushConstants)};
+  auto kernelResult = engine.createKernel("invert_rgba.spv", signature);
+  if (!kernelResult.isValid()) {
+    std::cout << "createKernel failed: " << kernelResult.getError()
+              << std::endl;
+    return 1;
+  }
+  Kernel invert = kernelResult.getValue();
+
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+  const WorkGroups groups =
+      groupsFor(kPixels, props.limits.maxComputeWorkGroupCount[0]);
+
+  const VkDeviceSize bytes = VkDeviceSize(kPixels) * 4;
+  void *inMemory = engine.allocateHostMemory(bytes);
+  void *outMemory = engine.allocateHostMemory(bytes);
+  cv::Mat input(kHeight, kWidth, CV_8UC4, inMemory);
+  cv::Mat output(kHeight, kWidth, CV_8UC4, outMemory);
+  for (uint32_t i = 0; i < kPixels; i++) {
+    reinterpret_cast<uint32_t *>(input.data)[i] = 0x80000000u | (i & 0xFFFFFF);
+  }
+
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto run = [&](const Buffer &in, const Buffer &out) {
+    double best = 1e30;
+    double mean = 0.0;
+    for (int f = -1; f < kFrames; f++) {
+      std::memset(output.data, 0, bytes);
+      auto start = Clock::now();
+      stream.write(in, input.data, bytes);
+      stream.dispatch(invert, {in, out}, PushConstants{kPixels}, groups);
+      stream.read(out, output.data, bytes);
+      ok &= stream.submit() == VK_SUCCESS;
+      double ms = msSince(start);
+      if (f >= 0) {
+        best = std::min(best, ms);
+        mean += ms / kFrames;
+      }
+    }
+    const auto *px = reinterpret_cast<const uint32_t *>(output.data);
+    uint32_t expected =
+        (0x80000000u | ((kPixels - 1) & 0xFFFFFF)) ^ 0x00FFFFFFu;
+    ok &= px[kPixels - 1] == expected;
+    std::cout << "  min " << std::setw(9) << best << " ms  mean "
+              << std::setw(9) << mean << " ms\n";
+  };
+
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  std::cout << kWidth << "x" << kHeight << " RGBA8 cv::Mat, " << kFrames
+            << " frames\n"
+            << std::fixed << std::setprecision(3);
+
+  if (engine.hostImportSupported()) {
+    auto in = engine.importHostMemory(input.data, bytes, usage);
+    auto out = engine.importHostMemory(output.data, bytes, usage);
+    if (in.isValid() && out.isValid()) {
+      std::cout << "imported cv::Mat memory\n";
+      run(in.getValue(), out.getValue());
+    } else {
+      std::cout << "import failed\n";
+    }
+    if (in.isValid()) {
+      engine.destroyBuffer(in.getValue());
+    }
+    if (out.isValid()) {
+      engine.destroyBuffer(out.getValue());
+    }
+  } else {
+    std::cout << "VK_EXT_external_memory_host not supported\n";
+  }
+
+  {
+    Buffer in = engine.createSharedBuffer(bytes, usage).getValue();
+    Buffer out = engine.createSharedBuffer(bytes, usage).getValue();
+    std::cout << (in._mapped ? "unified memory, memcpy per side\n"
+                             : "staging, copy per side\n");
+    run(in, out);
+    engine.destroyBuffer(in);
+    engine.destroyBuffer(out);
+  }
+
+  {
+    Buffer in = engine.createBuffer(bytes, usage | USAGE_TRANSFER_SRC_DST,
+                                    MEM_GPU_ONLY)
+                    .getValue();
+    Buffer out = engine.createBuffer(bytes, usage | USAGE_TRANSFER_SRC_DST,
+                                     MEM_GPU_ONLY)
+                     .getValue();
+    std::cout << "staging rings\n";
+    run(in, out);
+    engine.destroyBuffer(in);
+    engine.destroyBuffer(out);
+  }
+
+  engine.freeHostMemory(inMemory);
+  engine.freeHostMemory(outMemory);
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
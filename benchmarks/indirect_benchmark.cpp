@@ -0,0 +1,158 @@
+#include "compact.hpp"
+#include "engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 50;
+
+struct PushConstants {
+  uint32_t countOffset;
+  float a;
+};
+
+} // namespace
+
+// A data-dependent launch: compact scores above a threshold, then scale
+// the kept ones. The host roundtrip reads the count back and submits the
+// second kernel sized on the CPU; the indirect variants keep both in one
+// submission, dispatching straight from the count buffer Compact writes or
+// from arguments CommandStream::dispatchArgs builds out of the bare count.
+int main() {
+  Engine engine("bench_indirect");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+  auto compactResult = Compact::create(engine);
+  auto kernelResult = engine.createKernel(
+      "scale_counted.spv",
+      {{{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ_WRITE},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ}},
+       sizeof(PushConstants)});
+  if (!compactResult.isValid() || !kernelResult.isValid()) {
+    std::cout << "Kernel creation failed" << std::endl;
+    return 1;
+  }
+  Compact compact = compactResult.getValue();
+  Kernel scale = kernelResult.getValue();
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const VkBufferUsageFlags indirectUsage =
+      usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+  Buffer count =
+      engine.createBuffer(Compact::kCountBytes, indirectUsage, MEM_GPU_ONLY)
+          .getValue();
+  Buffer args = engine
+                    .createBuffer(sizeof(VkDispatchIndirectCommand),
+                                  indirectUsage, MEM_GPU_ONLY)
+                    .getValue();
+
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &run) {
+    run();
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      run();
+    }
+    return msSince(start) / kIterations;
+  };
+
+  std::cout << std::setw(10) << "elements" << std::setw(8) << "kept"
+            << std::setw(12) << "roundtrip" << std::setw(12) << "indirect"
+            << std::setw(14) << "dispatchArgs" << "   ms per frame\n"
+            << std::fixed << std::setprecision(3);
+
+  std::mt19937 rng(9);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  for (uint32_t n : {1u << 12, 1u << 16, 1u << 20}) {
+    for (float threshold : {0.5f, 0.99f}) {
+      std::vector<float> scores(n);
+      for (auto &score : scores) {
+        score = dist(rng);
+      }
+      const VkDeviceSize bytes = VkDeviceSize(n) * sizeof(float);
+      Buffer in = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+      Buffer out = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+      ok &= compact.reserve(n) == VK_SUCCESS;
+      stream.upload(in, scores.data(), bytes);
+      const auto filter =
+          CompactFilter::compare(CompactPredicate::GREATER, threshold);
+
+      uint32_t kept = 0;
+      double roundtripMs = time([&] {
+        compact.record(stream, in, out, count, n, filter);
+        stream.readback(count, &kept, sizeof(kept), 3 * sizeof(uint32_t));
+        ok &= stream.submit() == VK_SUCCESS;
+        stream.dispatch(scale, {out, count}, PushConstants{3, 2.0f},
+                        {std::max(1u, groupCount(kept, 256))});
+        ok &= stream.submit() == VK_SUCCESS;
+      });
+      double indirectMs = time([&] {
+        compact.record(stream, in, out, count, n, filter);
+        stream.dispatchIndirect(scale, {out, count}, PushConstants{3, 2.0f},
+                                count);
+        ok &= stream.submit() == VK_SUCCESS;
+      });
+      double argsMs = time([&] {
+        compact.record(stream, in, out, count, n, filter);
+        stream.dispatchArgs(count, args, 256, 3 * sizeof(uint32_t));
+        stream.dispatchIndirect(scale, {out, count}, PushConstants{3, 2.0f},
+                                args);
+        ok &= stream.submit() == VK_SUCCESS;
+      });
+
+      // every kept score was compacted once and doubled once
+      std::vector<float> result(n);
+      compact.record(stream, in, out, count, n, filter);
+      stream.dispatchArgs(count, args, 256, 3 * sizeof(uint32_t));
+      stream.dispatchIndirect(scale, {out, count}, PushConstants{3, 2.0f},
+                              args);
+      stream.readback(out, result.data(), bytes);
+      stream.readback(count, &kept, sizeof(kept), 3 * sizeof(uint32_t));
+      ok &= stream.submit() == VK_SUCCESS;
+      uint32_t expected = 0;
+      for (float score : scores) {
+        if (score > threshold) {
+          ok &= result[expected++] == 2.0f * score;
+        }
+      }
+      ok &= kept == expected;
+
+      std::cout << std::setw(10) << n << std::setw(8) << kept << std::setw(12)
+                << roundtripMs << std::setw(12) << indirectMs
+                << std::setw(14) << argsMs << "\n";
+
+      engine.destroyBuffer(in);
+      engine.destroyBuffer(out);
+    }
+  }
+
+  compact.destroy();
+  engine.destroyBuffer(count);
+  engine.destroyBuffer(args);
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include "engine.hpp"
+
+#include <chrono>
+#include <iostream>
+
+using namespace melkior::engine;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double usSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+      .count();
+}
+
+struct PushConstants {
+  uint32_t N;
+  uint32_t value;
+};
+
+constexpr uint32_t kN = 1024;
+constexpr int kLaunches = 1000;
+
+} // namespace
+
+int main() {
+  auto start = Clock::now();
+  Engine engine("bench_kernel_launch");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+  double engineUs = usSince(start);
+
+  const KernelSignature signature{{{}}, sizeof(PushConstants)};
+
+  start = Clock::now();
+  auto kernelResult = engine.createKernel("clear.spv", signature);
+  if (!kernelResult.isValid()) {
+    std::cout << "createKernel failed: " << kernelResult.getError()
+              << std::endl;
+    return 1;
+  }
+  double firstKernelUs = usSince(start);
+
+  start = Clock::now();
+  Kernel clear = engine.createKernel("clear.spv", signature).getValue();
+  double cachedKernelUs = usSince(start);
+
+  auto out = engine
+                 .createBuffer(kN * sizeof(uint32_t),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               MEM_GPU_ONLY)
+                 .getValue();
+
+  const WorkGroups groups{groupCount(kN, 256)};
+
+  // first launch writes the descriptor set
+  start = Clock::now();
+  clear.dispatch({out}, PushConstants{kN, 0}, groups);
+  double firstLaunchUs = usSince(start);
+
+  start = Clock::now();
+  for (int i = 0; i < kLaunches; i++) {
+    clear.dispatch({out}, PushConstants{kN, uint32_t(i)}, groups);
+  }
+  double launchUs = usSince(start) / kLaunches;
+
+  // same work recorded into a single command buffer, one submit; no barriers
+  // between the clears, only the launch cost is of interest here
+  start = Clock::now();
+  engine.submitAndWait([&](VkCommandBuffer cmd) {
+    for (int i = 0; i < kLaunches; i++) {
+      auto result = clear.record(cmd, {out}, PushConstants{kN, uint32_t(i)},
+                                 groups);
+      if (result != VK_SUCCESS) {
+        return result;
+      }
+    }
+    return VK_SUCCESS;
+  });
+  double recordedUs = usSince(start) / kLaunches;
+
+  std::cout << "Engine init:                 " << engineUs << " us\n";
+  std::cout << "createKernel (first):        " << firstKernelUs << " us\n";
+  std::cout << "createKernel (cached):       " << cachedKernelUs << " us\n";
+  std::cout << "First dispatch:              " << firstLaunchUs << " us\n";
+  std::cout << "Kernel::dispatch (per op):   " << launchUs << " us\n";
+  std::cout << "Kernel::record, one submit:  " << recordedUs << " us/op\n";
+
+  engine.destroyBuffer(out);
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "engine.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using melkior::engine::Engine;
+using melkior::engine::Specialization;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// Variants per shader; the constant ids are not used by the shaders, which
+// is allowed and still gives the driver distinct pipelines to build.
+constexpr uint32_t kVariants = 8;
+
+bool run_startup(const char *label, const std::vector<std::string> &shaders) {
+  auto start = Clock::now();
+  Engine engine("bench_pipeline_cache");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return false;
+  }
+  double initMs = msSince(start);
+
+  VkDescriptorSetLayoutBinding bind0{};
+  bind0.binding = 0;
+  bind0.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bind0.descriptorCount = 1;
+  bind0.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo dsci{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+  dsci.bindingCount = 1;
+  dsci.pBindings = &bind0;
+
+  VkDescriptorSetLayout dsl = VK_NULL_HANDLE;
+  vkCreateDescriptorSetLayout(engine.device(), &dsci, nullptr, &dsl);
+
+  VkPushConstantRange pcr{VK_SHADER_STAGE_COMPUTE_BIT, 0, 8};
+
+  VkPipelineLayoutCreateInfo plci{
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  plci.setLayoutCount = 1;
+  plci.pSetLayouts = &dsl;
+  plci.pushConstantRangeCount = 1;
+  plci.pPushConstantRanges = &pcr;
+
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  vkCreatePipelineLayout(engine.device(), &plci, nullptr, &layout);
+
+  std::vector<std::vector<uint32_t>> spirvs;
+  for (const auto &path : shaders) {
+    auto spirv = melkior::engine::readSpirv(path);
+    if (!spirv.isValid()) {
+      std::cout << "Cannot read " << path << std::endl;
+      return false;
+    }
+    spirvs.push_back(spirv.getValue());
+  }
+
+  auto createAll = [&]() {
+    for (const auto &spirv : spirvs) {
+      for (uint32_t v = 0; v < kVariants; v++) {
+        Specialization spec;
+        spec.set(100, v);
+        if (!engine.getComputePipeline(spirv, layout, spec).isValid()) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  start = Clock::now();
+  bool ok = createAll();
+  double createMs = msSince(start);
+
+  start = Clock::now();
+  ok = ok && createAll();
+  double registryMs = msSince(start);
+
+  start = Clock::now();
+  engine.savePipelineCache();
+  double saveMs = msSince(start);
+
+  auto stats = engine.pipelineCacheStats();
+  std::cout << label << " (" << stats._loadedBytes << " bytes loaded)\n";
+  std::cout << "  engine init:        " << initMs << " ms\n";
+  std::cout << "  " << stats._pipelinesCreated
+            << " pipelines created:  " << createMs << " ms\n";
+  std::cout << "  same pipelines again: " << registryMs << " ms ("
+            << stats._registryHits << " registry hits)\n";
+  std::cout << "  cache save:         " << saveMs << " ms\n";
+
+  vkDestroyPipelineLayout(engine.device(), layout, nullptr);
+  vkDestroyDescriptorSetLayout(engine.device(), dsl, nullptr);
+  return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> shaders;
+  for (int i = 1; i < argc; i++) {
+    shaders.push_back(argv[i]);
+  }
+  if (shaders.empty()) {
+    shaders = {"clear.spv", "compute.spv"};
+  }
+
+  // keep the benchmark away from the user's real cache
+  auto dir = std::filesystem::temp_directory_path() / "melkior_bench_cache";
+  std::filesystem::remove_all(dir);
+  setenv("MELKIOR_CACHE_DIR", dir.c_str(), 1);
+
+  if (!run_startup("Cold cache", shaders)) {
+    return 1;
+  }
+  if (!run_startup("Warm cache", shaders)) {
+    return 1;
+  }
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
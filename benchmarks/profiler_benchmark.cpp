@@ -0,0 +1,109 @@
+#include "engine.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace melkior::engine;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+struct PushConstants {
+  uint32_t N;
+  float a;
+  float b;
+};
+
+constexpr int kIterations = 50;
+
+} // namespace
+
+// Wall clock time of Kernel::dispatch next to the GPU time the timestamps
+// report for the same launches; the difference is submit and wait overhead.
+int main(int argc, char **argv) {
+  const std::string tracePath = argc > 1 ? argv[1] : "melkior_trace.json";
+
+  Engine engine("bench_profiler");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+  Profiler &profiler = engine.profiler();
+  if (!profiler.supported()) {
+    std::cout << "Timestamps are not supported on this queue" << std::endl;
+    return 1;
+  }
+  profiler.setEnabled(true);
+
+  const KernelSignature signature{
+      {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ},
+       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::WRITE}},
+      sizeof(PushConstants)};
+  auto kernelResult = engine.createKernel("axpb.spv", signature);
+  if (!kernelResult.isValid()) {
+    std::cout << "createKernel failed: " << kernelResult.getError()
+              << std::endl;
+    return 1;
+  }
+  Kernel axpb = kernelResult.getValue();
+
+  std::cout << std::setw(10) << "elements" << std::setw(14) << "wall ms"
+            << std::setw(14) << "gpu ms" << std::setw(12) << "GB/s"
+            << "\n";
+  std::cout << std::fixed << std::setprecision(4);
+
+  for (uint32_t n : {1u << 10, 1u << 14, 1u << 18, 1u << 22}) {
+    Buffer x = engine
+                   .createBuffer(n * sizeof(float),
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                 MEM_GPU_ONLY)
+                   .getValue();
+    Buffer y = engine
+                   .createBuffer(n * sizeof(float),
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                 MEM_GPU_ONLY)
+                   .getValue();
+
+    const PushConstants pc{n, 2.0f, 1.0f};
+    const WorkGroups groups{groupCount(n, 256)};
+    // one read and one write per element, a multiply and an add
+    const Cost cost{2ull * n * sizeof(float), 2ull * n};
+
+    // warm up, then only keep the timed launches
+    axpb.dispatch({x, y}, pc, groups, cost);
+    profiler.summary();
+    profiler.clear();
+
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      axpb.dispatch({x, y}, pc, groups, cost);
+    }
+    double wallMs = msSince(start) / kIterations;
+
+    auto profiles = profiler.summary();
+    if (!profiles.empty()) {
+      std::cout << std::setw(10) << n << std::setw(14) << wallMs
+                << std::setw(14) << profiles[0]._meanMs << std::setw(12)
+                << std::setprecision(2) << profiles[0]._gbps
+                << std::setprecision(4) << "\n";
+    }
+
+    engine.destroyBuffer(x);
+    engine.destroyBuffer(y);
+  }
+
+  // the trace and table hold the launches of the largest size
+  std::cout << "\n";
+  profiler.print();
+  if (profiler.exportChromeTrace(tracePath)) {
+    std::cout << "trace written to " << tracePath << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,172 @@
+#include "engine.hpp"
+#include "radix_sort.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 5;
+
+double mkeys(uint64_t count, double ms) { return count / (ms * 1e3); }
+
+// 8-bit LSD radix sort, the CPU counterpart of the GPU kernels
+void cpuRadixSort(std::vector<uint32_t> &keys, std::vector<uint32_t> &temp) {
+  temp.resize(keys.size());
+  for (uint32_t shift = 0; shift < 32; shift += 8) {
+    uint32_t offsets[256] = {};
+    for (uint32_t key : keys) {
+      offsets[(key >> shift) & 0xFF]++;
+    }
+    uint32_t sum = 0;
+    for (uint32_t &offset : offsets) {
+      uint32_t count = offset;
+      offset = sum;
+      sum += count;
+    }
+    for (uint32_t key : keys) {
+      temp[offsets[(key >> shift) & 0xFF]++] = key;
+    }
+    keys.swap(temp);
+  }
+}
+
+} // namespace
+
+// Random uint keys, 1M to 64M of them, as millions of keys per second:
+// the GPU sort with 4 and 8 bit digits, key-only and with a value per key,
+// next to std::sort and a CPU radix sort. GPU times exclude the upload; the
+// keys are sorted again from the same input every iteration.
+int main() {
+  Engine engine("bench_radix_sort");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  auto sort4Result = RadixSort::create(engine, 4);
+  auto sort8Result = RadixSort::create(engine, 8);
+  if (!sort4Result.isValid() || !sort8Result.isValid()) {
+    std::cout << "RadixSort::create failed" << std::endl;
+    return 1;
+  }
+  RadixSort sort4 = sort4Result.getValue();
+  RadixSort sort8 = sort8Result.getValue();
+  const uint32_t maxCount = 1u << 26;
+  if (sort4.reserve(maxCount) != VK_SUCCESS ||
+      sort8.reserve(maxCount) != VK_SUCCESS) {
+    std::cout << "RadixSort::reserve failed" << std::endl;
+    return 1;
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+  auto timeCpu = [&](const std::function<void()> &run) {
+    auto start = Clock::now();
+    run();
+    return msSince(start);
+  };
+
+  std::cout << std::setw(10) << "keys" << std::setw(10) << "gpu k4"
+            << std::setw(10) << "gpu k8" << std::setw(10) << "gpu kv4"
+            << std::setw(10) << "gpu kv8" << std::setw(11) << "std::sort"
+            << std::setw(11) << "cpu radix" << "   Mkeys/s\n"
+            << std::fixed << std::setprecision(1);
+
+  std::mt19937 rng(42);
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> sorted;
+  std::vector<uint32_t> temp;
+  std::vector<uint32_t> result;
+  for (uint32_t n : {1u << 20, 1u << 22, 1u << 24, 1u << 26}) {
+    keys.resize(n);
+    for (auto &key : keys) {
+      key = rng();
+    }
+    const VkDeviceSize bytes = VkDeviceSize(n) * sizeof(uint32_t);
+    Buffer input = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer work = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer values = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    stream.upload(input, keys.data(), bytes);
+    stream.fill(values, 0);
+
+    double gpuMs[4];
+    int column = 0;
+    for (bool withValues : {false, true}) {
+      for (const RadixSort *sort : {&sort4, &sort8}) {
+        gpuMs[column++] = time([&] {
+          stream.copy(input, work, bytes);
+          if (withValues) {
+            sort->record(stream, work, values, n);
+          } else {
+            sort->record(stream, work, n);
+          }
+        });
+      }
+    }
+    // the copy is part of every iteration, take it out again
+    double copyMs = time([&] { stream.copy(input, work, bytes); });
+
+    sorted = keys;
+    double stdMs = timeCpu([&] { std::sort(sorted.begin(), sorted.end()); });
+    std::vector<uint32_t> radix = keys;
+    double radixMs = timeCpu([&] { cpuRadixSort(radix, temp); });
+
+    // work holds a fresh copy of the input after the copy timing
+    result.resize(n);
+    sort8.record(stream, work, n);
+    stream.readback(work, result.data(), bytes);
+    ok &= stream.submit() == VK_SUCCESS;
+    ok &= radix == sorted;
+    if (result != sorted) {
+      ok = false;
+      std::cout << "GPU result differs from std::sort at " << n << "\n";
+    }
+
+    std::cout << std::setw(10) << n;
+    for (double ms : gpuMs) {
+      std::cout << std::setw(10) << mkeys(n, std::max(ms - copyMs, 1e-3));
+    }
+    std::cout << std::setw(11) << mkeys(n, stdMs) << std::setw(11)
+              << mkeys(n, radixMs) << "\n";
+
+    engine.destroyBuffer(input);
+    engine.destroyBuffer(work);
+    engine.destroyBuffer(values);
+  }
+
+  sort4.destroy();
+  sort8.destroy();
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+#include "engine.hpp"
+#include "reduce.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+double gbps(uint64_t bytes, double ms) { return bytes / (ms * 1e6); }
+
+} // namespace
+
+// Throughput of every reduction, with subgroup arithmetic and with the
+// shared-memory tree, next to the bandwidth ceiling: a vkCmdCopyBuffer of
+// the same data, counted as read + write. Reductions only read, so their
+// GB/s is input bytes over time. Axis reductions of a 3D tensor follow.
+int main() {
+  Engine engine("bench_reduce");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+  const bool subgroups = (engine.subgroupFeatures() &
+                          VK_SUBGROUP_FEATURE_ARITHMETIC_BIT) != 0;
+  std::cout << "subgroup size " << engine.subgroupSize() << ", arithmetic "
+            << (subgroups ? "supported" : "not supported") << "\n\n";
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  struct Op {
+    ReduceOp _op;
+    const char *_name;
+  };
+  const Op ops[] = {{ReduceOp::SUM, "sum"},
+                    {ReduceOp::MIN, "min"},
+                    {ReduceOp::MAX, "max"},
+                    {ReduceOp::ARGMIN, "argmin"},
+                    {ReduceOp::DOT, "dot"}};
+
+  std::cout << std::setw(10) << "elements" << std::setw(9) << "op"
+            << std::setw(12) << "subgroup" << std::setw(12) << "shared"
+            << std::setw(12) << "copy" << "   GB/s\n"
+            << std::fixed << std::setprecision(2);
+
+  for (uint32_t n : {1u << 20, 1u << 22, 1u << 24, 1u << 26}) {
+    const VkDeviceSize bytes = VkDeviceSize(n) * sizeof(float);
+    Buffer x = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer y = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer out =
+        engine.createBuffer(sizeof(ReducePair), usage, MEM_GPU_ONLY)
+            .getValue();
+    Buffer scratch =
+        engine
+            .createBuffer(std::max<VkDeviceSize>(Reduction::scratchSize(n), 16),
+                          usage, MEM_GPU_ONLY)
+            .getValue();
+
+    // ones, so the sum is n and exact in fp32 up to 2^24
+    std::vector<float> ones(n, 1.0f);
+    ones[n / 2] = -1.0f;
+    stream.upload(x, ones.data(), bytes);
+    stream.upload(y, ones.data(), bytes);
+
+    double copyMs = time([&] { stream.copy(x, y, bytes); });
+    stream.upload(y, ones.data(), bytes);
+
+    for (const Op &op : ops) {
+      double ms[2] = {0.0, 0.0};
+      for (int variant = 0; variant < 2; variant++) {
+        bool useSubgroups = variant == 0;
+        if (useSubgroups && !subgroups) {
+          continue;
+        }
+        auto reduction = Reduction::create(engine, op._op, useSubgroups);
+        if (!reduction.isValid()) {
+          ok = false;
+          continue;
+        }
+        const Reduction &r = reduction.getValue();
+        ms[variant] =
+            time([&] { r.record(stream, x, y, out, scratch, n); });
+
+        ReducePair result{};
+        stream.readback(out, &result, sizeof(result));
+        ok &= stream.submit() == VK_SUCCESS;
+        switch (op._op) {
+        case ReduceOp::SUM:
+        case ReduceOp::DOT:
+          ok &= std::fabs(result._value - float(n - 2)) <= 1e-6 * n;
+          break;
+        case ReduceOp::MIN:
+          ok &= result._value == -1.0f;
+          break;
+        case ReduceOp::MAX:
+          ok &= result._value == 1.0f;
+          break;
+        case ReduceOp::ARGMIN:
+          ok &= result._value == -1.0f && result._index == n / 2;
+          break;
+        }
+      }
+      const uint64_t read = bytes * (op._op == ReduceOp::DOT ? 2 : 1);
+      std::cout << std::setw(10) << n << std::setw(9) << op._name
+                << std::setw(12) << (ms[0] > 0.0 ? gbps(read, ms[0]) : 0.0)
+                << std::setw(12) << (ms[1] > 0.0 ? gbps(read, ms[1]) : 0.0)
+                << std::setw(12) << gbps(2 * bytes, copyMs) << "\n";
+    }
+
+    engine.destroyBuffer(x);
+    engine.destroyBuffer(y);
+    engine.destroyBuffer(out);
+    engine.destroyBuffer(scratch);
+  }
+
+  // [outer, axis, inner] = [64, 256, 1024]: the contiguous last axis goes
+  // through the hierarchical kernel, the middle one through the strided one
+  {
+    const uint32_t outer = 64;
+    const uint32_t axis = 256;
+    const uint32_t inner = 1024;
+    const uint64_t n = uint64_t(outer) * axis * inner;
+    const VkDeviceSize bytes = n * sizeof(float);
+    Buffer x = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer out = engine
+                     .createBuffer(uint64_t(outer) * axis * sizeof(ReducePair),
+                                   usage, MEM_GPU_ONLY)
+                     .getValue();
+    Buffer scratch =
+        engine
+            .createBuffer(std::max<VkDeviceSize>(
+                              Reduction::scratchSize(outer * axis, inner, 1),
+                              16),
+                          usage, MEM_GPU_ONLY)
+            .getValue();
+    stream.fill(x, 0);
+    auto sum = Reduction::create(engine, ReduceOp::SUM).getValue();
+
+    double lastMs = time([&] {
+      sum.recordAxis(stream, x, out, scratch, outer * axis, inner, 1);
+    });
+    double middleMs = time([&] {
+      sum.recordAxis(stream, x, out, scratch, outer, axis, inner);
+    });
+    std::cout << "\n[" << outer << ", " << axis << ", " << inner << "] sum\n"
+              << "  last axis    " << std::setw(9) << gbps(bytes, lastMs)
+              << " GB/s\n"
+              << "  middle axis  " << std::setw(9) << gbps(bytes, middleMs)
+              << " GB/s\n";
+
+    engine.destroyBuffer(x);
+    engine.destroyBuffer(out);
+    engine.destroyBuffer(scratch);
+  }
+
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
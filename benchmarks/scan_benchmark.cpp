@@ -0,0 +1,123 @@
+#include "engine.hpp"
+#include "scan.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+double gbps(uint64_t bytes, double ms) { return bytes / (ms * 1e6); }
+
+} // namespace
+
+// Exclusive uint scans, single pass decoupled look-back next to
+// reduce-then-scan, as GB/s of input + output bytes. A vkCmdCopyBuffer of
+// the same size is the ceiling either can reach.
+int main() {
+  Engine engine("bench_scan");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  auto lookback =
+      Scan::create(engine, ScanType::UINT32, ScanAlgorithm::LOOKBACK);
+  auto fallback =
+      Scan::create(engine, ScanType::UINT32, ScanAlgorithm::REDUCE_THEN_SCAN);
+  auto automatic = Scan::create(engine);
+  if (!lookback.isValid() || !fallback.isValid() || !automatic.isValid()) {
+    std::cout << "Scan::create failed" << std::endl;
+    return 1;
+  }
+  std::cout << "default algorithm: "
+            << (automatic.getValue().usesLookback() ? "look-back"
+                                                    : "reduce-then-scan")
+            << "\n";
+  // MELKIOR_SCAN_FALLBACK or a device without forward progress guarantees
+  const bool runLookback = automatic.getValue().usesLookback();
+  if (!runLookback) {
+    std::cout << "look-back may not terminate here, only timing the "
+                 "fallback\n";
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  std::cout << std::setw(10) << "elements" << std::setw(12) << "look-back"
+            << std::setw(14) << "reduce-scan" << std::setw(12) << "copy"
+            << "   GB/s\n"
+            << std::fixed << std::setprecision(2);
+
+  for (uint32_t n : {1u << 20, 1u << 22, 1u << 24, 1u << 26}) {
+    const VkDeviceSize bytes = VkDeviceSize(n) * sizeof(uint32_t);
+    Buffer in = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer out = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer scratch = engine
+                         .createBuffer(
+                             std::max(lookback.getValue().scratchSize(n),
+                                      fallback.getValue().scratchSize(n)),
+                             usage, MEM_GPU_ONLY)
+                         .getValue();
+    stream.fill(in, 1);
+
+    double lookbackMs = 0.0;
+    if (runLookback) {
+      lookbackMs = time([&] {
+        lookback.getValue().record(stream, in, out, scratch, n, true);
+      });
+    }
+    double fallbackMs = time([&] {
+      fallback.getValue().record(stream, in, out, scratch, n, true);
+    });
+    double copyMs = time([&] { stream.copy(in, out, bytes); });
+
+    // exclusive scan of ones
+    fallback.getValue().record(stream, in, out, scratch, n, true);
+    uint32_t last = 0;
+    stream.readback(out, &last, sizeof(last), bytes - sizeof(last));
+    ok &= stream.submit() == VK_SUCCESS && last == n - 1;
+
+    std::cout << std::setw(10) << n << std::setw(12)
+              << (lookbackMs > 0.0 ? gbps(2 * bytes, lookbackMs) : 0.0)
+              << std::setw(14) << gbps(2 * bytes, fallbackMs) << std::setw(12)
+              << gbps(2 * bytes, copyMs) << "\n";
+
+    engine.destroyBuffer(in);
+    engine.destroyBuffer(out);
+    engine.destroyBuffer(scratch);
+  }
+
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
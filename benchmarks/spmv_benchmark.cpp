@@ -0,0 +1,274 @@
+#include "engine.hpp"
+#include "spmv.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+struct HostCsr {
+  std::string _name;
+  uint32_t _rows = 0;
+  uint32_t _cols = 0;
+  std::vector<uint32_t> _rowPtr{0};
+  std::vector<uint32_t> _colIdx;
+  std::vector<float> _values;
+
+  void addRow(const std::vector<uint32_t> &cols) {
+    for (uint32_t c : cols) {
+      _colIdx.push_back(c);
+      _values.push_back(1.0f / float(cols.size()));
+    }
+    _rowPtr.push_back(static_cast<uint32_t>(_colIdx.size()));
+    _rows++;
+  }
+};
+
+// every row 16 random columns
+HostCsr uniform(uint32_t rows, std::mt19937 &rng) {
+  HostCsr m;
+  m._name = "uniform 16/row";
+  m._cols = rows;
+  std::vector<uint32_t> cols(16);
+  for (uint32_t r = 0; r < rows; r++) {
+    for (uint32_t &c : cols) {
+      c = rng() % rows;
+    }
+    m.addRow(cols);
+  }
+  return m;
+}
+
+// 27-point stencil on an n^3 grid, the pattern of a trilinear FEM mesh
+HostCsr stencil27(uint32_t n) {
+  HostCsr m;
+  m._name = "fem 27-point";
+  m._cols = n * n * n;
+  std::vector<uint32_t> cols;
+  for (uint32_t z = 0; z < n; z++) {
+    for (uint32_t y = 0; y < n; y++) {
+      for (uint32_t x = 0; x < n; x++) {
+        cols.clear();
+        for (int dz = -1; dz <= 1; dz++) {
+          for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+              int i = int(x) + dx;
+              int j = int(y) + dy;
+              int k = int(z) + dz;
+              if (i >= 0 && j >= 0 && k >= 0 && i < int(n) && j < int(n) &&
+                  k < int(n)) {
+                cols.push_back((uint32_t(k) * n + uint32_t(j)) * n +
+                               uint32_t(i));
+              }
+            }
+          }
+        }
+        m.addRow(cols);
+      }
+    }
+  }
+  return m;
+}
+
+// power-law row lengths, most rows short and a few with thousands of
+// non-zeros, like the adjacency of a social graph
+HostCsr powerLaw(uint32_t rows, std::mt19937 &rng) {
+  HostCsr m;
+  m._name = "power law";
+  m._cols = rows;
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<uint32_t> cols;
+  for (uint32_t r = 0; r < rows; r++) {
+    cols.resize(uint32_t(std::pow(unit(rng), 12.0) * 2000.0));
+    for (uint32_t &c : cols) {
+      c = rng() % rows;
+    }
+    m.addRow(cols);
+  }
+  return m;
+}
+
+} // namespace
+
+// y = A x on a uniform, an FEM-like and a power-law matrix with every
+// kernel, as ms per product, GFLOP/s and effective GB/s (matrix, x and y
+// touched once), with the kernel AUTO picks marked. Then the COO -> CSR
+// assembly of the power-law matrix from shuffled triplets.
+int main() {
+  Engine engine("bench_spmv");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  std::mt19937 rng(12);
+  std::vector<HostCsr> matrices;
+  matrices.push_back(uniform(1u << 18, rng));
+  matrices.push_back(stencil27(64));
+  matrices.push_back(powerLaw(1u << 16, rng));
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  const SpmvKernel kernels[] = {SpmvKernel::SCALAR, SpmvKernel::VECTOR,
+                                SpmvKernel::MERGE_PATH};
+  std::cout << std::setw(16) << "matrix" << std::setw(10) << "nnz"
+            << std::setw(22) << "scalar" << std::setw(22) << "vector"
+            << std::setw(22) << "merge path"
+            << "   ms (GFLOP/s, GB/s), * = auto\n"
+            << std::fixed << std::setprecision(2);
+
+  for (const HostCsr &host : matrices) {
+    auto csrResult = CsrMatrix::upload(engine, host._rows, host._cols,
+                                       host._rowPtr, host._colIdx,
+                                       host._values);
+    if (!csrResult.isValid()) {
+      std::cout << "CsrMatrix::upload failed" << std::endl;
+      return 1;
+    }
+    CsrMatrix csr = csrResult.getValue();
+    Buffer x = engine.createBuffer(host._cols * sizeof(float), usage,
+                                   MEM_GPU_ONLY)
+                   .getValue();
+    Buffer y = engine.createBuffer(host._rows * sizeof(float), usage,
+                                   MEM_GPU_ONLY)
+                   .getValue();
+    stream.fill(x, 0x3f800000u); // 1.0f
+
+    std::cout << std::setw(16) << host._name << std::setw(10) << csr._nnz;
+    SpmvKernel automatic = SpmvKernel::AUTO;
+    std::vector<float> reference;
+    for (SpmvKernel kernel : kernels) {
+      auto spmvResult = Spmv::create(engine, csr, kernel);
+      if (!spmvResult.isValid()) {
+        std::cout << "Spmv::create failed" << std::endl;
+        return 1;
+      }
+      Spmv spmv = spmvResult.getValue();
+      if (automatic == SpmvKernel::AUTO) {
+        uint32_t lanes = 0;
+        automatic = Spmv::choose(spmv.stats(), lanes);
+      }
+      double ms = time([&] { spmv.record(stream, x, y); });
+      std::cout << std::setw(7) << ms << (kernel == automatic ? "*" : " ")
+                << "(" << std::setw(5) << spmv.flops() / (ms * 1e6) << ", "
+                << std::setw(5) << spmv.bytes() / (ms * 1e6) << ")";
+
+      // with x = 1 every row sums to 1 (or 0 when empty); all kernels agree
+      std::vector<float> result(host._rows);
+      stream.readback(y, result.data(), result.size() * sizeof(float));
+      ok &= stream.submit() == VK_SUCCESS;
+      if (reference.empty()) {
+        reference = result;
+      } else {
+        for (size_t i = 0; i < result.size(); i++) {
+          ok &= std::abs(result[i] - reference[i]) < 1e-4f;
+        }
+      }
+      spmv.destroy();
+    }
+    std::cout << "\n";
+
+    engine.destroyBuffer(x);
+    engine.destroyBuffer(y);
+    csr.destroy(engine);
+  }
+
+  // COO -> CSR of the power-law matrix, triplets in shuffled order
+  {
+    const HostCsr &host = matrices.back();
+    const uint32_t nnz = static_cast<uint32_t>(host._colIdx.size());
+    std::vector<uint32_t> rows(nnz);
+    for (uint32_t r = 0; r < host._rows; r++) {
+      for (uint32_t i = host._rowPtr[r]; i < host._rowPtr[r + 1]; i++) {
+        rows[i] = r;
+      }
+    }
+    std::vector<uint32_t> perm(nnz);
+    for (uint32_t i = 0; i < nnz; i++) {
+      perm[i] = i;
+    }
+    std::shuffle(perm.begin(), perm.end(), rng);
+    std::vector<uint32_t> cooRows(nnz);
+    std::vector<uint32_t> cooCols(nnz);
+    std::vector<float> cooValues(nnz);
+    for (uint32_t i = 0; i < nnz; i++) {
+      cooRows[i] = rows[perm[i]];
+      cooCols[i] = host._colIdx[perm[i]];
+      cooValues[i] = host._values[perm[i]];
+    }
+    const VkDeviceSize bytes = VkDeviceSize(nnz) * sizeof(uint32_t);
+    Buffer rowsBuf = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer colsBuf = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer valuesBuf =
+        engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    stream.upload(rowsBuf, cooRows.data(), bytes);
+    stream.upload(colsBuf, cooCols.data(), bytes);
+    stream.upload(valuesBuf, cooValues.data(), bytes);
+
+    auto assembleResult = CooToCsr::create(engine);
+    auto csrResult =
+        CsrMatrix::allocate(engine, host._rows, host._cols, nnz);
+    if (!assembleResult.isValid() || !csrResult.isValid()) {
+      std::cout << "CooToCsr setup failed" << std::endl;
+      return 1;
+    }
+    CooToCsr assemble = assembleResult.getValue();
+    CsrMatrix csr = csrResult.getValue();
+    ok &= assemble.reserve(nnz, host._rows) == VK_SUCCESS;
+    double ms = time([&] {
+      assemble.record(stream, rowsBuf, colsBuf, valuesBuf, csr);
+    });
+    std::cout << "\ncoo -> csr, " << nnz << " triplets: " << ms << " ms ("
+              << nnz / (ms * 1e3) << " M/s)\n";
+
+    std::vector<uint32_t> rowPtr(host._rows + 1);
+    stream.readback(csr._rowPtr, rowPtr.data(),
+                    rowPtr.size() * sizeof(uint32_t));
+    ok &= stream.submit() == VK_SUCCESS;
+    ok &= rowPtr == host._rowPtr;
+
+    engine.destroyBuffer(rowsBuf);
+    engine.destroyBuffer(colsBuf);
+    engine.destroyBuffer(valuesBuf);
+    csr.destroy(engine);
+    assemble.destroy();
+  }
+
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
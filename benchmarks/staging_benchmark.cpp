@@ -0,0 +1,109 @@
+#include "engine.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace melkior::engine;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+
+double gbps(VkDeviceSize bytes, double ms) {
+  return ms > 0.0 ? double(bytes) / (ms * 1e6) : 0.0;
+}
+
+} // namespace
+
+// Host <-> device round trips through the staging rings, against the old way
+// of going through a HOST_VISIBLE | HOST_COHERENT buffer: memcpy in, copy on
+// the GPU, memcpy out of uncached memory.
+int main() {
+  Engine engine("bench_staging");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+
+  std::cout << std::setw(10) << "KB" << std::setw(16) << "ring up GB/s"
+            << std::setw(16) << "ring down GB/s" << std::setw(16)
+            << "mapped up GB/s" << std::setw(18) << "mapped down GB/s"
+            << "\n";
+  std::cout << std::fixed << std::setprecision(2);
+
+  CommandStream stream(engine);
+  bool ok = true;
+
+  for (VkDeviceSize bytes = 64 * 1024; bytes <= 64ull * 1024 * 1024;
+       bytes *= 4) {
+    Buffer device = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer mapped =
+        engine.createBuffer(bytes, usage, MEM_CPU_VISIBLE_COHERENT).getValue();
+    std::vector<uint8_t> in(bytes);
+    std::vector<uint8_t> out(bytes);
+    for (size_t i = 0; i < in.size(); i++) {
+      in[i] = uint8_t(i * 7);
+    }
+
+    // staging ring: upload, readback, one submit each
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      stream.upload(device, in.data(), bytes);
+      stream.submit();
+    }
+    double ringUpMs = msSince(start) / kIterations;
+
+    start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      stream.readback(device, out.data(), bytes);
+      stream.submit();
+    }
+    double ringDownMs = msSince(start) / kIterations;
+    ok &= std::memcmp(in.data(), out.data(), bytes) == 0;
+
+    // host visible coherent buffer copied on the GPU
+    start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      std::memcpy(mapped._mapped, in.data(), bytes);
+      stream.copy(mapped, device);
+      stream.submit();
+    }
+    double mappedUpMs = msSince(start) / kIterations;
+
+    start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      stream.copy(device, mapped);
+      stream.submit();
+      std::memcpy(out.data(), mapped._mapped, bytes);
+    }
+    double mappedDownMs = msSince(start) / kIterations;
+    ok &= std::memcmp(in.data(), out.data(), bytes) == 0;
+
+    std::cout << std::setw(10) << bytes / 1024 << std::setw(16)
+              << gbps(bytes, ringUpMs) << std::setw(16)
+              << gbps(bytes, ringDownMs) << std::setw(16)
+              << gbps(bytes, mappedUpMs) << std::setw(18)
+              << gbps(bytes, mappedDownMs) << "\n";
+
+    engine.destroyBuffer(device);
+    engine.destroyBuffer(mapped);
+  }
+
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
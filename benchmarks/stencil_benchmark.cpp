@@ -0,0 +1,136 @@
+#include "engine.hpp"
+#include "stencil.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int kIterations = 20;
+constexpr uint32_t kSteps = 64;
+
+} // namespace
+
+// Heat equation steps on a 2048^2 grid with 1, 2, 4 and 8 time steps per
+// dispatch and on a 256^3 grid, 64 steps in one submission, as ms per step
+// and the bandwidth of one read and write per cell and step. Then a 257^2
+// Laplace solve run to a 1e-4 residual in one submission with a check
+// every 1 and 16 sweeps.
+int main() {
+  Engine engine("bench_stencil");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto time = [&](const std::function<void()> &record) {
+    record();
+    ok &= stream.submit() == VK_SUCCESS;
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      record();
+    }
+    ok &= stream.submit() == VK_SUCCESS;
+    return msSince(start) / kIterations;
+  };
+
+  struct Run {
+    std::string _name;
+    StencilShape _shape;
+    uint32_t _timeSteps;
+  };
+  const std::vector<Run> runs = {
+      {"2d 2048^2, 1 step/sweep", {2048, 2048}, 1},
+      {"2d 2048^2, 2 steps/sweep", {2048, 2048}, 2},
+      {"2d 2048^2, 4 steps/sweep", {2048, 2048}, 4},
+      {"2d 2048^2, 8 steps/sweep", {2048, 2048}, 8},
+      {"3d 256^3", {256, 256, 256}, 1},
+  };
+  std::cout << std::setw(28) << "grid" << std::setw(12) << "ms/step"
+            << std::setw(12) << "GB/s" << std::setw(12) << "rows\n"
+            << std::fixed << std::setprecision(3);
+  for (const Run &run : runs) {
+    const VkDeviceSize bytes = run._shape.count() * sizeof(float);
+    Buffer grid = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    stream.fill(grid, 0x3f800000u); // 1.0f
+    StencilOptions options;
+    options._timeSteps = run._timeSteps;
+    // a residual reduction per submission only
+    options._checkInterval = kSteps;
+    auto stencilResult =
+        Stencil::create(engine, run._shape,
+                        StencilWeights::heat(run._shape, 0.1f), options);
+    if (!stencilResult.isValid()) {
+      // the widened tile doesn't fit shared memory
+      std::cout << std::setw(28) << run._name << std::setw(12) << "-\n";
+      engine.destroyBuffer(grid);
+      continue;
+    }
+    Stencil stencil = stencilResult.getValue();
+    double ms = time([&] { stencil.record(stream, grid, grid, kSteps); }) /
+                kSteps;
+    std::cout << std::setw(28) << run._name << std::setw(12) << ms
+              << std::setw(12) << 2.0 * bytes / (ms * 1e6) << std::setw(11)
+              << stencil.coarsening() << "\n";
+    stencil.destroy();
+    engine.destroyBuffer(grid);
+  }
+
+  // Laplace solve: hot top edge, stops on the device
+  const StencilShape shape{257, 257};
+  std::vector<float> initial(shape.count(), 0.0f);
+  std::fill_n(initial.begin(), shape._width, 1.0f);
+  const VkDeviceSize bytes = shape.count() * sizeof(float);
+  Buffer input = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer output = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  stream.upload(input, initial.data(), bytes);
+  for (uint32_t interval : {1u, 16u}) {
+    StencilOptions options;
+    options._timeSteps = 4;
+    options._checkInterval = interval;
+    options._tolerance = 1e-4f;
+    auto stencilResult = Stencil::create(
+        engine, shape, StencilWeights::jacobi(shape, 1.0f / 256), options);
+    if (!stencilResult.isValid()) {
+      std::cout << "Stencil::create failed" << std::endl;
+      return 1;
+    }
+    Stencil stencil = stencilResult.getValue();
+    auto start = Clock::now();
+    stencil.record(stream, input, output, 20000);
+    StencilState state{};
+    stream.readback(stencil.state(), &state, sizeof(state));
+    ok &= stream.submit() == VK_SUCCESS;
+    const double ms = msSince(start);
+    ok &= state._converged != 0;
+    std::cout << "laplace 257^2, check every " << interval << " sweeps: "
+              << state._steps << " steps, " << ms << " ms\n";
+    stencil.destroy();
+  }
+  engine.destroyBuffer(input);
+  engine.destroyBuffer(output);
+
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
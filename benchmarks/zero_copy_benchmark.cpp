@@ -0,0 +1,124 @@
+#include "engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace melkior::engine;
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+struct PushConstants {
+  uint32_t N;
+  float a;
+  float b;
+};
+
+// one 4K frame, a float per pixel
+constexpr uint32_t kWidth = 3840;
+constexpr uint32_t kHeight = 2160;
+constexpr uint32_t kN = kWidth * kHeight;
+constexpr int kFrames = 30;
+
+struct Timing {
+  double _minMs = 1e30;
+  double _meanMs = 0.0;
+};
+
+} // namespace
+
+// End-to-end latency of one frame: host data in, one kernel, host data out.
+// The staging path copies through the upload and readback rings; the shared
+// path writes and reads device memory directly when it is host visible.
+int main() {
+  Engine engine("bench_zero_copy");
+  if (!engine.getEngineState()._ready) {
+    std::cout << "Engine init failed!" << std::endl;
+    return 1;
+  }
+
+  const KernelSignature signature{
+      {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ},
+       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::WRITE}},
+      sizeof(PushConstants)};
+  auto kernelResult = engine.createKernel("axpb.spv", signature);
+  if (!kernelResult.isValid()) {
+    std::cout << "createKernel failed: " << kernelResult.getError()
+              << std::endl;
+    return 1;
+  }
+  Kernel axpb = kernelResult.getValue();
+
+  const VkDeviceSize bytes = VkDeviceSize(kN) * sizeof(float);
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const PushConstants pc{kN, 2.0f, 1.0f};
+  const WorkGroups groups{groupCount(kN, 256)};
+
+  std::vector<float> frame(kN);
+  std::vector<float> result(kN);
+  for (uint32_t i = 0; i < kN; i++) {
+    frame[i] = float(i % 4096);
+  }
+
+  CommandStream stream(engine);
+  bool ok = true;
+
+  auto run = [&](const Buffer &in, const Buffer &out) {
+    Timing timing;
+    for (int f = -1; f < kFrames; f++) {
+      auto start = Clock::now();
+      stream.write(in, frame.data(), bytes);
+      stream.dispatch(axpb, {in, out}, pc, groups);
+      stream.read(out, result.data(), bytes);
+      ok &= stream.submit() == VK_SUCCESS;
+      double ms = msSince(start);
+      // the first frame pays for descriptor sets and first touches
+      if (f >= 0) {
+        timing._minMs = std::min(timing._minMs, ms);
+        timing._meanMs += ms / kFrames;
+      }
+    }
+    ok &= result[kN - 1] == 2.0f * frame[kN - 1] + 1.0f;
+    return timing;
+  };
+
+  Buffer stagedIn = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer stagedOut =
+      engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Timing staged = run(stagedIn, stagedOut);
+  engine.destroyBuffer(stagedIn);
+  engine.destroyBuffer(stagedOut);
+
+  Buffer sharedIn = engine.createSharedBuffer(bytes, usage).getValue();
+  Buffer sharedOut = engine.createSharedBuffer(bytes, usage).getValue();
+  bool zeroCopy = sharedIn._mapped != nullptr && sharedOut._mapped != nullptr;
+  Timing shared = run(sharedIn, sharedOut);
+  engine.destroyBuffer(sharedIn);
+  engine.destroyBuffer(sharedOut);
+
+  std::cout << kWidth << "x" << kHeight << " float frame, " << kFrames
+            << " frames, unified memory: "
+            << (engine.unifiedMemory() ? "yes" : "no") << "\n";
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "  staging      min " << std::setw(9) << staged._minMs
+            << " ms  mean " << std::setw(9) << staged._meanMs << " ms\n";
+  std::cout << "  " << (zeroCopy ? "zero-copy " : "fallback  ") << "   min "
+            << std::setw(9) << shared._minMs << " ms  mean " << std::setw(9)
+            << shared._meanMs << " ms  (" << std::setprecision(2)
+            << staged._meanMs / shared._meanMs << "x)\n";
+  if (!ok) {
+    std::cout << "MISMATCH" << std::endl;
+  }
+  return ok ? 0 : 1;
+}
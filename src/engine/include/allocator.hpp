@@ -0,0 +1,85 @@
+#ifndef MELKIOR_ALLOCATOR_HPP
+#define MELKIOR_ALLOCATOR_HPP
+
+#include "types.hpp"
+
+#include <array>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+
+// default size of one VkDeviceMemory block
+constexpr VkDeviceSize ARENA_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+struct AllocatorStats {
+  uint32_t _blockCount = 0;
+  uint32_t _allocationCount = 0;
+  // number of vkAllocateMemory calls made by the arena so far
+  uint64_t _deviceAllocations = 0;
+  VkDeviceSize _reservedBytes = 0;
+  VkDeviceSize _usedBytes = 0;
+  VkDeviceSize _peakUsedBytes = 0;
+  VkDeviceSize _freeBytes = 0;
+  VkDeviceSize _largestFreeRange = 0;
+  // 0 = all free memory is one range, close to 1 = free memory is scattered
+  // in small holes
+  double _fragmentation = 0.0;
+};
+
+// Sub-allocates buffers out of large VkDeviceMemory blocks, one block list per
+// memory type. Free space inside a block is kept as an offset-sorted free list
+// with best-fit placement and coalescing on free. Requests larger than half a
+// block get a block of their own which is released as soon as it is freed.
+class MemoryArena {
+public:
+  MemoryArena() = default;
+  MemoryArena(const MemoryArena &) = delete;
+  MemoryArena &operator=(const MemoryArena &) = delete;
+
+  void init(VkDevice device, VkPhysicalDevice physicalDevice,
+            VkDeviceSize blockSize = ARENA_BLOCK_SIZE);
+  void destroy();
+
+  Result<Allocation> allocate(const VkMemoryRequirements &req,
+                              uint32_t memoryTypeIndex);
+  void free(const Allocation &allocation);
+
+  AllocatorStats stats() const;
+
+private:
+  struct Range {
+    VkDeviceSize _offset;
+    VkDeviceSize _size;
+  };
+
+  struct Block {
+    VkDeviceMemory _memory = VK_NULL_HANDLE;
+    VkDeviceSize _size = 0;
+    VkDeviceSize _used = 0;
+    void *_mapped = nullptr;
+    uint32_t _allocationCount = 0;
+    bool _dedicated = false;
+    std::vector<Range> _freeRanges;
+  };
+
+  Result<uint32_t> createBlock(uint32_t memoryTypeIndex, VkDeviceSize size,
+                               bool dedicated);
+  void releaseBlock(uint32_t memoryTypeIndex, uint32_t blockId);
+  bool tryPlace(Block &block, VkDeviceSize size, VkDeviceSize alignment,
+                VkDeviceSize &offset);
+
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  VkDeviceSize m_blockSize = ARENA_BLOCK_SIZE;
+  VkDeviceSize m_nonCoherentAtomSize = 1;
+  std::array<std::vector<Block>, VK_MAX_MEMORY_TYPES> m_blocks;
+
+  VkDeviceSize m_usedBytes = 0;
+  VkDeviceSize m_peakUsedBytes = 0;
+  uint64_t m_deviceAllocations = 0;
+};
+
+} // namespace melkior::engine
+
+#endif
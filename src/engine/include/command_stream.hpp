@@ -0,0 +1,201 @@
+#ifndef MELKIOR_COMMAND_STREAM_HPP
+#define MELKIOR_COMMAND_STREAM_HPP
+
+#include "kernel.hpp"
+#include "staging.hpp"
+#include "types.hpp"
+
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+
+class Engine;
+
+// Records many dispatches, copies and fills into one command buffer and
+// submits them once. Every command declares what it reads and writes (kernels
+// through their signature), and the stream only inserts a buffer barrier when
+// a command actually depends on an earlier one:
+//   read after write / write after write -> memory barrier
+//   write after read                     -> execution dependency only
+//   read after read, disjoint buffers    -> nothing
+// Barriers needed by one command are batched into a single
+// vkCmdPipelineBarrier.
+//
+//   CommandStream stream(engine);
+//   stream.dispatch(scale, {a, b}, pc, groups);
+//   stream.dispatch(scale, {b, a}, pc, groups);
+//   stream.submit();
+class CommandStream {
+public:
+  explicit CommandStream(Engine &engine);
+  ~CommandStream();
+
+  CommandStream(const CommandStream &) = delete;
+  CommandStream &operator=(const CommandStream &) = delete;
+
+  VkResult getState() const { return m_result; }
+
+  // cost is only used by the profiler
+  void dispatch(const Kernel &kernel, const std::vector<Buffer> &buffers,
+                WorkGroups groups, Cost cost = {}) {
+    dispatchRaw(kernel, buffers, nullptr, 0, groups, cost);
+  }
+  template <typename PC>
+  void dispatch(const Kernel &kernel, const std::vector<Buffer> &buffers,
+                const PC &pushConstants, WorkGroups groups, Cost cost = {}) {
+    static_assert(!std::is_pointer_v<PC>, "pass push constants by value");
+    dispatchRaw(kernel, buffers, &pushConstants, sizeof(PC), groups, cost);
+  }
+  void dispatchRaw(const Kernel &kernel, const std::vector<Buffer> &buffers,
+                   const void *pushConstants, uint32_t pushConstantSize,
+                   WorkGroups groups, Cost cost = {});
+
+  // Group counts read by the device from the VkDispatchIndirectCommand at
+  // offset in args (INDIRECT_BUFFER usage), so work sized by earlier
+  // commands needs no readback. Writes to args by earlier commands are
+  // made visible to the indirect read like any other dependency.
+  void dispatchIndirect(const Kernel &kernel,
+                        const std::vector<Buffer> &buffers, const Buffer &args,
+                        VkDeviceSize offset = 0, Cost cost = {}) {
+    dispatchIndirectRaw(kernel, buffers, nullptr, 0, args, offset, cost);
+  }
+  template <typename PC>
+  void dispatchIndirect(const Kernel &kernel,
+                        const std::vector<Buffer> &buffers,
+                        const PC &pushConstants, const Buffer &args,
+                        VkDeviceSize offset = 0, Cost cost = {}) {
+    static_assert(!std::is_pointer_v<PC>, "pass push constants by value");
+    dispatchIndirectRaw(kernel, buffers, &pushConstants, sizeof(PC), args,
+                        offset, cost);
+  }
+  void dispatchIndirectRaw(const Kernel &kernel,
+                           const std::vector<Buffer> &buffers,
+                           const void *pushConstants,
+                           uint32_t pushConstantSize, const Buffer &args,
+                           VkDeviceSize offset, Cost cost = {});
+
+  // Writes the VkDispatchIndirectCommand of a dispatch over the uint count
+  // at countOffset in count, groupSize elements per work group, to
+  // argsOffset in args (STORAGE and INDIRECT_BUFFER usage). Group counts
+  // past maxComputeWorkGroupCount[0] continue in Y, so the kernel should
+  // take its group index as wg.x + wg.y * gl_NumWorkGroups.x and check it
+  // against the count. Offsets are in bytes and multiples of 4.
+  //
+  //   stream.dispatchArgs(frontierSize, args, 256);
+  //   stream.dispatchIndirect(expand, {frontier, frontierSize}, args);
+  void dispatchArgs(const Buffer &count, const Buffer &args,
+                    uint32_t groupSize, VkDeviceSize countOffset = 0,
+                    VkDeviceSize argsOffset = 0);
+
+  void copy(const Buffer &src, const Buffer &dst,
+            VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize srcOffset = 0,
+            VkDeviceSize dstOffset = 0);
+  void fill(const Buffer &dst, uint32_t value, VkDeviceSize offset = 0,
+            VkDeviceSize size = VK_WHOLE_SIZE);
+
+  // Copies data into the engine's upload ring right away and records the
+  // copy into dst. Consecutive uploads are batched into one vkCmdCopyBuffer
+  // per destination, flushed before the next command of any other kind.
+  void upload(const Buffer &dst, const void *data, VkDeviceSize size,
+              VkDeviceSize dstOffset = 0);
+  // Records a copy of src into the readback ring. data is written once the
+  // submission has been waited for through submit() or wait(), and must stay
+  // alive until then.
+  void readback(const Buffer &src, void *data, VkDeviceSize size,
+                VkDeviceSize srcOffset = 0);
+
+  // Zero-copy for mapped buffers (Engine::createSharedBuffer on unified
+  // memory), upload()/readback() otherwise. On the zero-copy path write()
+  // lands immediately instead of in stream order, so the buffer must not be
+  // in use by the GPU, and read() copies out whatever the buffer holds when
+  // the submission completes.
+  void write(const Buffer &dst, const void *data, VkDeviceSize size,
+             VkDeviceSize dstOffset = 0);
+  void read(const Buffer &src, void *data, VkDeviceSize size,
+            VkDeviceSize srcOffset = 0);
+
+  // Declare an access made by commands recorded straight into
+  // commandBuffer(), so later commands are still ordered against it.
+  void access(const Buffer &buffer, VkPipelineStageFlags stage,
+              VkAccessFlags accessMask, bool write);
+  // Emit pending uploads and whatever access() calls made pending.
+  void flushBarriers();
+
+  VkCommandBuffer commandBuffer() const { return m_cmd; }
+
+  // One vkQueueSubmit without waiting. The recorded work starts after
+  // waitFor completes, or after the previous submission when it is empty:
+  // the next batch starts without barriers, so only tickets it really
+  // depends on may be passed to let it overlap. The stream continues on a
+  // fresh command buffer from the engine's ring, so the next batch can be
+  // recorded right away.
+  Result<Ticket> submitAsync(const std::vector<Ticket> &waitFor = {});
+  // submitAsync() and wait. Device writes are visible to the host afterwards
+  // and the stream is empty and ready for recording again.
+  VkResult submit();
+  // engine wait that also completes the readbacks of ticket and earlier
+  VkResult wait(Ticket ticket);
+
+  uint32_t commandCount() const { return m_commandCount; }
+  uint32_t barrierCount() const { return m_barrierCount; }
+
+private:
+  struct BufferState {
+    VkPipelineStageFlags _writeStage = 0;
+    VkAccessFlags _writeAccess = 0;
+    // stages/accesses that already saw the last write
+    VkPipelineStageFlags _visibleStages = 0;
+    VkAccessFlags _visibleAccess = 0;
+    // stages that read since the last write
+    VkPipelineStageFlags _readStages = 0;
+  };
+
+  struct PendingUpload {
+    VkBuffer _src;
+    Buffer _dst;
+    VkBufferCopy _region;
+  };
+
+  struct PendingReadback {
+    StagingRegion _region;
+    void *_data;
+    VkDeviceSize _size;
+    // read straight out of a mapped buffer, _region is unused
+    bool _direct = false;
+    Buffer _buffer;
+    VkDeviceSize _offset = 0;
+    // timeline value of the submission, 0 while still recording
+    uint64_t _value = 0;
+  };
+
+  VkResult begin();
+  void flushUploads();
+  void emitBarriers();
+  // declares the accesses of a dispatch, false when it can't be recorded
+  bool declareDispatch(const Kernel &kernel,
+                       const std::vector<Buffer> &buffers);
+
+  Engine &m_engine;
+  uint32_t m_slot = UINT32_MAX;
+  VkCommandBuffer m_cmd = VK_NULL_HANDLE;
+  VkResult m_result = VK_SUCCESS;
+
+  std::unordered_map<uint64_t, BufferState> m_states;
+  std::vector<VkBufferMemoryBarrier> m_pendingBarriers;
+  VkPipelineStageFlags m_pendingSrcStages = 0;
+  VkPipelineStageFlags m_pendingDstStages = 0;
+  VkPipelineStageFlags m_usedStages = 0;
+
+  std::vector<PendingUpload> m_uploads;
+  std::vector<PendingReadback> m_readbacks;
+
+  uint32_t m_commandCount = 0;
+  uint32_t m_barrierCount = 0;
+};
+
+} // namespace melkior::engine
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef MELKIOR_DESCRIPTOR_CACHE_HPP
+#define MELKIOR_DESCRIPTOR_CACHE_HPP
+
+#include "types.hpp"
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+
+// how a kernel touches one of its bindings, drives barrier placement
+enum class Access : uint8_t { READ, WRITE, READ_WRITE };
+
+struct Binding {
+  VkDescriptorType _type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  Access _access = Access::READ_WRITE;
+};
+
+// Descriptor bindings (set 0, binding i = _bindings[i]) plus the size of the
+// push constant block, enough to build a compute pipeline layout.
+struct KernelSignature {
+  std::vector<Binding> _bindings;
+  uint32_t _pushConstantSize = 0;
+};
+
+struct Layouts {
+  VkDescriptorSetLayout _setLayout = VK_NULL_HANDLE;
+  VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+};
+
+// Caches pipeline layouts per signature and descriptor sets per
+// (set layout, bound buffers). A set is written once and reused for every
+// dispatch with the same buffers; it is released when one of its buffers is
+// destroyed.
+class DescriptorCache {
+public:
+  DescriptorCache() = default;
+  DescriptorCache(const DescriptorCache &) = delete;
+  DescriptorCache &operator=(const DescriptorCache &) = delete;
+
+  void init(VkDevice device);
+  void destroy();
+
+  Result<Layouts> getLayouts(const KernelSignature &signature);
+  Result<VkDescriptorSet> getSet(VkDescriptorSetLayout setLayout,
+                                 const KernelSignature &signature,
+                                 const std::vector<Buffer> &buffers);
+  void forget(uint64_t bufferId);
+
+private:
+  // [push constant size, descriptor types...]
+  using LayoutKey = std::vector<uint32_t>;
+  // [set layout handle, buffer ids...]
+  using SetKey = std::vector<uint64_t>;
+
+  struct SetEntry {
+    VkDescriptorSet _set;
+    VkDescriptorPool _pool;
+  };
+
+  VkResult addPool();
+
+  VkDevice m_device = VK_NULL_HANDLE;
+  std::map<LayoutKey, Layouts> m_layouts;
+  std::vector<VkDescriptorPool> m_pools;
+  std::map<SetKey, SetEntry> m_sets;
+  // buffer id -> keys of the sets it is bound in
+  std::unordered_map<uint64_t, std::vector<SetKey>> m_setsByBuffer;
+};
+
+} // namespace melkior::engine
+
+#endif
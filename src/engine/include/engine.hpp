@@ -1,8 +1,19 @@
 #ifndef MELKIOR_ENGINE_HPP
 #define MELKIOR_ENGINE_HPP
 
+#include "allocator.hpp"
+#include "command_stream.hpp"
+#include "descriptor_cache.hpp"
+#include "kernel.hpp"
+#include "pipeline_cache.hpp"
+#include "profiler.hpp"
+#include "staging.hpp"
+#include "types.hpp"
+
+#include <functional>
+#include <string>
 #include <string_view>
-#include <variant>
+#include <vector>
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
 
@@ -22,27 +33,12 @@ constexpr VkMemoryPropertyFlags MEM_CPU_VISIBLE_COHERENT =
 constexpr VkMemoryPropertyFlags MEM_GPU_ONLY =
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
-// utility data structs
-struct EngineState {
-  bool _ready;
-  VkResult _result;
-};
-
-template <typename T> struct Result {
-  std::variant<T, VkResult> _result;
-
-  bool isValid() { return !std::holds_alternative<VkResult>(_result); }
-
-  VkResult getError() { return std::get<VkResult>(_result); }
-
-  T getValue() { return std::get<T>(_result); }
-};
+// device local and mapped, integrated GPUs (and resizable BAR) only
+constexpr VkMemoryPropertyFlags MEM_UNIFIED =
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
 
-struct Buffer {
-  VkBuffer _buffer = VK_NULL_HANDLE;
-  VkDeviceMemory _memory = VK_NULL_HANDLE;
-  VkDeviceSize _size = 0;
-};
+// command buffers the engine keeps in flight before recycling the oldest
+constexpr uint32_t SUBMIT_RING_SIZE = 8;
 
 // the engine
 class Engine {
@@ -50,6 +46,9 @@ public:
   Engine(std::string_view name);
   ~Engine();
 
+  Engine(const Engine &) = delete;
+  Engine &operator=(const Engine &) = delete;
+
   EngineState getEngineState() const;
   std::string version() const;
   std::string vendorName() const;
@@ -58,20 +57,168 @@ public:
   void printQueueFamilies() const;
   void printMemoryTypes();
 
+  // sub-allocated from the memory arena
   Result<Buffer> createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                               VkMemoryPropertyFlags memProps);
+  // one vkAllocateMemory per buffer, bypasses the arena
+  Result<Buffer> createDedicatedBuffer(VkDeviceSize size,
+                                       VkBufferUsageFlags usage,
+                                       VkMemoryPropertyFlags memProps);
+  // Zero-copy when unifiedMemory(): device local memory the host reads and
+  // writes through _mapped. Otherwise a plain device local buffer without
+  // _mapped, and CommandStream::write/read go through the staging rings.
+  Result<Buffer> createSharedBuffer(VkDeviceSize size,
+                                    VkBufferUsageFlags usage);
+  // Uses host memory the caller owns as the buffer's memory
+  // (VK_EXT_external_memory_host). ptr must be aligned to
+  // hostPointerAlignment() and stay allocated until the buffer is destroyed;
+  // the import is rounded up to whole alignment units, which is safe for
+  // page aligned allocations such as those from allocateHostMemory().
+  Result<Buffer> importHostMemory(void *ptr, VkDeviceSize size,
+                                  VkBufferUsageFlags usage);
+  // importHostMemory(), or createSharedBuffer() when that isn't possible.
+  // Either way CommandStream::write/read(buffer, ptr, size) moves the data,
+  // and skip the copy when ptr is the buffer's memory.
+  Result<Buffer> wrapHostMemory(void *ptr, VkDeviceSize size,
+                                VkBufferUsageFlags usage);
+  bool hostImportSupported() const {
+    return m_getMemoryHostPointerProperties != nullptr;
+  }
+  VkDeviceSize hostPointerAlignment() const { return m_hostPointerAlignment; }
+  // host allocations that importHostMemory() accepts, e.g. as cv::Mat data
+  void *allocateHostMemory(VkDeviceSize size) const;
+  void freeHostMemory(void *ptr) const;
+
   void destroyBuffer(Buffer buffer);
 
+  // true when the GPU's main memory is host visible, as on the Pi 5 or an
+  // APU, so staging copies only cost time
+  bool unifiedMemory() const { return m_unifiedMemory; }
+  // host writes to / device writes from a mapped buffer, no-ops on coherent
+  // memory
+  VkResult flushBuffer(const Buffer &buffer, VkDeviceSize offset = 0,
+                       VkDeviceSize size = VK_WHOLE_SIZE) const;
+  VkResult invalidateBuffer(const Buffer &buffer, VkDeviceSize offset = 0,
+                            VkDeviceSize size = VK_WHOLE_SIZE) const;
+
+  // shaderFloat16 and storageBuffer16BitAccess, both enabled when present
+  bool float16Supported() const { return m_float16; }
+  // subgroup operations available to compute shaders, 0 when there are none
+  VkSubgroupFeatureFlags subgroupFeatures() const {
+    return m_subgroupFeatures;
+  }
+  uint32_t subgroupSize() const { return m_subgroupSize; }
+  // maxComputeWorkGroupCount[0], larger grids have to spread into Y
+  uint32_t maxGroupsX() const { return m_maxGroupsX; }
+
+  AllocatorStats allocatorStats() const;
+  void printAllocatorStats() const;
+
+  // created once per process, backed by the on-disk VkPipelineCache
+  Result<VkPipeline> getComputePipeline(const std::vector<uint32_t> &spirv,
+                                        VkPipelineLayout layout,
+                                        const Specialization &spec = {});
+  bool savePipelineCache() const;
+  const std::string &pipelineCachePath() const;
+  PipelineCacheStats pipelineCacheStats() const;
+
+  // spirvPath is looked up as given, then in $MELKIOR_SHADER_DIR and the
+  // build's bin directory
+  Result<Kernel> createKernel(std::string_view spirvPath,
+                              const KernelSignature &signature,
+                              const Specialization &spec = {});
+  Result<Kernel> createKernel(std::string_view name,
+                              const std::vector<uint32_t> &spirv,
+                              const KernelSignature &signature,
+                              const Specialization &spec = {});
+
+  // records through the callback, submits and blocks until the GPU is done;
+  // device writes are made visible to the host before returning
+  VkResult
+  submitAndWait(const std::function<VkResult(VkCommandBuffer)> &record);
+
+  // Records through the callback and submits without waiting. The submission
+  // starts only after every ticket in waitFor has completed, and the returned
+  // ticket completes when it has finished. An empty waitFor orders it after
+  // the previous submission, so batches sharing buffers stay race free; pass
+  // just the tickets it depends on (a default Ticket for none) to let it
+  // overlap the rest. Not thread safe.
+  Result<Ticket>
+  submitAsync(const std::function<VkResult(VkCommandBuffer)> &record,
+              const std::vector<Ticket> &waitFor = {});
+  VkResult wait(Ticket ticket, uint64_t timeoutNs = UINT64_MAX) const;
+  bool poll(Ticket ticket) const;
+  // the ticket of the most recent submission
+  Ticket lastSubmitted() const { return {m_timelineValue}; }
+
+  // GPU timestamps of dispatches recorded through Kernel and CommandStream
+  Profiler &profiler() { return m_profiler; }
+
+  VkDevice device() const { return m_device; }
+  VkPhysicalDevice physicalDevice() const { return m_physicalDevice; }
+  VkQueue queue() const { return m_queue; }
+  uint32_t computeFamilyIndex() const { return m_computeFamilyIndex; }
+
   // void fillAndCopyPractice();
 
 private:
-  VkInstance m_instance;
-  VkPhysicalDevice m_physicalDevice;
-  VkDevice m_device;
-  VkQueue m_queue;
-  uint32_t m_computeFamilyIndex;
+  friend class CommandStream;
+  friend class Kernel;
+
+  Result<VkBuffer> createRawBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                   VkMemoryPropertyFlags memProps,
+                                   VkMemoryRequirements &req,
+                                   uint32_t &memoryTypeIndex);
+
+  // a slot of the in-flight ring, begun and reserved until submitted or
+  // released
+  Result<uint32_t> acquireSlot();
+  Result<Ticket> submitSlot(uint32_t slot, const std::vector<Ticket> &waitFor);
+  void releaseSlot(uint32_t slot);
+  // drops whatever was tied to a command buffer that will never run
+  void discardSlot(VkCommandBuffer cmd);
+  // dispatch_args.spv, created on first use
+  Result<Kernel> dispatchArgsKernel();
+
+  struct InFlight {
+    VkCommandBuffer _cmd = VK_NULL_HANDLE;
+    uint64_t _value = 0;
+    bool _recording = false;
+  };
+
+  VkInstance m_instance = VK_NULL_HANDLE;
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  uint32_t m_computeFamilyIndex = 0;
   VkResult m_result;
   bool m_success;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  VkDeviceSize m_nonCoherentAtomSize = 1;
+  bool m_unifiedMemory = false;
+  PFN_vkGetMemoryHostPointerPropertiesEXT m_getMemoryHostPointerProperties =
+      nullptr;
+  VkDeviceSize m_hostPointerAlignment = 4096;
+  bool m_float16 = false;
+  VkSubgroupFeatureFlags m_subgroupFeatures = 0;
+  uint32_t m_subgroupSize = 1;
+  uint32_t m_maxGroupsX = 65535;
+
+  MemoryArena m_arena;
+  PipelineCache m_pipelineCache;
+  DescriptorCache m_descriptors;
+  Profiler m_profiler;
+  // host -> device, and device -> host preferring HOST_CACHED memory
+  StagingRing m_uploadRing;
+  StagingRing m_readbackRing;
+  uint64_t m_nextBufferId = 1;
+  Kernel m_dispatchArgs;
+
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  std::vector<InFlight> m_ring;
+  uint32_t m_ringIndex = 0;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  uint64_t m_timelineValue = 0;
 };
 
 } // namespace melkior::engine
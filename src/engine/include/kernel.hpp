@@ -0,0 +1,137 @@
+#ifndef MELKIOR_KERNEL_HPP
+#define MELKIOR_KERNEL_HPP
+
+#include "descriptor_cache.hpp"
+#include "types.hpp"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+
+class Engine;
+
+struct WorkGroups {
+  uint32_t _x = 1;
+  uint32_t _y = 1;
+  uint32_t _z = 1;
+};
+
+// number of workgroups of localSize threads needed to cover count items
+constexpr uint32_t groupCount(uint64_t count, uint32_t localSize) {
+  return static_cast<uint32_t>((count + localSize - 1) / localSize);
+}
+
+// groupCount() spread over x and y once it passes maxX, e.g.
+// maxComputeWorkGroupCount[0]; shaders flatten the two and bounds check the
+// excess of the last row. Always at least one group.
+constexpr WorkGroups spread(uint64_t count, uint32_t localSize,
+                            uint32_t maxX) {
+  const uint32_t groups = count == 0 ? 1 : groupCount(count, localSize);
+  const uint32_t x = groups < maxX ? groups : maxX;
+  return {x, groupCount(groups, x)};
+}
+
+// storage buffer bindings of a KernelSignature
+inline constexpr Binding STORAGE_READ{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                      Access::READ};
+inline constexpr Binding STORAGE_WRITE{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                       Access::WRITE};
+inline constexpr Binding STORAGE_READ_WRITE{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                            Access::READ_WRITE};
+
+// GPU only storage buffer of words 32-bit words with transfer usage, at
+// least one word so it can be bound when empty
+Result<Buffer> createStorage(Engine &engine, uint64_t words);
+// destroys buffer unless it was never created, and resets it
+void destroyIfSet(Engine &engine, Buffer &buffer);
+
+// A compute pipeline plus the layouts it was built against. Kernels are cheap
+// handles: the pipeline lives in the engine's registry and the layouts and
+// descriptor sets in its descriptor cache, so copying a Kernel or creating the
+// same one twice costs nothing and nothing has to be destroyed by hand.
+//
+//   auto kernel = engine.createKernel("clear.spv", {{{}}, sizeof(PC)});
+//   kernel.getValue().dispatch({buffer}, pc, {groupCount(N, 256)});
+class Kernel {
+public:
+  Kernel() = default;
+
+  // record + submit + wait, for one-off launches; cost is only used by the
+  // profiler
+  VkResult dispatch(const std::vector<Buffer> &buffers, WorkGroups groups,
+                    Cost cost = {}) {
+    return dispatchRaw(buffers, nullptr, 0, groups, cost);
+  }
+  template <typename PC>
+  VkResult dispatch(const std::vector<Buffer> &buffers, const PC &pushConstants,
+                    WorkGroups groups, Cost cost = {}) {
+    static_assert(!std::is_pointer_v<PC>, "pass push constants by value");
+    return dispatchRaw(buffers, &pushConstants, sizeof(PC), groups, cost);
+  }
+
+  // record into a command buffer owned by the caller
+  VkResult record(VkCommandBuffer cmd, const std::vector<Buffer> &buffers,
+                  WorkGroups groups) const {
+    return recordRaw(cmd, buffers, nullptr, 0, groups);
+  }
+  template <typename PC>
+  VkResult record(VkCommandBuffer cmd, const std::vector<Buffer> &buffers,
+                  const PC &pushConstants, WorkGroups groups) const {
+    static_assert(!std::is_pointer_v<PC>, "pass push constants by value");
+    return recordRaw(cmd, buffers, &pushConstants, sizeof(PC), groups);
+  }
+
+  // vkCmdDispatchIndirect with the VkDispatchIndirectCommand at offset in
+  // args; synchronizing with whatever wrote it is up to the caller
+  VkResult recordIndirect(VkCommandBuffer cmd,
+                          const std::vector<Buffer> &buffers,
+                          const Buffer &args, VkDeviceSize offset = 0) const {
+    return recordIndirectRaw(cmd, buffers, nullptr, 0, args, offset);
+  }
+  template <typename PC>
+  VkResult recordIndirect(VkCommandBuffer cmd,
+                          const std::vector<Buffer> &buffers,
+                          const PC &pushConstants, const Buffer &args,
+                          VkDeviceSize offset = 0) const {
+    static_assert(!std::is_pointer_v<PC>, "pass push constants by value");
+    return recordIndirectRaw(cmd, buffers, &pushConstants, sizeof(PC), args,
+                             offset);
+  }
+
+  VkResult dispatchRaw(const std::vector<Buffer> &buffers,
+                       const void *pushConstants, uint32_t pushConstantSize,
+                       WorkGroups groups, Cost cost = {});
+  VkResult recordRaw(VkCommandBuffer cmd, const std::vector<Buffer> &buffers,
+                     const void *pushConstants, uint32_t pushConstantSize,
+                     WorkGroups groups) const;
+  VkResult recordIndirectRaw(VkCommandBuffer cmd,
+                             const std::vector<Buffer> &buffers,
+                             const void *pushConstants,
+                             uint32_t pushConstantSize, const Buffer &args,
+                             VkDeviceSize offset) const;
+
+  const std::string &name() const { return m_name; }
+  const KernelSignature &signature() const { return m_signature; }
+  VkPipeline pipeline() const { return m_pipeline; }
+  VkPipelineLayout pipelineLayout() const { return m_layouts._pipelineLayout; }
+
+private:
+  friend class Engine;
+
+  // pipeline, descriptor set and push constants
+  VkResult bind(VkCommandBuffer cmd, const std::vector<Buffer> &buffers,
+                const void *pushConstants, uint32_t pushConstantSize) const;
+
+  Engine *m_engine = nullptr;
+  std::string m_name;
+  KernelSignature m_signature;
+  Layouts m_layouts;
+  VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
+
+} // namespace melkior::engine
+
+#endif
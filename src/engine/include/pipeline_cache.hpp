@@ -0,0 +1,104 @@
+#ifndef MELKIOR_PIPELINE_CACHE_HPP
+#define MELKIOR_PIPELINE_CACHE_HPP
+
+#include "types.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+
+// Specialization constant values for one pipeline, e.g.
+//   Specialization spec;
+//   spec.set(0, 256u); // local_size_x_id = 0
+struct Specialization {
+  std::vector<VkSpecializationMapEntry> _entries;
+  std::vector<uint8_t> _data;
+
+  template <typename T> Specialization &set(uint32_t constantId, T value) {
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                  "specialization constants are 32 or 64 bit");
+    VkSpecializationMapEntry entry{};
+    entry.constantID = constantId;
+    entry.offset = static_cast<uint32_t>(_data.size());
+    entry.size = sizeof(T);
+    _entries.push_back(entry);
+    _data.resize(_data.size() + sizeof(T));
+    std::memcpy(_data.data() + entry.offset, &value, sizeof(T));
+    return *this;
+  }
+
+  bool empty() const { return _entries.empty(); }
+};
+
+struct PipelineCacheStats {
+  // bytes handed to vkCreatePipelineCache from disk, 0 on a cold start
+  size_t _loadedBytes = 0;
+  uint32_t _pipelinesCreated = 0;
+  uint32_t _registryHits = 0;
+  double _creationMs = 0.0;
+};
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+Result<std::vector<uint32_t>> readSpirv(std::string_view path);
+
+// resolves a shader file name against the working directory,
+// $MELKIOR_SHADER_DIR and the build's bin directory, in that order
+std::string shaderPath(std::string_view name);
+
+// Owns the device VkPipelineCache and the in-process pipeline registry.
+//
+// The driver cache is loaded from / saved to
+//   <cache dir>/pipeline_cache_<device uuid>_<driver version>.bin
+// where the cache dir is $MELKIOR_CACHE_DIR, $XDG_CACHE_HOME/melkior or
+// ~/.cache/melkior. On top of it every pipeline is registered under
+// (SPIR-V hash, specialization constants, pipeline layout) so a given
+// variant is created only once per process.
+class PipelineCache {
+public:
+  PipelineCache() = default;
+  PipelineCache(const PipelineCache &) = delete;
+  PipelineCache &operator=(const PipelineCache &) = delete;
+
+  VkResult init(VkDevice device, VkPhysicalDevice physicalDevice);
+  void destroy();
+
+  Result<VkPipeline> getComputePipeline(const std::vector<uint32_t> &spirv,
+                                        VkPipelineLayout layout,
+                                        const Specialization &spec = {});
+
+  bool save() const;
+  const std::string &path() const { return m_path; }
+  PipelineCacheStats stats() const { return m_stats; }
+
+private:
+  struct Key {
+    uint64_t _spirvHash;
+    VkPipelineLayout _layout;
+    std::vector<VkSpecializationMapEntry> _entries;
+    std::vector<uint8_t> _data;
+
+    bool operator==(const Key &other) const;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkPipelineCache m_cache = VK_NULL_HANDLE;
+  VkPhysicalDeviceProperties m_deviceProps{};
+  std::string m_path;
+  std::unordered_map<Key, VkPipeline, KeyHash> m_pipelines;
+  PipelineCacheStats m_stats;
+};
+
+} // namespace melkior::engine
+
+#endif
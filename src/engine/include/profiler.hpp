@@ -0,0 +1,111 @@
+#ifndef MELKIOR_PROFILER_HPP
+#define MELKIOR_PROFILER_HPP
+
+#include "types.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+
+// scopes that can be recorded but not yet read back at any one time
+constexpr uint32_t PROFILER_MAX_SCOPES = 4096;
+
+// GPU time of one kernel name, aggregated over every collected dispatch
+struct KernelProfile {
+  std::string _name;
+  uint32_t _count = 0;
+  double _minMs = 0.0;
+  double _meanMs = 0.0;
+  double _p99Ms = 0.0;
+  double _totalMs = 0.0;
+  uint64_t _bytes = 0;
+  uint64_t _flops = 0;
+  // achieved rates over _totalMs, 0 when no cost was declared
+  double _gbps = 0.0;
+  double _gflops = 0.0;
+};
+
+// Brackets recorded commands with vkCmdWriteTimestamp and turns the results
+// into per-kernel statistics and a Chrome trace (chrome://tracing, Perfetto).
+// Disabled by default; enable it with setEnabled(true) or by setting
+// MELKIOR_PROFILE in the environment. CommandStream and Kernel::dispatch
+// record a scope per command, anything else can use begin()/end().
+//
+// Results are read back lazily: a scope is collected once the submission it
+// was recorded into has completed on the engine's timeline.
+class Profiler {
+public:
+  Profiler() = default;
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  VkResult init(VkDevice device, VkPhysicalDevice physicalDevice,
+                uint32_t queueFamilyIndex, VkSemaphore timeline,
+                uint32_t maxScopes = PROFILER_MAX_SCOPES);
+  void destroy();
+
+  // false when the queue family has no timestamp support
+  bool supported() const { return m_pool != VK_NULL_HANDLE; }
+  void setEnabled(bool enabled) { m_enabled = enabled; }
+  bool enabled() const { return m_enabled && supported(); }
+
+  // returns UINT32_MAX when profiling is off or every scope is in use, end()
+  // ignores that value
+  uint32_t begin(VkCommandBuffer cmd, const std::string &name,
+                 Cost cost = {});
+  void end(VkCommandBuffer cmd, uint32_t scope);
+
+  // called by the engine when cmd is submitted as timelineValue, or dropped
+  void submitted(VkCommandBuffer cmd, uint64_t timelineValue);
+  void discard(VkCommandBuffer cmd);
+
+  // reads back every scope whose submission has completed
+  void collect();
+  std::vector<KernelProfile> summary();
+  void print(std::ostream &os = std::cout);
+  bool exportChromeTrace(const std::string &path);
+  // forgets collected results, scopes in flight are kept
+  void clear() { m_events.clear(); }
+
+  // scopes skipped because all of them were in flight
+  uint32_t dropped() const { return m_dropped; }
+
+private:
+  struct Scope {
+    std::string _name;
+    Cost _cost;
+    VkCommandBuffer _cmd = VK_NULL_HANDLE;
+    // timeline value of the submission, 0 while still recording
+    uint64_t _value = 0;
+  };
+
+  struct Event {
+    std::string _name;
+    Cost _cost;
+    uint64_t _start = 0;
+    uint64_t _end = 0;
+  };
+
+  double toMs(uint64_t ticks) const { return ticks * m_periodNs * 1e-6; }
+
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueryPool m_pool = VK_NULL_HANDLE;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  bool m_enabled = false;
+  double m_periodNs = 1.0;
+  uint64_t m_mask = ~0ull;
+
+  // scope i owns queries 2i and 2i + 1
+  std::vector<Scope> m_scopes;
+  std::vector<uint32_t> m_free;
+  std::vector<uint32_t> m_inFlight;
+  std::vector<Event> m_events;
+  uint32_t m_dropped = 0;
+};
+
+} // namespace melkior::engine
+
+#endif
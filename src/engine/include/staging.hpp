@@ -0,0 +1,116 @@
+#ifndef MELKIOR_STAGING_HPP
+#define MELKIOR_STAGING_HPP
+
+#include "types.hpp"
+
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+
+// size of each of the engine's staging rings (upload and readback), one
+// 3840x2160 RGBA8 frame fits; allocated on first use
+constexpr VkDeviceSize STAGING_RING_SIZE = 64ull * 1024 * 1024;
+
+// A piece of a staging ring, mapped and ready for memcpy. Valid until the
+// submission it was allocated for has completed.
+struct StagingRegion {
+  VkBuffer _buffer = VK_NULL_HANDLE;
+  VkDeviceMemory _memory = VK_NULL_HANDLE;
+  // offset inside _buffer and _memory, the buffer is bound at 0
+  VkDeviceSize _offset = 0;
+  VkDeviceSize _size = 0;
+  void *_mapped = nullptr;
+};
+
+// One persistently mapped buffer handed out front to back. Every region is
+// owned by the command buffer it was allocated for and is recycled once the
+// engine's timeline shows that submission complete, so steady streaming
+// never allocates or maps memory. When the ring is full of in-flight work
+// allocate() waits for the oldest submission; requests that can't be served
+// from the ring at all (bigger than it, or blocked by work that is still
+// being recorded or by pinned regions) get a temporary buffer of their own.
+//
+// Pinned regions (readbacks) also outlive their submission until release()
+// is called, so the host can copy out of them whenever it gets around to it.
+//
+// init() only picks the size; the buffer is created and mapped by the first
+// allocate(), so an engine that never uploads or reads back never holds it.
+class StagingRing {
+public:
+  StagingRing() = default;
+  StagingRing(const StagingRing &) = delete;
+  StagingRing &operator=(const StagingRing &) = delete;
+
+  // the first memory type in preferred that exists is used, chosen when
+  // the buffer is created
+  VkResult init(VkDevice device, VkPhysicalDevice physicalDevice,
+                VkSemaphore timeline, VkDeviceSize size,
+                VkBufferUsageFlags usage,
+                const std::vector<VkMemoryPropertyFlags> &preferred);
+  void destroy();
+
+  Result<StagingRegion> allocate(VkCommandBuffer owner, VkDeviceSize size,
+                                 bool pinned = false);
+  void release(const StagingRegion &region);
+
+  // called by the engine when owner is submitted as timelineValue, or dropped
+  void submitted(VkCommandBuffer owner, uint64_t timelineValue);
+  void discard(VkCommandBuffer owner);
+
+  // makes device writes visible to the host, a no-op on coherent memory
+  void invalidate(const StagingRegion &region) const;
+
+  // 0 until the first allocate()
+  VkMemoryPropertyFlags memoryProperties() const { return m_properties; }
+  VkDeviceSize size() const { return m_size; }
+
+private:
+  struct Span {
+    VkDeviceSize _begin = 0;
+    VkDeviceSize _end = 0;
+    VkCommandBuffer _owner = VK_NULL_HANDLE;
+    // timeline value of the submission, 0 while still recording
+    uint64_t _value = 0;
+    bool _discarded = false;
+    bool _pinned = false;
+  };
+
+  struct Overflow {
+    VkBuffer _buffer = VK_NULL_HANDLE;
+    VkDeviceMemory _memory = VK_NULL_HANDLE;
+    VkCommandBuffer _owner = VK_NULL_HANDLE;
+    uint64_t _value = 0;
+    bool _pinned = false;
+  };
+
+  // the ring buffer itself, on the first allocate()
+  VkResult create();
+  Result<StagingRegion> createBuffer(VkDeviceSize size, VkBuffer &buffer,
+                                     VkDeviceMemory &memory);
+  // pops finished spans off the front, frees finished overflow buffers
+  void reclaim();
+  bool fits(VkDeviceSize size, VkDeviceSize &offset) const;
+
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  VkBufferUsageFlags m_usage = 0;
+  std::vector<VkMemoryPropertyFlags> m_preferred;
+  uint32_t m_memoryTypeIndex = 0;
+  VkMemoryPropertyFlags m_properties = 0;
+  VkDeviceSize m_alignment = 64;
+
+  VkBuffer m_buffer = VK_NULL_HANDLE;
+  VkDeviceMemory m_memory = VK_NULL_HANDLE;
+  uint8_t *m_mapped = nullptr;
+  VkDeviceSize m_size = 0;
+  VkDeviceSize m_head = 0;
+  std::deque<Span> m_spans;
+  std::vector<Overflow> m_overflow;
+};
+
+} // namespace melkior::engine
+
+#endif
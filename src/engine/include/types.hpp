@@ -0,0 +1,75 @@
+#ifndef MELKIOR_TYPES_HPP
+#define MELKIOR_TYPES_HPP
+
+#include <cstdint>
+#include <variant>
+#include <vulkan/vulkan.h>
+#include <vulkan/vulkan_core.h>
+
+namespace melkior::engine {
+
+// utility data structs
+struct EngineState {
+  bool _ready;
+  VkResult _result;
+};
+
+template <typename T> struct Result {
+  std::variant<T, VkResult> _result;
+
+  bool isValid() { return !std::holds_alternative<VkResult>(_result); }
+
+  VkResult getError() { return std::get<VkResult>(_result); }
+
+  T getValue() { return std::get<T>(_result); }
+};
+
+// Where a piece of device memory came from. Buffers created through
+// Engine::createBuffer live inside one of the arena blocks; dedicated buffers
+// own their VkDeviceMemory outright.
+struct Allocation {
+  static constexpr uint32_t DEDICATED = UINT32_MAX;
+
+  VkDeviceMemory _memory = VK_NULL_HANDLE;
+  VkDeviceSize _offset = 0;
+  VkDeviceSize _size = 0;
+  void *_mapped = nullptr;
+  uint32_t _memoryTypeIndex = 0;
+  uint32_t _blockId = DEDICATED;
+};
+
+// A plain handle: copies name the same VkBuffer, and destroyBuffer() on any
+// of them invalidates all. Classes that hold Buffers of their own and free
+// them in destroy() follow the same rule; a reserve() that reallocates frees
+// the old buffers too, so give such an object one owner and pass it around
+// by reference.
+struct Buffer {
+  // unique per engine, never reused (VkBuffer handles can be)
+  uint64_t _id = 0;
+  VkBuffer _buffer = VK_NULL_HANDLE;
+  VkDeviceMemory _memory = VK_NULL_HANDLE;
+  VkDeviceSize _size = 0;
+  // offset of the buffer inside _memory
+  VkDeviceSize _offset = 0;
+  // persistent host pointer, only set for HOST_VISIBLE memory
+  void *_mapped = nullptr;
+  Allocation _allocation{};
+};
+
+// Completion point of an asynchronous submission: the value the engine's
+// timeline semaphore reaches once the GPU is done with it. A default
+// constructed ticket counts as complete.
+struct Ticket {
+  uint64_t _value = 0;
+};
+
+// Work done by one dispatch as declared by the caller, used by the profiler to
+// turn GPU time into GB/s and GFLOP/s.
+struct Cost {
+  uint64_t _bytes = 0;
+  uint64_t _flops = 0;
+};
+
+} // namespace melkior::engine
+
+#endif
@@ -0,0 +1,286 @@
+#include "../include/allocator.hpp"
+
+#include <algorithm>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool isHostVisible(VkMemoryPropertyFlags flags) {
+  return flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+bool isNonCoherent(VkMemoryPropertyFlags flags) {
+  return isHostVisible(flags) &&
+         !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+} // namespace
+
+void MemoryArena::init(VkDevice device, VkPhysicalDevice physicalDevice,
+                       VkDeviceSize blockSize) {
+  m_device = device;
+  m_blockSize = blockSize;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(physicalDevice, &props);
+  m_nonCoherentAtomSize =
+      std::max<VkDeviceSize>(1, props.limits.nonCoherentAtomSize);
+}
+
+void MemoryArena::destroy() {
+  if (m_device == VK_NULL_HANDLE) {
+    return;
+  }
+  for (auto &blocks : m_blocks) {
+    for (auto &block : blocks) {
+      if (block._memory != VK_NULL_HANDLE) {
+        vkFreeMemory(m_device, block._memory, nullptr);
+      }
+    }
+    blocks.clear();
+  }
+  m_usedBytes = 0;
+  m_device = VK_NULL_HANDLE;
+}
+
+Result<uint32_t> MemoryArena::createBlock(uint32_t memoryTypeIndex,
+                                          VkDeviceSize size, bool dedicated) {
+  Block block{};
+  block._size = size;
+  block._dedicated = dedicated;
+
+  VkMemoryAllocateInfo mai{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+  mai.allocationSize = size;
+  mai.memoryTypeIndex = memoryTypeIndex;
+
+  auto result = vkAllocateMemory(m_device, &mai, nullptr, &block._memory);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+  m_deviceAllocations++;
+
+  // host visible blocks stay mapped for their whole lifetime, mapping the same
+  // VkDeviceMemory twice is not allowed once buffers share it
+  if (isHostVisible(
+          m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags)) {
+    result = vkMapMemory(m_device, block._memory, 0, VK_WHOLE_SIZE, 0,
+                         &block._mapped);
+    if (result != VK_SUCCESS) {
+      vkFreeMemory(m_device, block._memory, nullptr);
+      return {result};
+    }
+  }
+
+  block._freeRanges.push_back({0, size});
+
+  auto &blocks = m_blocks[memoryTypeIndex];
+  for (uint32_t i = 0; i < blocks.size(); i++) {
+    if (blocks[i]._memory == VK_NULL_HANDLE) {
+      blocks[i] = std::move(block);
+      return {i};
+    }
+  }
+  blocks.push_back(std::move(block));
+  return {static_cast<uint32_t>(blocks.size() - 1)};
+}
+
+void MemoryArena::releaseBlock(uint32_t memoryTypeIndex, uint32_t blockId) {
+  auto &block = m_blocks[memoryTypeIndex][blockId];
+  vkFreeMemory(m_device, block._memory, nullptr);
+  block = Block{};
+}
+
+bool MemoryArena::tryPlace(Block &block, VkDeviceSize size,
+                           VkDeviceSize alignment, VkDeviceSize &offset) {
+  // best fit: the smallest free range that still holds the aligned request
+  size_t best = block._freeRanges.size();
+  VkDeviceSize bestWaste = ~VkDeviceSize(0);
+  for (size_t i = 0; i < block._freeRanges.size(); i++) {
+    const auto &range = block._freeRanges[i];
+    VkDeviceSize start = alignUp(range._offset, alignment);
+    VkDeviceSize end = range._offset + range._size;
+    if (start + size > end) {
+      continue;
+    }
+    // the alignment padding in front is lost as well
+    VkDeviceSize waste = end - start - size;
+    if (waste < bestWaste) {
+      best = i;
+      bestWaste = waste;
+    }
+  }
+  if (best == block._freeRanges.size()) {
+    return false;
+  }
+
+  Range range = block._freeRanges[best];
+  offset = alignUp(range._offset, alignment);
+  VkDeviceSize end = range._offset + range._size;
+
+  block._freeRanges.erase(block._freeRanges.begin() + best);
+  // keep the list sorted by offset: tail first, then the alignment padding
+  if (offset + size < end) {
+    block._freeRanges.insert(block._freeRanges.begin() + best,
+                             {offset + size, end - offset - size});
+  }
+  if (offset > range._offset) {
+    block._freeRanges.insert(block._freeRanges.begin() + best,
+                             {range._offset, offset - range._offset});
+  }
+  return true;
+}
+
+Result<Allocation> MemoryArena::allocate(const VkMemoryRequirements &req,
+                                         uint32_t memoryTypeIndex) {
+  VkMemoryPropertyFlags flags =
+      m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+  VkDeviceSize size = req.size;
+  VkDeviceSize alignment = std::max<VkDeviceSize>(1, req.alignment);
+  // flush/invalidate ranges must not touch a neighbouring allocation
+  if (isNonCoherent(flags)) {
+    alignment = std::max(alignment, m_nonCoherentAtomSize);
+    size = alignUp(size, m_nonCoherentAtomSize);
+  }
+
+  auto &blocks = m_blocks[memoryTypeIndex];
+
+  uint32_t blockId = Allocation::DEDICATED;
+  VkDeviceSize offset = 0;
+
+  if (size <= m_blockSize / 2) {
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+      auto &block = blocks[i];
+      if (block._memory == VK_NULL_HANDLE || block._dedicated) {
+        continue;
+      }
+      if (tryPlace(block, size, alignment, offset)) {
+        blockId = i;
+        break;
+      }
+    }
+
+    if (blockId == Allocation::DEDICATED) {
+      auto created = createBlock(memoryTypeIndex, m_blockSize, false);
+      if (created.isValid()) {
+        if (tryPlace(blocks[created.getValue()], size, alignment, offset)) {
+          blockId = created.getValue();
+        } else {
+          releaseBlock(memoryTypeIndex, created.getValue());
+        }
+      }
+    }
+  }
+
+  // large request, or the heap could not fit another full block
+  if (blockId == Allocation::DEDICATED) {
+    auto created = createBlock(memoryTypeIndex, size, true);
+    if (!created.isValid()) {
+      return {created.getError()};
+    }
+    blockId = created.getValue();
+    tryPlace(blocks[blockId], size, alignment, offset);
+  }
+
+  auto &block = blocks[blockId];
+  block._used += size;
+  block._allocationCount++;
+
+  m_usedBytes += size;
+  m_peakUsedBytes = std::max(m_peakUsedBytes, m_usedBytes);
+
+  Allocation out{};
+  out._memory = block._memory;
+  out._offset = offset;
+  out._size = size;
+  out._mapped =
+      block._mapped ? static_cast<char *>(block._mapped) + offset : nullptr;
+  out._memoryTypeIndex = memoryTypeIndex;
+  out._blockId = blockId;
+  return {out};
+}
+
+void MemoryArena::free(const Allocation &allocation) {
+  auto &blocks = m_blocks[allocation._memoryTypeIndex];
+  auto &block = blocks[allocation._blockId];
+
+  block._used -= allocation._size;
+  block._allocationCount--;
+  m_usedBytes -= allocation._size;
+
+  if (block._dedicated) {
+    releaseBlock(allocation._memoryTypeIndex, allocation._blockId);
+    return;
+  }
+
+  auto &ranges = block._freeRanges;
+  auto it = std::lower_bound(ranges.begin(), ranges.end(), allocation._offset,
+                             [](const Range &r, VkDeviceSize offset) {
+                               return r._offset < offset;
+                             });
+  it = ranges.insert(it, {allocation._offset, allocation._size});
+
+  // coalesce with the following and preceding range
+  auto next = it + 1;
+  if (next != ranges.end() && it->_offset + it->_size == next->_offset) {
+    it->_size += next->_size;
+    ranges.erase(next);
+  }
+  if (it != ranges.begin()) {
+    auto prev = it - 1;
+    if (prev->_offset + prev->_size == it->_offset) {
+      prev->_size += it->_size;
+      ranges.erase(it);
+    }
+  }
+
+  if (block._allocationCount > 0) {
+    return;
+  }
+
+  // keep one empty block per memory type around so a create/destroy loop does
+  // not end up calling vkAllocateMemory every time
+  for (uint32_t i = 0; i < blocks.size(); i++) {
+    if (i != allocation._blockId && blocks[i]._memory != VK_NULL_HANDLE &&
+        !blocks[i]._dedicated && blocks[i]._allocationCount == 0) {
+      releaseBlock(allocation._memoryTypeIndex, allocation._blockId);
+      return;
+    }
+  }
+}
+
+AllocatorStats MemoryArena::stats() const {
+  AllocatorStats out{};
+  out._deviceAllocations = m_deviceAllocations;
+  out._usedBytes = m_usedBytes;
+  out._peakUsedBytes = m_peakUsedBytes;
+
+  for (const auto &blocks : m_blocks) {
+    for (const auto &block : blocks) {
+      if (block._memory == VK_NULL_HANDLE) {
+        continue;
+      }
+      out._blockCount++;
+      out._allocationCount += block._allocationCount;
+      out._reservedBytes += block._size;
+      for (const auto &range : block._freeRanges) {
+        out._freeBytes += range._size;
+        out._largestFreeRange = std::max(out._largestFreeRange, range._size);
+      }
+    }
+  }
+
+  if (out._freeBytes > 0) {
+    out._fragmentation =
+        1.0 - static_cast<double>(out._largestFreeRange) / out._freeBytes;
+  }
+  return out;
+}
+
+} // namespace melkior::engine
@@ -0,0 +1,504 @@
+#include "../include/command_stream.hpp"
+#include "../include/engine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+namespace {
+
+constexpr VkAccessFlags kWriteAccess =
+    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+VkAccessFlags shaderAccess(Access access) {
+  switch (access) {
+  case Access::READ:
+    return VK_ACCESS_SHADER_READ_BIT;
+  case Access::WRITE:
+    return VK_ACCESS_SHADER_WRITE_BIT;
+  case Access::READ_WRITE:
+  default:
+    return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  }
+}
+
+} // namespace
+
+CommandStream::CommandStream(Engine &engine) : m_engine(engine) {
+  m_result = begin();
+}
+
+CommandStream::~CommandStream() {
+  if (m_slot != UINT32_MAX) {
+    m_engine.releaseSlot(m_slot);
+  }
+  // submitted but never waited for, the data is dropped
+  for (const auto &pending : m_readbacks) {
+    if (pending._value != 0 && !pending._direct) {
+      m_engine.m_readbackRing.release(pending._region);
+    }
+  }
+}
+
+VkResult CommandStream::begin() {
+  m_states.clear();
+  m_pendingBarriers.clear();
+  m_pendingSrcStages = 0;
+  m_pendingDstStages = 0;
+  m_usedStages = 0;
+  m_commandCount = 0;
+  m_barrierCount = 0;
+
+  auto slot = m_engine.acquireSlot();
+  if (!slot.isValid()) {
+    m_slot = UINT32_MAX;
+    m_cmd = VK_NULL_HANDLE;
+    return slot.getError();
+  }
+  m_slot = slot.getValue();
+  m_cmd = m_engine.m_ring[m_slot]._cmd;
+  return VK_SUCCESS;
+}
+
+void CommandStream::access(const Buffer &buffer, VkPipelineStageFlags stage,
+                           VkAccessFlags accessMask, bool write) {
+  auto &state = m_states[buffer._id];
+  m_usedStages |= stage;
+
+  bool hasWrite = state._writeStage != 0;
+  bool alreadyVisible = (stage & ~state._visibleStages) == 0 &&
+                        (accessMask & ~state._visibleAccess) == 0;
+  bool needMemory = hasWrite && !alreadyVisible;
+  bool needExecution = write && state._readStages != 0;
+
+  if (needMemory) {
+    VkBufferMemoryBarrier bmb{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+    bmb.srcAccessMask = state._writeAccess;
+    bmb.dstAccessMask = accessMask;
+    bmb.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bmb.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bmb.buffer = buffer._buffer;
+    bmb.offset = 0;
+    bmb.size = VK_WHOLE_SIZE;
+    m_pendingBarriers.push_back(bmb);
+    m_pendingSrcStages |= state._writeStage;
+    m_pendingDstStages |= stage;
+  }
+  if (needExecution) {
+    // write after read only has to wait for the reads to finish
+    m_pendingSrcStages |= state._readStages;
+    m_pendingDstStages |= stage;
+  }
+
+  if (write) {
+    state._writeStage = stage;
+    state._writeAccess = accessMask & kWriteAccess;
+    state._visibleStages = 0;
+    state._visibleAccess = 0;
+    state._readStages = 0;
+  } else {
+    if (needMemory) {
+      state._visibleStages |= stage;
+      state._visibleAccess |= accessMask;
+    }
+    state._readStages |= stage;
+  }
+}
+
+void CommandStream::flushBarriers() {
+  flushUploads();
+  emitBarriers();
+}
+
+void CommandStream::emitBarriers() {
+  if (m_pendingDstStages == 0) {
+    return;
+  }
+  vkCmdPipelineBarrier(m_cmd, m_pendingSrcStages, m_pendingDstStages, 0, 0,
+                       nullptr,
+                       static_cast<uint32_t>(m_pendingBarriers.size()),
+                       m_pendingBarriers.data(), 0, nullptr);
+  m_barrierCount++;
+  m_pendingBarriers.clear();
+  m_pendingSrcStages = 0;
+  m_pendingDstStages = 0;
+}
+
+bool CommandStream::declareDispatch(const Kernel &kernel,
+                                    const std::vector<Buffer> &buffers) {
+  if (m_result != VK_SUCCESS) {
+    return false;
+  }
+  const auto &bindings = kernel.signature()._bindings;
+  if (buffers.size() != bindings.size()) {
+    m_result = VK_ERROR_UNKNOWN;
+    return false;
+  }
+  flushUploads();
+
+  // the same buffer may be bound more than once, merge its accesses first
+  std::vector<std::pair<size_t, VkAccessFlags>> accesses;
+  accesses.reserve(buffers.size());
+  for (size_t i = 0; i < buffers.size(); i++) {
+    VkAccessFlags mask = shaderAccess(bindings[i]._access);
+    if (bindings[i]._type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+      mask = VK_ACCESS_UNIFORM_READ_BIT;
+    }
+    bool merged = false;
+    for (auto &entry : accesses) {
+      if (buffers[entry.first]._id == buffers[i]._id) {
+        entry.second |= mask;
+        merged = true;
+        break;
+      }
+    }
+    if (!merged) {
+      accesses.emplace_back(i, mask);
+    }
+  }
+  for (const auto &entry : accesses) {
+    access(buffers[entry.first], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+           entry.second, (entry.second & kWriteAccess) != 0);
+  }
+  return true;
+}
+
+void CommandStream::dispatchRaw(const Kernel &kernel,
+                                const std::vector<Buffer> &buffers,
+                                const void *pushConstants,
+                                uint32_t pushConstantSize, WorkGroups groups,
+                                Cost cost) {
+  if (!declareDispatch(kernel, buffers)) {
+    return;
+  }
+  emitBarriers();
+
+  auto &profiler = m_engine.m_profiler;
+  uint32_t scope = profiler.begin(m_cmd, kernel.name(), cost);
+  m_result = kernel.recordRaw(m_cmd, buffers, pushConstants, pushConstantSize,
+                              groups);
+  profiler.end(m_cmd, scope);
+  m_commandCount++;
+}
+
+void CommandStream::dispatchIndirectRaw(const Kernel &kernel,
+                                        const std::vector<Buffer> &buffers,
+                                        const void *pushConstants,
+                                        uint32_t pushConstantSize,
+                                        const Buffer &args,
+                                        VkDeviceSize offset, Cost cost) {
+  if (!declareDispatch(kernel, buffers)) {
+    return;
+  }
+  // the group counts are fetched before the shader stage
+  access(args, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+         VK_ACCESS_INDIRECT_COMMAND_READ_BIT, false);
+  emitBarriers();
+
+  auto &profiler = m_engine.m_profiler;
+  uint32_t scope = profiler.begin(m_cmd, kernel.name(), cost);
+  m_result = kernel.recordIndirectRaw(m_cmd, buffers, pushConstants,
+                                      pushConstantSize, args, offset);
+  profiler.end(m_cmd, scope);
+  m_commandCount++;
+}
+
+void CommandStream::dispatchArgs(const Buffer &count, const Buffer &args,
+                                 uint32_t groupSize, VkDeviceSize countOffset,
+                                 VkDeviceSize argsOffset) {
+  if (m_result != VK_SUCCESS) {
+    return;
+  }
+  if (groupSize == 0 || countOffset % 4 != 0 || argsOffset % 4 != 0 ||
+      countOffset + sizeof(uint32_t) > count._size ||
+      argsOffset + sizeof(VkDispatchIndirectCommand) > args._size) {
+    m_result = VK_ERROR_UNKNOWN;
+    return;
+  }
+  auto kernel = m_engine.dispatchArgsKernel();
+  if (!kernel.isValid()) {
+    m_result = kernel.getError();
+    return;
+  }
+  // matches the push constant block of dispatch_args.comp
+  struct PushConstants {
+    uint32_t countOffset;
+    uint32_t argsOffset;
+    uint32_t groupSize;
+    uint32_t maxGroupsX;
+  };
+  dispatch(kernel.getValue(), {count, args},
+           PushConstants{static_cast<uint32_t>(countOffset / 4),
+                         static_cast<uint32_t>(argsOffset / 4), groupSize,
+                         m_engine.maxGroupsX()},
+           {1}, {4 * sizeof(uint32_t), 0});
+}
+
+void CommandStream::copy(const Buffer &src, const Buffer &dst,
+                         VkDeviceSize size, VkDeviceSize srcOffset,
+                         VkDeviceSize dstOffset) {
+  if (m_result != VK_SUCCESS) {
+    return;
+  }
+  flushUploads();
+  access(src, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+         false);
+  access(dst, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+         true);
+  emitBarriers();
+
+  VkBufferCopy region{};
+  region.srcOffset = srcOffset;
+  region.dstOffset = dstOffset;
+  region.size = size == VK_WHOLE_SIZE ? src._size - srcOffset : size;
+  auto &profiler = m_engine.m_profiler;
+  uint32_t scope = profiler.begin(m_cmd, "copy", {2 * region.size, 0});
+  vkCmdCopyBuffer(m_cmd, src._buffer, dst._buffer, 1, &region);
+  profiler.end(m_cmd, scope);
+  m_commandCount++;
+}
+
+void CommandStream::fill(const Buffer &dst, uint32_t value,
+                         VkDeviceSize offset, VkDeviceSize size) {
+  if (m_result != VK_SUCCESS) {
+    return;
+  }
+  flushUploads();
+  access(dst, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+         true);
+  emitBarriers();
+
+  auto &profiler = m_engine.m_profiler;
+  uint32_t scope = profiler.begin(
+      m_cmd, "fill", {size == VK_WHOLE_SIZE ? dst._size - offset : size, 0});
+  vkCmdFillBuffer(m_cmd, dst._buffer, offset, size, value);
+  profiler.end(m_cmd, scope);
+  m_commandCount++;
+}
+
+void CommandStream::upload(const Buffer &dst, const void *data,
+                           VkDeviceSize size, VkDeviceSize dstOffset) {
+  if (m_result != VK_SUCCESS || size == 0) {
+    return;
+  }
+  auto region = m_engine.m_uploadRing.allocate(m_cmd, size);
+  if (!region.isValid()) {
+    m_result = region.getError();
+    return;
+  }
+  StagingRegion staging = region.getValue();
+  std::memcpy(staging._mapped, data, size);
+
+  // the regions of one vkCmdCopyBuffer must not overlap
+  for (const auto &pending : m_uploads) {
+    if (pending._dst._id == dst._id &&
+        dstOffset < pending._region.dstOffset + pending._region.size &&
+        pending._region.dstOffset < dstOffset + size) {
+      flushUploads();
+      break;
+    }
+  }
+
+  VkBufferCopy copy{};
+  copy.srcOffset = staging._offset;
+  copy.dstOffset = dstOffset;
+  copy.size = size;
+  m_uploads.push_back({staging._buffer, dst, copy});
+}
+
+void CommandStream::flushUploads() {
+  if (m_uploads.empty()) {
+    return;
+  }
+  // one write access per destination, the batch is a single transfer
+  std::stable_sort(m_uploads.begin(), m_uploads.end(),
+                   [](const PendingUpload &a, const PendingUpload &b) {
+                     return a._dst._id < b._dst._id;
+                   });
+  for (size_t i = 0; i < m_uploads.size(); i++) {
+    if (i == 0 || m_uploads[i]._dst._id != m_uploads[i - 1]._dst._id) {
+      access(m_uploads[i]._dst, VK_PIPELINE_STAGE_TRANSFER_BIT,
+             VK_ACCESS_TRANSFER_WRITE_BIT, true);
+    }
+  }
+  emitBarriers();
+
+  auto &profiler = m_engine.m_profiler;
+  std::vector<VkBufferCopy> regions;
+  while (!m_uploads.empty()) {
+    // overflow uploads come from their own staging buffer
+    VkBuffer src = m_uploads.front()._src;
+    Buffer dst = m_uploads.front()._dst;
+    auto group = std::stable_partition(
+        m_uploads.begin(), m_uploads.end(), [&](const PendingUpload &pending) {
+          return pending._dst._id != dst._id || pending._src != src;
+        });
+    regions.clear();
+    VkDeviceSize bytes = 0;
+    for (auto it = group; it != m_uploads.end(); ++it) {
+      regions.push_back(it->_region);
+      bytes += it->_region.size;
+    }
+    m_uploads.erase(group, m_uploads.end());
+
+    uint32_t scope = profiler.begin(m_cmd, "upload", {2 * bytes, 0});
+    vkCmdCopyBuffer(m_cmd, src, dst._buffer,
+                    static_cast<uint32_t>(regions.size()), regions.data());
+    profiler.end(m_cmd, scope);
+    m_commandCount++;
+  }
+}
+
+void CommandStream::readback(const Buffer &src, void *data, VkDeviceSize size,
+                             VkDeviceSize srcOffset) {
+  if (m_result != VK_SUCCESS || size == 0) {
+    return;
+  }
+  flushUploads();
+  auto region = m_engine.m_readbackRing.allocate(m_cmd, size, true);
+  if (!region.isValid()) {
+    m_result = region.getError();
+    return;
+  }
+  StagingRegion staging = region.getValue();
+
+  access(src, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+         false);
+  emitBarriers();
+
+  VkBufferCopy copy{};
+  copy.srcOffset = srcOffset;
+  copy.dstOffset = staging._offset;
+  copy.size = size;
+  auto &profiler = m_engine.m_profiler;
+  uint32_t scope = profiler.begin(m_cmd, "readback", {2 * size, 0});
+  vkCmdCopyBuffer(m_cmd, src._buffer, staging._buffer, 1, &copy);
+  profiler.end(m_cmd, scope);
+  // the host barrier at submit covers transfer writes
+  m_usedStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+  m_commandCount++;
+
+  m_readbacks.push_back({staging, data, size});
+}
+
+void CommandStream::write(const Buffer &dst, const void *data,
+                          VkDeviceSize size, VkDeviceSize dstOffset) {
+  if (dst._mapped == nullptr) {
+    upload(dst, data, size, dstOffset);
+    return;
+  }
+  if (m_result != VK_SUCCESS || size == 0) {
+    return;
+  }
+  auto *target = static_cast<uint8_t *>(dst._mapped) + dstOffset;
+  // imported host memory is already where the data is
+  if (target != data) {
+    std::memcpy(target, data, size);
+  }
+  // host writes before vkQueueSubmit are visible to the device
+  m_result = m_engine.flushBuffer(dst, dstOffset, size);
+}
+
+void CommandStream::read(const Buffer &src, void *data, VkDeviceSize size,
+                         VkDeviceSize srcOffset) {
+  if (src._mapped == nullptr) {
+    readback(src, data, size, srcOffset);
+    return;
+  }
+  if (m_result != VK_SUCCESS || size == 0) {
+    return;
+  }
+  PendingReadback pending{};
+  pending._data = data;
+  pending._size = size;
+  pending._direct = true;
+  pending._buffer = src;
+  pending._offset = srcOffset;
+  m_readbacks.push_back(pending);
+}
+
+Result<Ticket> CommandStream::submitAsync(const std::vector<Ticket> &waitFor) {
+  if (m_result != VK_SUCCESS) {
+    return {m_result};
+  }
+  flushBarriers();
+
+  if (m_usedStages != 0) {
+    VkMemoryBarrier mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    mb.srcAccessMask = kWriteAccess;
+    mb.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(m_cmd, m_usedStages, VK_PIPELINE_STAGE_HOST_BIT, 0, 1,
+                         &mb, 0, nullptr, 0, nullptr);
+  }
+
+  auto ticket = m_engine.submitSlot(m_slot, waitFor);
+  m_slot = UINT32_MAX;
+  // the regions of a failed submission were discarded with its slot
+  m_readbacks.erase(std::remove_if(m_readbacks.begin(), m_readbacks.end(),
+                                   [&](PendingReadback &pending) {
+                                     if (pending._value != 0) {
+                                       return false;
+                                     }
+                                     if (!ticket.isValid()) {
+                                       return true;
+                                     }
+                                     pending._value = ticket.getValue()._value;
+                                     return false;
+                                   }),
+                    m_readbacks.end());
+  if (!ticket.isValid()) {
+    m_result = ticket.getError();
+    return ticket;
+  }
+
+  m_result = begin();
+  return ticket;
+}
+
+VkResult CommandStream::submit() {
+  auto ticket = submitAsync();
+  if (!ticket.isValid()) {
+    return ticket.getError();
+  }
+  return wait(ticket.getValue());
+}
+
+VkResult CommandStream::wait(Ticket ticket) {
+  auto result = m_engine.wait(ticket);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  auto &ring = m_engine.m_readbackRing;
+  m_readbacks.erase(
+      std::remove_if(m_readbacks.begin(), m_readbacks.end(),
+                     [&](const PendingReadback &pending) {
+                       if (pending._value == 0 ||
+                           pending._value > ticket._value) {
+                         return false;
+                       }
+                       if (pending._direct) {
+                         m_engine.invalidateBuffer(pending._buffer,
+                                                   pending._offset,
+                                                   pending._size);
+                         const auto *source =
+                             static_cast<const uint8_t *>(
+                                 pending._buffer._mapped) +
+                             pending._offset;
+                         if (source != pending._data) {
+                           std::memcpy(pending._data, source, pending._size);
+                         }
+                         return true;
+                       }
+                       ring.invalidate(pending._region);
+                       std::memcpy(pending._data, pending._region._mapped,
+                                   pending._size);
+                       ring.release(pending._region);
+                       return true;
+                     }),
+      m_readbacks.end());
+  return VK_SUCCESS;
+}
+
+} // namespace melkior::engine
@@ -0,0 +1,201 @@
+#include "../include/descriptor_cache.hpp"
+
+#include <algorithm>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+namespace {
+
+constexpr uint32_t kSetsPerPool = 256;
+
+} // namespace
+
+void DescriptorCache::init(VkDevice device) { m_device = device; }
+
+void DescriptorCache::destroy() {
+  if (m_device == VK_NULL_HANDLE) {
+    return;
+  }
+  // sets go away with their pools
+  for (auto pool : m_pools) {
+    vkDestroyDescriptorPool(m_device, pool, nullptr);
+  }
+  m_pools.clear();
+  m_sets.clear();
+  m_setsByBuffer.clear();
+
+  for (auto &entry : m_layouts) {
+    vkDestroyPipelineLayout(m_device, entry.second._pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, entry.second._setLayout, nullptr);
+  }
+  m_layouts.clear();
+  m_device = VK_NULL_HANDLE;
+}
+
+Result<Layouts> DescriptorCache::getLayouts(const KernelSignature &signature) {
+  LayoutKey key;
+  key.reserve(signature._bindings.size() + 1);
+  key.push_back(signature._pushConstantSize);
+  for (const auto &binding : signature._bindings) {
+    key.push_back(static_cast<uint32_t>(binding._type));
+  }
+
+  auto found = m_layouts.find(key);
+  if (found != m_layouts.end()) {
+    return {found->second};
+  }
+
+  std::vector<VkDescriptorSetLayoutBinding> bindings(
+      signature._bindings.size());
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = signature._bindings[i]._type;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo dsci{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+  dsci.bindingCount = static_cast<uint32_t>(bindings.size());
+  dsci.pBindings = bindings.data();
+
+  Layouts layouts{};
+  auto result = vkCreateDescriptorSetLayout(m_device, &dsci, nullptr,
+                                            &layouts._setLayout);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  VkPushConstantRange pcr{};
+  pcr.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pcr.offset = 0;
+  pcr.size = signature._pushConstantSize;
+
+  VkPipelineLayoutCreateInfo plci{
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  plci.setLayoutCount = 1;
+  plci.pSetLayouts = &layouts._setLayout;
+  plci.pushConstantRangeCount = signature._pushConstantSize > 0 ? 1 : 0;
+  plci.pPushConstantRanges = &pcr;
+
+  result = vkCreatePipelineLayout(m_device, &plci, nullptr,
+                                  &layouts._pipelineLayout);
+  if (result != VK_SUCCESS) {
+    vkDestroyDescriptorSetLayout(m_device, layouts._setLayout, nullptr);
+    return {result};
+  }
+
+  m_layouts.emplace(std::move(key), layouts);
+  return {layouts};
+}
+
+VkResult DescriptorCache::addPool() {
+  VkDescriptorPoolSize poolSizes[2]{};
+  poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[0].descriptorCount = kSetsPerPool * 4;
+  poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  poolSizes[1].descriptorCount = kSetsPerPool;
+
+  VkDescriptorPoolCreateInfo dpci{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+  dpci.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+  dpci.maxSets = kSetsPerPool;
+  dpci.poolSizeCount = 2;
+  dpci.pPoolSizes = poolSizes;
+
+  VkDescriptorPool pool = VK_NULL_HANDLE;
+  auto result = vkCreateDescriptorPool(m_device, &dpci, nullptr, &pool);
+  if (result == VK_SUCCESS) {
+    m_pools.push_back(pool);
+  }
+  return result;
+}
+
+Result<VkDescriptorSet>
+DescriptorCache::getSet(VkDescriptorSetLayout setLayout,
+                        const KernelSignature &signature,
+                        const std::vector<Buffer> &buffers) {
+  SetKey key;
+  key.reserve(buffers.size() + 1);
+  key.push_back((uint64_t)setLayout);
+  for (const auto &buffer : buffers) {
+    key.push_back(buffer._id);
+  }
+
+  auto found = m_sets.find(key);
+  if (found != m_sets.end()) {
+    return {found->second._set};
+  }
+
+  if (m_pools.empty()) {
+    auto result = addPool();
+    if (result != VK_SUCCESS) {
+      return {result};
+    }
+  }
+
+  VkDescriptorSetAllocateInfo dsai{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+  dsai.descriptorPool = m_pools.back();
+  dsai.descriptorSetCount = 1;
+  dsai.pSetLayouts = &setLayout;
+
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  auto result = vkAllocateDescriptorSets(m_device, &dsai, &set);
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY ||
+      result == VK_ERROR_FRAGMENTED_POOL) {
+    result = addPool();
+    if (result != VK_SUCCESS) {
+      return {result};
+    }
+    dsai.descriptorPool = m_pools.back();
+    result = vkAllocateDescriptorSets(m_device, &dsai, &set);
+  }
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  std::vector<VkDescriptorBufferInfo> infos(buffers.size());
+  std::vector<VkWriteDescriptorSet> writes(buffers.size());
+  for (uint32_t i = 0; i < buffers.size(); i++) {
+    infos[i].buffer = buffers[i]._buffer;
+    infos[i].offset = 0;
+    infos[i].range = VK_WHOLE_SIZE;
+
+    writes[i] = VkWriteDescriptorSet{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    writes[i].dstSet = set;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType = signature._bindings[i]._type;
+    writes[i].pBufferInfo = &infos[i];
+  }
+  vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()),
+                         writes.data(), 0, nullptr);
+
+  for (const auto &buffer : buffers) {
+    auto &keys = m_setsByBuffer[buffer._id];
+    if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+      keys.push_back(key);
+    }
+  }
+  m_sets.emplace(std::move(key), SetEntry{set, dsai.descriptorPool});
+  return {set};
+}
+
+void DescriptorCache::forget(uint64_t bufferId) {
+  auto found = m_setsByBuffer.find(bufferId);
+  if (found == m_setsByBuffer.end()) {
+    return;
+  }
+  for (const auto &key : found->second) {
+    auto set = m_sets.find(key);
+    if (set == m_sets.end()) {
+      continue;
+    }
+    vkFreeDescriptorSets(m_device, set->second._pool, 1, &set->second._set);
+    m_sets.erase(set);
+  }
+  m_setsByBuffer.erase(found);
+}
+
+} // namespace melkior::engine
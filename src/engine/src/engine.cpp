@@ -1,8 +1,10 @@
 #include "../include/engine.hpp"
+#include <algorithm>
 #include <cstdint>
 #include <variant>
 #include <vulkan/vulkan.h>
 
+#include <cstdlib>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -70,7 +72,66 @@ std::string memoryPropertyFlagsToString(VkMemoryPropertyFlags flags) {
   return s;
 }
 
-// Helper: create buffer + allocate/bind memory
+bool hasDeviceExtension(VkPhysicalDevice phys, const char *name) {
+  uint32_t count = 0;
+  vkEnumerateDeviceExtensionProperties(phys, nullptr, &count, nullptr);
+  std::vector<VkExtensionProperties> extensions(count);
+  vkEnumerateDeviceExtensionProperties(phys, nullptr, &count,
+                                       extensions.data());
+  for (const auto &extension : extensions) {
+    if (std::strcmp(extension.extensionName, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A discrete GPU's 256 MB BAR window is DEVICE_LOCAL | HOST_VISIBLE too, only
+// count it when it is the whole of device memory.
+bool hasUnifiedMemory(VkPhysicalDevice phys,
+                      const VkPhysicalDeviceMemoryProperties &mp) {
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(phys, &props);
+  bool integrated =
+      props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ||
+      props.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+
+  VkDeviceSize largestLocalHeap = 0;
+  for (uint32_t i = 0; i < mp.memoryHeapCount; i++) {
+    if (mp.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      largestLocalHeap = std::max(largestLocalHeap, mp.memoryHeaps[i].size);
+    }
+  }
+  for (uint32_t i = 0; i < mp.memoryTypeCount; i++) {
+    const auto &type = mp.memoryTypes[i];
+    bool wholeHeap = mp.memoryHeaps[type.heapIndex].size == largestLocalHeap;
+    if ((type.propertyFlags & MEM_UNIFIED) == MEM_UNIFIED &&
+        (integrated || wholeHeap)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+VkMappedMemoryRange mappedRange(const Buffer &buffer, VkDeviceSize offset,
+                                VkDeviceSize size, VkDeviceSize atom) {
+  // ranges are in memory offsets and must be atom aligned; arena allocations
+  // of non-coherent types are atom aligned and sized already
+  VkDeviceSize begin = buffer._offset + offset;
+  VkDeviceSize end = buffer._offset +
+                     (size == VK_WHOLE_SIZE ? buffer._size : offset + size);
+  VkMappedMemoryRange range{VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE};
+  range.memory = buffer._memory;
+  range.offset = begin / atom * atom;
+  VkDeviceSize alignedEnd = (end + atom - 1) / atom * atom;
+  range.size = alignedEnd - range.offset;
+  if (buffer._allocation._blockId == Allocation::DEDICATED ||
+      alignedEnd > buffer._offset + buffer._allocation._size) {
+    // dedicated memory may not be a whole number of atoms
+    range.size = VK_WHOLE_SIZE;
+  }
+  return range;
+}
 
 } // namespace
 
@@ -125,30 +186,72 @@ Engine::Engine(std::string_view name) {
   m_physicalDevice = gpus[physicalDeviceIndex];
 
   // ---- Logical device (VkDevice) ----
-  int m_computeFamilyIndex = findGraphicsQueueFamily(m_physicalDevice);
-  if (m_computeFamilyIndex < 0) {
+  int computeFamilyIndex = findGraphicsQueueFamily(m_physicalDevice);
+  if (computeFamilyIndex < 0) {
     // std::cerr << "No compute queue family found on chosen device.\n";
     m_result = VK_ERROR_UNKNOWN;
     m_success = false;
     return;
   }
+  m_computeFamilyIndex = (uint32_t)computeFamilyIndex;
 
   float prio = 1.0f;
   VkDeviceQueueCreateInfo qci{};
   qci.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-  qci.queueFamilyIndex = (uint32_t)m_computeFamilyIndex;
+  qci.queueFamilyIndex = m_computeFamilyIndex;
   qci.queueCount = 1;
   qci.pQueuePriorities = &prio;
 
   // Enabled features
   VkPhysicalDeviceFeatures enabledFeatures{};
 
+  VkPhysicalDeviceVulkan11Features supported11{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
+  VkPhysicalDeviceVulkan12Features supported12{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+  supported12.pNext = &supported11;
+  VkPhysicalDeviceFeatures2 supported{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+  supported.pNext = &supported12;
+  vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supported);
+
+  // async submission is built on timeline semaphores
+  if (!supported12.timelineSemaphore) {
+    m_result = VK_ERROR_FEATURE_NOT_PRESENT;
+    m_success = false;
+    return;
+  }
+  VkPhysicalDeviceVulkan12Features enabled12{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+  enabled12.timelineSemaphore = VK_TRUE;
+
+  // optional, fp16 kernels keep float16_t in buffers and shared memory
+  VkPhysicalDeviceVulkan11Features enabled11{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
+  m_float16 = supported12.shaderFloat16 && supported11.storageBuffer16BitAccess;
+  if (m_float16) {
+    enabled12.shaderFloat16 = VK_TRUE;
+    enabled11.storageBuffer16BitAccess = VK_TRUE;
+    enabled12.pNext = &enabled11;
+  }
+
   VkDeviceCreateInfo dci{};
   dci.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  dci.pNext = &enabled12;
   dci.queueCreateInfoCount = 1;
   dci.pQueueCreateInfos = &qci;
   dci.pEnabledFeatures = &enabledFeatures;
 
+  // optional, lets host allocations be used as device memory
+  std::vector<const char *> extensions;
+  bool hostImport = hasDeviceExtension(
+      m_physicalDevice, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+  if (hostImport) {
+    extensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+  }
+  dci.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+  dci.ppEnabledExtensionNames = extensions.data();
+
   m_device = VK_NULL_HANDLE;
   m_result = vkCreateDevice(m_physicalDevice, &dci, nullptr, &m_device);
   if (m_result != VK_SUCCESS) {
@@ -158,10 +261,136 @@ Engine::Engine(std::string_view name) {
   }
 
   m_queue = VK_NULL_HANDLE;
-  vkGetDeviceQueue(m_device, (uint32_t)m_computeFamilyIndex, 0, &m_queue);
+  vkGetDeviceQueue(m_device, m_computeFamilyIndex, 0, &m_queue);
+
+  if (hostImport) {
+    m_getMemoryHostPointerProperties =
+        reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(
+            vkGetDeviceProcAddr(m_device,
+                                "vkGetMemoryHostPointerPropertiesEXT"));
+
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProps{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT};
+    VkPhysicalDeviceProperties2 props2{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    props2.pNext = &hostProps;
+    vkGetPhysicalDeviceProperties2(m_physicalDevice, &props2);
+    m_hostPointerAlignment = std::max<VkDeviceSize>(
+        m_hostPointerAlignment, hostProps.minImportedHostPointerAlignment);
+  }
+
+  vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+  m_unifiedMemory = hasUnifiedMemory(m_physicalDevice, m_memoryProperties);
+  {
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &props);
+    m_nonCoherentAtomSize =
+        std::max<VkDeviceSize>(1, props.limits.nonCoherentAtomSize);
+    m_maxGroupsX = props.limits.maxComputeWorkGroupCount[0];
+  }
+  {
+    VkPhysicalDeviceSubgroupProperties subgroup{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES};
+    VkPhysicalDeviceProperties2 props2{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    props2.pNext = &subgroup;
+    vkGetPhysicalDeviceProperties2(m_physicalDevice, &props2);
+    m_subgroupSize = std::max(1u, subgroup.subgroupSize);
+    if (subgroup.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) {
+      m_subgroupFeatures = subgroup.supportedOperations;
+    }
+  }
+
+  m_arena.init(m_device, m_physicalDevice);
+
+  m_descriptors.init(m_device);
+
+  m_result = m_pipelineCache.init(m_device, m_physicalDevice);
+  if (m_result != VK_SUCCESS) {
+    m_success = false;
+    return;
+  }
+
+  VkCommandPoolCreateInfo cpci{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+  cpci.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  cpci.queueFamilyIndex = m_computeFamilyIndex;
+
+  m_result = vkCreateCommandPool(m_device, &cpci, nullptr, &m_commandPool);
+  if (m_result != VK_SUCCESS) {
+    m_success = false;
+    return;
+  }
+
+  VkCommandBufferAllocateInfo cbai{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+  cbai.commandPool = m_commandPool;
+  cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cbai.commandBufferCount = SUBMIT_RING_SIZE;
+
+  std::vector<VkCommandBuffer> cmds(SUBMIT_RING_SIZE);
+  m_result = vkAllocateCommandBuffers(m_device, &cbai, cmds.data());
+  if (m_result != VK_SUCCESS) {
+    m_success = false;
+    return;
+  }
+  m_ring.resize(SUBMIT_RING_SIZE);
+  for (uint32_t i = 0; i < SUBMIT_RING_SIZE; i++) {
+    m_ring[i]._cmd = cmds[i];
+  }
+
+  VkSemaphoreTypeCreateInfo stci{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+  stci.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  stci.initialValue = 0;
+
+  VkSemaphoreCreateInfo sci{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+  sci.pNext = &stci;
+  m_result = vkCreateSemaphore(m_device, &sci, nullptr, &m_timeline);
+  if (m_result != VK_SUCCESS) {
+    m_success = false;
+    return;
+  }
+
+  m_result = m_profiler.init(m_device, m_physicalDevice, m_computeFamilyIndex,
+                             m_timeline);
+  if (m_result != VK_SUCCESS) {
+    m_success = false;
+    return;
+  }
+
+  // the host only writes upload memory, write-combined coherent is ideal
+  m_result = m_uploadRing.init(
+      m_device, m_physicalDevice, m_timeline, STAGING_RING_SIZE,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT, {MEM_CPU_VISIBLE_COHERENT});
+  if (m_result != VK_SUCCESS) {
+    m_success = false;
+    return;
+  }
+  // reads from uncached memory are slow, take cached even if that means
+  // invalidating by hand
+  m_result = m_readbackRing.init(
+      m_device, m_physicalDevice, m_timeline, STAGING_RING_SIZE,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      {MEM_CPU_VISIBLE_COHERENT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+       MEM_CPU_VISIBLE_COHERENT});
+  if (m_result != VK_SUCCESS) {
+    m_success = false;
+    return;
+  }
 }
 
 Engine::~Engine() {
+  if (m_device != VK_NULL_HANDLE) {
+    vkDeviceWaitIdle(m_device);
+    m_profiler.destroy();
+    m_uploadRing.destroy();
+    m_readbackRing.destroy();
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+  }
+  m_descriptors.destroy();
+  m_pipelineCache.destroy();
+  m_arena.destroy();
   vkDestroyDevice(m_device, nullptr);
   vkDestroyInstance(m_instance, nullptr);
 }
@@ -270,51 +499,540 @@ void Engine::printQueueFamilies() const {
   }
 }
 
+Result<VkBuffer> Engine::createRawBuffer(VkDeviceSize size,
+                                         VkBufferUsageFlags usage,
+                                         VkMemoryPropertyFlags memProps,
+                                         VkMemoryRequirements &req,
+                                         uint32_t &memoryTypeIndex) {
+  VkBufferCreateInfo bci{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bci.size = size;
+  bci.usage = usage;
+  bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkBuffer buffer = VK_NULL_HANDLE;
+  auto result = vkCreateBuffer(m_device, &bci, nullptr, &buffer);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  vkGetBufferMemoryRequirements(m_device, buffer, &req);
+
+  auto typeIndex = findMemoryTypeIndex<uint32_t>(
+      m_physicalDevice, req.memoryTypeBits, memProps);
+
+  if (!typeIndex.isValid()) {
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    return {typeIndex.getError()};
+  }
+  memoryTypeIndex = typeIndex.getValue();
+
+  return {buffer};
+}
+
 Result<Buffer> Engine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                                     VkMemoryPropertyFlags memProps) {
+  VkMemoryRequirements req{};
+  uint32_t memoryTypeIndex = 0;
+  auto buffer = createRawBuffer(size, usage, memProps, req, memoryTypeIndex);
+  if (!buffer.isValid()) {
+    return {buffer.getError()};
+  }
+
   Buffer out{};
+  out._id = m_nextBufferId++;
+  out._buffer = buffer.getValue();
   out._size = size;
 
+  auto allocation = m_arena.allocate(req, memoryTypeIndex);
+  if (!allocation.isValid()) {
+    vkDestroyBuffer(m_device, out._buffer, nullptr);
+    return {allocation.getError()};
+  }
+  out._allocation = allocation.getValue();
+  out._memory = out._allocation._memory;
+  out._offset = out._allocation._offset;
+  out._mapped = out._allocation._mapped;
+
+  auto result =
+      vkBindBufferMemory(m_device, out._buffer, out._memory, out._offset);
+  if (result != VK_SUCCESS) {
+    destroyBuffer(out);
+    return {result};
+  }
+
+  return {out};
+}
+
+Result<Buffer> Engine::createDedicatedBuffer(VkDeviceSize size,
+                                             VkBufferUsageFlags usage,
+                                             VkMemoryPropertyFlags memProps) {
+  VkMemoryRequirements req{};
+  uint32_t memoryTypeIndex = 0;
+  auto buffer = createRawBuffer(size, usage, memProps, req, memoryTypeIndex);
+  if (!buffer.isValid()) {
+    return {buffer.getError()};
+  }
+
+  Buffer out{};
+  out._id = m_nextBufferId++;
+  out._buffer = buffer.getValue();
+  out._size = size;
+
+  VkMemoryAllocateInfo mai{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+  mai.allocationSize = req.size;
+  mai.memoryTypeIndex = memoryTypeIndex;
+
+  auto result = vkAllocateMemory(m_device, &mai, nullptr, &out._memory);
+  if (result != VK_SUCCESS) {
+    vkDestroyBuffer(m_device, out._buffer, nullptr);
+    return {result};
+  }
+  out._allocation._memory = out._memory;
+  out._allocation._size = req.size;
+  out._allocation._memoryTypeIndex = memoryTypeIndex;
+
+  result = vkBindBufferMemory(m_device, out._buffer, out._memory, 0);
+  if (result != VK_SUCCESS) {
+    destroyBuffer(out);
+    return {result};
+  }
+
+  if (memProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    result = vkMapMemory(m_device, out._memory, 0, VK_WHOLE_SIZE, 0,
+                         &out._mapped);
+    if (result != VK_SUCCESS) {
+      destroyBuffer(out);
+      return {result};
+    }
+    out._allocation._mapped = out._mapped;
+  }
+
+  return {out};
+}
+
+Result<Buffer> Engine::createSharedBuffer(VkDeviceSize size,
+                                          VkBufferUsageFlags usage) {
+  // transfers are kept so the staging path works either way
+  usage |= USAGE_TRANSFER_SRC_DST;
+  if (m_unifiedMemory) {
+    auto buffer = createBuffer(
+        size, usage, MEM_UNIFIED | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (!buffer.isValid()) {
+      buffer = createBuffer(size, usage, MEM_UNIFIED);
+    }
+    if (buffer.isValid()) {
+      return buffer;
+    }
+  }
+  return createBuffer(size, usage, MEM_GPU_ONLY);
+}
+
+Result<Buffer> Engine::importHostMemory(void *ptr, VkDeviceSize size,
+                                        VkBufferUsageFlags usage) {
+  if (m_getMemoryHostPointerProperties == nullptr) {
+    return {VK_ERROR_FEATURE_NOT_PRESENT};
+  }
+  if (ptr == nullptr ||
+      reinterpret_cast<uintptr_t>(ptr) % m_hostPointerAlignment != 0) {
+    return {VK_ERROR_INVALID_EXTERNAL_HANDLE};
+  }
+  // the import covers whole alignment units, the buffer only size bytes
+  VkDeviceSize importSize = (size + m_hostPointerAlignment - 1) /
+                            m_hostPointerAlignment * m_hostPointerAlignment;
+
+  VkMemoryHostPointerPropertiesEXT pointerProps{
+      VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT};
+  auto result = m_getMemoryHostPointerProperties(
+      m_device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, ptr,
+      &pointerProps);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  VkExternalMemoryBufferCreateInfo embci{
+      VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO};
+  embci.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
   VkBufferCreateInfo bci{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bci.pNext = &embci;
   bci.size = size;
-  bci.usage = usage;
+  bci.usage = usage | USAGE_TRANSFER_SRC_DST;
   bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  auto result = vkCreateBuffer(m_device, &bci, nullptr, &out._buffer);
+  Buffer out{};
+  result = vkCreateBuffer(m_device, &bci, nullptr, &out._buffer);
   if (result != VK_SUCCESS) {
     return {result};
   }
-
   VkMemoryRequirements req{};
   vkGetBufferMemoryRequirements(m_device, out._buffer, &req);
 
-  auto memoryTypeIndex = findMemoryTypeIndex<uint32_t>(
-      m_physicalDevice, req.memoryTypeBits, memProps);
-
-  if (!memoryTypeIndex.isValid()) {
-    return {memoryTypeIndex.getError()};
+  // coherent first, so nothing has to be flushed around kernels
+  uint32_t typeBits = req.memoryTypeBits & pointerProps.memoryTypeBits;
+  uint32_t memoryTypeIndex = UINT32_MAX;
+  for (auto props : {MEM_CPU_VISIBLE_COHERENT,
+                     VkMemoryPropertyFlags(
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)}) {
+    auto found = findMemoryTypeIndex<uint32_t>(m_physicalDevice, typeBits,
+                                               props);
+    if (found.isValid()) {
+      memoryTypeIndex = found.getValue();
+      break;
+    }
+  }
+  if (memoryTypeIndex == UINT32_MAX || req.size > importSize) {
+    vkDestroyBuffer(m_device, out._buffer, nullptr);
+    return {VK_ERROR_FEATURE_NOT_PRESENT};
   }
 
+  VkImportMemoryHostPointerInfoEXT importInfo{
+      VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT};
+  importInfo.handleType =
+      VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+  importInfo.pHostPointer = ptr;
+
   VkMemoryAllocateInfo mai{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-  mai.allocationSize = req.size;
-  mai.memoryTypeIndex = memoryTypeIndex.getValue();
+  mai.pNext = &importInfo;
+  mai.allocationSize = importSize;
+  mai.memoryTypeIndex = memoryTypeIndex;
 
   result = vkAllocateMemory(m_device, &mai, nullptr, &out._memory);
   if (result != VK_SUCCESS) {
+    vkDestroyBuffer(m_device, out._buffer, nullptr);
     return {result};
   }
-
   result = vkBindBufferMemory(m_device, out._buffer, out._memory, 0);
   if (result != VK_SUCCESS) {
+    vkDestroyBuffer(m_device, out._buffer, nullptr);
+    vkFreeMemory(m_device, out._memory, nullptr);
     return {result};
   }
 
+  // destroyBuffer frees the import like any dedicated allocation, the host
+  // memory itself stays with the caller
+  out._id = m_nextBufferId++;
+  out._size = size;
+  out._mapped = ptr;
+  out._allocation._memory = out._memory;
+  out._allocation._size = importSize;
+  out._allocation._mapped = ptr;
+  out._allocation._memoryTypeIndex = memoryTypeIndex;
   return {out};
 }
 
+Result<Buffer> Engine::wrapHostMemory(void *ptr, VkDeviceSize size,
+                                      VkBufferUsageFlags usage) {
+  auto imported = importHostMemory(ptr, size, usage);
+  if (imported.isValid()) {
+    return imported;
+  }
+  return createSharedBuffer(size, usage);
+}
+
+void *Engine::allocateHostMemory(VkDeviceSize size) const {
+  VkDeviceSize aligned = (size + m_hostPointerAlignment - 1) /
+                         m_hostPointerAlignment * m_hostPointerAlignment;
+  return std::aligned_alloc(static_cast<size_t>(m_hostPointerAlignment),
+                            static_cast<size_t>(aligned));
+}
+
+void Engine::freeHostMemory(void *ptr) const { std::free(ptr); }
+
+VkResult Engine::flushBuffer(const Buffer &buffer, VkDeviceSize offset,
+                             VkDeviceSize size) const {
+  VkMemoryPropertyFlags flags =
+      m_memoryProperties.memoryTypes[buffer._allocation._memoryTypeIndex]
+          .propertyFlags;
+  if (buffer._mapped == nullptr ||
+      (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+    return VK_SUCCESS;
+  }
+  auto range = mappedRange(buffer, offset, size, m_nonCoherentAtomSize);
+  return vkFlushMappedMemoryRanges(m_device, 1, &range);
+}
+
+VkResult Engine::invalidateBuffer(const Buffer &buffer, VkDeviceSize offset,
+                                  VkDeviceSize size) const {
+  VkMemoryPropertyFlags flags =
+      m_memoryProperties.memoryTypes[buffer._allocation._memoryTypeIndex]
+          .propertyFlags;
+  if (buffer._mapped == nullptr ||
+      (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+    return VK_SUCCESS;
+  }
+  auto range = mappedRange(buffer, offset, size, m_nonCoherentAtomSize);
+  return vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+}
+
 void Engine::destroyBuffer(Buffer buffer) {
+  m_descriptors.forget(buffer._id);
   vkDestroyBuffer(m_device, buffer._buffer, nullptr);
-  vkFreeMemory(m_device, buffer._memory, nullptr);
+  if (buffer._allocation._blockId == Allocation::DEDICATED) {
+    // freeing implicitly unmaps
+    vkFreeMemory(m_device, buffer._memory, nullptr);
+  } else {
+    m_arena.free(buffer._allocation);
+  }
+}
+
+AllocatorStats Engine::allocatorStats() const { return m_arena.stats(); }
+
+void Engine::printAllocatorStats() const {
+  auto stats = m_arena.stats();
+  std::cout << "  Memory arena:\n";
+  std::cout << "    blocks:             " << stats._blockCount << "\n";
+  std::cout << "    allocations:        " << stats._allocationCount << "\n";
+  std::cout << "    vkAllocateMemory:   " << stats._deviceAllocations << "\n";
+  std::cout << "    reserved:           " << stats._reservedBytes / 1024
+            << " KB\n";
+  std::cout << "    used:               " << stats._usedBytes / 1024
+            << " KB\n";
+  std::cout << "    peak used:          " << stats._peakUsedBytes / 1024
+            << " KB\n";
+  std::cout << "    largest free range: " << stats._largestFreeRange / 1024
+            << " KB\n";
+  std::cout << "    fragmentation:      " << std::fixed << std::setprecision(3)
+            << stats._fragmentation << std::defaultfloat << "\n";
+}
+
+Result<VkPipeline> Engine::getComputePipeline(const std::vector<uint32_t> &spirv,
+                                             VkPipelineLayout layout,
+                                             const Specialization &spec) {
+  return m_pipelineCache.getComputePipeline(spirv, layout, spec);
+}
+
+bool Engine::savePipelineCache() const { return m_pipelineCache.save(); }
+
+const std::string &Engine::pipelineCachePath() const {
+  return m_pipelineCache.path();
+}
+
+PipelineCacheStats Engine::pipelineCacheStats() const {
+  return m_pipelineCache.stats();
+}
+
+Result<Kernel> Engine::createKernel(std::string_view spirvPath,
+                                   const KernelSignature &signature,
+                                   const Specialization &spec) {
+  auto spirv = readSpirv(shaderPath(spirvPath));
+  if (!spirv.isValid()) {
+    return {spirv.getError()};
+  }
+  return createKernel(spirvPath, spirv.getValue(), signature, spec);
+}
+
+Result<Kernel> Engine::createKernel(std::string_view name,
+                                   const std::vector<uint32_t> &spirv,
+                                   const KernelSignature &signature,
+                                   const Specialization &spec) {
+  auto layouts = m_descriptors.getLayouts(signature);
+  if (!layouts.isValid()) {
+    return {layouts.getError()};
+  }
+
+  auto pipeline = m_pipelineCache.getComputePipeline(
+      spirv, layouts.getValue()._pipelineLayout, spec);
+  if (!pipeline.isValid()) {
+    return {pipeline.getError()};
+  }
+
+  Kernel kernel;
+  kernel.m_engine = this;
+  kernel.m_name = std::string(name);
+  kernel.m_signature = signature;
+  kernel.m_layouts = layouts.getValue();
+  kernel.m_pipeline = pipeline.getValue();
+  return {kernel};
+}
+
+Result<Kernel> Engine::dispatchArgsKernel() {
+  if (m_dispatchArgs.pipeline() == VK_NULL_HANDLE) {
+    auto kernel = createKernel(
+        "dispatch_args.spv",
+        {{{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::READ},
+          {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Access::WRITE}},
+         4 * sizeof(uint32_t)});
+    if (!kernel.isValid()) {
+      return kernel;
+    }
+    m_dispatchArgs = kernel.getValue();
+  }
+  return {m_dispatchArgs};
+}
+
+Result<uint32_t> Engine::acquireSlot() {
+  // oldest slot first; slots still being recorded are skipped
+  uint32_t slot = UINT32_MAX;
+  for (uint32_t i = 0; i < m_ring.size(); i++) {
+    uint32_t candidate = (m_ringIndex + i) % m_ring.size();
+    if (!m_ring[candidate]._recording) {
+      slot = candidate;
+      break;
+    }
+  }
+
+  if (slot == UINT32_MAX) {
+    // every command buffer is held by an open stream, grow the ring
+    VkCommandBufferAllocateInfo cbai{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    cbai.commandPool = m_commandPool;
+    cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cbai.commandBufferCount = 1;
+
+    InFlight entry{};
+    auto result = vkAllocateCommandBuffers(m_device, &cbai, &entry._cmd);
+    if (result != VK_SUCCESS) {
+      return {result};
+    }
+    m_ring.push_back(entry);
+    slot = static_cast<uint32_t>(m_ring.size() - 1);
+  }
+  m_ringIndex = (slot + 1) % m_ring.size();
+
+  auto &entry = m_ring[slot];
+  auto result = wait({entry._value});
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  result = vkResetCommandBuffer(entry._cmd, 0);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  VkCommandBufferBeginInfo cbbi{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  cbbi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  result = vkBeginCommandBuffer(entry._cmd, &cbbi);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  entry._recording = true;
+  return {slot};
+}
+
+Result<Ticket> Engine::submitSlot(uint32_t slot,
+                                  const std::vector<Ticket> &waitFor) {
+  auto &entry = m_ring[slot];
+  entry._recording = false;
+
+  auto result = vkEndCommandBuffer(entry._cmd);
+  if (result != VK_SUCCESS) {
+    discardSlot(entry._cmd);
+    return {result};
+  }
+
+  // all tickets live on the same timeline, waiting for the latest one covers
+  // the others; without any the previous submission is waited for, which
+  // also makes its writes visible to this one
+  uint64_t waitValue = waitFor.empty() ? m_timelineValue : 0;
+  for (const auto &ticket : waitFor) {
+    waitValue = std::max(waitValue, ticket._value);
+  }
+  uint64_t signalValue = m_timelineValue + 1;
+
+  VkTimelineSemaphoreSubmitInfo tssi{
+      VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+  tssi.waitSemaphoreValueCount = waitValue > 0 ? 1 : 0;
+  tssi.pWaitSemaphoreValues = &waitValue;
+  tssi.signalSemaphoreValueCount = 1;
+  tssi.pSignalSemaphoreValues = &signalValue;
+
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+  VkSubmitInfo si{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  si.pNext = &tssi;
+  si.waitSemaphoreCount = waitValue > 0 ? 1 : 0;
+  si.pWaitSemaphores = &m_timeline;
+  si.pWaitDstStageMask = &waitStage;
+  si.commandBufferCount = 1;
+  si.pCommandBuffers = &entry._cmd;
+  si.signalSemaphoreCount = 1;
+  si.pSignalSemaphores = &m_timeline;
+
+  result = vkQueueSubmit(m_queue, 1, &si, VK_NULL_HANDLE);
+  if (result != VK_SUCCESS) {
+    discardSlot(entry._cmd);
+    return {result};
+  }
+
+  m_profiler.submitted(entry._cmd, signalValue);
+  m_uploadRing.submitted(entry._cmd, signalValue);
+  m_readbackRing.submitted(entry._cmd, signalValue);
+  m_timelineValue = signalValue;
+  entry._value = signalValue;
+  return {Ticket{signalValue}};
+}
+
+void Engine::releaseSlot(uint32_t slot) {
+  auto &entry = m_ring[slot];
+  if (entry._recording) {
+    vkEndCommandBuffer(entry._cmd);
+    entry._recording = false;
+  }
+  discardSlot(entry._cmd);
+}
+
+void Engine::discardSlot(VkCommandBuffer cmd) {
+  m_profiler.discard(cmd);
+  m_uploadRing.discard(cmd);
+  m_readbackRing.discard(cmd);
+}
+
+Result<Ticket>
+Engine::submitAsync(const std::function<VkResult(VkCommandBuffer)> &record,
+                    const std::vector<Ticket> &waitFor) {
+  auto slot = acquireSlot();
+  if (!slot.isValid()) {
+    return {slot.getError()};
+  }
+  VkCommandBuffer cmd = m_ring[slot.getValue()]._cmd;
+
+  auto result = record(cmd);
+  if (result != VK_SUCCESS) {
+    releaseSlot(slot.getValue());
+    return {result};
+  }
+
+  // make shader and transfer writes visible to host reads
+  VkMemoryBarrier mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  mb.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  mb.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(cmd,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                           VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &mb, 0, nullptr, 0,
+                       nullptr);
+
+  return submitSlot(slot.getValue(), waitFor);
+}
+
+VkResult
+Engine::submitAndWait(const std::function<VkResult(VkCommandBuffer)> &record) {
+  auto ticket = submitAsync(record);
+  if (!ticket.isValid()) {
+    return ticket.getError();
+  }
+  return wait(ticket.getValue());
+}
+
+VkResult Engine::wait(Ticket ticket, uint64_t timeoutNs) const {
+  if (ticket._value == 0) {
+    return VK_SUCCESS;
+  }
+  VkSemaphoreWaitInfo swi{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+  swi.semaphoreCount = 1;
+  swi.pSemaphores = &m_timeline;
+  swi.pValues = &ticket._value;
+  return vkWaitSemaphores(m_device, &swi, timeoutNs);
+}
+
+bool Engine::poll(Ticket ticket) const {
+  uint64_t value = 0;
+  if (vkGetSemaphoreCounterValue(m_device, m_timeline, &value) != VK_SUCCESS) {
+    return false;
+  }
+  return value >= ticket._value;
 }
 
 void Engine::printMemoryTypes() {
@@ -0,0 +1,98 @@
+#include "../include/kernel.hpp"
+#include "../include/engine.hpp"
+
+#include <algorithm>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+
+VkResult Kernel::dispatchRaw(const std::vector<Buffer> &buffers,
+                             const void *pushConstants,
+                             uint32_t pushConstantSize, WorkGroups groups,
+                             Cost cost) {
+  if (m_engine == nullptr) {
+    return VK_ERROR_UNKNOWN;
+  }
+  return m_engine->submitAndWait([&](VkCommandBuffer cmd) {
+    auto &profiler = m_engine->m_profiler;
+    uint32_t scope = profiler.begin(cmd, m_name, cost);
+    auto result =
+        recordRaw(cmd, buffers, pushConstants, pushConstantSize, groups);
+    profiler.end(cmd, scope);
+    return result;
+  });
+}
+
+VkResult Kernel::recordRaw(VkCommandBuffer cmd,
+                           const std::vector<Buffer> &buffers,
+                           const void *pushConstants,
+                           uint32_t pushConstantSize, WorkGroups groups) const {
+  auto result = bind(cmd, buffers, pushConstants, pushConstantSize);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  vkCmdDispatch(cmd, groups._x, groups._y, groups._z);
+  return VK_SUCCESS;
+}
+
+VkResult Kernel::recordIndirectRaw(VkCommandBuffer cmd,
+                                   const std::vector<Buffer> &buffers,
+                                   const void *pushConstants,
+                                   uint32_t pushConstantSize,
+                                   const Buffer &args,
+                                   VkDeviceSize offset) const {
+  if (offset % 4 != 0 ||
+      offset + sizeof(VkDispatchIndirectCommand) > args._size) {
+    return VK_ERROR_UNKNOWN;
+  }
+  auto result = bind(cmd, buffers, pushConstants, pushConstantSize);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  vkCmdDispatchIndirect(cmd, args._buffer, offset);
+  return VK_SUCCESS;
+}
+
+VkResult Kernel::bind(VkCommandBuffer cmd, const std::vector<Buffer> &buffers,
+                      const void *pushConstants,
+                      uint32_t pushConstantSize) const {
+  if (m_engine == nullptr ||
+      buffers.size() != m_signature._bindings.size() ||
+      pushConstantSize != m_signature._pushConstantSize) {
+    return VK_ERROR_UNKNOWN;
+  }
+
+  auto set = m_engine->m_descriptors.getSet(m_layouts._setLayout, m_signature,
+                                            buffers);
+  if (!set.isValid()) {
+    return set.getError();
+  }
+  VkDescriptorSet descriptorSet = set.getValue();
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          m_layouts._pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  if (pushConstantSize > 0) {
+    vkCmdPushConstants(cmd, m_layouts._pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstantSize,
+                       pushConstants);
+  }
+  return VK_SUCCESS;
+}
+
+Result<Buffer> createStorage(Engine &engine, uint64_t words) {
+  return engine.createBuffer(std::max<uint64_t>(words, 1) * sizeof(uint32_t),
+                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                 USAGE_TRANSFER_SRC_DST,
+                             MEM_GPU_ONLY);
+}
+
+void destroyIfSet(Engine &engine, Buffer &buffer) {
+  if (buffer._buffer != VK_NULL_HANDLE) {
+    engine.destroyBuffer(buffer);
+  }
+  buffer = {};
+}
+
+} // namespace melkior::engine
@@ -0,0 +1,289 @@
+#include "../include/pipeline_cache.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+namespace {
+
+namespace fs = std::filesystem;
+
+fs::path cacheDirectory() {
+  if (const char *dir = std::getenv("MELKIOR_CACHE_DIR")) {
+    return fs::path(dir);
+  }
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME")) {
+    return fs::path(xdg) / "melkior";
+  }
+  if (const char *home = std::getenv("HOME")) {
+    return fs::path(home) / ".cache" / "melkior";
+  }
+  return fs::current_path();
+}
+
+std::string uuidToString(const uint8_t *uuid) {
+  std::ostringstream ss;
+  for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+    ss << std::hex << std::setw(2) << std::setfill('0') << int(uuid[i]);
+  }
+  return ss.str();
+}
+
+std::vector<char> readBinary(const fs::path &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return {};
+  }
+  auto size = file.tellg();
+  if (size <= 0) {
+    return {};
+  }
+  std::vector<char> data(static_cast<size_t>(size));
+  file.seekg(0);
+  file.read(data.data(), size);
+  return data;
+}
+
+// drivers are supposed to reject foreign blobs, not all of them do
+bool headerMatches(const std::vector<char> &data,
+                   const VkPhysicalDeviceProperties &props) {
+  VkPipelineCacheHeaderVersionOne header{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == props.vendorID &&
+         header.deviceID == props.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+}
+
+} // namespace
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed) {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+  auto bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+Result<std::vector<uint32_t>> readSpirv(std::string_view path) {
+  std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+  if (!file) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  auto size = file.tellg();
+  if (size <= 0 || (size % 4) != 0) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  std::vector<uint32_t> data(static_cast<size_t>(size) / 4);
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(data.data()), size);
+  return {data};
+}
+
+std::string shaderPath(std::string_view name) {
+  fs::path path(name);
+  std::error_code ec;
+  if (path.is_absolute() || fs::exists(path, ec)) {
+    return path.string();
+  }
+  if (const char *dir = std::getenv("MELKIOR_SHADER_DIR")) {
+    auto candidate = fs::path(dir) / path;
+    if (fs::exists(candidate, ec)) {
+      return candidate.string();
+    }
+  }
+#ifdef MELKIOR_SHADER_DIR
+  return (fs::path(MELKIOR_SHADER_DIR) / path).string();
+#else
+  return path.string();
+#endif
+}
+
+bool PipelineCache::Key::operator==(const Key &other) const {
+  if (_spirvHash != other._spirvHash || _layout != other._layout ||
+      _data != other._data || _entries.size() != other._entries.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < _entries.size(); i++) {
+    if (_entries[i].constantID != other._entries[i].constantID ||
+        _entries[i].offset != other._entries[i].offset ||
+        _entries[i].size != other._entries[i].size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t PipelineCache::KeyHash::operator()(const Key &key) const {
+  uint64_t hash = hashBytes(&key._layout, sizeof(key._layout), key._spirvHash);
+  hash = hashBytes(key._data.data(), key._data.size(), hash);
+  for (const auto &entry : key._entries) {
+    hash = hashBytes(&entry.constantID, sizeof(entry.constantID), hash);
+  }
+  return static_cast<size_t>(hash);
+}
+
+VkResult PipelineCache::init(VkDevice device,
+                             VkPhysicalDevice physicalDevice) {
+  m_device = device;
+
+  VkPhysicalDeviceIDProperties idProps{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+  VkPhysicalDeviceProperties2 props2{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+  props2.pNext = &idProps;
+  vkGetPhysicalDeviceProperties2(physicalDevice, &props2);
+  m_deviceProps = props2.properties;
+
+  m_path = (cacheDirectory() /
+            ("pipeline_cache_" + uuidToString(idProps.deviceUUID) + "_" +
+             std::to_string(m_deviceProps.driverVersion) + ".bin"))
+               .string();
+
+  auto data = readBinary(m_path);
+  if (!headerMatches(data, m_deviceProps)) {
+    data.clear();
+  }
+
+  VkPipelineCacheCreateInfo pcci{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+  pcci.initialDataSize = data.size();
+  pcci.pInitialData = data.empty() ? nullptr : data.data();
+
+  auto result = vkCreatePipelineCache(m_device, &pcci, nullptr, &m_cache);
+  if (result != VK_SUCCESS && !data.empty()) {
+    // corrupt blob, start cold
+    pcci.initialDataSize = 0;
+    pcci.pInitialData = nullptr;
+    data.clear();
+    result = vkCreatePipelineCache(m_device, &pcci, nullptr, &m_cache);
+  }
+  m_stats._loadedBytes = data.size();
+  return result;
+}
+
+void PipelineCache::destroy() {
+  if (m_device == VK_NULL_HANDLE) {
+    return;
+  }
+  save();
+  for (auto &entry : m_pipelines) {
+    vkDestroyPipeline(m_device, entry.second, nullptr);
+  }
+  m_pipelines.clear();
+  vkDestroyPipelineCache(m_device, m_cache, nullptr);
+  m_cache = VK_NULL_HANDLE;
+  m_device = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::save() const {
+  if (m_cache == VK_NULL_HANDLE) {
+    return false;
+  }
+
+  size_t size = 0;
+  if (vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) !=
+          VK_SUCCESS ||
+      size == 0) {
+    return false;
+  }
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) !=
+      VK_SUCCESS) {
+    return false;
+  }
+
+  // write next to the target and rename, so a concurrent reader never sees a
+  // half written blob
+  std::error_code ec;
+  fs::path path(m_path);
+  fs::create_directories(path.parent_path(), ec);
+  fs::path tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      return false;
+    }
+    file.write(data.data(), static_cast<std::streamsize>(size));
+    if (!file) {
+      return false;
+    }
+  }
+  fs::rename(tmp, path, ec);
+  return !ec;
+}
+
+Result<VkPipeline>
+PipelineCache::getComputePipeline(const std::vector<uint32_t> &spirv,
+                                  VkPipelineLayout layout,
+                                  const Specialization &spec) {
+  Key key{hashBytes(spirv.data(), spirv.size() * sizeof(uint32_t)), layout,
+          spec._entries, spec._data};
+
+  auto found = m_pipelines.find(key);
+  if (found != m_pipelines.end()) {
+    m_stats._registryHits++;
+    return {found->second};
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+
+  VkShaderModuleCreateInfo smci{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+  smci.codeSize = spirv.size() * sizeof(uint32_t);
+  smci.pCode = spirv.data();
+
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  auto result = vkCreateShaderModule(m_device, &smci, nullptr, &shaderModule);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  VkSpecializationInfo specInfo{};
+  specInfo.mapEntryCount = static_cast<uint32_t>(spec._entries.size());
+  specInfo.pMapEntries = spec._entries.data();
+  specInfo.dataSize = spec._data.size();
+  specInfo.pData = spec._data.data();
+
+  VkPipelineShaderStageCreateInfo stage{
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
+  stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  stage.module = shaderModule;
+  stage.pName = "main";
+  stage.pSpecializationInfo = spec.empty() ? nullptr : &specInfo;
+
+  VkComputePipelineCreateInfo cpci{
+      VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+  cpci.stage = stage;
+  cpci.layout = layout;
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  result = vkCreateComputePipelines(m_device, m_cache, 1, &cpci, nullptr,
+                                    &pipeline);
+  // the module is only needed while the pipeline is being built
+  vkDestroyShaderModule(m_device, shaderModule, nullptr);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+  m_stats._creationMs +=
+      std::chrono::duration<double, std::milli>(end - start).count();
+  m_stats._pipelinesCreated++;
+
+  m_pipelines.emplace(std::move(key), pipeline);
+  return {pipeline};
+}
+
+} // namespace melkior::engine
@@ -0,0 +1,275 @@
+#include "../include/profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+namespace {
+
+std::string jsonEscape(const std::string &s) {
+  std::string out;
+  out.reserve(s.size());
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out += ' ';
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+VkResult Profiler::init(VkDevice device, VkPhysicalDevice physicalDevice,
+                        uint32_t queueFamilyIndex, VkSemaphore timeline,
+                        uint32_t maxScopes) {
+  m_device = device;
+  m_timeline = timeline;
+  m_enabled = std::getenv("MELKIOR_PROFILE") != nullptr;
+
+  uint32_t count = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, nullptr);
+  std::vector<VkQueueFamilyProperties> families(count);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count,
+                                           families.data());
+  uint32_t validBits =
+      queueFamilyIndex < count ? families[queueFamilyIndex].timestampValidBits
+                               : 0;
+  if (validBits == 0) {
+    // not an error, the profiler just stays unsupported
+    return VK_SUCCESS;
+  }
+  m_mask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(physicalDevice, &props);
+  m_periodNs = props.limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo qpci{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+  qpci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  qpci.queryCount = 2 * maxScopes;
+  auto result = vkCreateQueryPool(m_device, &qpci, nullptr, &m_pool);
+  if (result != VK_SUCCESS) {
+    m_pool = VK_NULL_HANDLE;
+    return result;
+  }
+
+  m_scopes.resize(maxScopes);
+  m_free.resize(maxScopes);
+  for (uint32_t i = 0; i < maxScopes; i++) {
+    // popped from the back, hand out low indices first
+    m_free[i] = maxScopes - 1 - i;
+  }
+  return VK_SUCCESS;
+}
+
+void Profiler::destroy() {
+  if (m_pool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(m_device, m_pool, nullptr);
+    m_pool = VK_NULL_HANDLE;
+  }
+  m_scopes.clear();
+  m_free.clear();
+  m_inFlight.clear();
+  m_events.clear();
+  m_device = VK_NULL_HANDLE;
+}
+
+uint32_t Profiler::begin(VkCommandBuffer cmd, const std::string &name,
+                         Cost cost) {
+  if (!enabled()) {
+    return UINT32_MAX;
+  }
+  if (m_free.empty()) {
+    // try to make room before giving up on this scope
+    collect();
+    if (m_free.empty()) {
+      m_dropped++;
+      return UINT32_MAX;
+    }
+  }
+  uint32_t scope = m_free.back();
+  m_free.pop_back();
+  m_inFlight.push_back(scope);
+
+  auto &entry = m_scopes[scope];
+  entry._name = name;
+  entry._cost = cost;
+  entry._cmd = cmd;
+  entry._value = 0;
+
+  vkCmdResetQueryPool(cmd, m_pool, 2 * scope, 2);
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_pool,
+                      2 * scope);
+  return scope;
+}
+
+void Profiler::end(VkCommandBuffer cmd, uint32_t scope) {
+  if (scope == UINT32_MAX) {
+    return;
+  }
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_pool,
+                      2 * scope + 1);
+}
+
+void Profiler::submitted(VkCommandBuffer cmd, uint64_t timelineValue) {
+  for (uint32_t scope : m_inFlight) {
+    auto &entry = m_scopes[scope];
+    if (entry._cmd == cmd && entry._value == 0) {
+      entry._value = timelineValue;
+    }
+  }
+}
+
+void Profiler::discard(VkCommandBuffer cmd) {
+  auto it = std::remove_if(m_inFlight.begin(), m_inFlight.end(),
+                           [&](uint32_t scope) {
+                             const auto &entry = m_scopes[scope];
+                             if (entry._cmd == cmd && entry._value == 0) {
+                               m_free.push_back(scope);
+                               return true;
+                             }
+                             return false;
+                           });
+  m_inFlight.erase(it, m_inFlight.end());
+}
+
+void Profiler::collect() {
+  if (m_inFlight.empty()) {
+    return;
+  }
+  uint64_t completed = 0;
+  if (vkGetSemaphoreCounterValue(m_device, m_timeline, &completed) !=
+      VK_SUCCESS) {
+    return;
+  }
+
+  auto it = std::remove_if(
+      m_inFlight.begin(), m_inFlight.end(), [&](uint32_t scope) {
+        const auto &entry = m_scopes[scope];
+        if (entry._value == 0 || entry._value > completed) {
+          return false;
+        }
+        uint64_t ticks[2] = {};
+        auto result = vkGetQueryPoolResults(
+            m_device, m_pool, 2 * scope, 2, sizeof(ticks), ticks,
+            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS) {
+          m_events.push_back(
+              {entry._name, entry._cost, ticks[0] & m_mask, ticks[1] & m_mask});
+        }
+        m_free.push_back(scope);
+        return true;
+      });
+  m_inFlight.erase(it, m_inFlight.end());
+}
+
+std::vector<KernelProfile> Profiler::summary() {
+  collect();
+
+  std::map<std::string, std::vector<const Event *>> byName;
+  for (const auto &event : m_events) {
+    byName[event._name].push_back(&event);
+  }
+
+  std::vector<KernelProfile> out;
+  for (const auto &entry : byName) {
+    KernelProfile profile;
+    profile._name = entry.first;
+    profile._count = static_cast<uint32_t>(entry.second.size());
+
+    std::vector<double> times;
+    times.reserve(entry.second.size());
+    for (const Event *event : entry.second) {
+      // the counter may wrap inside a scope
+      times.push_back(toMs((event->_end - event->_start) & m_mask));
+      profile._bytes += event->_cost._bytes;
+      profile._flops += event->_cost._flops;
+    }
+    std::sort(times.begin(), times.end());
+    for (double t : times) {
+      profile._totalMs += t;
+    }
+    profile._minMs = times.front();
+    profile._meanMs = profile._totalMs / times.size();
+    // nearest rank
+    size_t rank = static_cast<size_t>(std::ceil(0.99 * times.size()));
+    profile._p99Ms = times[std::max<size_t>(rank, 1) - 1];
+    if (profile._totalMs > 0.0) {
+      profile._gbps = profile._bytes / (profile._totalMs * 1e6);
+      profile._gflops = profile._flops / (profile._totalMs * 1e6);
+    }
+    out.push_back(profile);
+  }
+
+  // most expensive first
+  std::sort(out.begin(), out.end(),
+            [](const KernelProfile &a, const KernelProfile &b) {
+              return a._totalMs > b._totalMs;
+            });
+  return out;
+}
+
+void Profiler::print(std::ostream &os) {
+  auto profiles = summary();
+
+  os << std::left << std::setw(24) << "kernel" << std::right << std::setw(8)
+     << "count" << std::setw(12) << "min ms" << std::setw(12) << "mean ms"
+     << std::setw(12) << "p99 ms" << std::setw(12) << "total ms"
+     << std::setw(10) << "GB/s" << std::setw(10) << "GFLOP/s" << "\n";
+  os << std::fixed << std::setprecision(4);
+  for (const auto &p : profiles) {
+    os << std::left << std::setw(24) << p._name << std::right << std::setw(8)
+       << p._count << std::setw(12) << p._minMs << std::setw(12) << p._meanMs
+       << std::setw(12) << p._p99Ms << std::setw(12) << p._totalMs
+       << std::setprecision(2) << std::setw(10) << p._gbps << std::setw(10)
+       << p._gflops << std::setprecision(4) << "\n";
+  }
+  if (m_dropped > 0) {
+    os << m_dropped << " scopes dropped, all " << m_scopes.size()
+       << " were in flight\n";
+  }
+  os << std::defaultfloat;
+}
+
+bool Profiler::exportChromeTrace(const std::string &path) {
+  collect();
+
+  std::ofstream file(path, std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+
+  uint64_t base = UINT64_MAX;
+  for (const auto &event : m_events) {
+    base = std::min(base, event._start);
+  }
+
+  // complete events ("ph": "X"), timestamps in microseconds
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto &event : m_events) {
+    double ts = toMs((event._start - base) & m_mask) * 1e3;
+    double dur = toMs((event._end - event._start) & m_mask) * 1e3;
+    file << (first ? "\n" : ",\n") << "{\"name\":\""
+         << jsonEscape(event._name)
+         << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << ts
+         << ",\"dur\":" << dur << ",\"args\":{\"bytes\":"
+         << event._cost._bytes << ",\"flops\":" << event._cost._flops << "}}";
+    first = false;
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
+
+} // namespace melkior::engine
@@ -0,0 +1,335 @@
+#include "../include/staging.hpp"
+
+#include <algorithm>
+#include <vulkan/vulkan.h>
+
+namespace melkior::engine {
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) {
+  return value / alignment * alignment;
+}
+
+} // namespace
+
+VkResult
+StagingRing::init(VkDevice device, VkPhysicalDevice physicalDevice,
+                  VkSemaphore timeline, VkDeviceSize size,
+                  VkBufferUsageFlags usage,
+                  const std::vector<VkMemoryPropertyFlags> &preferred) {
+  m_device = device;
+  m_physicalDevice = physicalDevice;
+  m_timeline = timeline;
+  m_usage = usage;
+  m_preferred = preferred;
+
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(physicalDevice, &props);
+  // region offsets double as invalidate offsets on non-coherent memory
+  m_alignment =
+      std::max<VkDeviceSize>(m_alignment, props.limits.nonCoherentAtomSize);
+  m_size = alignUp(size, m_alignment);
+  return VK_SUCCESS;
+}
+
+VkResult StagingRing::create() {
+  VkBufferCreateInfo bci{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bci.size = m_size;
+  bci.usage = m_usage;
+  bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  auto result = vkCreateBuffer(m_device, &bci, nullptr, &m_buffer);
+  if (result != VK_SUCCESS) {
+    m_buffer = VK_NULL_HANDLE;
+    return result;
+  }
+
+  VkMemoryRequirements req{};
+  vkGetBufferMemoryRequirements(m_device, m_buffer, &req);
+
+  VkPhysicalDeviceMemoryProperties mp{};
+  vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &mp);
+  bool found = false;
+  for (auto flags : m_preferred) {
+    for (uint32_t i = 0; i < mp.memoryTypeCount && !found; i++) {
+      if ((req.memoryTypeBits & (1u << i)) &&
+          (mp.memoryTypes[i].propertyFlags & flags) == flags) {
+        m_memoryTypeIndex = i;
+        m_properties = mp.memoryTypes[i].propertyFlags;
+        found = true;
+      }
+    }
+    if (found) {
+      break;
+    }
+  }
+
+  void *mapped = nullptr;
+  result = VK_ERROR_FEATURE_NOT_PRESENT;
+  if (found) {
+    VkMemoryAllocateInfo mai{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    mai.allocationSize = req.size;
+    mai.memoryTypeIndex = m_memoryTypeIndex;
+    result = vkAllocateMemory(m_device, &mai, nullptr, &m_memory);
+  }
+  if (result == VK_SUCCESS) {
+    result = vkBindBufferMemory(m_device, m_buffer, m_memory, 0);
+  }
+  if (result == VK_SUCCESS) {
+    result = vkMapMemory(m_device, m_memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+  }
+  if (result != VK_SUCCESS) {
+    // the next allocate() tries again
+    vkDestroyBuffer(m_device, m_buffer, nullptr);
+    vkFreeMemory(m_device, m_memory, nullptr);
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+    return result;
+  }
+  m_mapped = static_cast<uint8_t *>(mapped);
+  return VK_SUCCESS;
+}
+
+void StagingRing::destroy() {
+  if (m_device == VK_NULL_HANDLE) {
+    return;
+  }
+  for (auto &overflow : m_overflow) {
+    vkDestroyBuffer(m_device, overflow._buffer, nullptr);
+    vkFreeMemory(m_device, overflow._memory, nullptr);
+  }
+  m_overflow.clear();
+  m_spans.clear();
+  vkDestroyBuffer(m_device, m_buffer, nullptr);
+  // freeing implicitly unmaps
+  vkFreeMemory(m_device, m_memory, nullptr);
+  m_buffer = VK_NULL_HANDLE;
+  m_memory = VK_NULL_HANDLE;
+  m_mapped = nullptr;
+  m_device = VK_NULL_HANDLE;
+}
+
+Result<StagingRegion> StagingRing::createBuffer(VkDeviceSize size,
+                                                VkBuffer &buffer,
+                                                VkDeviceMemory &memory) {
+  VkBufferCreateInfo bci{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bci.size = size;
+  bci.usage = m_usage;
+  bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  auto result = vkCreateBuffer(m_device, &bci, nullptr, &buffer);
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  VkMemoryRequirements req{};
+  vkGetBufferMemoryRequirements(m_device, buffer, &req);
+  VkMemoryAllocateInfo mai{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+  mai.allocationSize = req.size;
+  mai.memoryTypeIndex = m_memoryTypeIndex;
+
+  StagingRegion region{};
+  result = vkAllocateMemory(m_device, &mai, nullptr, &memory);
+  if (result == VK_SUCCESS) {
+    result = vkBindBufferMemory(m_device, buffer, memory, 0);
+  }
+  if (result == VK_SUCCESS) {
+    result = vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0,
+                         &region._mapped);
+  }
+  if (result != VK_SUCCESS) {
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    if (memory != VK_NULL_HANDLE) {
+      vkFreeMemory(m_device, memory, nullptr);
+    }
+    return {result};
+  }
+
+  region._buffer = buffer;
+  region._memory = memory;
+  region._size = size;
+  return {region};
+}
+
+bool StagingRing::fits(VkDeviceSize size, VkDeviceSize &offset) const {
+  if (m_spans.empty()) {
+    offset = 0;
+    return size <= m_size;
+  }
+  // [tail, head) is in use, possibly wrapped around the end
+  VkDeviceSize tail = m_spans.front()._begin;
+  if (m_head > tail) {
+    if (m_head + size <= m_size) {
+      offset = m_head;
+      return true;
+    }
+    // wrap, the end of the ring stays unused until the head passes it again;
+    // stay strictly below tail so that head == tail only means empty
+    if (size < tail) {
+      offset = 0;
+      return true;
+    }
+    return false;
+  }
+  if (m_head + size < tail) {
+    offset = m_head;
+    return true;
+  }
+  return false;
+}
+
+void StagingRing::reclaim() {
+  uint64_t completed = 0;
+  vkGetSemaphoreCounterValue(m_device, m_timeline, &completed);
+
+  while (!m_spans.empty()) {
+    const auto &front = m_spans.front();
+    bool done = front._discarded || (!front._pinned && front._value != 0 &&
+                                     front._value <= completed);
+    if (!done) {
+      break;
+    }
+    m_spans.pop_front();
+  }
+  if (m_spans.empty()) {
+    m_head = 0;
+  }
+
+  auto it = std::remove_if(
+      m_overflow.begin(), m_overflow.end(), [&](const Overflow &overflow) {
+        if (overflow._pinned || overflow._value == 0 ||
+            overflow._value > completed) {
+          return false;
+        }
+        vkDestroyBuffer(m_device, overflow._buffer, nullptr);
+        vkFreeMemory(m_device, overflow._memory, nullptr);
+        return true;
+      });
+  m_overflow.erase(it, m_overflow.end());
+}
+
+Result<StagingRegion> StagingRing::allocate(VkCommandBuffer owner,
+                                            VkDeviceSize size, bool pinned) {
+  if (m_buffer == VK_NULL_HANDLE) {
+    auto result = create();
+    if (result != VK_SUCCESS) {
+      return {result};
+    }
+  }
+  size = alignUp(std::max<VkDeviceSize>(size, 1), m_alignment);
+  reclaim();
+
+  while (size <= m_size) {
+    VkDeviceSize offset = 0;
+    if (fits(size, offset)) {
+      m_spans.push_back({offset, offset + size, owner, 0, false, pinned});
+      m_head = offset + size;
+
+      StagingRegion region{};
+      region._buffer = m_buffer;
+      region._memory = m_memory;
+      region._offset = offset;
+      region._size = size;
+      region._mapped = m_mapped + offset;
+      return {region};
+    }
+
+    // the oldest region has to finish first; work that hasn't been submitted
+    // yet or that is pinned can't be waited for (reclaim() already dropped
+    // discarded ones)
+    const auto &front = m_spans.front();
+    if (front._value == 0 || front._pinned) {
+      break;
+    }
+    uint64_t value = front._value;
+    VkSemaphoreWaitInfo swi{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    swi.semaphoreCount = 1;
+    swi.pSemaphores = &m_timeline;
+    swi.pValues = &value;
+    auto result = vkWaitSemaphores(m_device, &swi, UINT64_MAX);
+    if (result != VK_SUCCESS) {
+      return {result};
+    }
+    reclaim();
+  }
+
+  Overflow overflow{};
+  overflow._owner = owner;
+  overflow._pinned = pinned;
+  auto region = createBuffer(size, overflow._buffer, overflow._memory);
+  if (region.isValid()) {
+    m_overflow.push_back(overflow);
+  }
+  return region;
+}
+
+void StagingRing::submitted(VkCommandBuffer owner, uint64_t timelineValue) {
+  for (auto &span : m_spans) {
+    if (span._owner == owner && span._value == 0 && !span._discarded) {
+      span._value = timelineValue;
+    }
+  }
+  for (auto &overflow : m_overflow) {
+    if (overflow._owner == owner && overflow._value == 0) {
+      overflow._value = timelineValue;
+    }
+  }
+}
+
+void StagingRing::discard(VkCommandBuffer owner) {
+  for (auto &span : m_spans) {
+    if (span._owner == owner && span._value == 0) {
+      span._discarded = true;
+    }
+  }
+  auto it = std::remove_if(
+      m_overflow.begin(), m_overflow.end(), [&](const Overflow &overflow) {
+        if (overflow._owner != owner || overflow._value != 0) {
+          return false;
+        }
+        vkDestroyBuffer(m_device, overflow._buffer, nullptr);
+        vkFreeMemory(m_device, overflow._memory, nullptr);
+        return true;
+      });
+  m_overflow.erase(it, m_overflow.end());
+  reclaim();
+}
+
+void StagingRing::release(const StagingRegion &region) {
+  if (region._buffer == m_buffer) {
+    for (auto &span : m_spans) {
+      if (span._begin == region._offset) {
+        span._pinned = false;
+        break;
+      }
+    }
+  } else {
+    for (auto &overflow : m_overflow) {
+      if (overflow._buffer == region._buffer) {
+        overflow._pinned = false;
+        break;
+      }
+    }
+  }
+  reclaim();
+}
+
+void StagingRing::invalidate(const StagingRegion &region) const {
+  if (m_properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+    return;
+  }
+  VkMappedMemoryRange range{VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE};
+  range.memory = region._memory;
+  range.offset = alignDown(region._offset, m_alignment);
+  // ring regions are atom aligned already, overflow buffers are their own
+  // allocation
+  range.size = region._memory == m_memory
+                   ? alignUp(region._offset + region._size, m_alignment) -
+                         range.offset
+                   : VK_WHOLE_SIZE;
+  vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+}
+
+} // namespace melkior::engine
@@ -0,0 +1,107 @@
+#ifndef MELKIOR_COMPACT_HPP
+#define MELKIOR_COMPACT_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+#include "scan.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+enum class CompactKey : uint8_t { UINT32, INT32, FLOAT32 };
+
+enum class CompactPredicate : uint8_t {
+  NONZERO,
+  EQUAL,
+  NOT_EQUAL,
+  LESS,
+  LESS_EQUAL,
+  GREATER,
+  GREATER_EQUAL
+};
+
+// Which elements survive a compaction: elements are _words 32-bit words and
+// word _field of each is tested against _threshold, read as _keyType. A
+// float NaN passes NONZERO and NOT_EQUAL and fails every other predicate.
+struct CompactFilter {
+  CompactPredicate _predicate = CompactPredicate::NONZERO;
+  CompactKey _keyType = CompactKey::UINT32;
+  // bit pattern of the value in _keyType
+  uint32_t _threshold = 0;
+  uint32_t _words = 1;
+  uint32_t _field = 0;
+
+  static CompactFilter compare(CompactPredicate predicate, uint32_t value) {
+    return {predicate, CompactKey::UINT32, value};
+  }
+  static CompactFilter compare(CompactPredicate predicate, int32_t value) {
+    return {predicate, CompactKey::INT32, static_cast<uint32_t>(value)};
+  }
+  static CompactFilter compare(CompactPredicate predicate, float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return {predicate, CompactKey::FLOAT32, bits};
+  }
+
+  // elements of several words, e.g. {x, y, w, h, score, class} filtered on
+  // the score: compare(GREATER, 0.5f).element(6, 4)
+  CompactFilter &element(uint32_t words, uint32_t field) {
+    _words = words;
+    _field = field;
+    return *this;
+  }
+};
+
+// Stable stream compaction: the elements of input that pass a filter, in
+// input order, written to the front of output, with the number kept left
+// on the device. Nothing has to come back to the host to size the work on
+// the kept elements; the count buffer holds
+//   { groupsX, groupsY, 1, count }
+// where the first three words are the VkDispatchIndirectCommand of a
+// dispatch with localSize threads per group over count elements. Give the
+// count buffer VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT to launch the next
+// kernel with CommandStream::dispatchIndirect(kernel, buffers, count).
+//
+// Flags, an exclusive Scan of them and a scatter; the flags and the scan's
+// scratch are allocated from the engine in reserve() and freed by
+// destroy().
+//
+//   auto compact = Compact::create(engine).getValue();
+//   compact.reserve(n);
+//   compact.record(stream, boxes, kept, count, n,
+//                  CompactFilter::compare(CompactPredicate::GREATER, 0.5f)
+//                      .element(6, 4));
+//   stream.dispatchIndirect(decode, {kept, count}, count);
+class Compact {
+public:
+  static constexpr VkDeviceSize kCountBytes = 4 * sizeof(uint32_t);
+
+  static engine::Result<Compact> create(engine::Engine &engine);
+
+  VkResult reserve(uint64_t capacity);
+  void destroy();
+  uint64_t capacity() const { return m_capacity; }
+
+  // elements counts input elements, output needs room for all of them
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &input,
+                  const engine::Buffer &output, const engine::Buffer &count,
+                  uint64_t elements, const CompactFilter &filter,
+                  uint32_t localSize = 256) const;
+
+private:
+  engine::Engine *m_engine = nullptr;
+  engine::Kernel m_flags;
+  engine::Kernel m_scatter;
+  Scan m_scan;
+
+  uint64_t m_capacity = 0;
+  engine::Buffer m_offsets;
+  engine::Buffer m_scanScratch;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
@@ -0,0 +1,100 @@
+#include "compact.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters: detection candidates {x, y, w, h, score, class}
+  const uint32_t N = 200003;
+  const uint32_t words = 6;
+  const float threshold = 0.9f;
+
+  Engine engine("vk_compact");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+  auto compactResult = Compact::create(engine);
+  if (!compactResult.isValid()) {
+    std::cerr << "Compact::create failed: " << compactResult.getError()
+              << "\n";
+    return 1;
+  }
+  Compact compact = compactResult.getValue();
+  if (compact.reserve(N) != VK_SUCCESS) {
+    std::cerr << "Compact::reserve failed\n";
+    return 1;
+  }
+
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  std::vector<float> boxes(size_t(N) * words);
+  std::vector<float> expected;
+  for (uint32_t i = 0; i < N; i++) {
+    float *box = &boxes[size_t(i) * words];
+    for (uint32_t w = 0; w < words; w++) {
+      box[w] = w == 4 ? dist(rng) : float(i % 97 + w);
+    }
+    if (box[4] > threshold) {
+      expected.insert(expected.end(), box, box + words);
+    }
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const VkDeviceSize bytes = boxes.size() * sizeof(float);
+  Buffer in = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer out = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer count =
+      engine
+          .createBuffer(Compact::kCountBytes,
+                        usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                        MEM_GPU_ONLY)
+          .getValue();
+
+  CommandStream stream(engine);
+  stream.upload(in, boxes.data(), bytes);
+  VkResult r = compact.record(
+      stream, in, out, count, N,
+      CompactFilter::compare(CompactPredicate::GREATER, threshold)
+          .element(words, 4));
+  uint32_t args[4] = {};
+  std::vector<float> result(boxes.size());
+  stream.readback(count, args, sizeof(args));
+  stream.readback(out, result.data(), bytes);
+  if (r == VK_SUCCESS) {
+    r = stream.submit();
+  }
+  if (r != VK_SUCCESS) {
+    std::cerr << "compact failed: " << r << "\n";
+    return 1;
+  }
+
+  const uint32_t kept = static_cast<uint32_t>(expected.size() / words);
+  bool ok = args[3] == kept && args[0] * args[1] * 256 >= kept &&
+            args[2] == 1 &&
+            std::memcmp(result.data(), expected.data(),
+                        expected.size() * sizeof(float)) == 0;
+  std::cout << "kept " << args[3] << " of " << N << " (expected " << kept
+            << "), dispatch {" << args[0] << ", " << args[1] << ", "
+            << args[2] << "}\n";
+
+  compact.destroy();
+  engine.destroyBuffer(in);
+  engine.destroyBuffer(out);
+  engine.destroyBuffer(count);
+  if (!ok) {
+    std::cerr << "Mismatch\n";
+    return 1;
+  }
+  std::cout << "OK: compaction matches.\n";
+  return 0;
+}
@@ -0,0 +1,66 @@
+// Push constants and the predicate of the compaction kernels.
+
+// predicates
+const uint NONZERO = 0;
+const uint EQUAL = 1;
+const uint NOT_EQUAL = 2;
+const uint LESS = 3;
+const uint LESS_EQUAL = 4;
+const uint GREATER = 5;
+const uint GREATER_EQUAL = 6;
+
+// key types
+const uint KEY_UINT = 0;
+const uint KEY_INT = 1;
+const uint KEY_FLOAT = 2;
+
+layout(push_constant) uniform PC {
+    uint count;
+    // words per element and the word the predicate looks at
+    uint words;
+    uint field;
+    uint predicate;
+    uint keyType;
+    // bits of the value compared against, in the key type
+    uint threshold;
+    // threads per group of the dispatch the count is turned into
+    uint localSize;
+    uint maxGroupsX;
+} pc;
+
+// -1, 0, 1 for less, equal, greater; 2 when unordered (NaN)
+int compareKey(uint bits) {
+    if (pc.keyType == KEY_FLOAT) {
+        float a = uintBitsToFloat(bits);
+        float b = uintBitsToFloat(pc.threshold);
+        return a < b ? -1 : (a > b ? 1 : (a == b ? 0 : 2));
+    }
+    if (pc.keyType == KEY_INT) {
+        int a = int(bits);
+        int b = int(pc.threshold);
+        return a < b ? -1 : (a > b ? 1 : 0);
+    }
+    return bits < pc.threshold ? -1 : (bits > pc.threshold ? 1 : 0);
+}
+
+bool keep(uint bits) {
+    if (pc.predicate == NONZERO) {
+        return pc.keyType == KEY_FLOAT ? uintBitsToFloat(bits) != 0.0
+                                       : bits != 0;
+    }
+    int c = compareKey(bits);
+    switch (pc.predicate) {
+    case EQUAL:
+        return c == 0;
+    case NOT_EQUAL:
+        return c != 0;
+    case LESS:
+        return c == -1;
+    case LESS_EQUAL:
+        return c == -1 || c == 0;
+    case GREATER:
+        return c == 1;
+    default:
+        return c == 1 || c == 0;
+    }
+}
@@ -0,0 +1,133 @@
+#include "../include/compact.hpp"
+
+#include <algorithm>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of compact_common.glsl
+struct PushConstants {
+  uint32_t count;
+  uint32_t words;
+  uint32_t field;
+  uint32_t predicate;
+  uint32_t keyType;
+  uint32_t threshold;
+  uint32_t localSize;
+  uint32_t maxGroupsX;
+};
+
+constexpr uint32_t kThreads = 256;
+
+} // namespace
+
+Result<Compact> Compact::create(Engine &engine) {
+  auto flags = engine.createKernel(
+      "compact_flags.spv",
+      {{STORAGE_READ, STORAGE_WRITE}, sizeof(PushConstants)});
+  if (!flags.isValid()) {
+    return {flags.getError()};
+  }
+  auto scatter = engine.createKernel(
+      "compact_scatter.spv",
+      {{STORAGE_READ, STORAGE_READ, STORAGE_WRITE, STORAGE_WRITE},
+       sizeof(PushConstants)});
+  if (!scatter.isValid()) {
+    return {scatter.getError()};
+  }
+  auto scan = Scan::create(engine);
+  if (!scan.isValid()) {
+    return {scan.getError()};
+  }
+
+  Compact compact;
+  compact.m_engine = &engine;
+  compact.m_flags = flags.getValue();
+  compact.m_scatter = scatter.getValue();
+  compact.m_scan = scan.getValue();
+  return {compact};
+}
+
+VkResult Compact::reserve(uint64_t capacity) {
+  if (m_engine == nullptr || capacity > UINT32_MAX) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  // the buffers are bound even for an empty input
+  capacity = std::max<uint64_t>(capacity, 1);
+  if (capacity <= m_capacity) {
+    return VK_SUCCESS;
+  }
+  destroy();
+
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  auto offsets = m_engine->createBuffer(capacity * sizeof(uint32_t), usage,
+                                        MEM_GPU_ONLY);
+  if (!offsets.isValid()) {
+    return offsets.getError();
+  }
+  auto scratch = m_engine->createBuffer(m_scan.scratchSize(capacity), usage,
+                                        MEM_GPU_ONLY);
+  if (!scratch.isValid()) {
+    m_engine->destroyBuffer(offsets.getValue());
+    return scratch.getError();
+  }
+
+  m_offsets = offsets.getValue();
+  m_scanScratch = scratch.getValue();
+  m_capacity = capacity;
+  return VK_SUCCESS;
+}
+
+void Compact::destroy() {
+  if (m_engine == nullptr || m_capacity == 0) {
+    return;
+  }
+  m_engine->destroyBuffer(m_offsets);
+  m_engine->destroyBuffer(m_scanScratch);
+  m_offsets = {};
+  m_scanScratch = {};
+  m_capacity = 0;
+}
+
+VkResult Compact::record(CommandStream &stream, const Buffer &input,
+                         const Buffer &output, const Buffer &count,
+                         uint64_t elements, const CompactFilter &filter,
+                         uint32_t localSize) const {
+  const VkDeviceSize bytes =
+      VkDeviceSize(elements) * filter._words * sizeof(uint32_t);
+  if (m_capacity == 0 || elements > m_capacity || filter._words == 0 ||
+      filter._field >= filter._words || localSize == 0 ||
+      input._size < bytes || output._size < bytes ||
+      count._size < kCountBytes) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const uint32_t maxGroupsX = m_engine->maxGroupsX();
+  const PushConstants pc{static_cast<uint32_t>(elements),
+                         filter._words,
+                         filter._field,
+                         static_cast<uint32_t>(filter._predicate),
+                         static_cast<uint32_t>(filter._keyType),
+                         filter._threshold,
+                         localSize,
+                         maxGroupsX};
+  const WorkGroups grid = spread(elements, kThreads, maxGroupsX);
+
+  // an empty input only has the scatter write the zero count
+  if (elements > 0) {
+    stream.dispatch(m_flags, {input, m_offsets}, pc, grid,
+                    {elements * 2 * sizeof(uint32_t), elements});
+    VkResult result = m_scan.record(stream, m_offsets, m_offsets,
+                                    m_scanScratch, elements, true);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+  }
+  stream.dispatch(m_scatter, {input, m_offsets, output, count}, pc, grid,
+                  {2 * bytes + elements * 2 * sizeof(uint32_t), elements});
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
@@ -0,0 +1,96 @@
+#ifndef MELKIOR_ELEMENTWISE_HPP
+#define MELKIOR_ELEMENTWISE_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+enum class ElementType : uint8_t { FLOAT32, FLOAT16, INT32, UINT8 };
+
+// ADD a + b, SAXPY alpha a + b, RELU max(a, 0), CLAMP clamp(a, lo, hi),
+// TANH and SIGMOID (float types only)
+enum class ElementwiseOp : uint8_t { ADD, SAXPY, RELU, CLAMP, TANH, SIGMOID };
+
+// Scalar operands; integer types round them.
+struct ElementwiseScalars {
+  double _alpha = 1.0;
+  double _lo = 0.0;
+  double _hi = 1.0;
+};
+
+// One elementwise op over fp32, fp16, int32 or uint8 buffers.
+//
+// Every op / type pair is its own kernel, generated at build time from
+// one template (shaders/elementwise.comp) by the CMake shader step. The
+// kernels move four elements per load and store and several vectors per
+// thread. uint8 results saturate to [0, 255], int32 ones wrap. Buffers
+// are sized with bufferSize(), whole four element vectors, and the output
+// may be one of the inputs. The masked variants take a byte per element
+// and write the result only where it is nonzero, the passthrough input (b
+// for SAXPY, a otherwise) elsewhere.
+//
+//   auto saxpy = Elementwise::create(engine, ElementwiseOp::SAXPY,
+//                                    ElementType::FLOAT32).getValue();
+//   saxpy.record(stream, x, y, y, n, {2.0});
+//   stream.submit();
+class Elementwise {
+public:
+  static engine::Result<Elementwise> create(engine::Engine &engine,
+                                            ElementwiseOp op,
+                                            ElementType type);
+
+  static bool supports(ElementwiseOp op, ElementType type);
+  static bool binary(ElementwiseOp op) {
+    return op == ElementwiseOp::ADD || op == ElementwiseOp::SAXPY;
+  }
+  static uint32_t elementSize(ElementType type);
+  // bytes of a buffer of count elements, padded to whole vectors; also the
+  // size of a mask of count bytes
+  static VkDeviceSize bufferSize(ElementType type, uint64_t count);
+
+  // unary ops
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &a,
+                  const engine::Buffer &out, uint32_t count,
+                  const ElementwiseScalars &scalars = {}) const;
+  // ADD and SAXPY
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &a,
+                  const engine::Buffer &b, const engine::Buffer &out,
+                  uint32_t count, const ElementwiseScalars &scalars = {}) const;
+  VkResult recordMasked(engine::CommandStream &stream,
+                        const engine::Buffer &a, const engine::Buffer &mask,
+                        const engine::Buffer &out, uint32_t count,
+                        const ElementwiseScalars &scalars = {}) const;
+  VkResult recordMasked(engine::CommandStream &stream,
+                        const engine::Buffer &a, const engine::Buffer &b,
+                        const engine::Buffer &mask, const engine::Buffer &out,
+                        uint32_t count,
+                        const ElementwiseScalars &scalars = {}) const;
+
+  ElementwiseOp op() const { return m_op; }
+  ElementType type() const { return m_type; }
+  // inputs, mask and output each touched once
+  uint64_t bytes(uint32_t count, bool masked = false) const;
+
+private:
+  VkResult recordKernel(engine::CommandStream &stream,
+                        const engine::Kernel &kernel, const engine::Buffer &a,
+                        const engine::Buffer &b, const engine::Buffer &mask,
+                        const engine::Buffer &out, uint32_t count,
+                        const ElementwiseScalars &scalars, bool binaryCall,
+                        bool masked) const;
+
+  engine::Engine *m_engine = nullptr;
+  ElementwiseOp m_op = ElementwiseOp::ADD;
+  ElementType m_type = ElementType::FLOAT32;
+  uint32_t m_maxGroupsX = 65535;
+  engine::Kernel m_kernel;
+  engine::Kernel m_masked;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
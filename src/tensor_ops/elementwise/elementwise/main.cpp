@@ -0,0 +1,263 @@
+#include "elementwise.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+uint16_t toHalf(float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000u;
+  const int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+  if (exponent <= 0) {
+    return uint16_t(sign); // flushed, inputs stay away from this range
+  }
+  // round to nearest on the dropped mantissa bits
+  const uint32_t mantissa = (bits & 0x7FFFFFu) + 0x1000u;
+  return uint16_t(sign + (uint32_t(exponent) << 10) + (mantissa >> 13));
+}
+
+float fromHalf(uint16_t half) {
+  const uint32_t sign = uint32_t(half & 0x8000u) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1F;
+  const uint32_t mantissa = half & 0x3FFu;
+  uint32_t bits = sign;
+  if (exponent != 0) {
+    bits |= ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  float value = 0.0f;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// host copy of an element buffer, read and written as doubles
+struct Elements {
+  ElementType _type;
+  std::vector<uint8_t> _bytes;
+
+  Elements(ElementType type, uint32_t count)
+      : _type(type), _bytes(Elementwise::bufferSize(type, count), 0) {}
+
+  double get(uint32_t i) const {
+    switch (_type) {
+    case ElementType::FLOAT32: {
+      float f;
+      std::memcpy(&f, &_bytes[i * 4], 4);
+      return f;
+    }
+    case ElementType::FLOAT16: {
+      uint16_t h;
+      std::memcpy(&h, &_bytes[i * 2], 2);
+      return fromHalf(h);
+    }
+    case ElementType::INT32: {
+      int32_t v;
+      std::memcpy(&v, &_bytes[i * 4], 4);
+      return v;
+    }
+    default:
+      return _bytes[i];
+    }
+  }
+
+  void set(uint32_t i, double value) {
+    switch (_type) {
+    case ElementType::FLOAT32: {
+      const float f = float(value);
+      std::memcpy(&_bytes[i * 4], &f, 4);
+      break;
+    }
+    case ElementType::FLOAT16: {
+      const uint16_t h = toHalf(float(value));
+      std::memcpy(&_bytes[i * 2], &h, 2);
+      break;
+    }
+    case ElementType::INT32: {
+      const int32_t v = int32_t(value);
+      std::memcpy(&_bytes[i * 4], &v, 4);
+      break;
+    }
+    default:
+      _bytes[i] = uint8_t(std::clamp(value, 0.0, 255.0));
+      break;
+    }
+  }
+};
+
+double apply(ElementwiseOp op, ElementType type, double a, double b,
+             const ElementwiseScalars &s) {
+  const bool integer = type == ElementType::INT32 || type == ElementType::UINT8;
+  double r = 0.0;
+  switch (op) {
+  case ElementwiseOp::ADD:
+    r = a + b;
+    break;
+  case ElementwiseOp::SAXPY:
+    r = (integer ? std::round(s._alpha) : s._alpha) * a + b;
+    break;
+  case ElementwiseOp::RELU:
+    r = std::max(a, 0.0);
+    break;
+  case ElementwiseOp::CLAMP:
+    r = integer ? std::clamp(a, std::round(s._lo), std::round(s._hi))
+                : std::clamp(a, s._lo, s._hi);
+    break;
+  case ElementwiseOp::TANH:
+    r = std::tanh(a);
+    break;
+  case ElementwiseOp::SIGMOID:
+    r = 1.0 / (1.0 + std::exp(-a));
+    break;
+  }
+  return type == ElementType::UINT8 ? std::clamp(r, 0.0, 255.0) : r;
+}
+
+} // namespace
+
+int main() {
+  // --- Parameters: an element count that leaves a partial last vector
+  const uint32_t count = 100003;
+  const ElementwiseScalars scalars{1.75, -0.5, 40.0};
+
+  Engine engine("vk_elementwise");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  CommandStream stream(engine);
+  std::mt19937 rng(24);
+  std::uniform_real_distribution<double> dist(-60.0, 60.0);
+  bool ok = true;
+
+  std::vector<uint8_t> mask(Elementwise::bufferSize(ElementType::UINT8, count));
+  for (uint8_t &m : mask) {
+    m = rng() % 3 == 0 ? 0 : uint8_t(1 + rng() % 255);
+  }
+  Buffer maskBuf =
+      engine.createBuffer(mask.size(), usage, MEM_GPU_ONLY).getValue();
+  stream.upload(maskBuf, mask.data(), mask.size());
+
+  const char *opNames[] = {"add", "saxpy", "relu", "clamp", "tanh", "sigmoid"};
+  const char *typeNames[] = {"fp32", "fp16", "int32", "uint8"};
+  const ElementwiseOp ops[] = {ElementwiseOp::ADD,  ElementwiseOp::SAXPY,
+                               ElementwiseOp::RELU, ElementwiseOp::CLAMP,
+                               ElementwiseOp::TANH, ElementwiseOp::SIGMOID};
+  const ElementType types[] = {ElementType::FLOAT32, ElementType::FLOAT16,
+                               ElementType::INT32, ElementType::UINT8};
+
+  for (ElementType type : types) {
+    Elements a(type, count);
+    Elements b(type, count);
+    for (uint32_t i = 0; i < count; i++) {
+      double x = dist(rng);
+      double y = dist(rng);
+      if (type != ElementType::FLOAT32 && type != ElementType::FLOAT16) {
+        x = std::round(type == ElementType::UINT8 ? std::abs(x) * 4 : x);
+        y = std::round(type == ElementType::UINT8 ? std::abs(y) * 4 : y);
+      }
+      a.set(i, type == ElementType::FLOAT32 || type == ElementType::FLOAT16
+                   ? x / 20
+                   : x);
+      b.set(i, y);
+    }
+    const VkDeviceSize bytes = a._bytes.size();
+    Buffer aBuf = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer bBuf = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer outBuf = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    stream.upload(aBuf, a._bytes.data(), bytes);
+    stream.upload(bBuf, b._bytes.data(), bytes);
+
+    for (ElementwiseOp op : ops) {
+      if (!Elementwise::supports(op, type)) {
+        continue;
+      }
+      auto created = Elementwise::create(engine, op, type);
+      if (!created.isValid()) {
+        std::cerr << "Elementwise::create failed: " << created.getError()
+                  << "\n";
+        return 1;
+      }
+      Elementwise elementwise = created.getValue();
+      for (bool masked : {false, true}) {
+        // the padding past count has to survive
+        Elements out(type, count);
+        for (size_t i = 0; i < out._bytes.size(); i++) {
+          out._bytes[i] = uint8_t(0xA5 ^ i);
+        }
+        stream.upload(outBuf, out._bytes.data(), bytes);
+        const bool binary = Elementwise::binary(op);
+        VkResult r;
+        if (masked) {
+          r = binary ? elementwise.recordMasked(stream, aBuf, bBuf, maskBuf,
+                                                outBuf, count, scalars)
+                     : elementwise.recordMasked(stream, aBuf, maskBuf, outBuf,
+                                                count, scalars);
+        } else {
+          r = binary ? elementwise.record(stream, aBuf, bBuf, outBuf, count,
+                                          scalars)
+                     : elementwise.record(stream, aBuf, outBuf, count,
+                                          scalars);
+        }
+        Elements result(type, count);
+        stream.readback(outBuf, result._bytes.data(), bytes);
+        if (r == VK_SUCCESS) {
+          r = stream.submit();
+        }
+        if (r != VK_SUCCESS) {
+          std::cerr << "elementwise failed: " << r << "\n";
+          return 1;
+        }
+
+        const double tolerance = type == ElementType::FLOAT16   ? 4e-3
+                                 : type == ElementType::FLOAT32 ? 1e-5
+                                                                : 0.0;
+        double maxError = 0.0;
+        for (uint32_t i = 0; i < count; i++) {
+          double expected = apply(op, type, a.get(i), b.get(i), scalars);
+          if (masked && mask[i] == 0) {
+            expected = op == ElementwiseOp::SAXPY ? b.get(i) : a.get(i);
+          }
+          if (type == ElementType::INT32) {
+            expected = double(int32_t(int64_t(expected)));
+          }
+          const double error = std::abs(result.get(i) - expected) /
+                               std::max(1.0, std::abs(expected));
+          maxError = std::max(maxError, error);
+        }
+        bool match = maxError <= tolerance;
+        for (size_t i = size_t(count) * Elementwise::elementSize(type);
+             i < bytes; i++) {
+          match &= result._bytes[i] == out._bytes[i];
+        }
+        std::cout << "  " << opNames[int(op)] << " " << typeNames[int(type)]
+                  << (masked ? " masked" : "") << ": max error " << maxError
+                  << (match ? " OK" : " FAILED") << "\n";
+        ok &= match;
+      }
+    }
+    engine.destroyBuffer(aBuf);
+    engine.destroyBuffer(bBuf);
+    engine.destroyBuffer(outBuf);
+  }
+
+  engine.destroyBuffer(maskBuf);
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "OK: elementwise ops match.\n";
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "../include/elementwise.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of elementwise.comp; scalars hold float
+// bits for float types and int for integer ones
+struct ElementwisePushConstants {
+  uint32_t count;
+  uint32_t vectors;
+  uint32_t alpha;
+  uint32_t lo;
+  uint32_t hi;
+};
+
+constexpr uint32_t kThreads = 256;
+// vectors per thread
+constexpr uint32_t kItems = 4;
+
+// the file names the CMake shader step gives the template's variants
+std::string kernelFile(ElementwiseOp op, ElementType type, bool masked) {
+  static const char *ops[] = {"add",  "saxpy", "relu",
+                              "clamp", "tanh", "sigmoid"};
+  static const char *types[] = {"fp32", "fp16", "int32", "uint8"};
+  return std::string("ew_") + ops[int(op)] + "_" + types[int(type)] +
+         (masked ? "_masked.spv" : ".spv");
+}
+
+uint32_t scalarBits(ElementType type, double value) {
+  if (type == ElementType::FLOAT32 || type == ElementType::FLOAT16) {
+    const float f = static_cast<float>(value);
+    uint32_t bits = 0;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+  }
+  const double clamped = std::clamp(std::round(value), double(INT32_MIN),
+                                    double(INT32_MAX));
+  return static_cast<uint32_t>(static_cast<int32_t>(clamped));
+}
+
+} // namespace
+
+bool Elementwise::supports(ElementwiseOp op, ElementType type) {
+  const bool transcendental =
+      op == ElementwiseOp::TANH || op == ElementwiseOp::SIGMOID;
+  return !transcendental || type == ElementType::FLOAT32 ||
+         type == ElementType::FLOAT16;
+}
+
+uint32_t Elementwise::elementSize(ElementType type) {
+  switch (type) {
+  case ElementType::FLOAT16:
+    return 2;
+  case ElementType::UINT8:
+    return 1;
+  default:
+    return 4;
+  }
+}
+
+VkDeviceSize Elementwise::bufferSize(ElementType type, uint64_t count) {
+  // bound even when empty
+  const uint64_t vectors = std::max<uint64_t>(1, (count + 3) / 4);
+  return vectors * 4 * elementSize(type);
+}
+
+uint64_t Elementwise::bytes(uint32_t count, bool masked) const {
+  const uint64_t streams = binary(m_op) ? 3 : 2;
+  return streams * count * elementSize(m_type) + (masked ? count : 0);
+}
+
+Result<Elementwise> Elementwise::create(Engine &engine, ElementwiseOp op,
+                                        ElementType type) {
+  if (!supports(op, type)) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  const KernelSignature signature{
+      {STORAGE_READ, STORAGE_READ, STORAGE_READ, STORAGE_READ_WRITE},
+      sizeof(ElementwisePushConstants)};
+  Specialization spec;
+  spec.set(0, kItems);
+  auto kernel =
+      engine.createKernel(kernelFile(op, type, false), signature, spec);
+  if (!kernel.isValid()) {
+    return {kernel.getError()};
+  }
+  auto masked =
+      engine.createKernel(kernelFile(op, type, true), signature, spec);
+  if (!masked.isValid()) {
+    return {masked.getError()};
+  }
+
+  Elementwise elementwise;
+  elementwise.m_engine = &engine;
+  elementwise.m_op = op;
+  elementwise.m_type = type;
+  elementwise.m_maxGroupsX = engine.maxGroupsX();
+  elementwise.m_kernel = kernel.getValue();
+  elementwise.m_masked = masked.getValue();
+  return {elementwise};
+}
+
+VkResult Elementwise::record(CommandStream &stream, const Buffer &a,
+                             const Buffer &out, uint32_t count,
+                             const ElementwiseScalars &scalars) const {
+  return recordKernel(stream, m_kernel, a, a, a, out, count, scalars, false,
+                      false);
+}
+
+VkResult Elementwise::record(CommandStream &stream, const Buffer &a,
+                             const Buffer &b, const Buffer &out,
+                             uint32_t count,
+                             const ElementwiseScalars &scalars) const {
+  return recordKernel(stream, m_kernel, a, b, a, out, count, scalars, true,
+                      false);
+}
+
+VkResult Elementwise::recordMasked(CommandStream &stream, const Buffer &a,
+                                   const Buffer &mask, const Buffer &out,
+                                   uint32_t count,
+                                   const ElementwiseScalars &scalars) const {
+  return recordKernel(stream, m_masked, a, a, mask, out, count, scalars, false,
+                      true);
+}
+
+VkResult Elementwise::recordMasked(CommandStream &stream, const Buffer &a,
+                                   const Buffer &b, const Buffer &mask,
+                                   const Buffer &out, uint32_t count,
+                                   const ElementwiseScalars &scalars) const {
+  return recordKernel(stream, m_masked, a, b, mask, out, count, scalars, true,
+                      true);
+}
+
+VkResult Elementwise::recordKernel(CommandStream &stream, const Kernel &kernel,
+                                   const Buffer &a, const Buffer &b,
+                                   const Buffer &mask, const Buffer &out,
+                                   uint32_t count,
+                                   const ElementwiseScalars &scalars,
+                                   bool binaryCall, bool masked) const {
+  const VkDeviceSize size = bufferSize(m_type, count);
+  if (m_engine == nullptr || binaryCall != binary(m_op) || a._size < size ||
+      b._size < size || out._size < size ||
+      (masked && mask._size < bufferSize(ElementType::UINT8, count))) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  if (count == 0) {
+    return stream.getState();
+  }
+  const uint32_t vectors = groupCount(count, 4);
+  const ElementwisePushConstants pc{count, vectors,
+                                    scalarBits(m_type, scalars._alpha),
+                                    scalarBits(m_type, scalars._lo),
+                                    scalarBits(m_type, scalars._hi)};
+  const bool transcendental =
+      m_op == ElementwiseOp::TANH || m_op == ElementwiseOp::SIGMOID;
+  stream.dispatch(kernel, {a, b, mask, out}, pc,
+                  spread(groupCount(vectors, kItems), kThreads, m_maxGroupsX),
+                  {bytes(count, masked), transcendental ? 8ull * count
+                                                        : uint64_t(count)});
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
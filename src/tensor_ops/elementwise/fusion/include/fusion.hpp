@@ -0,0 +1,174 @@
+#ifndef MELKIOR_FUSION_HPP
+#define MELKIOR_FUSION_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+#include "reduce.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+enum class ExprOp : uint8_t {
+  INPUT,
+  PARAM,
+  CONSTANT,
+  ADD,
+  SUB,
+  MUL,
+  DIV,
+  MIN,
+  MAX,
+  NEG,
+  ABS,
+  EXP,
+  SQRT,
+  RELU,
+  CLAMP,
+  TANH,
+  SIGMOID
+};
+
+// Node of an fp32 elementwise expression. Inputs are buffers, params push
+// constants that can change per record() without a new kernel, and
+// constants are baked into the generated shader. Nodes are immutable and
+// shared, so a sub-expression used twice is computed once.
+//
+//   Expr x = Expr::input(0);
+//   Expr e = clamp(relu(Expr::param(0) * x + Expr::input(1)), 0.0f, 6.0f);
+class Expr {
+public:
+  static constexpr uint32_t kMaxInputs = 8;
+  static constexpr uint32_t kMaxParams = 8;
+
+  struct Node {
+    ExprOp _op = ExprOp::CONSTANT;
+    // input or param index
+    uint32_t _index = 0;
+    float _value = 0.0f;
+    std::vector<std::shared_ptr<const Node>> _args;
+  };
+
+  // a float constant
+  Expr(float value);
+
+  static Expr input(uint32_t index);
+  static Expr param(uint32_t index);
+  // an arithmetic node, args as the operator / function below takes them
+  static Expr apply(ExprOp op, const std::vector<Expr> &args);
+
+  ExprOp op() const { return m_node->_op; }
+  const std::shared_ptr<const Node> &node() const { return m_node; }
+
+private:
+  explicit Expr(std::shared_ptr<const Node> node) : m_node(std::move(node)) {}
+
+  std::shared_ptr<const Node> m_node;
+};
+
+Expr operator+(const Expr &a, const Expr &b);
+Expr operator-(const Expr &a, const Expr &b);
+Expr operator*(const Expr &a, const Expr &b);
+Expr operator/(const Expr &a, const Expr &b);
+Expr operator-(const Expr &a);
+Expr min(const Expr &a, const Expr &b);
+Expr max(const Expr &a, const Expr &b);
+Expr abs(const Expr &a);
+Expr exp(const Expr &a);
+Expr sqrt(const Expr &a);
+Expr relu(const Expr &a);
+Expr clamp(const Expr &a, const Expr &lo, const Expr &hi);
+Expr tanh(const Expr &a);
+Expr sigmoid(const Expr &a);
+
+// what a FusedKernel does with the expression's values
+enum class FusedReduce : uint8_t { NONE, SUM, MIN, MAX };
+
+// Process wide counters of the fused kernel SPIR-V cache.
+struct FusionCacheStats {
+  uint32_t _compiled = 0;
+  uint32_t _memoryHits = 0;
+  uint32_t _diskHits = 0;
+  double _compileMs = 0.0;
+};
+
+// One compute shader for a whole elementwise expression, optionally
+// followed by a reduction over every element.
+//
+// A chain of separate elementwise ops reads and writes the full tensor
+// once per op; the fused kernel reads each input once and writes the
+// result once, keeping the intermediates in registers. create() turns the
+// expression into GLSL (four elements per load and store, a grid stride
+// loop, common sub-expressions computed once) and compiles it at runtime
+// with shaderc. The SPIR-V is cached under the hash of the generated
+// source, in the process and as fused_<hash>.spv next to the pipeline
+// cache, so the same expression is compiled once per machine; without
+// shaderc only cached kernels can be created.
+//
+// Without a reduction the values go to the output, which may be one of
+// the inputs. With one, a bounded number of work groups fold the values
+// into partials, which a Reduction folds into one ReducePair in out. The
+// partials and the Reduction's scratch are owned by the FusedKernel and
+// freed by destroy(). Buffers are sized with bufferSize(), whole four
+// element vectors, and a partial last vector keeps the output's elements
+// past the count.
+//
+//   Expr x = Expr::input(0);
+//   auto fused = FusedKernel::create(
+//                    engine, clamp(relu(Expr::param(0) * x + Expr::input(1)),
+//                                  0.0f, 6.0f))
+//                    .getValue();
+//   fused.record(stream, {xBuf, bBuf}, out, n, {2.0f});
+//   stream.submit();
+class FusedKernel {
+public:
+  static engine::Result<FusedKernel>
+  create(engine::Engine &engine, const Expr &expr,
+         FusedReduce reduce = FusedReduce::NONE);
+
+  // the generated GLSL, and the hash the SPIR-V is cached under; empty
+  // when an input or param index is past kMaxInputs / kMaxParams
+  static std::string source(const Expr &expr, FusedReduce reduce);
+  static uint64_t hash(const Expr &expr, FusedReduce reduce);
+  static FusionCacheStats cacheStats();
+  // bytes of an fp32 buffer of count elements, padded to whole vectors
+  static VkDeviceSize bufferSize(uint64_t count);
+
+  // inputs[i] is Expr::input(i), params[i] Expr::param(i) (0 if missing);
+  // out is count floats, or a ReducePair with a reduction
+  VkResult record(engine::CommandStream &stream,
+                  const std::vector<engine::Buffer> &inputs,
+                  const engine::Buffer &out, uint32_t count,
+                  const std::vector<float> &params = {}) const;
+
+  void destroy();
+
+  uint64_t hash() const { return m_hash; }
+  FusedReduce reduce() const { return m_reduce; }
+  // Expr::input slots the kernel binds, the highest used index + 1
+  uint32_t inputs() const { return m_inputs; }
+  // distinct arithmetic nodes, i.e. the ops a chain of kernels would run
+  uint32_t ops() const { return m_ops; }
+  // every input read and the output written once
+  uint64_t bytes(uint32_t count) const;
+
+private:
+  engine::Engine *m_engine = nullptr;
+  FusedReduce m_reduce = FusedReduce::NONE;
+  uint64_t m_hash = 0;
+  uint32_t m_inputs = 0;
+  uint32_t m_ops = 0;
+  uint32_t m_maxGroupsX = 65535;
+  engine::Kernel m_kernel;
+  Reduction m_reduction;
+  engine::Buffer m_partials;
+  engine::Buffer m_scratch;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
@@ -0,0 +1,229 @@
+#include "fusion.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+// the expression at element i, on the host in double
+double evaluate(const Expr::Node &node,
+                const std::vector<std::vector<float>> &inputs,
+                const std::vector<float> &params, size_t i) {
+  auto arg = [&](size_t k) {
+    return evaluate(*node._args[k], inputs, params, i);
+  };
+  switch (node._op) {
+  case ExprOp::INPUT:
+    return inputs[node._index][i];
+  case ExprOp::PARAM:
+    return node._index < params.size() ? params[node._index] : 0.0;
+  case ExprOp::CONSTANT:
+    return node._value;
+  case ExprOp::ADD:
+    return arg(0) + arg(1);
+  case ExprOp::SUB:
+    return arg(0) - arg(1);
+  case ExprOp::MUL:
+    return arg(0) * arg(1);
+  case ExprOp::DIV:
+    return arg(0) / arg(1);
+  case ExprOp::MIN:
+    return std::min(arg(0), arg(1));
+  case ExprOp::MAX:
+    return std::max(arg(0), arg(1));
+  case ExprOp::NEG:
+    return -arg(0);
+  case ExprOp::ABS:
+    return std::abs(arg(0));
+  case ExprOp::EXP:
+    return std::exp(arg(0));
+  case ExprOp::SQRT:
+    return std::sqrt(arg(0));
+  case ExprOp::RELU:
+    return std::max(arg(0), 0.0);
+  case ExprOp::CLAMP:
+    return std::min(std::max(arg(0), arg(1)), arg(2));
+  case ExprOp::TANH:
+    return std::tanh(arg(0));
+  case ExprOp::SIGMOID:
+    return 1.0 / (1.0 + std::exp(-arg(0)));
+  }
+  return 0.0;
+}
+
+} // namespace
+
+int main() {
+  // --- Parameters: an element count that leaves a partial last vector
+  const uint32_t count = 100003;
+
+  Engine engine("vk_fusion");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const VkDeviceSize bytes = FusedKernel::bufferSize(count);
+  CommandStream stream(engine);
+  std::mt19937 rng(25);
+  std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+  bool ok = true;
+
+  std::vector<std::vector<float>> inputs(3, std::vector<float>(bytes / 4));
+  std::vector<Buffer> inputBufs;
+  for (auto &input : inputs) {
+    for (float &v : input) {
+      v = dist(rng);
+    }
+    inputBufs.push_back(
+        engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue());
+    stream.upload(inputBufs.back(), input.data(), bytes);
+  }
+  Buffer outBuf = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  const std::vector<float> params = {1.5f, -0.25f, 6.0f};
+
+  const Expr x = Expr::input(0);
+  const Expr b = Expr::input(1);
+  const Expr c = Expr::input(2);
+  const Expr alpha = Expr::param(0);
+  const Expr saxpy = alpha * x + b;
+  // swish: x is loaded once and sigmoid(x) feeds two nodes
+  const Expr gate = sigmoid(x);
+  struct Case {
+    const char *_name;
+    Expr _expr;
+    FusedReduce _reduce;
+  };
+  const Case cases[] = {
+      {"clamp(relu(alpha x + b))",
+       clamp(relu(saxpy), Expr::param(1), Expr::param(2)), FusedReduce::NONE},
+      {"swish + tanh chain",
+       x * gate + tanh(b - gate) / 2.0f - min(abs(c), 3.0f),
+       FusedReduce::NONE},
+      {"exp, sqrt, max, neg",
+       sqrt(exp(-abs(x)) + 1.0f) * max(b, -c), FusedReduce::NONE},
+      {"sum of squares", (x - b) * (x - b), FusedReduce::SUM},
+      {"max of relu(alpha x + b)", relu(saxpy), FusedReduce::MAX},
+      {"min of tanh(x) c", tanh(x) * c, FusedReduce::MIN},
+  };
+
+  for (const Case &t : cases) {
+    auto created = FusedKernel::create(engine, t._expr, t._reduce);
+    if (!created.isValid()) {
+      std::cerr << "FusedKernel::create failed: " << created.getError()
+                << "\n";
+      return 1;
+    }
+    FusedKernel fused = created.getValue();
+    // the padding past count has to survive
+    std::vector<float> out(bytes / 4, 0.0f);
+    for (size_t i = count; i < out.size(); i++) {
+      out[i] = 1234.5f + float(i);
+    }
+    stream.upload(outBuf, out.data(), bytes);
+    VkResult r = fused.record(stream, inputBufs, outBuf, count, params);
+    std::vector<float> result(bytes / 4);
+    stream.readback(outBuf, result.data(), bytes);
+    if (r == VK_SUCCESS) {
+      r = stream.submit();
+    }
+    if (r != VK_SUCCESS) {
+      std::cerr << "fused kernel failed: " << r << "\n";
+      return 1;
+    }
+
+    double maxError = 0.0;
+    bool match = true;
+    if (t._reduce == FusedReduce::NONE) {
+      for (uint32_t i = 0; i < count; i++) {
+        const double expected =
+            evaluate(*t._expr.node(), inputs, params, i);
+        maxError = std::max(maxError, std::abs(result[i] - expected) /
+                                          std::max(1.0, std::abs(expected)));
+      }
+      for (size_t i = count; i < out.size(); i++) {
+        match &= result[i] == out[i];
+      }
+    } else {
+      double expected = t._reduce == FusedReduce::SUM ? 0.0
+                        : t._reduce == FusedReduce::MIN ? INFINITY
+                                                        : -INFINITY;
+      for (uint32_t i = 0; i < count; i++) {
+        const double v = evaluate(*t._expr.node(), inputs, params, i);
+        expected = t._reduce == FusedReduce::SUM   ? expected + v
+                   : t._reduce == FusedReduce::MIN ? std::min(expected, v)
+                                                   : std::max(expected, v);
+      }
+      ReducePair pair{};
+      std::memcpy(&pair, result.data(), sizeof(pair));
+      maxError =
+          std::abs(pair._value - expected) / std::max(1.0, std::abs(expected));
+    }
+    match &= maxError < 1e-4;
+    std::cout << "  " << t._name << ": " << fused.ops() << " ops, "
+              << fused.inputs() << " inputs, max error " << maxError
+              << (match ? " OK" : " FAILED") << "\n";
+    ok &= match;
+    fused.destroy();
+  }
+
+  // in place, and the same expression again comes from the cache
+  {
+    const Expr expr = clamp(relu(saxpy), Expr::param(1), Expr::param(2));
+    const FusionCacheStats before = FusedKernel::cacheStats();
+    auto again = FusedKernel::create(engine, expr);
+    if (!again.isValid()) {
+      std::cerr << "FusedKernel::create failed: " << again.getError() << "\n";
+      return 1;
+    }
+    FusedKernel fused = again.getValue();
+    VkResult r = fused.record(stream, inputBufs, inputBufs[0], count, params);
+    std::vector<float> result(bytes / 4);
+    stream.readback(inputBufs[0], result.data(), bytes);
+    if (r == VK_SUCCESS) {
+      r = stream.submit();
+    }
+    if (r != VK_SUCCESS) {
+      std::cerr << "fused kernel failed: " << r << "\n";
+      return 1;
+    }
+    double maxError = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+      const double expected = evaluate(*expr.node(), inputs, params, i);
+      maxError = std::max(maxError, std::abs(result[i] - expected));
+    }
+    const FusionCacheStats after = FusedKernel::cacheStats();
+    const bool cached = after._memoryHits == before._memoryHits + 1 &&
+                        after._compiled == before._compiled &&
+                        fused.hash() == FusedKernel::hash(expr,
+                                                          FusedReduce::NONE);
+    const bool match = cached && maxError < 1e-5;
+    std::cout << "  in place, cached (" << after._compiled << " compiled in "
+              << after._compileMs << " ms, " << after._diskHits
+              << " from disk): max error " << maxError
+              << (match ? " OK" : " FAILED") << "\n";
+    ok &= match;
+  }
+
+  for (Buffer buffer : inputBufs) {
+    engine.destroyBuffer(buffer);
+  }
+  engine.destroyBuffer(outBuf);
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "OK: fused kernels match.\n";
+  return 0;
+}
@@ -0,0 +1,583 @@
+#include "../include/fusion.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#ifdef MELKIOR_HAS_SHADERC
+#include <shaderc/shaderc.h>
+#endif
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// matches the push constant block of the generated shader
+struct FusedPushConstants {
+  uint32_t count;
+  uint32_t vectors;
+  float params[Expr::kMaxParams];
+};
+
+constexpr uint32_t kThreads = 256;
+// vectors per thread of an elementwise dispatch
+constexpr uint32_t kItems = 4;
+// work groups of a reducing dispatch, i.e. the partials Reduction folds
+constexpr uint32_t kReduceGroups = 1024;
+
+// SPIR-V of every expression compiled or loaded by this process
+struct SpirvCache {
+  std::mutex _mutex;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> _spirv;
+  FusionCacheStats _stats;
+};
+
+SpirvCache &spirvCache() {
+  static SpirvCache cache;
+  return cache;
+}
+
+// Emits the body of apply(): one vec4 temporary per distinct node, in
+// dependency order.
+class Generator {
+public:
+  // stops at the first input or param index past its limit, before the
+  // index sizes any bindings; generate() then drops the source
+  std::string emit(const std::shared_ptr<const Expr::Node> &node) {
+    if (!m_valid) {
+      return {};
+    }
+    auto found = m_names.find(node.get());
+    if (found != m_names.end()) {
+      return found->second;
+    }
+    std::vector<std::string> args;
+    for (const auto &arg : node->_args) {
+      args.push_back(emit(arg));
+    }
+    const uint32_t limit = node->_op == ExprOp::INPUT   ? Expr::kMaxInputs
+                           : node->_op == ExprOp::PARAM ? Expr::kMaxParams
+                                                        : UINT32_MAX;
+    if (!m_valid || node->_index >= limit) {
+      m_valid = false;
+      return {};
+    }
+
+    std::ostringstream value;
+    switch (node->_op) {
+    case ExprOp::INPUT:
+      m_inputs = std::max(m_inputs, node->_index + 1);
+      value << "in" << node->_index << "[v]";
+      break;
+    case ExprOp::PARAM:
+      value << "vec4(pc.p" << node->_index << ")";
+      break;
+    case ExprOp::CONSTANT: {
+      // the exact bits, no decimal round trip
+      uint32_t bits = 0;
+      std::memcpy(&bits, &node->_value, sizeof(bits));
+      value << "vec4(uintBitsToFloat(0x" << std::hex << std::setw(8)
+            << std::setfill('0') << bits << "u))";
+      break;
+    }
+    case ExprOp::ADD:
+      value << args[0] << " + " << args[1];
+      break;
+    case ExprOp::SUB:
+      value << args[0] << " - " << args[1];
+      break;
+    case ExprOp::MUL:
+      value << args[0] << " * " << args[1];
+      break;
+    case ExprOp::DIV:
+      value << args[0] << " / " << args[1];
+      break;
+    case ExprOp::MIN:
+      value << "min(" << args[0] << ", " << args[1] << ")";
+      break;
+    case ExprOp::MAX:
+      value << "max(" << args[0] << ", " << args[1] << ")";
+      break;
+    case ExprOp::NEG:
+      value << "-" << args[0];
+      break;
+    case ExprOp::ABS:
+      value << "abs(" << args[0] << ")";
+      break;
+    case ExprOp::EXP:
+      value << "exp(" << args[0] << ")";
+      break;
+    case ExprOp::SQRT:
+      value << "sqrt(" << args[0] << ")";
+      break;
+    case ExprOp::RELU:
+      value << "max(" << args[0] << ", vec4(0.0))";
+      break;
+    case ExprOp::CLAMP:
+      // defined for lo > hi too, unlike GLSL clamp()
+      value << "min(max(" << args[0] << ", " << args[1] << "), " << args[2]
+            << ")";
+      break;
+    case ExprOp::TANH:
+      value << "tanh(" << args[0] << ")";
+      break;
+    case ExprOp::SIGMOID:
+      value << "1.0 / (1.0 + exp(-" << args[0] << "))";
+      break;
+    }
+    const bool leaf = node->_args.empty();
+    m_ops += leaf ? 0 : 1;
+
+    const std::string name = "t" + std::to_string(m_names.size());
+    m_body << "    vec4 " << name << " = " << value.str() << ";\n";
+    m_names.emplace(node.get(), name);
+    return name;
+  }
+
+  std::string body() const { return m_body.str(); }
+  bool valid() const { return m_valid; }
+  uint32_t inputs() const { return m_inputs; }
+  uint32_t ops() const { return m_ops; }
+
+private:
+  std::unordered_map<const Expr::Node *, std::string> m_names;
+  std::ostringstream m_body;
+  bool m_valid = true;
+  uint32_t m_inputs = 0;
+  uint32_t m_ops = 0;
+};
+
+struct Generated {
+  std::string _source;
+  bool _valid = false;
+  uint32_t _inputs = 0;
+  uint32_t _ops = 0;
+};
+
+Generated generate(const Expr &expr, FusedReduce reduce) {
+  Generator generator;
+  const std::string result = generator.emit(expr.node());
+  if (!generator.valid()) {
+    return {};
+  }
+  const bool reduces = reduce != FusedReduce::NONE;
+  const char *reduceNames[] = {"", "SUM", "MIN", "MAX"};
+
+  std::ostringstream s;
+  s << "#version 450\n\n"
+    << "// Generated by FusedKernel::create: one fused elementwise "
+       "expression";
+  if (reduces) {
+    s << ",\n// folded into per work group " << reduceNames[int(reduce)]
+      << " partials";
+  }
+  s << ".\n"
+    << "layout(local_size_x = " << kThreads
+    << ", local_size_y = 1, local_size_z = 1) in;\n\n";
+  // every slot up to the highest used one is bound
+  for (uint32_t i = 0; i < generator.inputs(); i++) {
+    s << "layout(set = 0, binding = " << i
+      << ", std430) readonly buffer In" << i << " {\n"
+      << "    vec4 in" << i << "[];\n"
+      << "};\n\n";
+  }
+  if (reduces) {
+    s << "layout(set = 0, binding = " << generator.inputs()
+      << ", std430) writeonly buffer PartialBuf {\n"
+      << "    float partials[];\n"
+      << "};\n\n"
+      << "shared float partial[" << kThreads << "];\n\n";
+  } else {
+    s << "layout(set = 0, binding = " << generator.inputs()
+      << ", std430) buffer OutBuf {\n"
+      << "    vec4 dst[];\n"
+      << "};\n\n";
+  }
+  s << "layout(push_constant) uniform PC {\n"
+    << "    uint count;\n"
+    << "    uint vectors;\n";
+  for (uint32_t i = 0; i < Expr::kMaxParams; i++) {
+    s << "    float p" << i << ";\n";
+  }
+  s << "} pc;\n\n"
+    << "vec4 apply(uint v) {\n"
+    << generator.body() << "    return " << result << ";\n"
+    << "}\n\n";
+
+  if (reduces) {
+    const char *identity = reduce == FusedReduce::SUM   ? "0.0"
+                           : reduce == FusedReduce::MIN ? "uintBitsToFloat("
+                                                          "0x7f800000u)"
+                                                        : "uintBitsToFloat("
+                                                          "0xff800000u)";
+    const char *combine = reduce == FusedReduce::SUM   ? "a + b"
+                          : reduce == FusedReduce::MIN ? "min(a, b)"
+                                                       : "max(a, b)";
+    s << "#define IDENTITY " << identity << "\n\n"
+      << "float combine(float a, float b) {\n"
+      << "    return " << combine << ";\n"
+      << "}\n\n";
+  }
+
+  s << "void main() {\n"
+    << "    uint group = gl_WorkGroupID.x + gl_WorkGroupID.y * "
+       "gl_NumWorkGroups.x;\n"
+    << "    uint stride = gl_NumWorkGroups.x * gl_NumWorkGroups.y * "
+       "gl_WorkGroupSize.x;\n"
+    << "    uint first = group * gl_WorkGroupSize.x + "
+       "gl_LocalInvocationID.x;\n";
+  if (reduces) {
+    s << "    float acc = IDENTITY;\n";
+  }
+  s << "    for (uint v = first; v < pc.vectors; v += stride) {\n"
+    << "        vec4 result = apply(v);\n"
+    << "        if (v * 4 + 4 > pc.count) {\n"
+    << "            bvec4 live = lessThan(uvec4(v * 4) + uvec4(0, 1, 2, 3),\n"
+    << "                                  uvec4(pc.count));\n"
+    << "            result = mix("
+    << (reduces ? "vec4(IDENTITY)" : "dst[v]") << ", result, live);\n"
+    << "        }\n";
+  if (reduces) {
+    s << "        acc = combine(acc, combine(combine(result.x, result.y),\n"
+      << "                                   combine(result.z, result.w)));\n"
+      << "    }\n\n"
+      << "    uint lid = gl_LocalInvocationID.x;\n"
+      << "    partial[lid] = acc;\n"
+      << "    barrier();\n"
+      << "    for (uint s = gl_WorkGroupSize.x / 2; s > 0; s >>= 1) {\n"
+      << "        if (lid < s) {\n"
+      << "            partial[lid] = combine(partial[lid], partial[lid + s]);\n"
+      << "        }\n"
+      << "        barrier();\n"
+      << "    }\n"
+      << "    if (lid == 0) {\n"
+      << "        partials[group] = partial[0];\n"
+      << "    }\n";
+  } else {
+    s << "        dst[v] = result;\n"
+      << "    }\n";
+  }
+  s << "}\n";
+
+  Generated generated;
+  generated._source = s.str();
+  generated._valid = generator.valid();
+  generated._inputs = generator.inputs();
+  generated._ops = generator.ops();
+  return generated;
+}
+
+std::string hashString(uint64_t hash) {
+  std::ostringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return ss.str();
+}
+
+#ifdef MELKIOR_HAS_SHADERC
+Result<std::vector<uint32_t>> compile(const std::string &source) {
+  shaderc_compiler_t compiler = shaderc_compiler_initialize();
+  shaderc_compile_options_t options = shaderc_compile_options_initialize();
+  if (compiler == nullptr || options == nullptr) {
+    shaderc_compile_options_release(options);
+    shaderc_compiler_release(compiler);
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  shaderc_compile_options_set_optimization_level(
+      options, shaderc_optimization_level_performance);
+  shaderc_compilation_result_t result = shaderc_compile_into_spv(
+      compiler, source.data(), source.size(), shaderc_compute_shader,
+      "fused.comp", "main", options);
+
+  Result<std::vector<uint32_t>> spirv{VK_ERROR_INITIALIZATION_FAILED};
+  if (shaderc_result_get_compilation_status(result) ==
+      shaderc_compilation_status_success) {
+    std::vector<uint32_t> words(shaderc_result_get_length(result) / 4);
+    std::memcpy(words.data(), shaderc_result_get_bytes(result),
+                words.size() * 4);
+    spirv = {words};
+  }
+  shaderc_result_release(result);
+  shaderc_compile_options_release(options);
+  shaderc_compiler_release(compiler);
+  return spirv;
+}
+#endif
+
+// the process cache, then fused_<hash>.spv next to the pipeline cache, then
+// shaderc
+Result<std::vector<uint32_t>> spirvFor(Engine &engine, uint64_t hash,
+                                       const std::string &source) {
+  SpirvCache &cache = spirvCache();
+  std::lock_guard<std::mutex> lock(cache._mutex);
+  auto found = cache._spirv.find(hash);
+  if (found != cache._spirv.end()) {
+    cache._stats._memoryHits++;
+    return {found->second};
+  }
+
+  const fs::path dir = fs::path(engine.pipelineCachePath()).parent_path();
+  const fs::path path = dir / ("fused_" + hashString(hash) + ".spv");
+  auto cached = readSpirv(path.string());
+  if (cached.isValid()) {
+    cache._stats._diskHits++;
+    cache._spirv.emplace(hash, cached.getValue());
+    return cached;
+  }
+
+#ifdef MELKIOR_HAS_SHADERC
+  const auto start = std::chrono::steady_clock::now();
+  auto compiled = compile(source);
+  if (!compiled.isValid()) {
+    return compiled;
+  }
+  cache._stats._compiled++;
+  cache._stats._compileMs += std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+  const std::vector<uint32_t> &words = compiled.getValue();
+  cache._spirv.emplace(hash, words);
+
+  // a failed write only costs the next process a compile
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  const fs::path temp = dir / ("fused_" + hashString(hash) + ".tmp");
+  std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(words.data()),
+             static_cast<std::streamsize>(words.size() * 4));
+  file.close();
+  if (file) {
+    fs::rename(temp, path, ec);
+  } else {
+    fs::remove(temp, ec);
+  }
+  return compiled;
+#else
+  (void)source;
+  return {VK_ERROR_FEATURE_NOT_PRESENT};
+#endif
+}
+
+} // namespace
+
+Expr::Expr(float value) {
+  auto node = std::make_shared<Node>();
+  node->_op = ExprOp::CONSTANT;
+  node->_value = value;
+  m_node = std::move(node);
+}
+
+Expr Expr::input(uint32_t index) {
+  auto node = std::make_shared<Node>();
+  node->_op = ExprOp::INPUT;
+  node->_index = index;
+  return Expr(std::move(node));
+}
+
+Expr Expr::param(uint32_t index) {
+  auto node = std::make_shared<Node>();
+  node->_op = ExprOp::PARAM;
+  node->_index = index;
+  return Expr(std::move(node));
+}
+
+Expr Expr::apply(ExprOp op, const std::vector<Expr> &args) {
+  auto node = std::make_shared<Node>();
+  node->_op = op;
+  for (const Expr &arg : args) {
+    node->_args.push_back(arg.m_node);
+  }
+  return Expr(std::move(node));
+}
+
+Expr operator+(const Expr &a, const Expr &b) {
+  return Expr::apply(ExprOp::ADD, {a, b});
+}
+
+Expr operator-(const Expr &a, const Expr &b) {
+  return Expr::apply(ExprOp::SUB, {a, b});
+}
+
+Expr operator*(const Expr &a, const Expr &b) {
+  return Expr::apply(ExprOp::MUL, {a, b});
+}
+
+Expr operator/(const Expr &a, const Expr &b) {
+  return Expr::apply(ExprOp::DIV, {a, b});
+}
+
+Expr operator-(const Expr &a) { return Expr::apply(ExprOp::NEG, {a}); }
+
+Expr min(const Expr &a, const Expr &b) {
+  return Expr::apply(ExprOp::MIN, {a, b});
+}
+
+Expr max(const Expr &a, const Expr &b) {
+  return Expr::apply(ExprOp::MAX, {a, b});
+}
+
+Expr abs(const Expr &a) { return Expr::apply(ExprOp::ABS, {a}); }
+
+Expr exp(const Expr &a) { return Expr::apply(ExprOp::EXP, {a}); }
+
+Expr sqrt(const Expr &a) { return Expr::apply(ExprOp::SQRT, {a}); }
+
+Expr relu(const Expr &a) { return Expr::apply(ExprOp::RELU, {a}); }
+
+Expr clamp(const Expr &a, const Expr &lo, const Expr &hi) {
+  return Expr::apply(ExprOp::CLAMP, {a, lo, hi});
+}
+
+Expr tanh(const Expr &a) { return Expr::apply(ExprOp::TANH, {a}); }
+
+Expr sigmoid(const Expr &a) { return Expr::apply(ExprOp::SIGMOID, {a}); }
+
+std::string FusedKernel::source(const Expr &expr, FusedReduce reduce) {
+  return generate(expr, reduce)._source;
+}
+
+uint64_t FusedKernel::hash(const Expr &expr, FusedReduce reduce) {
+  const std::string text = source(expr, reduce);
+  return hashBytes(text.data(), text.size());
+}
+
+FusionCacheStats FusedKernel::cacheStats() {
+  SpirvCache &cache = spirvCache();
+  std::lock_guard<std::mutex> lock(cache._mutex);
+  return cache._stats;
+}
+
+VkDeviceSize FusedKernel::bufferSize(uint64_t count) {
+  // bound even when empty
+  return std::max<uint64_t>(1, (count + 3) / 4) * 4 * sizeof(float);
+}
+
+Result<FusedKernel> FusedKernel::create(Engine &engine, const Expr &expr,
+                                        FusedReduce reduce) {
+  const Generated generated = generate(expr, reduce);
+  if (!generated._valid) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  const uint64_t hash =
+      hashBytes(generated._source.data(), generated._source.size());
+  auto spirv = spirvFor(engine, hash, generated._source);
+  if (!spirv.isValid()) {
+    return {spirv.getError()};
+  }
+
+  const bool reduces = reduce != FusedReduce::NONE;
+  KernelSignature signature{{}, sizeof(FusedPushConstants)};
+  signature._bindings.assign(generated._inputs, STORAGE_READ);
+  signature._bindings.push_back(reduces ? STORAGE_WRITE : STORAGE_READ_WRITE);
+  auto kernel = engine.createKernel("fused_" + hashString(hash) + ".spv",
+                                    spirv.getValue(), signature);
+  if (!kernel.isValid()) {
+    return {kernel.getError()};
+  }
+
+  FusedKernel fused;
+  fused.m_engine = &engine;
+  fused.m_reduce = reduce;
+  fused.m_hash = hash;
+  fused.m_inputs = generated._inputs;
+  fused.m_ops = generated._ops;
+  fused.m_maxGroupsX = engine.maxGroupsX();
+  fused.m_kernel = kernel.getValue();
+  if (!reduces) {
+    return {fused};
+  }
+
+  const ReduceOp op = reduce == FusedReduce::SUM   ? ReduceOp::SUM
+                      : reduce == FusedReduce::MIN ? ReduceOp::MIN
+                                                   : ReduceOp::MAX;
+  auto reduction = Reduction::create(engine, op);
+  if (!reduction.isValid()) {
+    return {reduction.getError()};
+  }
+  fused.m_reduction = reduction.getValue();
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  auto partials =
+      engine.createBuffer(kReduceGroups * sizeof(float), usage, MEM_GPU_ONLY);
+  // sized for the most partials, fewer need no more
+  auto scratch = engine.createBuffer(
+      std::max<VkDeviceSize>(Reduction::scratchSize(kReduceGroups), 16),
+      usage, MEM_GPU_ONLY);
+  if (partials.isValid()) {
+    fused.m_partials = partials.getValue();
+  }
+  if (scratch.isValid()) {
+    fused.m_scratch = scratch.getValue();
+  }
+  if (!partials.isValid() || !scratch.isValid()) {
+    fused.destroy();
+    return {VK_ERROR_OUT_OF_DEVICE_MEMORY};
+  }
+  return {fused};
+}
+
+void FusedKernel::destroy() {
+  if (m_engine == nullptr) {
+    return;
+  }
+  destroyIfSet(*m_engine, m_partials);
+  destroyIfSet(*m_engine, m_scratch);
+}
+
+uint64_t FusedKernel::bytes(uint32_t count) const {
+  const uint64_t written = m_reduce == FusedReduce::NONE ? 1 : 0;
+  return (m_inputs + written) * uint64_t(count) * sizeof(float);
+}
+
+VkResult FusedKernel::record(CommandStream &stream,
+                             const std::vector<Buffer> &inputs,
+                             const Buffer &out, uint32_t count,
+                             const std::vector<float> &params) const {
+  const VkDeviceSize size = bufferSize(count);
+  const bool reduces = m_reduce != FusedReduce::NONE;
+  if (m_engine == nullptr || inputs.size() < m_inputs ||
+      params.size() > Expr::kMaxParams ||
+      out._size < (reduces ? sizeof(ReducePair) : size)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  for (uint32_t i = 0; i < m_inputs; i++) {
+    if (inputs[i]._size < size) {
+      return VK_ERROR_INITIALIZATION_FAILED;
+    }
+  }
+
+  const uint32_t vectors = static_cast<uint32_t>(size / (4 * sizeof(float)));
+  FusedPushConstants pc{count, vectors, {}};
+  std::copy(params.begin(), params.end(), pc.params);
+  std::vector<Buffer> buffers(inputs.begin(), inputs.begin() + m_inputs);
+  const Cost cost{bytes(count), uint64_t(m_ops) * count};
+  if (!reduces) {
+    buffers.push_back(out);
+    stream.dispatch(m_kernel, buffers, pc,
+                    spread(groupCount(vectors, kItems), kThreads,
+                           m_maxGroupsX),
+                    cost);
+    return stream.getState();
+  }
+
+  // every group folds a grid stride slice into one partial
+  const uint32_t groups =
+      std::min(std::max(1u, groupCount(vectors, kThreads)), kReduceGroups);
+  buffers.push_back(m_partials);
+  stream.dispatch(m_kernel, buffers, pc, WorkGroups{groups}, cost);
+  const VkResult r =
+      m_reduction.record(stream, m_partials, out, m_scratch, groups);
+  return r != VK_SUCCESS ? r : stream.getState();
+}
+
+} // namespace melkior::tensor_ops
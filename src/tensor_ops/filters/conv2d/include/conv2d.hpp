@@ -0,0 +1,146 @@
+#ifndef MELKIOR_CONV2D_HPP
+#define MELKIOR_CONV2D_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+enum class TensorLayout : uint8_t { NCHW, NHWC };
+
+enum class Activation : uint8_t { NONE, RELU, CLAMP };
+
+// Where conv2d.comp reads the weights from. AUTO picks the first of push
+// constants (up to 32 floats), a uniform buffer (up to 16 KiB) and a
+// storage buffer that holds the weights plus bias.
+enum class WeightStorage : uint8_t { AUTO, PUSH_CONSTANTS, UNIFORM, STORAGE };
+
+// Shape of one convolution layer. Input and output use the same layout,
+// padding is zeros on both sides. Channels and filters are split into
+// _groups independent groups; _groups == _channels == _filters filters every
+// channel with its own kernel, which is what image filters do.
+struct Conv2dShape {
+  uint32_t _batch = 1;
+  uint32_t _channels = 1;
+  uint32_t _height = 0;
+  uint32_t _width = 0;
+  uint32_t _filters = 1;
+  uint32_t _kernelH = 3;
+  uint32_t _kernelW = 3;
+  uint32_t _strideY = 1;
+  uint32_t _strideX = 1;
+  uint32_t _padY = 0;
+  uint32_t _padX = 0;
+  uint32_t _dilationY = 1;
+  uint32_t _dilationX = 1;
+  uint32_t _groups = 1;
+  TensorLayout _layout = TensorLayout::NCHW;
+
+  uint32_t outHeight() const {
+    return (_height + 2 * _padY - _dilationY * (_kernelH - 1) - 1) /
+               _strideY +
+           1;
+  }
+  uint32_t outWidth() const {
+    return (_width + 2 * _padX - _dilationX * (_kernelW - 1) - 1) / _strideX +
+           1;
+  }
+  uint64_t inputCount() const {
+    return uint64_t(_batch) * _channels * _height * _width;
+  }
+  uint64_t outputCount() const {
+    return uint64_t(_batch) * _filters * outHeight() * outWidth();
+  }
+  // OIHW, filters x (channels / groups) x kernelH x kernelW
+  uint64_t weightCount() const {
+    return uint64_t(_filters) * (_channels / _groups) * _kernelH * _kernelW;
+  }
+  double flops() const {
+    return 2.0 * outputCount() * (_channels / _groups) * _kernelH * _kernelW;
+  }
+
+  // odd kernel, stride 1 and padding that keeps the image size, e.g. a
+  // depthwise image filter when filters == groups == channels
+  static Conv2dShape same(uint32_t channels, uint32_t height, uint32_t width,
+                          uint32_t filters, uint32_t kernel,
+                          uint32_t groups = 1) {
+    Conv2dShape shape;
+    shape._channels = channels;
+    shape._height = height;
+    shape._width = width;
+    shape._filters = filters;
+    shape._kernelH = kernel;
+    shape._kernelW = kernel;
+    shape._padY = kernel / 2;
+    shape._padX = kernel / 2;
+    shape._groups = groups;
+    return shape;
+  }
+};
+
+// Applied to every output value after the bias.
+struct Conv2dEpilogue {
+  Activation _activation = Activation::NONE;
+  float _lo = 0.0f;
+  float _hi = 6.0f;
+};
+
+// Direct 2D convolution of fp32 tensors with fused bias and activation,
+// covering conv layers as well as image filters of any kernel size.
+//
+// One pipeline is built per layer: the shape, the epilogue and the tile are
+// specialization constants. Work groups stage an input patch with its halo
+// in shared memory and every thread accumulates several output channels, so
+// each staged value is reused KH * KW * channels-per-thread times. Small
+// weight sets are read from push constants or a uniform buffer, see
+// WeightStorage. The weights live in a buffer owned by the Conv2d and
+// freed by destroy().
+//
+//   Conv2dShape shape = Conv2dShape::same(32, 56, 56, 64, 3);
+//   auto conv = Conv2d::create(engine, shape, weights, bias,
+//                              {Activation::RELU}).getValue();
+//   conv.record(stream, input, output);
+//   stream.submit();
+class Conv2d {
+public:
+  // weights holds shape.weightCount() values, bias is empty or one value
+  // per filter
+  static engine::Result<Conv2d>
+  create(engine::Engine &engine, const Conv2dShape &shape,
+         const std::vector<float> &weights, const std::vector<float> &bias = {},
+         const Conv2dEpilogue &epilogue = {},
+         WeightStorage storage = WeightStorage::AUTO);
+
+  // input holds shape.inputCount() floats, output shape.outputCount()
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &input,
+                  const engine::Buffer &output) const;
+
+  void destroy();
+
+  const Conv2dShape &shape() const { return m_shape; }
+  WeightStorage weightStorage() const { return m_storage; }
+  // output pixels per work group
+  uint32_t tileWidth() const { return m_tileX; }
+  uint32_t tileHeight() const { return m_tileY; }
+
+private:
+  engine::Engine *m_engine = nullptr;
+  engine::Kernel m_kernel;
+  Conv2dShape m_shape;
+  WeightStorage m_storage = WeightStorage::STORAGE;
+  engine::Buffer m_weights;
+  // the push constant block of conv2d.comp built with PUSH_WEIGHTS
+  std::array<float, 32> m_pushWeights{};
+  engine::WorkGroups m_groups;
+  uint32_t m_tileX = 16;
+  uint32_t m_tileY = 16;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
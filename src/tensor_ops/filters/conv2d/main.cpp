@@ -0,0 +1,212 @@
+#include "conv2d.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+namespace {
+
+struct Case {
+  const char *_name;
+  Conv2dShape _shape;
+  bool _bias;
+  Conv2dEpilogue _epilogue;
+  WeightStorage _storage;
+};
+
+// direct convolution in double
+std::vector<float> reference(const Conv2dShape &s,
+                             const std::vector<float> &input,
+                             const std::vector<float> &weights,
+                             const std::vector<float> &bias,
+                             const Conv2dEpilogue &epilogue) {
+  const bool nhwc = s._layout == TensorLayout::NHWC;
+  const uint32_t outH = s.outHeight();
+  const uint32_t outW = s.outWidth();
+  const uint32_t channelsG = s._channels / s._groups;
+  const uint32_t filtersG = s._filters / s._groups;
+  auto in = [&](uint32_t n, uint32_t c, uint32_t y, uint32_t x) {
+    return nhwc ? input[((size_t(n) * s._height + y) * s._width + x) *
+                            s._channels +
+                        c]
+                : input[((size_t(n) * s._channels + c) * s._height + y) *
+                            s._width +
+                        x];
+  };
+  std::vector<float> out(s.outputCount());
+  for (uint32_t n = 0; n < s._batch; n++) {
+    for (uint32_t f = 0; f < s._filters; f++) {
+      const uint32_t g = f / filtersG;
+      for (uint32_t oy = 0; oy < outH; oy++) {
+        for (uint32_t ox = 0; ox < outW; ox++) {
+          double sum = bias.empty() ? 0.0 : bias[f];
+          for (uint32_t ci = 0; ci < channelsG; ci++) {
+            for (uint32_t ky = 0; ky < s._kernelH; ky++) {
+              for (uint32_t kx = 0; kx < s._kernelW; kx++) {
+                int y = int(oy * s._strideY + ky * s._dilationY) -
+                        int(s._padY);
+                int x = int(ox * s._strideX + kx * s._dilationX) -
+                        int(s._padX);
+                if (y < 0 || y >= int(s._height) || x < 0 ||
+                    x >= int(s._width)) {
+                  continue;
+                }
+                size_t w = ((size_t(f) * channelsG + ci) * s._kernelH + ky) *
+                               s._kernelW +
+                           kx;
+                sum += double(weights[w]) *
+                       in(n, g * channelsG + ci, uint32_t(y), uint32_t(x));
+              }
+            }
+          }
+          float v = float(sum);
+          if (epilogue._activation == Activation::RELU) {
+            v = std::max(v, 0.0f);
+          } else if (epilogue._activation == Activation::CLAMP) {
+            v = std::clamp(v, epilogue._lo, epilogue._hi);
+          }
+          size_t index =
+              nhwc ? ((size_t(n) * outH + oy) * outW + ox) * s._filters + f
+                   : ((size_t(n) * s._filters + f) * outH + oy) * outW + ox;
+          out[index] = v;
+        }
+      }
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+int main() {
+  // --- Parameters: conv layers and image filters through every weight path
+  std::vector<Case> cases;
+  {
+    Conv2dShape s = Conv2dShape::same(8, 37, 29, 16, 3);
+    s._batch = 2;
+    cases.push_back({"3x3 NCHW bias+relu", s, true, {Activation::RELU},
+                     WeightStorage::AUTO});
+  }
+  {
+    Conv2dShape s = Conv2dShape::same(3, 48, 64, 3, 3, 3);
+    s._layout = TensorLayout::NHWC;
+    cases.push_back({"3x3 depthwise NHWC", s, false, {}, WeightStorage::AUTO});
+  }
+  {
+    Conv2dShape s = Conv2dShape::same(3, 48, 64, 3, 9, 3);
+    s._layout = TensorLayout::NHWC;
+    cases.push_back({"9x9 depthwise NHWC", s, true, {}, WeightStorage::AUTO});
+  }
+  {
+    Conv2dShape s;
+    s._channels = 4;
+    s._height = 41;
+    s._width = 53;
+    s._filters = 6;
+    s._kernelH = 5;
+    s._kernelW = 7;
+    s._strideY = 2;
+    s._strideX = 3;
+    s._padY = 2;
+    s._padX = 3;
+    s._dilationY = 2;
+    s._dilationX = 1;
+    s._groups = 2;
+    cases.push_back({"5x7 strided dilated grouped", s, true,
+                     {Activation::CLAMP, -0.5f, 0.5f},
+                     WeightStorage::STORAGE});
+  }
+  {
+    Conv2dShape s = Conv2dShape::same(64, 20, 20, 64, 3);
+    s._layout = TensorLayout::NHWC;
+    cases.push_back({"3x3 NHWC 64->64", s, true, {Activation::RELU},
+                     WeightStorage::AUTO});
+  }
+
+  Engine engine("vk_conv2d");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const char *storageNames[] = {"auto", "push constants", "uniform",
+                                "storage"};
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  CommandStream stream(engine);
+  bool ok = true;
+
+  for (const Case &c : cases) {
+    const Conv2dShape &s = c._shape;
+    std::vector<float> input(s.inputCount());
+    std::vector<float> weights(s.weightCount());
+    std::vector<float> bias(c._bias ? s._filters : 0);
+    for (auto *v : {&input, &weights, &bias}) {
+      for (float &x : *v) {
+        x = dist(rng);
+      }
+    }
+
+    auto convResult =
+        Conv2d::create(engine, s, weights, bias, c._epilogue, c._storage);
+    if (!convResult.isValid()) {
+      std::cerr << "Conv2d::create failed for " << c._name << ": "
+                << convResult.getError() << "\n";
+      return 1;
+    }
+    Conv2d conv = convResult.getValue();
+
+    Buffer in = engine.createBuffer(input.size() * sizeof(float), usage,
+                                    MEM_GPU_ONLY)
+                    .getValue();
+    Buffer out = engine.createBuffer(s.outputCount() * sizeof(float), usage,
+                                     MEM_GPU_ONLY)
+                     .getValue();
+    std::vector<float> result(s.outputCount());
+    stream.upload(in, input.data(), input.size() * sizeof(float));
+    VkResult r = conv.record(stream, in, out);
+    stream.readback(out, result.data(), result.size() * sizeof(float));
+    if (r == VK_SUCCESS) {
+      r = stream.submit();
+    }
+    if (r != VK_SUCCESS) {
+      std::cerr << "conv2d failed: " << r << "\n";
+      return 1;
+    }
+
+    auto expected = reference(s, input, weights, bias, c._epilogue);
+    double maxError = 0.0;
+    for (size_t i = 0; i < expected.size(); i++) {
+      maxError =
+          std::max<double>(maxError, std::abs(result[i] - expected[i]));
+    }
+    bool match = maxError < 1e-3;
+    std::cout << "  " << c._name << " (" << s.outHeight() << "x"
+              << s.outWidth() << ", "
+              << storageNames[int(conv.weightStorage())] << " weights, "
+              << conv.tileWidth() << "x" << conv.tileHeight()
+              << " tile): max error " << maxError
+              << (match ? " OK" : " FAILED") << "\n";
+    ok &= match;
+
+    engine.destroyBuffer(in);
+    engine.destroyBuffer(out);
+    conv.destroy();
+  }
+
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "OK: convolutions match.\n";
+  return 0;
+}
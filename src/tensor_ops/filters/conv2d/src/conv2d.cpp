@@ -0,0 +1,232 @@
+#include "../include/conv2d.hpp"
+
+#include <algorithm>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// floats in the push constant block and the uniform block of conv2d.comp
+constexpr uint32_t kPushFloats = 32;
+constexpr uint32_t kUniformFloats = 4096;
+// output channels one thread accumulates at most
+constexpr uint32_t kMaxFiltersPerThread = 8;
+
+uint64_t patchBytes(const Conv2dShape &shape, uint32_t tileX,
+                    uint32_t tileY) {
+  const uint64_t h =
+      uint64_t(tileY - 1) * shape._strideY +
+      uint64_t(shape._kernelH - 1) * shape._dilationY + 1;
+  const uint64_t w =
+      uint64_t(tileX - 1) * shape._strideX +
+      uint64_t(shape._kernelW - 1) * shape._dilationX + 1;
+  return h * w * sizeof(float);
+}
+
+bool validShape(const Conv2dShape &s) {
+  if (s._batch == 0 || s._channels == 0 || s._height == 0 || s._width == 0 ||
+      s._filters == 0 || s._kernelH == 0 || s._kernelW == 0 ||
+      s._strideY == 0 || s._strideX == 0 || s._dilationY == 0 ||
+      s._dilationX == 0 || s._groups == 0 || s._channels % s._groups != 0 ||
+      s._filters % s._groups != 0) {
+    return false;
+  }
+  // the dilated kernel has to fit the padded input at least once
+  const uint64_t extentY = uint64_t(s._dilationY) * (s._kernelH - 1) + 1;
+  const uint64_t extentX = uint64_t(s._dilationX) * (s._kernelW - 1) + 1;
+  if (extentY > uint64_t(s._height) + 2 * s._padY ||
+      extentX > uint64_t(s._width) + 2 * s._padX) {
+    return false;
+  }
+  // shader indices are 32 bit
+  return s.inputCount() <= UINT32_MAX && s.outputCount() <= UINT32_MAX &&
+         s.weightCount() + s._filters <= UINT32_MAX;
+}
+
+} // namespace
+
+Result<Conv2d> Conv2d::create(Engine &engine, const Conv2dShape &shape,
+                              const std::vector<float> &weights,
+                              const std::vector<float> &bias,
+                              const Conv2dEpilogue &epilogue,
+                              WeightStorage storage) {
+  if (!validShape(shape) || weights.size() != shape.weightCount() ||
+      (!bias.empty() && bias.size() != shape._filters)) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+  const auto &limits = props.limits;
+
+  // weights and bias back to back, the layout every variant reads
+  std::vector<float> data(weights);
+  data.insert(data.end(), bias.begin(), bias.end());
+  const uint64_t total = data.size();
+  const uint64_t pushFloats =
+      std::min<uint64_t>(kPushFloats, limits.maxPushConstantsSize / 4);
+  const uint64_t uniformFloats =
+      std::min<uint64_t>(kUniformFloats, limits.maxUniformBufferRange / 4);
+  if (storage == WeightStorage::AUTO) {
+    storage = total <= pushFloats      ? WeightStorage::PUSH_CONSTANTS
+              : total <= uniformFloats ? WeightStorage::UNIFORM
+                                       : WeightStorage::STORAGE;
+  }
+  if ((storage == WeightStorage::PUSH_CONSTANTS && total > pushFloats) ||
+      (storage == WeightStorage::UNIFORM && total > uniformFloats)) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  // 16 x 16 outputs, narrower for small outputs, halved until the group
+  // and its input patch fit the device
+  const uint32_t outH = shape.outHeight();
+  const uint32_t outW = shape.outWidth();
+  uint32_t tileX = outW >= 16 ? 16 : 8;
+  uint32_t tileY = outH >= 16 ? 16 : 8;
+  while ((tileX * tileY > limits.maxComputeWorkGroupInvocations ||
+          patchBytes(shape, tileX, tileY) >
+              limits.maxComputeSharedMemorySize) &&
+         tileX * tileY > 1) {
+    if (tileX >= tileY) {
+      tileX /= 2;
+    } else {
+      tileY /= 2;
+    }
+  }
+  if (patchBytes(shape, tileX, tileY) > limits.maxComputeSharedMemorySize) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  const uint32_t filtersPerGroup = shape._filters / shape._groups;
+  const uint32_t filtersPerThread =
+      std::min(kMaxFiltersPerThread, filtersPerGroup);
+  const uint64_t groupsZ = uint64_t(shape._batch) * shape._groups *
+                           groupCount(filtersPerGroup, filtersPerThread);
+  const WorkGroups groups{groupCount(outW, tileX), groupCount(outH, tileY),
+                          static_cast<uint32_t>(groupsZ)};
+  if (groups._x > limits.maxComputeWorkGroupCount[0] ||
+      groups._y > limits.maxComputeWorkGroupCount[1] ||
+      groupsZ > limits.maxComputeWorkGroupCount[2]) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  Specialization spec;
+  spec.set(0, tileX)
+      .set(1, tileY)
+      .set(2, shape._kernelH)
+      .set(3, shape._kernelW)
+      .set(4, shape._strideY)
+      .set(5, shape._strideX)
+      .set(6, shape._dilationY)
+      .set(7, shape._dilationX)
+      .set(8, shape._padY)
+      .set(9, shape._padX)
+      .set(10, shape._channels)
+      .set(11, shape._height)
+      .set(12, shape._width)
+      .set(13, shape._filters)
+      .set(14, outH)
+      .set(15, outW)
+      .set(16, shape._groups)
+      .set(17, filtersPerThread)
+      .set(18, uint32_t(shape._layout == TensorLayout::NHWC))
+      .set(19, uint32_t(!bias.empty()))
+      .set(20, static_cast<uint32_t>(epilogue._activation))
+      .set(21, epilogue._lo)
+      .set(22, epilogue._hi);
+
+  Result<Kernel> kernel{VK_ERROR_INITIALIZATION_FAILED};
+  switch (storage) {
+  case WeightStorage::PUSH_CONSTANTS:
+    kernel = engine.createKernel(
+        "conv2d_push.spv",
+        {{STORAGE_READ, STORAGE_WRITE}, kPushFloats * sizeof(float)}, spec);
+    break;
+  case WeightStorage::UNIFORM:
+    kernel = engine.createKernel(
+        "conv2d_uniform.spv",
+        {{STORAGE_READ,
+          {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Access::READ},
+          STORAGE_WRITE}},
+        spec);
+    break;
+  default:
+    kernel = engine.createKernel(
+        "conv2d.spv", {{STORAGE_READ, STORAGE_READ, STORAGE_WRITE}}, spec);
+    break;
+  }
+  if (!kernel.isValid()) {
+    return {kernel.getError()};
+  }
+
+  Conv2d conv;
+  conv.m_engine = &engine;
+  conv.m_kernel = kernel.getValue();
+  conv.m_shape = shape;
+  conv.m_storage = storage;
+  conv.m_groups = groups;
+  conv.m_tileX = tileX;
+  conv.m_tileY = tileY;
+
+  if (storage == WeightStorage::PUSH_CONSTANTS) {
+    std::copy(data.begin(), data.end(), conv.m_pushWeights.begin());
+    return {conv};
+  }
+
+  // the uniform block is declared at its full 16 KiB
+  const VkDeviceSize bytes = storage == WeightStorage::UNIFORM
+                                 ? kUniformFloats * sizeof(float)
+                                 : total * sizeof(float);
+  const VkBufferUsageFlags usage =
+      (storage == WeightStorage::UNIFORM ? VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+                                         : VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) |
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  auto buffer = engine.createBuffer(bytes, usage, MEM_GPU_ONLY);
+  if (!buffer.isValid()) {
+    return {buffer.getError()};
+  }
+  CommandStream stream(engine);
+  if (bytes > total * sizeof(float)) {
+    stream.fill(buffer.getValue(), 0);
+  }
+  stream.upload(buffer.getValue(), data.data(), total * sizeof(float));
+  VkResult result = stream.submit();
+  if (result != VK_SUCCESS) {
+    engine.destroyBuffer(buffer.getValue());
+    return {result};
+  }
+  conv.m_weights = buffer.getValue();
+  return {conv};
+}
+
+void Conv2d::destroy() {
+  if (m_engine == nullptr || m_weights._buffer == VK_NULL_HANDLE) {
+    return;
+  }
+  m_engine->destroyBuffer(m_weights);
+  m_weights = {};
+}
+
+VkResult Conv2d::record(CommandStream &stream, const Buffer &input,
+                        const Buffer &output) const {
+  if (m_engine == nullptr ||
+      input._size < m_shape.inputCount() * sizeof(float) ||
+      output._size < m_shape.outputCount() * sizeof(float)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  const Cost cost{(m_shape.inputCount() + m_shape.outputCount() +
+                   m_shape.weightCount()) *
+                      sizeof(float),
+                  static_cast<uint64_t>(m_shape.flops())};
+  if (m_storage == WeightStorage::PUSH_CONSTANTS) {
+    stream.dispatch(m_kernel, {input, output}, m_pushWeights, m_groups, cost);
+  } else {
+    stream.dispatch(m_kernel, {input, m_weights, output}, m_groups, cost);
+  }
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
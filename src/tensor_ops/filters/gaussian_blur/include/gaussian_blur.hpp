@@ -0,0 +1,70 @@
+#ifndef MELKIOR_GAUSSIAN_BLUR_HPP
+#define MELKIOR_GAUSSIAN_BLUR_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+// kernels up to (2 * GAUSSIAN_MAX_RADIUS + 1)^2, i.e. 33x33
+constexpr uint32_t GAUSSIAN_MAX_RADIUS = 16;
+
+// Separable Gaussian blur of interleaved RGB8 images (cv::Mat CV_8UC3),
+// borders reflected like cv::BORDER_REFLECT_101.
+//
+// A horizontal pass reads the RGB8 rows as 32-bit words and writes each
+// pixel as fp16 RGB to a scratch buffer, a vertical pass reads that back and
+// writes RGB8 rows again, so results are rounded to 8 bits only once. Both passes stage their tile plus a halo
+// of radius pixels in shared memory. Strides are in bytes and must be
+// multiples of 4, which holds for any width that is a multiple of 4.
+//
+//   auto blur = GaussianBlur::create(engine).getValue();
+//   blur.setKernel(7); // 15x15, sigma as cv::GaussianBlur picks it
+//   blur.record(stream, src, dst, scratch, width, height);
+//   stream.submit();
+class GaussianBlur {
+public:
+  // tile is the number of pixels per work group of the horizontal pass
+  static engine::Result<GaussianBlur> create(engine::Engine &engine,
+                                             uint32_t tile = 256);
+
+  // sigma <= 0 derives it from the kernel size the way OpenCV does
+  VkResult setKernel(uint32_t radius, float sigma = 0.0f);
+  uint32_t radius() const { return m_params._radius; }
+
+  // bytes of the intermediate buffer record() needs
+  static VkDeviceSize scratchSize(uint32_t width, uint32_t height) {
+    // four fp16 values per pixel
+    return VkDeviceSize(width) * height * 4 * sizeof(uint16_t);
+  }
+
+  // records both passes, stride 0 means tightly packed rows
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &src,
+                  const engine::Buffer &dst, const engine::Buffer &scratch,
+                  uint32_t width, uint32_t height, uint32_t srcStride = 0,
+                  uint32_t dstStride = 0) const;
+
+private:
+  // matches the push constant block of blur_h.comp / blur_v.comp
+  struct Params {
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+    uint32_t _srcStride = 0;
+    uint32_t _dstStride = 0;
+    uint32_t _radius = 0;
+    std::array<float, GAUSSIAN_MAX_RADIUS + 1> _weights{};
+  };
+
+  engine::Kernel m_horizontal;
+  engine::Kernel m_vertical;
+  uint32_t m_tile = 256;
+  Params m_params;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
@@ -0,0 +1,97 @@
+#include "gaussian_blur.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters for the blur
+  const uint32_t width = 64;
+  const uint32_t height = 48;
+  const uint32_t radius = 3;
+  const VkDeviceSize bytes = VkDeviceSize(width) * height * 3;
+
+  Engine engine("vk_gaussian_blur");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  auto blurResult = GaussianBlur::create(engine);
+  if (!blurResult.isValid()) {
+    std::cerr << "GaussianBlur::create failed: " << blurResult.getError()
+              << "\n";
+    return 1;
+  }
+  GaussianBlur blur = blurResult.getValue();
+  blur.setKernel(radius);
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  Buffer src = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer dst = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer scratch = engine
+                       .createBuffer(GaussianBlur::scratchSize(width, height),
+                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                     MEM_GPU_ONLY)
+                       .getValue();
+
+  // A single white pixel on black: the blurred image is the kernel itself,
+  // centred on the pixel, with the same response in every channel.
+  std::vector<uint8_t> image(bytes, 0);
+  const uint32_t cx = width / 2;
+  const uint32_t cy = height / 2;
+  for (uint32_t c = 0; c < 3; c++) {
+    image[(cy * width + cx) * 3 + c] = 255;
+  }
+
+  CommandStream stream(engine);
+  stream.upload(src, image.data(), bytes);
+  auto result = blur.record(stream, src, dst, scratch, width, height);
+  stream.readback(dst, image.data(), bytes);
+  if (result == VK_SUCCESS) {
+    result = stream.submit();
+  }
+  if (result != VK_SUCCESS) {
+    std::cerr << "blur failed: " << result << "\n";
+    return 1;
+  }
+
+  std::cout << "Row through the centre, red channel:\n ";
+  for (uint32_t x = cx - radius - 1; x <= cx + radius + 1; x++) {
+    std::cout << " " << int(image[(cy * width + x) * 3]);
+  }
+  std::cout << "\n";
+
+  // Simple check: symmetric, equal channels, nothing outside the radius
+  bool ok = true;
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      const uint8_t *px = &image[(y * width + x) * 3];
+      const uint8_t *mirror = &image[((2 * cy - y) % height * width +
+                                      (2 * cx - x) % width) *
+                                     3];
+      bool inside = std::abs(int(x) - int(cx)) <= int(radius) &&
+                    std::abs(int(y) - int(cy)) <= int(radius);
+      ok &= px[0] == px[1] && px[1] == px[2];
+      ok &= inside ? px[0] == mirror[0] : px[0] == 0;
+    }
+  }
+  ok &= image[(cy * width + cx) * 3] > 0;
+
+  engine.destroyBuffer(src);
+  engine.destroyBuffer(dst);
+  engine.destroyBuffer(scratch);
+  if (!ok) {
+    std::cerr << "Mismatch in the blurred impulse\n";
+    return 1;
+  }
+  std::cout << "OK: impulse blurred.\n";
+  return 0;
+}
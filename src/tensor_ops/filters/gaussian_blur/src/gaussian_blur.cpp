@@ -0,0 +1,106 @@
+#include "../include/gaussian_blur.hpp"
+
+#include <cmath>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// blur_v.comp: 8 x 16 threads, four pixels per thread along x
+constexpr uint32_t VERTICAL_COLUMNS = 32;
+constexpr uint32_t VERTICAL_ROWS = 16;
+
+} // namespace
+
+Result<GaussianBlur> GaussianBlur::create(Engine &engine, uint32_t tile) {
+  // the horizontal halo must fit in the neighbouring tile
+  if (tile < GAUSSIAN_MAX_RADIUS || tile > 256) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  const KernelSignature signature{{STORAGE_READ, STORAGE_WRITE},
+                                  sizeof(Params)};
+  Specialization spec;
+  spec.set(0, tile);
+
+  auto horizontal = engine.createKernel("gaussian_blur_h.spv", signature, spec);
+  if (!horizontal.isValid()) {
+    return {horizontal.getError()};
+  }
+  // the vertical pass merges into the last word of a row
+  auto vertical = engine.createKernel(
+      "gaussian_blur_v.spv",
+      {{STORAGE_READ, STORAGE_READ_WRITE}, sizeof(Params)});
+  if (!vertical.isValid()) {
+    return {vertical.getError()};
+  }
+
+  GaussianBlur blur;
+  blur.m_horizontal = horizontal.getValue();
+  blur.m_vertical = vertical.getValue();
+  blur.m_tile = tile;
+  blur.setKernel(7);
+  return {blur};
+}
+
+VkResult GaussianBlur::setKernel(uint32_t radius, float sigma) {
+  if (radius > GAUSSIAN_MAX_RADIUS) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  if (sigma <= 0.0f) {
+    // cv::getGaussianKernel
+    sigma = 0.3f * (float(radius) - 1.0f) + 0.8f;
+  }
+
+  m_params._weights.fill(0.0f);
+  double sum = 0.0;
+  for (uint32_t k = 0; k <= radius; k++) {
+    double w = std::exp(-double(k * k) / (2.0 * sigma * sigma));
+    m_params._weights[k] = float(w);
+    sum += k == 0 ? w : 2.0 * w;
+  }
+  for (uint32_t k = 0; k <= radius; k++) {
+    m_params._weights[k] = float(m_params._weights[k] / sum);
+  }
+  m_params._radius = radius;
+  return VK_SUCCESS;
+}
+
+VkResult GaussianBlur::record(CommandStream &stream, const Buffer &src,
+                              const Buffer &dst, const Buffer &scratch,
+                              uint32_t width, uint32_t height,
+                              uint32_t srcStride, uint32_t dstStride) const {
+  srcStride = srcStride ? srcStride : width * 3;
+  dstStride = dstStride ? dstStride : width * 3;
+  if (width == 0 || height == 0 || srcStride % 4 != 0 ||
+      dstStride % 4 != 0 || srcStride < width * 3 || dstStride < width * 3 ||
+      src._size < VkDeviceSize(srcStride) * height ||
+      dst._size < VkDeviceSize(dstStride) * height ||
+      scratch._size < scratchSize(width, height)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  const uint64_t pixels = uint64_t(width) * height;
+  const uint64_t taps = 2 * m_params._radius + 1;
+
+  Params params = m_params;
+  params._width = width;
+  params._height = height;
+  params._srcStride = srcStride;
+  params._dstStride = width;
+  stream.dispatch(m_horizontal, {src, scratch}, params,
+                  {groupCount(width, m_tile), height},
+                  {pixels * 3 + pixels * 8, pixels * 3 * taps * 2});
+
+  params._srcStride = width;
+  params._dstStride = dstStride;
+  stream.dispatch(m_vertical, {scratch, dst}, params,
+                  {groupCount(width, VERTICAL_COLUMNS),
+                   groupCount(height, VERTICAL_ROWS)},
+                  {pixels * 8 + pixels * 3, pixels * 3 * taps * 2});
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
@@ -0,0 +1,222 @@
+#ifndef MELKIOR_GRAPH_HPP
+#define MELKIOR_GRAPH_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+// Directed graph in engine buffers, as CSR adjacency both ways: out-edges
+// (_outOffsets, _vertices + 1 uints, and _outTargets) for push-style
+// kernels and in-edges (_inOffsets, _inSources) for pull-style ones. An
+// undirected graph stores every edge in both directions. upload() ones are
+// freed with destroy().
+struct Graph {
+  uint32_t _vertices = 0;
+  uint32_t _edges = 0;
+  engine::Buffer _outOffsets;
+  engine::Buffer _outTargets;
+  engine::Buffer _inOffsets;
+  engine::Buffer _inSources;
+
+  // edge i goes from sources[i] to targets[i]; both CSR directions are
+  // built on the host
+  static engine::Result<Graph> upload(engine::Engine &engine,
+                                      uint32_t vertices,
+                                      const std::vector<uint32_t> &sources,
+                                      const std::vector<uint32_t> &targets);
+  void destroy(engine::Engine &engine);
+};
+
+// Device-side loop state of a Bfs, matches bfs_common.glsl.
+struct BfsState {
+  uint32_t _pushArgs[4];
+  uint32_t _pullArgs[4];
+  uint32_t _frontier;
+  uint32_t _next;
+  uint32_t _frontierEdges;
+  uint32_t _nextEdges;
+  uint32_t _unvisitedEdges;
+  // deepest level reached
+  uint32_t _depth;
+  uint32_t _pull;
+  uint32_t _visited;
+
+  bool done() const { return _frontier == 0; }
+};
+
+// Breadth-first search levels from a source vertex, with direction
+// switching: top-down (push) levels expand the frontier queue over
+// out-edges, bottom-up (pull) levels let every unvisited vertex look for a
+// parent over its in-edges. The switch follows Beamer's heuristic and is
+// taken on the device at the end of every level, which also writes the
+// indirect arguments of the next one; a finished search leaves them empty.
+// record() can therefore put many levels into one command buffer with no
+// host roundtrip, levels past the end of the search costing three empty
+// dispatches each. The frontier queue and state buffer come from the
+// engine and are freed by destroy().
+//
+//   auto bfs = Bfs::create(engine, graph).getValue();
+//   bfs.record(stream, source, levels, 64);
+//   stream.submit();
+//   // or, for graphs of unknown depth, 32 levels per submission:
+//   BfsState state = bfs.run(stream, source, levels).getValue();
+class Bfs {
+public:
+  // alpha and beta as in Beamer et al.: push -> pull once the frontier's
+  // out-edges exceed the unvisited vertices' out-edges / alpha, pull ->
+  // push once the frontier falls below vertices / beta
+  static engine::Result<Bfs> create(engine::Engine &engine, const Graph &graph,
+                                    uint32_t alpha = 14, uint32_t beta = 24);
+
+  // levels holds a uint per vertex, UINT32_MAX for unreached ones. Records
+  // the start from source and up to maxLevels levels.
+  VkResult record(engine::CommandStream &stream, uint32_t source,
+                  const engine::Buffer &levels, uint32_t maxLevels) const;
+  // up to maxLevels more levels of the search recorded last
+  VkResult recordMore(engine::CommandStream &stream,
+                      const engine::Buffer &levels, uint32_t maxLevels) const;
+  // records and submits batches of batchLevels levels until the frontier
+  // is empty, reading only the state back in between
+  engine::Result<BfsState> run(engine::CommandStream &stream, uint32_t source,
+                               const engine::Buffer &levels,
+                               uint32_t batchLevels = 32) const;
+
+  void destroy();
+
+  // a BfsState, for readback
+  const engine::Buffer &state() const { return m_state; }
+
+private:
+  engine::Engine *m_engine = nullptr;
+  Graph m_graph;
+  uint32_t m_alpha = 14;
+  uint32_t m_beta = 24;
+  uint32_t m_maxGroupsX = 65535;
+  engine::Kernel m_start;
+  engine::Kernel m_push;
+  engine::Kernel m_pull;
+  engine::Kernel m_step;
+  engine::Buffer m_queue;
+  engine::Buffer m_state;
+};
+
+// Device-side loop state of ConnectedComponents, matches cc_common.glsl.
+struct CcState {
+  uint32_t _args[4];
+  uint32_t _changed;
+  uint32_t _iterations;
+
+  bool done() const { return _args[0] == 0; }
+};
+
+// Weakly connected components by label propagation: every vertex starts
+// with its own index, passes take the smallest label among the neighbours
+// (hooking the old label onto it) followed by a pointer jump, until a pass
+// changes nothing. Each component ends up labelled with its smallest
+// vertex. The end test is on the device like Bfs's, so record() puts many
+// passes into one command buffer; converged passes are empty dispatches.
+// The state buffer comes from the engine and is freed by destroy().
+//
+//   auto cc = ConnectedComponents::create(engine, graph).getValue();
+//   cc.record(stream, labels, 32);
+//   stream.submit();
+class ConnectedComponents {
+public:
+  static engine::Result<ConnectedComponents> create(engine::Engine &engine,
+                                                    const Graph &graph);
+
+  // labels holds a uint per vertex; starts over and records up to
+  // maxIterations passes
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &labels,
+                  uint32_t maxIterations) const;
+  // up to maxIterations more passes of the run recorded last
+  VkResult recordMore(engine::CommandStream &stream,
+                      const engine::Buffer &labels,
+                      uint32_t maxIterations) const;
+  // batches of batchIterations passes per submission until converged
+  engine::Result<CcState> run(engine::CommandStream &stream,
+                              const engine::Buffer &labels,
+                              uint32_t batchIterations = 16) const;
+
+  void destroy();
+
+  const engine::Buffer &state() const { return m_state; }
+
+private:
+  engine::Engine *m_engine = nullptr;
+  Graph m_graph;
+  uint32_t m_maxGroupsX = 65535;
+  engine::Kernel m_init;
+  engine::Kernel m_propagate;
+  engine::Kernel m_jump;
+  engine::Kernel m_check;
+  engine::Buffer m_state;
+};
+
+// Device-side loop state of PageRank, matches pr_common.glsl.
+struct PageRankState {
+  uint32_t _args[4];
+  uint32_t _iterations;
+  uint32_t _converged;
+  // rank held by vertices without out-edges, and the L1 change of the
+  // last iteration
+  float _dangling;
+  float _delta;
+};
+
+// PageRank by power iteration. Each iteration splits every rank over the
+// out-edges, sums the dangling vertices' ranks, gathers the new ranks over
+// the in-edges and sums their L1 change; once that falls below the
+// tolerance the device empties the iterations recorded after it. All
+// maxIterations iterations go into one command buffer, followed by a copy
+// of the last ranks into the output, so a whole run is one submission.
+// Ranks sum to 1. The rank, contribution, partial sum and state buffers
+// come from the engine and are freed by destroy().
+//
+//   auto pagerank = PageRank::create(engine, graph).getValue();
+//   pagerank.record(stream, ranks, 100);
+//   stream.submit();
+class PageRank {
+public:
+  static engine::Result<PageRank> create(engine::Engine &engine,
+                                         const Graph &graph,
+                                         float damping = 0.85f,
+                                         float tolerance = 1e-6f);
+
+  // ranks holds a float per vertex; starts from the uniform distribution
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &ranks,
+                  uint32_t maxIterations) const;
+
+  void destroy();
+
+  // a PageRankState, for readback
+  const engine::Buffer &state() const { return m_state; }
+  // per iteration, roughly: offsets, indices and values read once each
+  uint64_t bytesPerIteration() const;
+
+private:
+  engine::Engine *m_engine = nullptr;
+  Graph m_graph;
+  float m_damping = 0.85f;
+  float m_tolerance = 1e-6f;
+  uint32_t m_maxGroupsX = 65535;
+  uint32_t m_groups = 0;
+  engine::Kernel m_contrib;
+  engine::Kernel m_reduce;
+  engine::Kernel m_update;
+  engine::Kernel m_check;
+  engine::Kernel m_finish;
+  engine::Buffer m_ranks;
+  engine::Buffer m_contribs;
+  engine::Buffer m_partials;
+  engine::Buffer m_state;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
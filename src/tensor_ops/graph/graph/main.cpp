@@ -0,0 +1,213 @@
+#include "graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters: a skewed random graph, a long tail that makes the search
+  // deeper than one batch of levels, and a few small separate components
+  const uint32_t core = 40000;
+  const uint32_t tail = 100;
+  const uint32_t islands = 300;
+  const uint32_t vertices = core + tail + islands * 3;
+
+  Engine engine("vk_graph");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  std::mt19937 rng(22);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<uint32_t> sources;
+  std::vector<uint32_t> targets;
+  auto addEdge = [&](uint32_t from, uint32_t to) {
+    sources.push_back(from);
+    targets.push_back(to);
+  };
+  for (uint32_t v = 0; v < core; v++) {
+    // a few vertices with thousands of out-edges, some with none
+    const uint32_t degree = uint32_t(std::pow(unit(rng), 6.0) * 3000.0);
+    for (uint32_t i = 0; i < degree; i++) {
+      // targets skewed towards low indices as well
+      addEdge(v, uint32_t(std::pow(unit(rng), 2.0) * core));
+    }
+  }
+  for (uint32_t i = 0; i < tail; i++) {
+    addEdge(i == 0 ? 0 : core + i - 1, core + i);
+  }
+  for (uint32_t i = 0; i < islands; i++) {
+    const uint32_t first = core + tail + i * 3;
+    addEdge(first, first + 1);
+    addEdge(first + 2, first + 1);
+  }
+  const uint32_t edges = static_cast<uint32_t>(sources.size());
+
+  // host references: levels, smallest vertex per weak component, PageRank
+  std::vector<std::vector<uint32_t>> out(vertices);
+  std::vector<std::vector<uint32_t>> in(vertices);
+  for (uint32_t e = 0; e < edges; e++) {
+    out[sources[e]].push_back(targets[e]);
+    in[targets[e]].push_back(sources[e]);
+  }
+  std::vector<uint32_t> expectedLevels(vertices, UINT32_MAX);
+  {
+    std::queue<uint32_t> frontier;
+    expectedLevels[0] = 0;
+    frontier.push(0);
+    while (!frontier.empty()) {
+      const uint32_t u = frontier.front();
+      frontier.pop();
+      for (uint32_t v : out[u]) {
+        if (expectedLevels[v] == UINT32_MAX) {
+          expectedLevels[v] = expectedLevels[u] + 1;
+          frontier.push(v);
+        }
+      }
+    }
+  }
+  std::vector<uint32_t> expectedLabels(vertices, UINT32_MAX);
+  uint32_t components = 0;
+  for (uint32_t s = 0; s < vertices; s++) {
+    if (expectedLabels[s] != UINT32_MAX) {
+      continue;
+    }
+    components++;
+    std::vector<uint32_t> stack{s};
+    expectedLabels[s] = s;
+    while (!stack.empty()) {
+      const uint32_t u = stack.back();
+      stack.pop_back();
+      for (const auto *list : {&out[u], &in[u]}) {
+        for (uint32_t v : *list) {
+          if (expectedLabels[v] == UINT32_MAX) {
+            expectedLabels[v] = s;
+            stack.push_back(v);
+          }
+        }
+      }
+    }
+  }
+  const double damping = 0.85;
+  std::vector<double> expectedRanks(vertices, 1.0 / vertices);
+  for (int iteration = 0; iteration < 200; iteration++) {
+    double dangling = 0.0;
+    for (uint32_t v = 0; v < vertices; v++) {
+      dangling += out[v].empty() ? expectedRanks[v] : 0.0;
+    }
+    std::vector<double> next(vertices);
+    for (uint32_t v = 0; v < vertices; v++) {
+      double sum = 0.0;
+      for (uint32_t u : in[v]) {
+        sum += expectedRanks[u] / out[u].size();
+      }
+      next[v] = (1.0 - damping) / vertices +
+                damping * (sum + dangling / vertices);
+    }
+    expectedRanks.swap(next);
+  }
+
+  auto graphResult = Graph::upload(engine, vertices, sources, targets);
+  if (!graphResult.isValid()) {
+    std::cerr << "Graph::upload failed: " << graphResult.getError() << "\n";
+    return 1;
+  }
+  Graph graph = graphResult.getValue();
+  auto bfsResult = Bfs::create(engine, graph);
+  auto ccResult = ConnectedComponents::create(engine, graph);
+  auto pagerankResult = PageRank::create(engine, graph, float(damping), 1e-6f);
+  if (!bfsResult.isValid() || !ccResult.isValid() ||
+      !pagerankResult.isValid()) {
+    std::cerr << "graph kernel setup failed\n";
+    return 1;
+  }
+  Bfs bfs = bfsResult.getValue();
+  ConnectedComponents cc = ccResult.getValue();
+  PageRank pagerank = pagerankResult.getValue();
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  Buffer levelsBuf =
+      engine.createBuffer(vertices * 4ull, usage, MEM_GPU_ONLY).getValue();
+  Buffer labelsBuf =
+      engine.createBuffer(vertices * 4ull, usage, MEM_GPU_ONLY).getValue();
+  Buffer ranksBuf =
+      engine.createBuffer(vertices * 4ull, usage, MEM_GPU_ONLY).getValue();
+  CommandStream stream(engine);
+  bool ok = true;
+
+  // --- BFS, 32 levels per submission
+  auto bfsRun = bfs.run(stream, 0, levelsBuf);
+  if (!bfsRun.isValid()) {
+    std::cerr << "bfs failed: " << bfsRun.getError() << "\n";
+    return 1;
+  }
+  BfsState bfsState = bfsRun.getValue();
+  std::vector<uint32_t> levels(vertices);
+  stream.readback(levelsBuf, levels.data(), vertices * 4ull);
+  VkResult r = stream.submit();
+  bool match = r == VK_SUCCESS && levels == expectedLevels;
+  std::cout << "  bfs: depth " << bfsState._depth << ", " << bfsState._visited
+            << " of " << vertices << " vertices" << (match ? " OK" : " FAILED")
+            << "\n";
+  ok &= match;
+
+  // --- connected components, every pass in one submission
+  r = cc.record(stream, labelsBuf, 64);
+  CcState ccState{};
+  std::vector<uint32_t> labels(vertices);
+  stream.readback(cc.state(), &ccState, sizeof(ccState));
+  stream.readback(labelsBuf, labels.data(), vertices * 4ull);
+  if (r == VK_SUCCESS) {
+    r = stream.submit();
+  }
+  match = r == VK_SUCCESS && ccState.done() && labels == expectedLabels;
+  std::cout << "  components: " << components << " in "
+            << ccState._iterations << " passes" << (match ? " OK" : " FAILED")
+            << "\n";
+  ok &= match;
+
+  // --- PageRank, up to 100 iterations in one submission
+  r = pagerank.record(stream, ranksBuf, 100);
+  PageRankState prState{};
+  std::vector<float> ranks(vertices);
+  stream.readback(pagerank.state(), &prState, sizeof(prState));
+  stream.readback(ranksBuf, ranks.data(), vertices * 4ull);
+  if (r == VK_SUCCESS) {
+    r = stream.submit();
+  }
+  double error = 0.0;
+  for (uint32_t v = 0; v < vertices; v++) {
+    error += std::abs(ranks[v] - expectedRanks[v]);
+  }
+  const double total = std::accumulate(ranks.begin(), ranks.end(), 0.0);
+  match = r == VK_SUCCESS && prState._converged != 0 && error < 1e-4 &&
+          std::abs(total - 1.0) < 1e-3;
+  std::cout << "  pagerank: " << prState._iterations << " iterations, L1 "
+            << "error " << error << (match ? " OK" : " FAILED") << "\n";
+  ok &= match;
+
+  for (Buffer buffer : {levelsBuf, labelsBuf, ranksBuf}) {
+    engine.destroyBuffer(buffer);
+  }
+  bfs.destroy();
+  cc.destroy();
+  pagerank.destroy();
+  graph.destroy(engine);
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "OK: graph kernels match.\n";
+  return 0;
+}
@@ -0,0 +1,40 @@
+// Loop state and push constants of the BFS kernels. The state lives on the
+// device so levels can be recorded back to back without the host looking
+// at the frontier; it matches BfsState in graph.hpp.
+
+const uint UNVISITED = 0xFFFFFFFFu;
+
+layout(set = 0, binding = 0, std430) buffer StateBuf {
+    // VkDispatchIndirectCommand of the push and pull kernels, one of them
+    // empty, both empty once the frontier is
+    uvec4 pushArgs;
+    uvec4 pullArgs;
+    uint frontier;
+    uint next;
+    uint frontierEdges;
+    uint nextEdges;
+    uint unvisitedEdges;
+    uint depth;
+    uint pull;
+    uint visited;
+} state;
+
+layout(push_constant) uniform PC {
+    uint vertices;
+    uint edges;
+    uint source;
+    uint maxGroupsX;
+    // push -> pull once frontier edges > unvisited edges / alpha,
+    // pull -> push once the frontier < vertices / beta
+    uint alpha;
+    uint beta;
+} pc;
+
+uint groupIndex() {
+    return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+}
+
+// the frontier of depth d is in half d & 1 of the queue
+uint queueSlot(uint depth, uint i) {
+    return (depth & 1u) * pc.vertices + i;
+}
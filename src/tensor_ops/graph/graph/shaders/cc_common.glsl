@@ -0,0 +1,19 @@
+// Loop state and push constants of the connected components kernels;
+// matches CcState in graph.hpp.
+
+layout(set = 0, binding = 0, std430) buffer StateBuf {
+    // VkDispatchIndirectCommand of the propagate and jump kernels, emptied
+    // once a pass changes no label
+    uvec4 args;
+    uint changed;
+    uint iterations;
+} state;
+
+layout(push_constant) uniform PC {
+    uint vertices;
+} pc;
+
+uint vertexIndex() {
+    uint group = gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+    return group * gl_WorkGroupSize.x + gl_LocalInvocationID.x;
+}
@@ -0,0 +1,53 @@
+// Loop state, per-workgroup partial sums and push constants of the
+// PageRank kernels; the state matches PageRankState in graph.hpp.
+
+layout(set = 0, binding = 0, std430) buffer StateBuf {
+    // VkDispatchIndirectCommand of the contribution and update kernels,
+    // emptied once the ranks converged
+    uvec4 args;
+    uint iterations;
+    uint converged;
+    float dangling;
+    float delta;
+} state;
+
+layout(set = 0, binding = 1, std430) buffer PartialBuf {
+    float partials[];
+};
+
+layout(push_constant) uniform PC {
+    uint vertices;
+    // workgroups of a pass over the vertices, one partial each
+    uint groups;
+    float damping;
+    // L1 change of the rank vector below which iterating stops
+    float tolerance;
+} pc;
+
+uint groupIndex() {
+    return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+}
+
+// ranks of iteration i are in half i & 1 of the rank buffer
+uint rankSlot(uint iteration, uint v) {
+    return (iteration & 1u) * pc.vertices + v;
+}
+
+shared float partial[256];
+
+// sums value over the workgroup into partials[groupIndex()]; every
+// invocation has to call it
+void storePartial(float value) {
+    uint lid = gl_LocalInvocationID.x;
+    partial[lid] = value;
+    barrier();
+    for (uint stride = gl_WorkGroupSize.x / 2; stride > 0; stride /= 2) {
+        if (lid < stride) {
+            partial[lid] += partial[lid + stride];
+        }
+        barrier();
+    }
+    if (lid == 0 && groupIndex() < pc.groups) {
+        partials[groupIndex()] = partial[0];
+    }
+}
@@ -0,0 +1,520 @@
+#include "../include/graph.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of bfs_common.glsl
+struct BfsPushConstants {
+  uint32_t vertices;
+  uint32_t edges;
+  uint32_t source;
+  uint32_t maxGroupsX;
+  uint32_t alpha;
+  uint32_t beta;
+};
+
+// matches the push constant block of cc_common.glsl
+struct CcPushConstants {
+  uint32_t vertices;
+};
+
+// matches the push constant block of pr_common.glsl
+struct PageRankPushConstants {
+  uint32_t vertices;
+  uint32_t groups;
+  float damping;
+  float tolerance;
+};
+
+constexpr uint32_t kThreads = 256;
+constexpr uint32_t kUnvisited = 0xFFFFFFFFu;
+// byte offsets of the push and pull arguments in BfsState
+constexpr VkDeviceSize kPushArgs = 0;
+constexpr VkDeviceSize kPullArgs = 4 * sizeof(uint32_t);
+
+// loop state the kernels read their indirect arguments from
+Result<Buffer> createState(Engine &engine, VkDeviceSize size) {
+  return engine.createBuffer(size,
+                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                 VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                 USAGE_TRANSFER_SRC_DST,
+                             MEM_GPU_ONLY);
+}
+
+// counting sort of the edges by key into CSR offsets and neighbours
+void buildCsr(uint32_t vertices, const std::vector<uint32_t> &keys,
+              const std::vector<uint32_t> &neighbours,
+              std::vector<uint32_t> &offsets, std::vector<uint32_t> &out) {
+  offsets.assign(size_t(vertices) + 1, 0);
+  for (uint32_t key : keys) {
+    offsets[key + 1]++;
+  }
+  for (uint32_t v = 0; v < vertices; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+  out.resize(keys.size());
+  std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < keys.size(); i++) {
+    out[cursor[keys[i]]++] = neighbours[i];
+  }
+}
+
+bool validGraph(const Graph &graph) {
+  return graph._vertices > 0 && graph._outOffsets._buffer != VK_NULL_HANDLE &&
+         graph._inOffsets._buffer != VK_NULL_HANDLE;
+}
+
+} // namespace
+
+Result<Graph> Graph::upload(Engine &engine, uint32_t vertices,
+                            const std::vector<uint32_t> &sources,
+                            const std::vector<uint32_t> &targets) {
+  if (vertices == 0 || vertices == UINT32_MAX ||
+      sources.size() != targets.size() || sources.size() >= UINT32_MAX) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  for (size_t i = 0; i < sources.size(); i++) {
+    if (sources[i] >= vertices || targets[i] >= vertices) {
+      return {VK_ERROR_INITIALIZATION_FAILED};
+    }
+  }
+  std::vector<uint32_t> outOffsets;
+  std::vector<uint32_t> outTargets;
+  std::vector<uint32_t> inOffsets;
+  std::vector<uint32_t> inSources;
+  buildCsr(vertices, sources, targets, outOffsets, outTargets);
+  buildCsr(vertices, targets, sources, inOffsets, inSources);
+
+  Graph graph;
+  graph._vertices = vertices;
+  graph._edges = static_cast<uint32_t>(sources.size());
+  auto outOffsetBuf = createStorage(engine, uint64_t(vertices) + 1);
+  auto outTargetBuf = createStorage(engine, graph._edges);
+  auto inOffsetBuf = createStorage(engine, uint64_t(vertices) + 1);
+  auto inSourceBuf = createStorage(engine, graph._edges);
+  if (outOffsetBuf.isValid()) {
+    graph._outOffsets = outOffsetBuf.getValue();
+  }
+  if (outTargetBuf.isValid()) {
+    graph._outTargets = outTargetBuf.getValue();
+  }
+  if (inOffsetBuf.isValid()) {
+    graph._inOffsets = inOffsetBuf.getValue();
+  }
+  if (inSourceBuf.isValid()) {
+    graph._inSources = inSourceBuf.getValue();
+  }
+  if (!outOffsetBuf.isValid() || !outTargetBuf.isValid() ||
+      !inOffsetBuf.isValid() || !inSourceBuf.isValid()) {
+    graph.destroy(engine);
+    return {VK_ERROR_OUT_OF_DEVICE_MEMORY};
+  }
+
+  const VkDeviceSize offsetBytes = outOffsets.size() * sizeof(uint32_t);
+  const VkDeviceSize edgeBytes = VkDeviceSize(graph._edges) * sizeof(uint32_t);
+  CommandStream stream(engine);
+  stream.upload(graph._outOffsets, outOffsets.data(), offsetBytes);
+  stream.upload(graph._inOffsets, inOffsets.data(), offsetBytes);
+  if (graph._edges > 0) {
+    stream.upload(graph._outTargets, outTargets.data(), edgeBytes);
+    stream.upload(graph._inSources, inSources.data(), edgeBytes);
+  }
+  VkResult result = stream.submit();
+  if (result != VK_SUCCESS) {
+    graph.destroy(engine);
+    return {result};
+  }
+  return {graph};
+}
+
+void Graph::destroy(Engine &engine) {
+  destroyIfSet(engine, _outOffsets);
+  destroyIfSet(engine, _outTargets);
+  destroyIfSet(engine, _inOffsets);
+  destroyIfSet(engine, _inSources);
+}
+
+Result<Bfs> Bfs::create(Engine &engine, const Graph &graph, uint32_t alpha,
+                        uint32_t beta) {
+  if (!validGraph(graph) || alpha == 0 || beta == 0) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  const uint32_t pcSize = sizeof(BfsPushConstants);
+  auto start = engine.createKernel(
+      "bfs_start.spv",
+      {{STORAGE_READ_WRITE, STORAGE_READ, STORAGE_WRITE, STORAGE_WRITE},
+       pcSize});
+  if (!start.isValid()) {
+    return {start.getError()};
+  }
+  auto push = engine.createKernel(
+      "bfs_push.spv",
+      {{STORAGE_READ_WRITE, STORAGE_READ, STORAGE_READ, STORAGE_READ_WRITE,
+        STORAGE_READ_WRITE},
+       pcSize});
+  if (!push.isValid()) {
+    return {push.getError()};
+  }
+  auto pull = engine.createKernel(
+      "bfs_pull.spv",
+      {{STORAGE_READ_WRITE, STORAGE_READ, STORAGE_READ, STORAGE_READ,
+        STORAGE_READ_WRITE, STORAGE_WRITE},
+       pcSize});
+  if (!pull.isValid()) {
+    return {pull.getError()};
+  }
+  auto step =
+      engine.createKernel("bfs_step.spv", {{STORAGE_READ_WRITE}, pcSize});
+  if (!step.isValid()) {
+    return {step.getError()};
+  }
+
+  Bfs bfs;
+  bfs.m_engine = &engine;
+  bfs.m_graph = graph;
+  bfs.m_alpha = alpha;
+  bfs.m_beta = beta;
+  bfs.m_maxGroupsX = engine.maxGroupsX();
+  bfs.m_start = start.getValue();
+  bfs.m_push = push.getValue();
+  bfs.m_pull = pull.getValue();
+  bfs.m_step = step.getValue();
+
+  // two halves, the current frontier and the next
+  auto queue = createStorage(engine, 2ull * graph._vertices);
+  auto state = createState(engine, sizeof(BfsState));
+  if (queue.isValid()) {
+    bfs.m_queue = queue.getValue();
+  }
+  if (state.isValid()) {
+    bfs.m_state = state.getValue();
+  }
+  if (!queue.isValid() || !state.isValid()) {
+    bfs.destroy();
+    return {VK_ERROR_OUT_OF_DEVICE_MEMORY};
+  }
+  return {bfs};
+}
+
+void Bfs::destroy() {
+  if (m_engine == nullptr) {
+    return;
+  }
+  destroyIfSet(*m_engine, m_queue);
+  destroyIfSet(*m_engine, m_state);
+}
+
+VkResult Bfs::record(CommandStream &stream, uint32_t source,
+                     const Buffer &levels, uint32_t maxLevels) const {
+  if (m_engine == nullptr || source >= m_graph._vertices ||
+      levels._size < VkDeviceSize(m_graph._vertices) * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const BfsPushConstants pc{m_graph._vertices, m_graph._edges, source,
+                            m_maxGroupsX,      m_alpha,        m_beta};
+  stream.fill(levels, kUnvisited, 0,
+              VkDeviceSize(m_graph._vertices) * sizeof(uint32_t));
+  stream.dispatch(m_start, {m_state, m_graph._outOffsets, levels, m_queue}, pc,
+                  WorkGroups{1}, {sizeof(BfsState), 0});
+  return recordMore(stream, levels, maxLevels);
+}
+
+VkResult Bfs::recordMore(CommandStream &stream, const Buffer &levels,
+                         uint32_t maxLevels) const {
+  if (m_engine == nullptr ||
+      levels._size < VkDeviceSize(m_graph._vertices) * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const BfsPushConstants pc{m_graph._vertices, m_graph._edges, 0,
+                            m_maxGroupsX,      m_alpha,        m_beta};
+  const std::vector<Buffer> pushBuffers{m_state, m_graph._outOffsets,
+                                        m_graph._outTargets, levels, m_queue};
+  const std::vector<Buffer> pullBuffers{m_state,
+                                        m_graph._outOffsets,
+                                        m_graph._inOffsets,
+                                        m_graph._inSources,
+                                        levels,
+                                        m_queue};
+  for (uint32_t level = 0; level < maxLevels; level++) {
+    // one of the two is empty, both once the search is over
+    stream.dispatchIndirect(m_push, pushBuffers, pc, m_state, kPushArgs);
+    stream.dispatchIndirect(m_pull, pullBuffers, pc, m_state, kPullArgs);
+    stream.dispatch(m_step, {m_state}, pc, WorkGroups{1},
+                    {sizeof(BfsState), 0});
+  }
+  return stream.getState();
+}
+
+Result<BfsState> Bfs::run(CommandStream &stream, uint32_t source,
+                          const Buffer &levels, uint32_t batchLevels) const {
+  if (batchLevels == 0) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  BfsState state{};
+  VkResult result = record(stream, source, levels, batchLevels);
+  // a search ends within vertices levels, so this terminates
+  while (result == VK_SUCCESS) {
+    stream.readback(m_state, &state, sizeof(state));
+    result = stream.submit();
+    if (result != VK_SUCCESS || state.done()) {
+      break;
+    }
+    result = recordMore(stream, levels, batchLevels);
+  }
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+  return {state};
+}
+
+Result<ConnectedComponents> ConnectedComponents::create(Engine &engine,
+                                                        const Graph &graph) {
+  if (!validGraph(graph)) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  const uint32_t pcSize = sizeof(CcPushConstants);
+  auto init = engine.createKernel(
+      "cc_init.spv", {{STORAGE_READ_WRITE, STORAGE_WRITE}, pcSize});
+  if (!init.isValid()) {
+    return {init.getError()};
+  }
+  auto propagate = engine.createKernel(
+      "cc_propagate.spv",
+      {{STORAGE_READ_WRITE, STORAGE_READ, STORAGE_READ, STORAGE_READ,
+        STORAGE_READ, STORAGE_READ_WRITE},
+       pcSize});
+  if (!propagate.isValid()) {
+    return {propagate.getError()};
+  }
+  auto jump = engine.createKernel(
+      "cc_jump.spv", {{STORAGE_READ_WRITE, STORAGE_READ_WRITE}, pcSize});
+  if (!jump.isValid()) {
+    return {jump.getError()};
+  }
+  auto check =
+      engine.createKernel("cc_check.spv", {{STORAGE_READ_WRITE}, pcSize});
+  if (!check.isValid()) {
+    return {check.getError()};
+  }
+
+  ConnectedComponents cc;
+  cc.m_engine = &engine;
+  cc.m_graph = graph;
+  cc.m_maxGroupsX = engine.maxGroupsX();
+  cc.m_init = init.getValue();
+  cc.m_propagate = propagate.getValue();
+  cc.m_jump = jump.getValue();
+  cc.m_check = check.getValue();
+  auto state = createState(engine, sizeof(CcState));
+  if (!state.isValid()) {
+    return {state.getError()};
+  }
+  cc.m_state = state.getValue();
+  return {cc};
+}
+
+void ConnectedComponents::destroy() {
+  if (m_engine == nullptr) {
+    return;
+  }
+  destroyIfSet(*m_engine, m_state);
+}
+
+VkResult ConnectedComponents::record(CommandStream &stream,
+                                     const Buffer &labels,
+                                     uint32_t maxIterations) const {
+  if (m_engine == nullptr ||
+      labels._size < VkDeviceSize(m_graph._vertices) * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const WorkGroups grid = spread(m_graph._vertices, kThreads, m_maxGroupsX);
+  const CcState initial{{grid._x, grid._y, 1, 0}, 0, 0};
+  stream.upload(m_state, &initial, sizeof(initial));
+  stream.dispatch(m_init, {m_state, labels}, CcPushConstants{m_graph._vertices},
+                  grid, {uint64_t(m_graph._vertices) * sizeof(uint32_t), 0});
+  return recordMore(stream, labels, maxIterations);
+}
+
+VkResult ConnectedComponents::recordMore(CommandStream &stream,
+                                         const Buffer &labels,
+                                         uint32_t maxIterations) const {
+  if (m_engine == nullptr ||
+      labels._size < VkDeviceSize(m_graph._vertices) * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const CcPushConstants pc{m_graph._vertices};
+  const std::vector<Buffer> propagateBuffers{
+      m_state,            m_graph._outOffsets, m_graph._outTargets,
+      m_graph._inOffsets, m_graph._inSources,  labels};
+  for (uint32_t i = 0; i < maxIterations; i++) {
+    stream.dispatchIndirect(m_propagate, propagateBuffers, pc, m_state);
+    stream.dispatchIndirect(m_jump, {m_state, labels}, pc, m_state);
+    stream.dispatch(m_check, {m_state}, pc, WorkGroups{1},
+                    {sizeof(CcState), 0});
+  }
+  return stream.getState();
+}
+
+Result<CcState> ConnectedComponents::run(CommandStream &stream,
+                                         const Buffer &labels,
+                                         uint32_t batchIterations) const {
+  if (batchIterations == 0) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  CcState state{};
+  VkResult result = record(stream, labels, batchIterations);
+  // labels only decrease, so this terminates
+  while (result == VK_SUCCESS) {
+    stream.readback(m_state, &state, sizeof(state));
+    result = stream.submit();
+    if (result != VK_SUCCESS || state.done()) {
+      break;
+    }
+    result = recordMore(stream, labels, batchIterations);
+  }
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+  return {state};
+}
+
+Result<PageRank> PageRank::create(Engine &engine, const Graph &graph,
+                                  float damping, float tolerance) {
+  if (!validGraph(graph) || !(damping > 0.0f && damping < 1.0f) ||
+      !(tolerance >= 0.0f) || graph._vertices > UINT32_MAX / 2) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  const uint32_t pcSize = sizeof(PageRankPushConstants);
+  auto contrib = engine.createKernel(
+      "pr_contrib.spv",
+      {{STORAGE_READ, STORAGE_WRITE, STORAGE_READ, STORAGE_READ, STORAGE_WRITE},
+       pcSize});
+  if (!contrib.isValid()) {
+    return {contrib.getError()};
+  }
+  auto reduce = engine.createKernel(
+      "pr_reduce.spv", {{STORAGE_READ_WRITE, STORAGE_READ}, pcSize});
+  if (!reduce.isValid()) {
+    return {reduce.getError()};
+  }
+  auto update = engine.createKernel(
+      "pr_update.spv",
+      {{STORAGE_READ, STORAGE_WRITE, STORAGE_READ, STORAGE_READ, STORAGE_READ,
+        STORAGE_READ_WRITE},
+       pcSize});
+  if (!update.isValid()) {
+    return {update.getError()};
+  }
+  auto check = engine.createKernel(
+      "pr_check.spv", {{STORAGE_READ_WRITE, STORAGE_READ}, pcSize});
+  if (!check.isValid()) {
+    return {check.getError()};
+  }
+  auto finish = engine.createKernel(
+      "pr_finish.spv",
+      {{STORAGE_READ, STORAGE_READ, STORAGE_READ, STORAGE_WRITE}, pcSize});
+  if (!finish.isValid()) {
+    return {finish.getError()};
+  }
+
+  PageRank pagerank;
+  pagerank.m_engine = &engine;
+  pagerank.m_graph = graph;
+  pagerank.m_damping = damping;
+  pagerank.m_tolerance = tolerance;
+  pagerank.m_maxGroupsX = engine.maxGroupsX();
+  pagerank.m_groups = groupCount(graph._vertices, kThreads);
+  pagerank.m_contrib = contrib.getValue();
+  pagerank.m_reduce = reduce.getValue();
+  pagerank.m_update = update.getValue();
+  pagerank.m_check = check.getValue();
+  pagerank.m_finish = finish.getValue();
+
+  // two halves, the ranks read and written by an iteration
+  auto ranks = createStorage(engine, 2ull * graph._vertices);
+  auto contribs = createStorage(engine, graph._vertices);
+  auto partials = createStorage(engine, pagerank.m_groups);
+  auto state = createState(engine, sizeof(PageRankState));
+  if (ranks.isValid()) {
+    pagerank.m_ranks = ranks.getValue();
+  }
+  if (contribs.isValid()) {
+    pagerank.m_contribs = contribs.getValue();
+  }
+  if (partials.isValid()) {
+    pagerank.m_partials = partials.getValue();
+  }
+  if (state.isValid()) {
+    pagerank.m_state = state.getValue();
+  }
+  if (!ranks.isValid() || !contribs.isValid() || !partials.isValid() ||
+      !state.isValid()) {
+    pagerank.destroy();
+    return {VK_ERROR_OUT_OF_DEVICE_MEMORY};
+  }
+  return {pagerank};
+}
+
+void PageRank::destroy() {
+  if (m_engine == nullptr) {
+    return;
+  }
+  destroyIfSet(*m_engine, m_ranks);
+  destroyIfSet(*m_engine, m_contribs);
+  destroyIfSet(*m_engine, m_partials);
+  destroyIfSet(*m_engine, m_state);
+}
+
+uint64_t PageRank::bytesPerIteration() const {
+  const uint64_t n = m_graph._vertices;
+  const uint64_t e = m_graph._edges;
+  // both offset arrays, in-sources plus their contributions, and ranks
+  // read twice, written once, contributions written once
+  return (2 * (n + 1) + 2 * e + 4 * n) * sizeof(uint32_t);
+}
+
+VkResult PageRank::record(CommandStream &stream, const Buffer &ranks,
+                          uint32_t maxIterations) const {
+  const VkDeviceSize rankBytes =
+      VkDeviceSize(m_graph._vertices) * sizeof(float);
+  if (m_engine == nullptr || ranks._size < rankBytes) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const PageRankPushConstants pc{m_graph._vertices, m_groups, m_damping,
+                                 m_tolerance};
+  const WorkGroups grid = spread(m_graph._vertices, kThreads, m_maxGroupsX);
+  const PageRankState initial{{grid._x, grid._y, 1, 0}, 0, 0, 0.0f, 0.0f};
+  const float uniform = 1.0f / float(m_graph._vertices);
+  uint32_t uniformBits = 0;
+  std::memcpy(&uniformBits, &uniform, sizeof(uniformBits));
+  stream.upload(m_state, &initial, sizeof(initial));
+  stream.fill(m_ranks, uniformBits, 0, rankBytes);
+
+  const std::vector<Buffer> contribBuffers{m_state, m_partials,
+                                           m_graph._outOffsets, m_ranks,
+                                           m_contribs};
+  const std::vector<Buffer> updateBuffers{
+      m_state,    m_partials, m_graph._inOffsets, m_graph._inSources,
+      m_contribs, m_ranks};
+  const Cost reduceCost{uint64_t(m_groups) * sizeof(float), m_groups};
+  for (uint32_t i = 0; i < maxIterations; i++) {
+    // emptied by pr_check once converged; the reductions return early
+    stream.dispatchIndirect(m_contrib, contribBuffers, pc, m_state);
+    stream.dispatch(m_reduce, {m_state, m_partials}, pc, WorkGroups{1},
+                    reduceCost);
+    stream.dispatchIndirect(m_update, updateBuffers, pc, m_state);
+    stream.dispatch(m_check, {m_state, m_partials}, pc, WorkGroups{1},
+                    reduceCost);
+  }
+  stream.dispatch(m_finish, {m_state, m_partials, m_ranks, ranks}, pc, grid,
+                  {2 * rankBytes, 0});
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
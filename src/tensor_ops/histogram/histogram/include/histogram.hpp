@@ -0,0 +1,68 @@
+#ifndef MELKIOR_HISTOGRAM_HPP
+#define MELKIOR_HISTOGRAM_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+// How counts reach the histogram, each builds on the one before:
+//   GLOBAL_ATOMICS one global atomic per element
+//   PRIVATIZED     per work group histograms in shared memory, merged with
+//                  one global atomic per non-empty bin and group
+//   AGGREGATED     PRIVATIZED, and runs of equal bins within a thread are
+//                  added with a single atomic
+enum class HistogramMode : uint8_t { GLOBAL_ATOMICS, PRIVATIZED, AGGREGATED };
+
+// Histograms of interleaved uint8 images, all channels in one pass, and of
+// fp32 data in any number of equal-width bins. Counts are uint32 and added
+// to what the counts buffer holds when accumulate is set; otherwise the
+// buffer is cleared first with vkCmdFillBuffer, which needs transfer usage.
+//
+// Bin counts that don't fit maxComputeSharedMemorySize fall back to global
+// atomics.
+//
+//   auto histogram = Histogram::create(engine).getValue();
+//   histogram.recordImage(stream, frame, counts, 3840, 2160, 4);
+class Histogram {
+public:
+  static engine::Result<Histogram>
+  create(engine::Engine &engine,
+         HistogramMode mode = HistogramMode::AGGREGATED);
+
+  // counts holds channels * 256 uints, channel-major; rowBytes 0 means
+  // tightly packed rows. The image buffer is read as whole words, so its
+  // size must be rounded up to 4 bytes.
+  VkResult recordImage(engine::CommandStream &stream,
+                       const engine::Buffer &image,
+                       const engine::Buffer &counts, uint32_t width,
+                       uint32_t height, uint32_t channels,
+                       uint32_t rowBytes = 0, bool accumulate = false) const;
+
+  // bins equal-width bins over [lo, hi); values outside it and NaNs are
+  // not counted
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &data,
+                  const engine::Buffer &counts, uint64_t count, uint32_t bins,
+                  float lo, float hi, bool accumulate = false) const;
+
+  HistogramMode mode() const { return m_mode; }
+  // most bins a work group can keep in shared memory
+  uint32_t maxPrivateBins() const { return m_maxPrivateBins; }
+
+private:
+  engine::WorkGroups groupsFor(uint64_t items) const;
+
+  engine::Engine *m_engine = nullptr;
+  HistogramMode m_mode = HistogramMode::AGGREGATED;
+  // uint8 kernels by channel count - 1
+  std::array<engine::Kernel, 4> m_image;
+  uint32_t m_maxPrivateBins = 4096;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
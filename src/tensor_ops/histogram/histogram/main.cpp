@@ -0,0 +1,116 @@
+#include "histogram.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters: an RGB image with padded rows, and float samples
+  const uint32_t W = 1001;
+  const uint32_t H = 601;
+  const uint32_t C = 3;
+  const uint32_t rowBytes = 3008;
+  const uint32_t N = 1000003;
+  const uint32_t bins = 100;
+  const float lo = -2.0f;
+  const float hi = 2.0f;
+
+  Engine engine("vk_histogram");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+  auto histogramResult = Histogram::create(engine);
+  if (!histogramResult.isValid()) {
+    std::cerr << "Histogram::create failed: " << histogramResult.getError()
+              << "\n";
+    return 1;
+  }
+  Histogram histogram = histogramResult.getValue();
+
+  std::mt19937 rng(1);
+  std::normal_distribution<float> normal(0.0f, 1.0f);
+  std::vector<uint8_t> image(size_t(rowBytes) * H, 0xEE);
+  std::vector<uint32_t> expectedImage(C * 256, 0);
+  for (uint32_t y = 0; y < H; y++) {
+    for (uint32_t x = 0; x < W * C; x++) {
+      // runs of equal values, like flat image regions
+      uint8_t v = uint8_t(x / 64 + y + (rng() % 8 == 0 ? rng() : 0));
+      image[size_t(y) * rowBytes + x] = v;
+      expectedImage[(x % C) * 256 + v]++;
+    }
+  }
+  std::vector<float> samples(N);
+  std::vector<uint32_t> expectedSamples(bins, 0);
+  for (auto &s : samples) {
+    s = normal(rng);
+    double x = (double(s) - lo) * (bins / (double(hi) - lo));
+    if (x >= 0.0 && x < bins) {
+      expectedSamples[uint32_t(x)]++;
+    }
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  Buffer imageBuffer =
+      engine.createBuffer(image.size(), usage, MEM_GPU_ONLY).getValue();
+  Buffer sampleBuffer =
+      engine.createBuffer(N * sizeof(float), usage, MEM_GPU_ONLY).getValue();
+  Buffer imageCounts =
+      engine.createBuffer(C * 256 * sizeof(uint32_t), usage, MEM_GPU_ONLY)
+          .getValue();
+  Buffer sampleCounts =
+      engine.createBuffer(bins * sizeof(uint32_t), usage, MEM_GPU_ONLY)
+          .getValue();
+
+  CommandStream stream(engine);
+  stream.upload(imageBuffer, image.data(), image.size());
+  stream.upload(sampleBuffer, samples.data(), N * sizeof(float));
+  VkResult r = histogram.recordImage(stream, imageBuffer, imageCounts, W, H,
+                                     C, rowBytes);
+  if (r == VK_SUCCESS) {
+    r = histogram.record(stream, sampleBuffer, sampleCounts, N, bins, lo, hi);
+  }
+  std::vector<uint32_t> imageResult(C * 256);
+  std::vector<uint32_t> sampleResult(bins);
+  stream.readback(imageCounts, imageResult.data(),
+                  imageResult.size() * sizeof(uint32_t));
+  stream.readback(sampleCounts, sampleResult.data(),
+                  sampleResult.size() * sizeof(uint32_t));
+  if (r == VK_SUCCESS) {
+    r = stream.submit();
+  }
+  if (r != VK_SUCCESS) {
+    std::cerr << "histogram failed: " << r << "\n";
+    return 1;
+  }
+
+  // float binning may differ from the double reference right at the edges
+  uint32_t moved = 0;
+  for (uint32_t b = 0; b < bins; b++) {
+    moved += uint32_t(std::abs(int64_t(sampleResult[b]) -
+                               int64_t(expectedSamples[b])));
+  }
+  bool imageOk = imageResult == expectedImage;
+  bool samplesOk = moved <= 8;
+  std::cout << "image " << W << "x" << H << "x" << C
+            << (imageOk ? " OK" : " FAILED") << ", " << N << " samples in "
+            << bins << " bins" << (samplesOk ? " OK" : " FAILED") << "\n";
+
+  engine.destroyBuffer(imageBuffer);
+  engine.destroyBuffer(sampleBuffer);
+  engine.destroyBuffer(imageCounts);
+  engine.destroyBuffer(sampleCounts);
+  if (!imageOk || !samplesOk) {
+    return 1;
+  }
+  std::cout << "OK: histograms match.\n";
+  return 0;
+}
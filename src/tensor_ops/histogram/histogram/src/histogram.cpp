@@ -0,0 +1,131 @@
+#include "../include/histogram.hpp"
+
+#include <algorithm>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of histogram.comp
+struct ImagePushConstants {
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels;
+  uint32_t rowBytes;
+};
+
+// matches the push constant block of histogram.comp with -DFLOAT
+struct FloatPushConstants {
+  uint32_t count;
+  uint32_t bins;
+  float lo;
+  float scale;
+};
+
+constexpr uint32_t kThreads = 256;
+// items per thread the grid is sized for; fewer groups means fewer merges
+constexpr uint32_t kItemsPerThread = 16;
+constexpr uint32_t kMaxGroups = 1024;
+
+const KernelSignature kSignature{{STORAGE_READ, STORAGE_READ_WRITE},
+                                 sizeof(ImagePushConstants)};
+
+Specialization specFor(HistogramMode mode, uint32_t bins,
+                       uint32_t maxPrivateBins) {
+  const bool privatize =
+      mode != HistogramMode::GLOBAL_ATOMICS && bins <= maxPrivateBins;
+  Specialization spec;
+  spec.set(0, privatize ? 1u : 0u)
+      .set(1, mode == HistogramMode::AGGREGATED ? 1u : 0u)
+      .set(2, privatize ? bins : 1u);
+  return spec;
+}
+
+} // namespace
+
+Result<Histogram> Histogram::create(Engine &engine, HistogramMode mode) {
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+
+  Histogram histogram;
+  histogram.m_engine = &engine;
+  histogram.m_mode = mode;
+  histogram.m_maxPrivateBins =
+      props.limits.maxComputeSharedMemorySize / sizeof(uint32_t);
+  for (uint32_t channels = 1; channels <= 4; channels++) {
+    auto kernel = engine.createKernel(
+        "histogram_u8.spv", kSignature,
+        specFor(mode, channels * 256, histogram.m_maxPrivateBins));
+    if (!kernel.isValid()) {
+      return {kernel.getError()};
+    }
+    histogram.m_image[channels - 1] = kernel.getValue();
+  }
+  return {histogram};
+}
+
+WorkGroups Histogram::groupsFor(uint64_t items) const {
+  const uint32_t groups = std::clamp<uint32_t>(
+      groupCount(items, kThreads * kItemsPerThread), 1, kMaxGroups);
+  return spread(groups, 1, m_engine->maxGroupsX());
+}
+
+VkResult Histogram::recordImage(CommandStream &stream, const Buffer &image,
+                                const Buffer &counts, uint32_t width,
+                                uint32_t height, uint32_t channels,
+                                uint32_t rowBytes, bool accumulate) const {
+  if (rowBytes == 0) {
+    rowBytes = width * channels;
+  }
+  const uint64_t bytes = uint64_t(rowBytes) * (height - 1) + width * channels;
+  if (m_engine == nullptr || channels == 0 || channels > 4 || width == 0 ||
+      height == 0 || rowBytes < width * channels ||
+      image._size < (bytes + 3) / 4 * 4 ||
+      counts._size < channels * 256 * sizeof(uint32_t) ||
+      bytes > UINT32_MAX) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (!accumulate) {
+    stream.fill(counts, 0, 0, channels * 256 * sizeof(uint32_t));
+  }
+  stream.dispatch(m_image[channels - 1], {image, counts},
+                  ImagePushConstants{width, height, channels, rowBytes},
+                  groupsFor((bytes + 3) / 4), {bytes, bytes});
+  return stream.getState();
+}
+
+VkResult Histogram::record(CommandStream &stream, const Buffer &data,
+                           const Buffer &counts, uint64_t count,
+                           uint32_t bins, float lo, float hi,
+                           bool accumulate) const {
+  if (m_engine == nullptr || bins == 0 || !(hi > lo) ||
+      count > UINT32_MAX || data._size < count * sizeof(float) ||
+      counts._size < bins * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  // pipelines per bin count come out of the engine's registry
+  auto kernel = m_engine->createKernel("histogram_f32.spv", kSignature,
+                                       specFor(m_mode, bins,
+                                               m_maxPrivateBins));
+  if (!kernel.isValid()) {
+    return kernel.getError();
+  }
+
+  if (!accumulate) {
+    stream.fill(counts, 0, 0, bins * sizeof(uint32_t));
+  }
+  if (count == 0) {
+    return stream.getState();
+  }
+  const float scale = static_cast<float>(bins / (double(hi) - lo));
+  stream.dispatch(kernel.getValue(), {data, counts},
+                  FloatPushConstants{static_cast<uint32_t>(count), bins, lo,
+                                     scale},
+                  groupsFor(count), {count * sizeof(float), count});
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
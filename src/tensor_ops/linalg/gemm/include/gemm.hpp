@@ -0,0 +1,119 @@
+#ifndef MELKIOR_GEMM_HPP
+#define MELKIOR_GEMM_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+enum class GemmPrecision : uint8_t { FP32, FP16 };
+
+// Work group tile of C and the register micro-tile of one thread, the
+// specialization constants of gemm.comp.
+struct GemmTile {
+  uint32_t _m = 64;
+  uint32_t _n = 64;
+  uint32_t _k = 16;
+  uint32_t _threadM = 4;
+  uint32_t _threadN = 4;
+
+  uint32_t threads() const { return (_m / _threadM) * (_n / _threadN); }
+  uint32_t sharedBytes(GemmPrecision precision) const {
+    return (_m + _n) * _k * (precision == GemmPrecision::FP16 ? 2 : 4);
+  }
+};
+
+// C = alpha * A * B + beta * C over row-major matrices, A is M x K and B is
+// K x N. Leading dimensions and batch strides are in elements; a batch
+// stride of 0 uses the same matrix for every batch entry, e.g. shared
+// weights.
+struct GemmShape {
+  uint32_t _m = 0;
+  uint32_t _n = 0;
+  uint32_t _k = 0;
+  uint32_t _lda = 0;
+  uint32_t _ldb = 0;
+  uint32_t _ldc = 0;
+  uint32_t _batch = 1;
+  uint32_t _strideA = 0;
+  uint32_t _strideB = 0;
+  uint32_t _strideC = 0;
+  float _alpha = 1.0f;
+  float _beta = 0.0f;
+
+  // tightly packed rows and matrices
+  static GemmShape packed(uint32_t m, uint32_t n, uint32_t k,
+                          uint32_t batch = 1) {
+    GemmShape shape;
+    shape._m = m;
+    shape._n = n;
+    shape._k = k;
+    shape._lda = k;
+    shape._ldb = n;
+    shape._ldc = n;
+    shape._batch = batch;
+    shape._strideA = m * k;
+    shape._strideB = k * n;
+    shape._strideC = m * n;
+    return shape;
+  }
+};
+
+// Tiled GEMM, fp32 or, when Engine::float16Supported(), fp16 buffers with
+// fp32 accumulation.
+//
+// The tile is chosen once per device and precision: autotune() times every
+// candidate that fits maxComputeSharedMemorySize and
+// maxComputeWorkGroupInvocations with GPU timestamps and writes the fastest
+// one to tunePath(), next to the pipeline cache. create() reads it from
+// there and never tunes; an untuned device gets the first candidate.
+//
+//   Gemm::autotune(engine, GemmPrecision::FP32); // once per device
+//   auto gemm = Gemm::create(engine).getValue();
+//   gemm.record(stream, a, b, c, GemmShape::packed(m, n, k));
+//   stream.submit();
+class Gemm {
+public:
+  static engine::Result<Gemm>
+  create(engine::Engine &engine, GemmPrecision precision = GemmPrecision::FP32);
+
+  // tiles that fit the device, the default first
+  static std::vector<GemmTile> candidates(const engine::Engine &engine,
+                                          GemmPrecision precision);
+  // times the candidates on a size^3 problem with the engine's profiler and
+  // stores the fastest; VK_ERROR_FEATURE_NOT_PRESENT without timestamps
+  static engine::Result<GemmTile> autotune(engine::Engine &engine,
+                                           GemmPrecision precision,
+                                           uint32_t size = 512);
+  static std::string tunePath(const engine::Engine &engine,
+                              GemmPrecision precision);
+
+  // fails when the tiles of C or the batch exceed
+  // maxComputeWorkGroupCount, e.g. a batch past 65535 on the minimum limits
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &a,
+                  const engine::Buffer &b, const engine::Buffer &c,
+                  const GemmShape &shape) const;
+
+  const GemmTile &tile() const { return m_tile; }
+  GemmPrecision precision() const { return m_precision; }
+
+private:
+  static engine::Result<engine::Kernel> createKernel(engine::Engine &engine,
+                                                     GemmPrecision precision,
+                                                     const GemmTile &tile);
+
+  engine::Kernel m_kernel;
+  GemmTile m_tile;
+  GemmPrecision m_precision = GemmPrecision::FP32;
+  // maxComputeWorkGroupCount
+  engine::WorkGroups m_maxGroups{65535, 65535, 65535};
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
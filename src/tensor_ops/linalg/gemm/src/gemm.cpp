@@ -0,0 +1,285 @@
+#include "../include/gemm.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// matches the push constant block of gemm.comp
+struct PushConstants {
+  uint32_t M;
+  uint32_t N;
+  uint32_t K;
+  uint32_t lda;
+  uint32_t ldb;
+  uint32_t ldc;
+  uint32_t strideA;
+  uint32_t strideB;
+  uint32_t strideC;
+  float alpha;
+  float beta;
+};
+
+// tried in this order, the first one that fits is the untuned default
+const GemmTile kCandidates[] = {
+    {64, 64, 16, 4, 4},  {64, 64, 8, 4, 4},   {32, 32, 16, 2, 2},
+    {32, 32, 8, 2, 2},   {64, 32, 16, 4, 2},  {32, 64, 16, 2, 4},
+    {64, 64, 16, 8, 4},  {64, 64, 16, 4, 8},  {128, 64, 8, 8, 4},
+    {64, 128, 8, 4, 8},  {128, 128, 8, 8, 8}, {32, 32, 16, 4, 4},
+    {16, 16, 16, 1, 1},
+};
+
+bool sameTile(const GemmTile &a, const GemmTile &b) {
+  return a._m == b._m && a._n == b._n && a._k == b._k &&
+         a._threadM == b._threadM && a._threadN == b._threadN;
+}
+
+uint32_t elementSize(GemmPrecision precision) {
+  return precision == GemmPrecision::FP16 ? 2 : 4;
+}
+
+// elements the last matrix of a batch reaches, 0 for an empty shape
+uint64_t extent(uint32_t batch, uint32_t stride, uint32_t rows,
+                uint32_t ld, uint32_t cols) {
+  if (batch == 0 || rows == 0 || cols == 0) {
+    return 0;
+  }
+  return uint64_t(batch - 1) * stride + uint64_t(rows - 1) * ld + cols;
+}
+
+bool loadTile(const std::string &path, GemmTile &tile) {
+  std::ifstream file(path);
+  return static_cast<bool>(file >> tile._m >> tile._n >> tile._k >>
+                           tile._threadM >> tile._threadN);
+}
+
+bool storeTile(const std::string &path, const GemmTile &tile) {
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+  std::ofstream file(path, std::ios::trunc);
+  file << tile._m << " " << tile._n << " " << tile._k << " " << tile._threadM
+       << " " << tile._threadN << "\n";
+  return static_cast<bool>(file);
+}
+
+} // namespace
+
+Result<Gemm> Gemm::create(Engine &engine, GemmPrecision precision) {
+  if (precision == GemmPrecision::FP16 && !engine.float16Supported()) {
+    return {VK_ERROR_FEATURE_NOT_PRESENT};
+  }
+  auto fits = candidates(engine, precision);
+  if (fits.empty()) {
+    return {VK_ERROR_FEATURE_NOT_PRESENT};
+  }
+
+  // a stored tile is only trusted if it still is a candidate
+  GemmTile tile;
+  bool tuned = false;
+  if (loadTile(tunePath(engine, precision), tile)) {
+    for (const auto &candidate : fits) {
+      tuned |= sameTile(candidate, tile);
+    }
+  }
+  if (!tuned) {
+    tile = fits.front();
+  }
+
+  auto kernel = createKernel(engine, precision, tile);
+  if (!kernel.isValid()) {
+    return {kernel.getError()};
+  }
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+  const auto &count = props.limits.maxComputeWorkGroupCount;
+
+  Gemm gemm;
+  gemm.m_kernel = kernel.getValue();
+  gemm.m_tile = tile;
+  gemm.m_precision = precision;
+  gemm.m_maxGroups = {count[0], count[1], count[2]};
+  return {gemm};
+}
+
+std::vector<GemmTile> Gemm::candidates(const Engine &engine,
+                                       GemmPrecision precision) {
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+  const auto &limits = props.limits;
+
+  std::vector<GemmTile> fits;
+  for (const auto &tile : kCandidates) {
+    if (tile.threads() <= limits.maxComputeWorkGroupInvocations &&
+        tile.threads() <= limits.maxComputeWorkGroupSize[0] &&
+        tile.sharedBytes(precision) <= limits.maxComputeSharedMemorySize) {
+      fits.push_back(tile);
+    }
+  }
+  return fits;
+}
+
+Result<GemmTile> Gemm::autotune(Engine &engine, GemmPrecision precision,
+                                uint32_t size) {
+  constexpr int kRuns = 5;
+
+  Profiler &profiler = engine.profiler();
+  if (!profiler.supported()) {
+    return {VK_ERROR_FEATURE_NOT_PRESENT};
+  }
+  const VkDeviceSize bytes =
+      VkDeviceSize(size) * size * elementSize(precision);
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  auto a = engine.createBuffer(bytes, usage, MEM_GPU_ONLY);
+  auto b = engine.createBuffer(bytes, usage, MEM_GPU_ONLY);
+  auto c = engine.createBuffer(bytes, usage, MEM_GPU_ONLY);
+  if (!a.isValid() || !b.isValid() || !c.isValid()) {
+    for (auto *buffer : {&a, &b, &c}) {
+      if (buffer->isValid()) {
+        engine.destroyBuffer(buffer->getValue());
+      }
+    }
+    return {VK_ERROR_OUT_OF_DEVICE_MEMORY};
+  }
+
+  const GemmShape shape = GemmShape::packed(size, size, size);
+  CommandStream stream(engine);
+  // zeros, so denormals or NaNs in fresh memory can't skew the timings
+  stream.fill(a.getValue(), 0);
+  stream.fill(b.getValue(), 0);
+
+  const bool wasEnabled = profiler.enabled();
+  profiler.setEnabled(true);
+  GemmTile best;
+  double bestMs = 0.0;
+  bool found = false;
+  for (const auto &tile : candidates(engine, precision)) {
+    auto kernel = createKernel(engine, precision, tile);
+    if (!kernel.isValid()) {
+      continue;
+    }
+    Gemm gemm;
+    gemm.m_kernel = kernel.getValue();
+    gemm.m_tile = tile;
+    gemm.m_precision = precision;
+
+    // first run pays for pipeline creation and cold caches
+    gemm.record(stream, a.getValue(), b.getValue(), c.getValue(), shape);
+    if (stream.submit() != VK_SUCCESS) {
+      continue;
+    }
+    // the stream's own scopes share the kernel name across candidates, so
+    // every run gets a scope named after its tile
+    const std::string name =
+        "gemm_tune_" + std::to_string(tile._m) + "x" +
+        std::to_string(tile._n) + "x" + std::to_string(tile._k) + "_" +
+        std::to_string(tile._threadM) + "x" + std::to_string(tile._threadN);
+    for (int i = 0; i < kRuns; i++) {
+      stream.flushBarriers();
+      uint32_t scope = profiler.begin(stream.commandBuffer(), name);
+      gemm.record(stream, a.getValue(), b.getValue(), c.getValue(), shape);
+      profiler.end(stream.commandBuffer(), scope);
+    }
+    if (stream.submit() != VK_SUCCESS) {
+      continue;
+    }
+    for (const auto &profile : profiler.summary()) {
+      // the fastest run, the others may have waited on the previous one
+      if (profile._name == name && (!found || profile._minMs < bestMs)) {
+        best = tile;
+        bestMs = profile._minMs;
+        found = true;
+      }
+    }
+  }
+  profiler.setEnabled(wasEnabled);
+
+  engine.destroyBuffer(a.getValue());
+  engine.destroyBuffer(b.getValue());
+  engine.destroyBuffer(c.getValue());
+  if (!found) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  storeTile(tunePath(engine, precision), best);
+  return {best};
+}
+
+std::string Gemm::tunePath(const Engine &engine, GemmPrecision precision) {
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+  // same directory as the pipeline cache, keyed by device and driver
+  auto dir = fs::path(engine.pipelineCachePath()).parent_path();
+  auto name = std::string("gemm_") +
+              (precision == GemmPrecision::FP16 ? "f16_" : "f32_") +
+              std::to_string(props.vendorID) + "_" +
+              std::to_string(props.deviceID) + "_" +
+              std::to_string(props.driverVersion) + ".tune";
+  return (dir / name).string();
+}
+
+VkResult Gemm::record(CommandStream &stream, const Buffer &a, const Buffer &b,
+                      const Buffer &c, const GemmShape &shape) const {
+  const uint32_t elem = elementSize(m_precision);
+  if (shape._lda < shape._k || shape._ldb < shape._n ||
+      shape._ldc < shape._n ||
+      extent(shape._batch, shape._strideA, shape._m, shape._lda, shape._k) *
+              elem >
+          a._size ||
+      extent(shape._batch, shape._strideB, shape._k, shape._ldb, shape._n) *
+              elem >
+          b._size ||
+      extent(shape._batch, shape._strideC, shape._m, shape._ldc, shape._n) *
+              elem >
+          c._size) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  if (shape._m == 0 || shape._n == 0 || shape._batch == 0) {
+    return stream.getState();
+  }
+  // one work group per tile of C and batch entry
+  const WorkGroups grid{groupCount(shape._n, m_tile._n),
+                        groupCount(shape._m, m_tile._m), shape._batch};
+  if (grid._x > m_maxGroups._x || grid._y > m_maxGroups._y ||
+      grid._z > m_maxGroups._z) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  const PushConstants pc{shape._m,       shape._n,       shape._k,
+                         shape._lda,     shape._ldb,     shape._ldc,
+                         shape._strideA, shape._strideB, shape._strideC,
+                         shape._alpha,   shape._beta};
+  const uint64_t batch = shape._batch;
+  const uint64_t mn = uint64_t(shape._m) * shape._n;
+  const Cost cost{
+      batch *
+          (uint64_t(shape._m) * shape._k + uint64_t(shape._k) * shape._n +
+           (shape._beta != 0.0f ? 2 : 1) * mn) *
+          elem,
+      batch * 2 * mn * shape._k};
+  stream.dispatch(m_kernel, {a, b, c}, pc, grid, cost);
+  return stream.getState();
+}
+
+Result<Kernel> Gemm::createKernel(Engine &engine, GemmPrecision precision,
+                                  const GemmTile &tile) {
+  const KernelSignature signature{
+      {STORAGE_READ, STORAGE_READ, STORAGE_READ_WRITE}, sizeof(PushConstants)};
+  Specialization spec;
+  spec.set(0, tile.threads())
+      .set(1, tile._m)
+      .set(2, tile._n)
+      .set(3, tile._k)
+      .set(4, tile._threadM)
+      .set(5, tile._threadN);
+  return engine.createKernel(precision == GemmPrecision::FP16 ? "gemm_f16.spv"
+                                                              : "gemm_f32.spv",
+                             signature, spec);
+}
+
+} // namespace melkior::tensor_ops
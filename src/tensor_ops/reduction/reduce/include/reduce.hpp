@@ -0,0 +1,92 @@
+#ifndef MELKIOR_REDUCE_HPP
+#define MELKIOR_REDUCE_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+enum class ReduceOp : uint32_t { SUM, MIN, MAX, ARGMIN, DOT };
+
+// What a reduction writes per reduced segment; _index is the position of the
+// minimum within the segment for ARGMIN (first one on ties) and unspecified
+// otherwise.
+struct ReducePair {
+  float _value;
+  uint32_t _index;
+};
+
+// Reductions of fp32 buffers: a whole buffer, or one axis of an
+// [outer, axis, inner] tensor (rows of a matrix: inner = 1).
+//
+// Contiguous reductions run hierarchically: each level lets a bounded
+// number of work groups fold long strided slices in registers and combine
+// them with subgroupAdd/Min/Max where the device has
+// VK_SUBGROUP_FEATURE_ARITHMETIC_BIT, or a shared-memory tree otherwise.
+// Levels repeat on the partials, which live in a caller provided scratch
+// buffer, until one ReducePair per segment is left in out.
+//
+//   auto sum = Reduction::create(engine, ReduceOp::SUM).getValue();
+//   sum.record(stream, x, out, scratch, n); // out: one ReducePair
+class Reduction {
+public:
+  static engine::Result<Reduction> create(engine::Engine &engine,
+                                          ReduceOp op,
+                                          bool allowSubgroups = true);
+
+  // bytes of scratch record() / recordAxis() need
+  static VkDeviceSize scratchSize(uint64_t count);
+  static VkDeviceSize scratchSize(uint32_t outer, uint32_t axis,
+                                  uint32_t inner);
+
+  // y is the second operand for DOT and ignored otherwise
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &x,
+                  const engine::Buffer &y, const engine::Buffer &out,
+                  const engine::Buffer &scratch, uint64_t count) const;
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &x,
+                  const engine::Buffer &out, const engine::Buffer &scratch,
+                  uint64_t count) const {
+    return record(stream, x, x, out, scratch, count);
+  }
+
+  // out holds outer * inner pairs, in [outer, inner] order
+  VkResult recordAxis(engine::CommandStream &stream, const engine::Buffer &x,
+                      const engine::Buffer &y, const engine::Buffer &out,
+                      const engine::Buffer &scratch, uint32_t outer,
+                      uint32_t axis, uint32_t inner) const;
+  VkResult recordAxis(engine::CommandStream &stream, const engine::Buffer &x,
+                      const engine::Buffer &out, const engine::Buffer &scratch,
+                      uint32_t outer, uint32_t axis, uint32_t inner) const {
+    return recordAxis(stream, x, x, out, scratch, outer, axis, inner);
+  }
+
+  ReduceOp op() const { return m_op; }
+  bool usesSubgroups() const { return m_subgroups; }
+
+private:
+  // work groups per segment of every level, the last level has 1
+  static std::vector<uint32_t> levels(uint64_t segments, uint64_t length);
+
+  VkResult recordSegments(engine::CommandStream &stream,
+                          const engine::Buffer &x, const engine::Buffer &y,
+                          const engine::Buffer &out,
+                          const engine::Buffer &scratch, uint32_t segments,
+                          uint32_t length) const;
+
+  // first level, later levels (DOT continues as SUM), strided axes
+  engine::Kernel m_first;
+  engine::Kernel m_partials;
+  engine::Kernel m_axis;
+  ReduceOp m_op = ReduceOp::SUM;
+  bool m_subgroups = false;
+  uint32_t m_maxGroupsX = 65535;
+  uint32_t m_maxGroupsY = 65535;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
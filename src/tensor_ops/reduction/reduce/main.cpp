@@ -0,0 +1,130 @@
+#include "reduce.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters for the reductions
+  const uint32_t N = 1000003; // not a multiple of anything
+  const uint32_t rows = 37;
+  const uint32_t cols = 5000;
+
+  Engine engine("vk_reduce");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  std::vector<float> x(N);
+  std::vector<float> y(N);
+  for (uint32_t i = 0; i < N; i++) {
+    x[i] = float((i * 37) % 101) - 50.0f;
+    y[i] = float(i % 3);
+  }
+  x[N / 3] = -1000.0f; // the argmin
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  Buffer bufX =
+      engine.createBuffer(N * sizeof(float), usage, MEM_GPU_ONLY).getValue();
+  Buffer bufY =
+      engine.createBuffer(N * sizeof(float), usage, MEM_GPU_ONLY).getValue();
+  Buffer out = engine.createBuffer(rows * sizeof(ReducePair), usage,
+                                   MEM_GPU_ONLY)
+                   .getValue();
+  const VkDeviceSize scratchBytes =
+      std::max(Reduction::scratchSize(N),
+               Reduction::scratchSize(rows, cols, 1));
+  Buffer scratch = engine
+                       .createBuffer(std::max<VkDeviceSize>(scratchBytes, 16),
+                                     usage, MEM_GPU_ONLY)
+                       .getValue();
+
+  CommandStream stream(engine);
+  stream.upload(bufX, x.data(), bufX._size);
+  stream.upload(bufY, y.data(), bufY._size);
+
+  // --- Whole buffer, every op, values are small integers so sums are exact
+  double sum = 0.0;
+  double dot = 0.0;
+  for (uint32_t i = 0; i < N; i++) {
+    sum += x[i];
+    dot += double(x[i]) * y[i];
+  }
+  const float minimum = *std::min_element(x.begin(), x.end());
+  const float maximum = *std::max_element(x.begin(), x.end());
+
+  struct Check {
+    ReduceOp _op;
+    const char *_name;
+    double _expected;
+  };
+  bool ok = true;
+  for (const Check &check :
+       {Check{ReduceOp::SUM, "sum", sum}, Check{ReduceOp::MIN, "min", minimum},
+        Check{ReduceOp::MAX, "max", maximum},
+        Check{ReduceOp::ARGMIN, "argmin", minimum},
+        Check{ReduceOp::DOT, "dot", dot}}) {
+    auto reduction = Reduction::create(engine, check._op);
+    if (!reduction.isValid()) {
+      std::cerr << "Reduction::create failed: " << reduction.getError()
+                << "\n";
+      return 1;
+    }
+    ReducePair result{};
+    auto r = reduction.getValue().record(stream, bufX, bufY, out, scratch, N);
+    stream.readback(out, &result, sizeof(result));
+    if (r == VK_SUCCESS) {
+      r = stream.submit();
+    }
+    if (r != VK_SUCCESS) {
+      std::cerr << check._name << " failed: " << r << "\n";
+      return 1;
+    }
+    bool match = result._value == float(check._expected);
+    if (check._op == ReduceOp::ARGMIN) {
+      match &= result._index == N / 3;
+    }
+    std::cout << "  " << check._name << " = " << result._value
+              << (check._op == ReduceOp::ARGMIN
+                      ? " at " + std::to_string(result._index)
+                      : "")
+              << (reduction.getValue().usesSubgroups() ? " (subgroup)" : "")
+              << "\n";
+    ok &= match;
+  }
+
+  // --- Row maxima of a rows x cols matrix, the first rows * cols of x
+  auto rowMax = Reduction::create(engine, ReduceOp::MAX).getValue();
+  std::vector<ReducePair> perRow(rows);
+  rowMax.recordAxis(stream, bufX, out, scratch, rows, cols, 1);
+  stream.readback(out, perRow.data(), rows * sizeof(ReducePair));
+  if (stream.submit() != VK_SUCCESS) {
+    std::cerr << "row reduction failed\n";
+    return 1;
+  }
+  for (uint32_t r = 0; r < rows; r++) {
+    float expected = *std::max_element(x.begin() + r * cols,
+                                       x.begin() + (r + 1) * cols);
+    ok &= perRow[r]._value == expected;
+  }
+
+  engine.destroyBuffer(bufX);
+  engine.destroyBuffer(bufY);
+  engine.destroyBuffer(out);
+  engine.destroyBuffer(scratch);
+  if (!ok) {
+    std::cerr << "Mismatch in a reduction\n";
+    return 1;
+  }
+  std::cout << "OK: reductions match.\n";
+  return 0;
+}
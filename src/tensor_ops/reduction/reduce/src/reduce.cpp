@@ -0,0 +1,207 @@
+#include "../include/reduce.hpp"
+
+#include <algorithm>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of reduce.comp
+struct SegmentPC {
+  uint32_t length;
+  uint32_t inOffset;
+  uint32_t outOffset;
+  uint32_t fromInput;
+  uint32_t segments;
+};
+
+// matches the push constant block of reduce_axis.comp
+struct AxisPC {
+  uint32_t outer;
+  uint32_t axis;
+  uint32_t inner;
+};
+
+constexpr uint32_t kThreads = 256;
+// elements a thread folds in registers before any group wide step
+constexpr uint32_t kCoarsen = 16;
+// work groups per level across all segments, enough to fill the GPU
+constexpr uint64_t kTargetGroups = 1024;
+
+} // namespace
+
+Result<Reduction> Reduction::create(Engine &engine, ReduceOp op,
+                                    bool allowSubgroups) {
+  const VkSubgroupFeatureFlags needed =
+      VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+  // the cross-subgroup step keeps at most 64 partials in shared memory
+  const bool subgroups = allowSubgroups &&
+                         (engine.subgroupFeatures() & needed) == needed &&
+                         engine.subgroupSize() >= kThreads / 64;
+
+  const KernelSignature signature{
+      {STORAGE_READ, STORAGE_READ, STORAGE_READ, STORAGE_WRITE},
+      sizeof(SegmentPC)};
+  const char *path = subgroups ? "reduce_subgroup.spv" : "reduce.spv";
+
+  Specialization firstSpec;
+  firstSpec.set(0, kThreads).set(1, static_cast<uint32_t>(op));
+  auto first = engine.createKernel(path, signature, firstSpec);
+  if (!first.isValid()) {
+    return {first.getError()};
+  }
+  // partials of a dot product are summed
+  ReduceOp partialOp = op == ReduceOp::DOT ? ReduceOp::SUM : op;
+  Specialization partialSpec;
+  partialSpec.set(0, kThreads).set(1, static_cast<uint32_t>(partialOp));
+  auto partials = engine.createKernel(path, signature, partialSpec);
+  if (!partials.isValid()) {
+    return {partials.getError()};
+  }
+
+  const KernelSignature axisSignature{
+      {STORAGE_READ, STORAGE_READ, STORAGE_WRITE}, sizeof(AxisPC)};
+  Specialization axisSpec;
+  axisSpec.set(0, static_cast<uint32_t>(op));
+  auto axis = engine.createKernel("reduce_axis.spv", axisSignature, axisSpec);
+  if (!axis.isValid()) {
+    return {axis.getError()};
+  }
+
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+
+  Reduction reduction;
+  reduction.m_first = first.getValue();
+  reduction.m_partials = partials.getValue();
+  reduction.m_axis = axis.getValue();
+  reduction.m_op = op;
+  reduction.m_subgroups = subgroups;
+  reduction.m_maxGroupsX = engine.maxGroupsX();
+  reduction.m_maxGroupsY = props.limits.maxComputeWorkGroupCount[1];
+  return {reduction};
+}
+
+std::vector<uint32_t> Reduction::levels(uint64_t segments, uint64_t length) {
+  std::vector<uint32_t> groups;
+  const uint64_t perSegment =
+      std::max<uint64_t>(1, kTargetGroups / std::max<uint64_t>(1, segments));
+  do {
+    uint64_t count = std::min<uint64_t>(
+        groupCount(length, kThreads * kCoarsen), perSegment);
+    count = std::max<uint64_t>(count, 1);
+    groups.push_back(static_cast<uint32_t>(count));
+    length = count;
+  } while (length > 1);
+  return groups;
+}
+
+VkDeviceSize Reduction::scratchSize(uint64_t count) {
+  return scratchSize(1, static_cast<uint32_t>(count), 1);
+}
+
+VkDeviceSize Reduction::scratchSize(uint32_t outer, uint32_t axis,
+                                    uint32_t inner) {
+  if (inner > 1) {
+    return 0;
+  }
+  // levels ping-pong between two regions, sized by the first two levels
+  auto groups = levels(outer, axis);
+  uint64_t pairs = 0;
+  if (groups.size() > 1) {
+    pairs += groups[0];
+  }
+  if (groups.size() > 2) {
+    pairs += groups[1];
+  }
+  return VkDeviceSize(pairs) * outer * sizeof(ReducePair);
+}
+
+VkResult Reduction::record(CommandStream &stream, const Buffer &x,
+                           const Buffer &y, const Buffer &out,
+                           const Buffer &scratch, uint64_t count) const {
+  if (count > UINT32_MAX) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  return recordSegments(stream, x, y, out, scratch, 1,
+                        static_cast<uint32_t>(count));
+}
+
+VkResult Reduction::recordAxis(CommandStream &stream, const Buffer &x,
+                               const Buffer &y, const Buffer &out,
+                               const Buffer &scratch, uint32_t outer,
+                               uint32_t axis, uint32_t inner) const {
+  if (inner <= 1) {
+    return recordSegments(stream, x, y, out, scratch, outer, axis);
+  }
+
+  const uint64_t outputs = uint64_t(outer) * inner;
+  const uint64_t elements = outputs * axis;
+  const uint32_t operands = m_op == ReduceOp::DOT ? 2 : 1;
+  if (elements > UINT32_MAX ||
+      x._size < elements * sizeof(float) ||
+      (operands == 2 && y._size < elements * sizeof(float)) ||
+      out._size < outputs * sizeof(ReducePair)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  stream.dispatch(m_axis, {x, y, out}, AxisPC{outer, axis, inner},
+                  spread(outputs, kThreads, m_maxGroupsX),
+                  {elements * sizeof(float) * operands +
+                       outputs * sizeof(ReducePair),
+                   elements * operands});
+  return stream.getState();
+}
+
+VkResult Reduction::recordSegments(CommandStream &stream, const Buffer &x,
+                                   const Buffer &y, const Buffer &out,
+                                   const Buffer &scratch, uint32_t segments,
+                                   uint32_t length) const {
+  const uint64_t elements = uint64_t(segments) * length;
+  const uint32_t operands = m_op == ReduceOp::DOT ? 2 : 1;
+  if (segments == 0 || elements > UINT32_MAX ||
+      x._size < elements * sizeof(float) ||
+      (operands == 2 && y._size < elements * sizeof(float)) ||
+      out._size < VkDeviceSize(segments) * sizeof(ReducePair)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const VkDeviceSize needed = scratchSize(segments, length, 1);
+  if (scratch._size < needed) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  // segments are spread over y and z, groups of one segment along x
+  const uint32_t gridY = std::min(segments, m_maxGroupsY);
+  const uint32_t gridZ = groupCount(segments, gridY);
+
+  auto groups = levels(segments, length);
+  const uint32_t regions[2] = {0, segments * groups[0]};
+  uint32_t inOffset = 0;
+  uint32_t levelLength = length;
+  for (size_t level = 0; level < groups.size(); level++) {
+    const bool last = level + 1 == groups.size();
+    const uint32_t outOffset = last ? 0 : regions[level % 2];
+    const Buffer &dst = last ? out : scratch;
+    // when everything fits one level the scratch binding is never read
+    const Buffer &partials = needed ? scratch : out;
+    const SegmentPC pc{levelLength, inOffset, outOffset, level == 0,
+                       segments};
+    const uint64_t pairsOut = uint64_t(segments) * groups[level];
+    const Cost cost =
+        level == 0 ? Cost{elements * sizeof(float) * operands +
+                              pairsOut * sizeof(ReducePair),
+                          elements * operands}
+                   : Cost{(uint64_t(segments) * levelLength + pairsOut) *
+                              sizeof(ReducePair),
+                          uint64_t(segments) * levelLength};
+    stream.dispatch(level == 0 ? m_first : m_partials,
+                    {x, y, partials, dst}, pc,
+                    {groups[level], gridY, gridZ}, cost);
+    inOffset = outOffset;
+    levelLength = groups[level];
+  }
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
@@ -0,0 +1,74 @@
+#ifndef MELKIOR_SCAN_HPP
+#define MELKIOR_SCAN_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+enum class ScanType : uint8_t { UINT32, FLOAT32 };
+
+// AUTO picks LOOKBACK unless the device is known not to guarantee forward
+// progress between work groups (V3D, CPU implementations);
+// $MELKIOR_SCAN_FALLBACK forces REDUCE_THEN_SCAN everywhere.
+enum class ScanAlgorithm : uint8_t { AUTO, LOOKBACK, REDUCE_THEN_SCAN };
+
+// Inclusive, exclusive and segmented prefix sums over engine buffers.
+//
+// LOOKBACK is a single pass with decoupled look-back: the input is read
+// once and written once. REDUCE_THEN_SCAN reads it twice (tile aggregates,
+// then the scan with carries) plus a scan of the aggregates, recursively,
+// but never has a work group wait for another.
+//
+// Segmented scans take one uint per element, non-zero where a segment
+// starts; an exclusive segmented scan is 0 at every segment head.
+//
+//   auto scan = Scan::create(engine).getValue();
+//   scan.record(stream, counts, offsets, scratch, n, true); // exclusive
+class Scan {
+public:
+  static engine::Result<Scan>
+  create(engine::Engine &engine, ScanType type = ScanType::UINT32,
+         ScanAlgorithm algorithm = ScanAlgorithm::AUTO);
+
+  // bytes of scratch a scan of count elements needs
+  VkDeviceSize scratchSize(uint64_t count) const;
+
+  // input and output may be the same buffer
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &input,
+                  const engine::Buffer &output, const engine::Buffer &scratch,
+                  uint64_t count, bool exclusive = false) const;
+  VkResult recordSegmented(engine::CommandStream &stream,
+                           const engine::Buffer &input,
+                           const engine::Buffer &heads,
+                           const engine::Buffer &output,
+                           const engine::Buffer &scratch, uint64_t count,
+                           bool exclusive = false) const;
+
+  ScanType type() const { return m_type; }
+  bool usesLookback() const { return m_lookback; }
+  uint32_t tileSize() const { return m_tileSize; }
+
+private:
+  VkResult recordScan(engine::CommandStream &stream,
+                      const engine::Buffer &input, const engine::Buffer &heads,
+                      const engine::Buffer &output,
+                      const engine::Buffer &scratch, uint64_t count,
+                      uint32_t mode) const;
+  // tiles of every reduce-then-scan level, down to a single tile
+  std::vector<uint32_t> levels(uint64_t count) const;
+
+  engine::Kernel m_kernel;
+  ScanType m_type = ScanType::UINT32;
+  bool m_lookback = false;
+  uint32_t m_tileSize = 1024;
+  uint32_t m_maxGroupsX = 65535;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
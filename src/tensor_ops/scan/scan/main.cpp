@@ -0,0 +1,101 @@
+#include "scan.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters for the scans, several levels of reduce-then-scan
+  const uint32_t N = 3000017;
+
+  Engine engine("vk_scan");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  std::vector<uint32_t> values(N);
+  std::vector<uint32_t> heads(N, 0);
+  for (uint32_t i = 0; i < N; i++) {
+    values[i] = (i * 7) % 5;
+    heads[i] = (i % 1237) == 0 || (i % 100003) == 17 ? 1 : 0;
+  }
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const VkDeviceSize bytes = VkDeviceSize(N) * sizeof(uint32_t);
+  Buffer in = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer flags = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer out = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+
+  CommandStream stream(engine);
+  stream.upload(in, values.data(), bytes);
+  stream.upload(flags, heads.data(), bytes);
+
+  bool ok = true;
+  std::vector<uint32_t> result(N);
+  for (ScanAlgorithm algorithm :
+       {ScanAlgorithm::AUTO, ScanAlgorithm::REDUCE_THEN_SCAN}) {
+    auto scanResult = Scan::create(engine, ScanType::UINT32, algorithm);
+    if (!scanResult.isValid()) {
+      std::cerr << "Scan::create failed: " << scanResult.getError() << "\n";
+      return 1;
+    }
+    Scan scan = scanResult.getValue();
+    Buffer scratch =
+        engine.createBuffer(scan.scratchSize(N), usage, MEM_GPU_ONLY)
+            .getValue();
+
+    // inclusive, exclusive, segmented inclusive, segmented exclusive
+    for (int variant = 0; variant < 4; variant++) {
+      const bool exclusive = variant & 1;
+      const bool segmented = variant & 2;
+      VkResult r = segmented ? scan.recordSegmented(stream, in, flags, out,
+                                                    scratch, N, exclusive)
+                             : scan.record(stream, in, out, scratch, N,
+                                           exclusive);
+      stream.readback(out, result.data(), bytes);
+      if (r == VK_SUCCESS) {
+        r = stream.submit();
+      }
+      if (r != VK_SUCCESS) {
+        std::cerr << "scan failed: " << r << "\n";
+        return 1;
+      }
+
+      uint32_t sum = 0;
+      bool match = true;
+      for (uint32_t i = 0; i < N && match; i++) {
+        if (segmented && heads[i]) {
+          sum = 0;
+        }
+        uint32_t inclusive = sum + values[i];
+        match = result[i] == (exclusive ? sum : inclusive);
+        if (!match) {
+          std::cerr << "Mismatch at " << i << ": got " << result[i] << "\n";
+        }
+        sum = inclusive;
+      }
+      std::cout << "  " << (scan.usesLookback() ? "look-back " : "reduce-scan ")
+                << (segmented ? "segmented " : "")
+                << (exclusive ? "exclusive" : "inclusive")
+                << (match ? " OK" : " FAILED") << "\n";
+      ok &= match;
+    }
+    engine.destroyBuffer(scratch);
+  }
+
+  engine.destroyBuffer(in);
+  engine.destroyBuffer(flags);
+  engine.destroyBuffer(out);
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "OK: scans match.\n";
+  return 0;
+}
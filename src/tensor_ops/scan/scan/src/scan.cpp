@@ -0,0 +1,203 @@
+#include "../include/scan.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of scan.comp
+struct PushConstants {
+  uint32_t count;
+  uint32_t phase;
+  uint32_t mode;
+  uint32_t tiles;
+  uint32_t srcOffset;
+  uint32_t dstOffset;
+  uint32_t headOffset;
+  uint32_t stateOffset;
+};
+
+constexpr uint32_t PHASE_LOOKBACK = 0;
+constexpr uint32_t PHASE_REDUCE = 1;
+constexpr uint32_t PHASE_CARRY = 2;
+
+constexpr uint32_t MODE_EXCLUSIVE = 1;
+constexpr uint32_t MODE_SEGMENTED = 2;
+constexpr uint32_t MODE_NO_RESET = 4;
+constexpr uint32_t MODE_HAS_CARRY = 8;
+
+constexpr uint32_t kThreads = 256;
+constexpr uint32_t kVendorBroadcom = 0x14E4;
+
+bool forwardProgress(const VkPhysicalDeviceProperties &props) {
+  if (std::getenv("MELKIOR_SCAN_FALLBACK")) {
+    return false;
+  }
+  return props.vendorID != kVendorBroadcom &&
+         props.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU;
+}
+
+} // namespace
+
+Result<Scan> Scan::create(Engine &engine, ScanType type,
+                          ScanAlgorithm algorithm) {
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+
+  // a tile and its head flags live in shared memory next to the totals
+  uint32_t items = 8;
+  while (items > 1 && (2 * items + 2) * kThreads * sizeof(uint32_t) >
+                          props.limits.maxComputeSharedMemorySize) {
+    items /= 2;
+  }
+
+  const KernelSignature signature{
+      {STORAGE_READ, STORAGE_WRITE, STORAGE_READ, STORAGE_READ_WRITE},
+      sizeof(PushConstants)};
+  Specialization spec;
+  spec.set(0, kThreads).set(1, items);
+  auto kernel = engine.createKernel(
+      type == ScanType::FLOAT32 ? "scan_f32.spv" : "scan_u32.spv", signature,
+      spec);
+  if (!kernel.isValid()) {
+    return {kernel.getError()};
+  }
+
+  Scan scan;
+  scan.m_kernel = kernel.getValue();
+  scan.m_type = type;
+  scan.m_lookback =
+      algorithm == ScanAlgorithm::LOOKBACK ||
+      (algorithm == ScanAlgorithm::AUTO && forwardProgress(props));
+  scan.m_tileSize = kThreads * items;
+  scan.m_maxGroupsX = engine.maxGroupsX();
+  return {scan};
+}
+
+std::vector<uint32_t> Scan::levels(uint64_t count) const {
+  std::vector<uint32_t> tiles;
+  do {
+    uint32_t t = std::max(1u, groupCount(count, m_tileSize));
+    tiles.push_back(t);
+    count = t;
+  } while (count > 1);
+  return tiles;
+}
+
+VkDeviceSize Scan::scratchSize(uint64_t count) const {
+  uint64_t words = 0;
+  if (m_lookback) {
+    // counter, then status, aggregate and inclusive prefix per tile
+    words = 1 + 3 * uint64_t(groupCount(count, m_tileSize));
+  } else {
+    // aggregate and head flag per tile of every level but the last
+    auto tiles = levels(count);
+    for (size_t i = 0; i + 1 < tiles.size(); i++) {
+      words += 2 * uint64_t(tiles[i]);
+    }
+  }
+  return std::max<uint64_t>(words, 1) * sizeof(uint32_t);
+}
+
+VkResult Scan::record(CommandStream &stream, const Buffer &input,
+                      const Buffer &output, const Buffer &scratch,
+                      uint64_t count, bool exclusive) const {
+  // unsegmented: the head binding is never read
+  return recordScan(stream, input, input, output, scratch, count,
+                    exclusive ? MODE_EXCLUSIVE : 0);
+}
+
+VkResult Scan::recordSegmented(CommandStream &stream, const Buffer &input,
+                               const Buffer &heads, const Buffer &output,
+                               const Buffer &scratch, uint64_t count,
+                               bool exclusive) const {
+  if (heads._size < count * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  return recordScan(stream, input, heads, output, scratch, count,
+                    MODE_SEGMENTED | (exclusive ? MODE_EXCLUSIVE : 0));
+}
+
+VkResult Scan::recordScan(CommandStream &stream, const Buffer &input,
+                          const Buffer &heads, const Buffer &output,
+                          const Buffer &scratch, uint64_t count,
+                          uint32_t mode) const {
+  const VkDeviceSize bytes = count * sizeof(uint32_t);
+  if (count > UINT32_MAX || input._size < bytes || output._size < bytes ||
+      scratch._size < scratchSize(count)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  if (count == 0) {
+    return stream.getState();
+  }
+  const uint32_t n = static_cast<uint32_t>(count);
+  const bool segmented = (mode & MODE_SEGMENTED) != 0;
+  const uint64_t headBytes = segmented ? bytes : 0;
+
+  if (m_lookback) {
+    const uint32_t tiles = groupCount(n, m_tileSize);
+    // the tile counter and every status start out as 0
+    stream.fill(scratch, 0, 0, (1 + VkDeviceSize(tiles)) * sizeof(uint32_t));
+    const PushConstants pc{n, PHASE_LOOKBACK, mode, tiles, 0, 0, 0, 0};
+    stream.dispatch(m_kernel, {input, output, heads, scratch}, pc,
+                    spread(tiles, 1, m_maxGroupsX),
+                    {2 * bytes + headBytes, count});
+    return stream.getState();
+  }
+
+  // Reduce every level down to a single tile, scan that, then walk back
+  // up scanning each level with the carries of the level above. Level i > 0
+  // scans the aggregates of level i - 1 in place in the scratch buffer.
+  auto tiles = levels(count);
+  std::vector<uint32_t> offsets(tiles.size(), 0);
+  for (size_t i = 1; i < tiles.size(); i++) {
+    offsets[i] = offsets[i - 1] + 2 * tiles[i - 1];
+  }
+  auto levelCount = [&](size_t level) {
+    return level == 0 ? n : tiles[level - 1];
+  };
+  auto levelMode = [&](size_t level) {
+    // aggregates need the carry into their tile, heads don't reset it
+    return level == 0 ? mode
+                      : MODE_EXCLUSIVE | MODE_NO_RESET |
+                            (mode & MODE_SEGMENTED);
+  };
+  auto dispatch = [&](size_t level, uint32_t phase, uint32_t levelFlags) {
+    // level 0 reads the caller's buffers, later ones the previous level's
+    // aggregates and heads
+    const bool top = level == 0;
+    const uint32_t in = top ? 0 : offsets[level - 1];
+    const PushConstants pc{levelCount(level),
+                           phase,
+                           levelFlags,
+                           tiles[level],
+                           in,
+                           in,
+                           top ? 0 : in + tiles[level - 1],
+                           offsets[level]};
+    const uint64_t elements = levelCount(level);
+    const Cost cost{elements * sizeof(uint32_t) *
+                        (phase == PHASE_REDUCE ? 1 : 2),
+                    elements};
+    stream.dispatch(m_kernel,
+                    {top ? input : scratch, top ? output : scratch,
+                     top ? heads : scratch, scratch},
+                    pc, spread(tiles[level], 1, m_maxGroupsX), cost);
+  };
+
+  const size_t last = tiles.size() - 1;
+  for (size_t level = 0; level < last; level++) {
+    dispatch(level, PHASE_REDUCE, levelMode(level));
+  }
+  for (size_t level = last + 1; level-- > 0;) {
+    dispatch(level, PHASE_CARRY,
+             levelMode(level) | (level < last ? MODE_HAS_CARRY : 0));
+  }
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
@@ -0,0 +1,105 @@
+#ifndef MELKIOR_FFT_HPP
+#define MELKIOR_FFT_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+// FORWARD uses exp(-2 pi i nk / N); INVERSE is not normalized, a forward
+// and inverse round trip scales by N
+enum class FftDirection : uint8_t { FORWARD, INVERSE };
+
+// A batch of complex fp32 FFTs of one power-of-two size, as interleaved
+// (re, im) pairs with one transform after the other. Plans come from
+// Fft::plan() and are cheap handles.
+//
+// Sizes whose transform fits maxComputeSharedMemorySize run in a single
+// dispatch, several transforms per work group, entirely in shared memory.
+// Larger sizes take one Stockham pass per radix over global memory,
+// ping-ponging between the output and scratch. Neither needs a bit-reversal
+// pass.
+class FftPlan {
+public:
+  // bytes of scratch record() needs, 0 for single dispatch plans
+  VkDeviceSize scratchSize() const;
+
+  // input and output may be the same buffer; in place multi-pass plans with
+  // an odd pass count end with a copy, which needs transfer usage
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &input,
+                  const engine::Buffer &output,
+                  const engine::Buffer &scratch = {}) const;
+
+  uint32_t size() const { return m_size; }
+  uint32_t batch() const { return m_batch; }
+  FftDirection direction() const { return m_direction; }
+  bool singleDispatch() const { return m_radices.empty(); }
+  // radices of the global passes, empty for single dispatch plans
+  const std::vector<uint32_t> &radices() const { return m_radices; }
+  // 5 N log2(N) per transform, the usual FFT operation count
+  double flops() const;
+
+private:
+  friend class Fft;
+
+  // one kernel and grid per dispatch
+  std::vector<engine::Kernel> m_kernels;
+  std::vector<engine::WorkGroups> m_groups;
+  std::vector<uint32_t> m_radices;
+  engine::Buffer m_twiddles;
+  uint32_t m_size = 0;
+  uint32_t m_batch = 0;
+  FftDirection m_direction = FftDirection::FORWARD;
+};
+
+// Creates FFT plans and caches them per (size, batch, direction, radix),
+// together with one twiddle table per size, computed in double precision.
+// Copies share the caches, so a plan made through one is found by all of
+// them; destroy() on any copy frees the tables for every copy and
+// invalidates every plan handed out.
+//
+//   auto fft = Fft::create(engine).getValue();
+//   auto plan = fft.plan(1024, 4096, FftDirection::FORWARD).getValue();
+//   plan.record(stream, signal, spectrum);
+//   stream.submit();
+//   fft.destroy();
+class Fft {
+public:
+  static engine::Result<Fft> create(engine::Engine &engine);
+
+  // size a power of two >= 2, radix 2, 4 or 8: the largest radix a pass
+  // may use
+  engine::Result<FftPlan> plan(uint32_t size, uint32_t batch,
+                               FftDirection direction, uint32_t radix = 8);
+  void destroy();
+
+  // largest size a single dispatch plan can use on this device
+  uint32_t maxSharedSize(uint32_t radix = 8) const;
+
+private:
+  using PlanKey = std::tuple<uint32_t, uint32_t, FftDirection, uint32_t>;
+
+  struct State {
+    std::map<uint32_t, engine::Buffer> _twiddles;
+    std::map<PlanKey, FftPlan> _plans;
+  };
+
+  engine::Result<engine::Buffer> twiddles(uint32_t size);
+
+  engine::Engine *m_engine = nullptr;
+  uint32_t m_maxSharedBytes = 16384;
+  uint32_t m_maxInvocations = 256;
+  uint32_t m_maxGroupsX = 65535;
+  std::shared_ptr<State> m_state;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
@@ -0,0 +1,120 @@
+#include "fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters: a single dispatch size and a multi-pass one
+  const uint32_t sizes[] = {1024, 1u << 16};
+  const uint32_t batch = 3;
+
+  Engine engine("vk_fft");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+  auto fftResult = Fft::create(engine);
+  if (!fftResult.isValid()) {
+    std::cerr << "Fft::create failed: " << fftResult.getError() << "\n";
+    return 1;
+  }
+  Fft fft = fftResult.getValue();
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  CommandStream stream(engine);
+  bool ok = true;
+
+  for (uint32_t n : sizes) {
+    auto forward = fft.plan(n, batch, FftDirection::FORWARD);
+    auto inverse = fft.plan(n, batch, FftDirection::INVERSE);
+    if (!forward.isValid() || !inverse.isValid()) {
+      std::cerr << "Fft::plan failed\n";
+      return 1;
+    }
+
+    std::vector<std::complex<float>> signal(size_t(n) * batch);
+    for (auto &x : signal) {
+      x = {dist(rng), dist(rng)};
+    }
+    const VkDeviceSize bytes = signal.size() * sizeof(signal[0]);
+    Buffer data = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer spectrum =
+        engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    Buffer scratch =
+        engine
+            .createBuffer(std::max<VkDeviceSize>(
+                              forward.getValue().scratchSize(), 4),
+                          usage, MEM_GPU_ONLY)
+            .getValue();
+
+    // forward out of place, inverse in place
+    std::vector<std::complex<float>> result(signal.size());
+    std::vector<std::complex<float>> roundTrip(signal.size());
+    stream.upload(data, signal.data(), bytes);
+    VkResult r = forward.getValue().record(stream, data, spectrum, scratch);
+    stream.readback(spectrum, result.data(), bytes);
+    if (r == VK_SUCCESS) {
+      r = inverse.getValue().record(stream, spectrum, spectrum, scratch);
+    }
+    stream.readback(spectrum, roundTrip.data(), bytes);
+    if (r == VK_SUCCESS) {
+      r = stream.submit();
+    }
+    if (r != VK_SUCCESS) {
+      std::cerr << "fft failed: " << r << "\n";
+      return 1;
+    }
+
+    // double precision DFT of the last transform, at a few bins
+    const auto *x = signal.data() + size_t(n) * (batch - 1);
+    const auto *y = result.data() + size_t(n) * (batch - 1);
+    double maxError = 0.0;
+    for (uint32_t k = 0; k < n; k += n / 16 + 1) {
+      std::complex<double> sum = 0.0;
+      for (uint32_t i = 0; i < n; i++) {
+        double angle = -2.0 * 3.14159265358979323846 * (uint64_t(i) * k % n) /
+                       n;
+        sum += std::complex<double>(x[i]) *
+               std::complex<double>(std::cos(angle), std::sin(angle));
+      }
+      maxError = std::max(
+          maxError, std::abs(std::complex<double>(y[k]) - sum) / std::sqrt(n));
+    }
+    double roundTripError = 0.0;
+    for (size_t i = 0; i < signal.size(); i++) {
+      roundTripError = std::max<double>(
+          roundTripError, std::abs(roundTrip[i] / float(n) - signal[i]));
+    }
+    bool match = maxError < 1e-4 && roundTripError < 1e-4;
+    std::cout << "  " << n << " x " << batch
+              << (forward.getValue().singleDispatch() ? " single dispatch"
+                                                      : " multi-pass")
+              << ": dft error " << maxError << ", round trip error "
+              << roundTripError << (match ? " OK" : " FAILED") << "\n";
+    ok &= match;
+
+    engine.destroyBuffer(data);
+    engine.destroyBuffer(spectrum);
+    engine.destroyBuffer(scratch);
+  }
+
+  fft.destroy();
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "OK: FFTs match.\n";
+  return 0;
+}
@@ -0,0 +1,56 @@
+// Complex helpers and the radix 2/4/8 butterflies of the FFT kernels.
+// Expects SIGN, -1.0 for forward and 1.0 for inverse transforms.
+
+vec2 cmul(vec2 a, vec2 b) {
+    return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+// a * SIGN * i
+vec2 rotate(vec2 a) {
+    return SIGN * vec2(-a.y, a.x);
+}
+
+void fft2(inout vec2 a, inout vec2 b) {
+    vec2 t = a;
+    a = t + b;
+    b = t - b;
+}
+
+// 4-point DFT in place, outputs in natural order
+void fft4(inout vec2 v0, inout vec2 v1, inout vec2 v2, inout vec2 v3) {
+    fft2(v0, v2);
+    fft2(v1, v3);
+    v3 = rotate(v3);
+    fft2(v0, v1);
+    fft2(v2, v3);
+    // v0..v3 hold X0, X2, X1, X3
+    vec2 t = v1;
+    v1 = v2;
+    v2 = t;
+}
+
+// 8-point DFT in place: two 4-point DFTs of the even and odd inputs, then
+// one radix-2 step with the 8th roots of unity
+void fft8(inout vec2 v0, inout vec2 v1, inout vec2 v2, inout vec2 v3,
+          inout vec2 v4, inout vec2 v5, inout vec2 v6, inout vec2 v7) {
+    const float R2 = 0.70710678118654752;
+    fft4(v0, v2, v4, v6);
+    fft4(v1, v3, v5, v7);
+    v3 = cmul(v3, vec2(R2, SIGN * R2));
+    v5 = rotate(v5);
+    v7 = cmul(v7, vec2(-R2, SIGN * R2));
+    fft2(v0, v1);
+    fft2(v2, v3);
+    fft2(v4, v5);
+    fft2(v6, v7);
+    // v0..v7 hold X0, X4, X1, X5, X2, X6, X3, X7
+    vec2 t1 = v1;
+    vec2 t3 = v3;
+    vec2 t5 = v5;
+    v1 = v2;
+    v2 = v4;
+    v3 = v6;
+    v4 = t1;
+    v5 = t3;
+    v6 = t5;
+}
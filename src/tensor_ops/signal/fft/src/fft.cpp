@@ -0,0 +1,226 @@
+#include "../include/fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of fft_shared.comp
+struct SharedPushConstants {
+  uint32_t batch;
+};
+
+// matches the push constant block of fft_pass.comp
+struct PassPushConstants {
+  uint32_t n;
+  uint32_t ns;
+  uint32_t batch;
+};
+
+constexpr uint32_t kPassThreads = 256;
+// threads a single dispatch work group aims for
+constexpr uint32_t kSharedThreads = 256;
+constexpr uint32_t kComplexBytes = 2 * sizeof(float);
+constexpr double kPi = 3.14159265358979323846;
+
+const KernelSignature kSignature{{STORAGE_READ, STORAGE_READ, STORAGE_WRITE},
+                                 sizeof(PassPushConstants)};
+
+bool isPowerOfTwo(uint32_t n) { return n != 0 && (n & (n - 1)) == 0; }
+
+uint32_t log2(uint32_t n) {
+  uint32_t bits = 0;
+  while ((1u << bits) < n) {
+    bits++;
+  }
+  return bits;
+}
+
+} // namespace
+
+VkDeviceSize FftPlan::scratchSize() const {
+  return singleDispatch() ? 0
+                          : VkDeviceSize(m_size) * m_batch * kComplexBytes;
+}
+
+double FftPlan::flops() const {
+  return 5.0 * m_size * log2(m_size) * m_batch;
+}
+
+VkResult FftPlan::record(CommandStream &stream, const Buffer &input,
+                         const Buffer &output, const Buffer &scratch) const {
+  const VkDeviceSize bytes = VkDeviceSize(m_size) * m_batch * kComplexBytes;
+  if (m_kernels.empty() || input._size < bytes || output._size < bytes) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (singleDispatch()) {
+    stream.dispatch(m_kernels[0], {m_twiddles, input, output},
+                    SharedPushConstants{m_batch}, m_groups[0],
+                    {2 * bytes, static_cast<uint64_t>(flops())});
+    return stream.getState();
+  }
+
+  if (scratch._size < bytes) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  // out of place the parity is chosen so the last pass writes output; in
+  // place the first pass must not, it would overwrite its own input
+  const bool inPlace = input._id == output._id;
+  const size_t passes = m_radices.size();
+  const Buffer *src = &input;
+  uint32_t ns = 1;
+  for (size_t i = 0; i < passes; i++) {
+    const bool toOutput = inPlace ? i % 2 == 1 : (passes - 1 - i) % 2 == 0;
+    const Buffer *dst = toOutput ? &output : &scratch;
+    stream.dispatch(m_kernels[i], {m_twiddles, *src, *dst},
+                    PassPushConstants{m_size, ns, m_batch}, m_groups[i],
+                    {2 * bytes, static_cast<uint64_t>(flops() / passes)});
+    src = dst;
+    ns *= m_radices[i];
+  }
+  if (src != &output) {
+    stream.copy(scratch, output, bytes);
+  }
+  return stream.getState();
+}
+
+Result<Fft> Fft::create(Engine &engine) {
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+
+  Fft fft;
+  fft.m_engine = &engine;
+  fft.m_state = std::make_shared<State>();
+  fft.m_maxSharedBytes = props.limits.maxComputeSharedMemorySize;
+  fft.m_maxInvocations = props.limits.maxComputeWorkGroupInvocations;
+  fft.m_maxGroupsX = engine.maxGroupsX();
+  return {fft};
+}
+
+uint32_t Fft::maxSharedSize(uint32_t radix) const {
+  uint32_t size = 0;
+  for (uint32_t n = 2; n != 0 && n * kComplexBytes <= m_maxSharedBytes;
+       n *= 2) {
+    if (n / std::min(radix, n) <= m_maxInvocations) {
+      size = n;
+    }
+  }
+  return size;
+}
+
+Result<Buffer> Fft::twiddles(uint32_t size) {
+  auto &cache = m_state->_twiddles;
+  auto found = cache.find(size);
+  if (found != cache.end()) {
+    return {found->second};
+  }
+
+  // computed in double, fp32 sin/cos on the device would cost accuracy
+  std::vector<float> table(2 * size);
+  for (uint32_t k = 0; k < size; k++) {
+    const double angle = 2.0 * kPi * k / size;
+    table[2 * k] = static_cast<float>(std::cos(angle));
+    table[2 * k + 1] = static_cast<float>(std::sin(angle));
+  }
+  const VkDeviceSize bytes = VkDeviceSize(size) * kComplexBytes;
+  auto buffer = m_engine->createBuffer(
+      bytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST,
+      MEM_GPU_ONLY);
+  if (!buffer.isValid()) {
+    return buffer;
+  }
+  CommandStream stream(*m_engine);
+  stream.upload(buffer.getValue(), table.data(), bytes);
+  VkResult result = stream.submit();
+  if (result != VK_SUCCESS) {
+    m_engine->destroyBuffer(buffer.getValue());
+    return {result};
+  }
+  cache.emplace(size, buffer.getValue());
+  return buffer;
+}
+
+Result<FftPlan> Fft::plan(uint32_t size, uint32_t batch,
+                          FftDirection direction, uint32_t radix) {
+  if (m_engine == nullptr || !isPowerOfTwo(size) || size < 2 || batch == 0 ||
+      (radix != 2 && radix != 4 && radix != 8) ||
+      uint64_t(size) * batch > UINT32_MAX) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  const PlanKey key{size, batch, direction, radix};
+  auto found = m_state->_plans.find(key);
+  if (found != m_state->_plans.end()) {
+    return {found->second};
+  }
+
+  auto table = twiddles(size);
+  if (!table.isValid()) {
+    return {table.getError()};
+  }
+  const float sign = direction == FftDirection::FORWARD ? -1.0f : 1.0f;
+
+  FftPlan plan;
+  plan.m_twiddles = table.getValue();
+  plan.m_size = size;
+  plan.m_batch = batch;
+  plan.m_direction = direction;
+
+  if (size <= maxSharedSize(radix)) {
+    const uint32_t sharedRadix = std::min(radix, size);
+    const uint32_t threadsPerFft = size / sharedRadix;
+    const uint32_t ffts = std::max(
+        1u, std::min({kSharedThreads / threadsPerFft,
+                      m_maxSharedBytes / (size * kComplexBytes),
+                      m_maxInvocations / threadsPerFft, batch}));
+    Specialization spec;
+    spec.set(0, ffts * threadsPerFft)
+        .set(1, size)
+        .set(2, sharedRadix)
+        .set(3, ffts)
+        .set(4, sign);
+    auto kernel = m_engine->createKernel(
+        "fft_shared.spv",
+        {kSignature._bindings, sizeof(SharedPushConstants)}, spec);
+    if (!kernel.isValid()) {
+      return {kernel.getError()};
+    }
+    plan.m_kernels.push_back(kernel.getValue());
+    plan.m_groups.push_back(spread(batch, ffts, m_maxGroupsX));
+  } else {
+    for (uint32_t ns = 1; ns < size;) {
+      const uint32_t passRadix = std::min(radix, size / ns);
+      Specialization spec;
+      spec.set(0, passRadix).set(1, sign);
+      auto kernel = m_engine->createKernel("fft_pass.spv", kSignature, spec);
+      if (!kernel.isValid()) {
+        return {kernel.getError()};
+      }
+      plan.m_kernels.push_back(kernel.getValue());
+      plan.m_groups.push_back(spread(uint64_t(size / passRadix) * batch,
+                                     kPassThreads, m_maxGroupsX));
+      plan.m_radices.push_back(passRadix);
+      ns *= passRadix;
+    }
+  }
+
+  m_state->_plans.emplace(key, plan);
+  return {plan};
+}
+
+void Fft::destroy() {
+  if (m_engine == nullptr) {
+    return;
+  }
+  for (auto &entry : m_state->_twiddles) {
+    m_engine->destroyBuffer(entry.second);
+  }
+  m_state->_twiddles.clear();
+  m_state->_plans.clear();
+}
+
+} // namespace melkior::tensor_ops
@@ -0,0 +1,79 @@
+#ifndef MELKIOR_RADIX_SORT_HPP
+#define MELKIOR_RADIX_SORT_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+#include "scan.hpp"
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+// FLOAT32 keys are fp32 bit patterns sorted by value (-0 before +0, NaNs
+// at the ends by sign)
+enum class SortKey : uint8_t { UINT32, FLOAT32 };
+
+// Stable ascending LSD radix sort of 32-bit keys, optionally carrying a
+// 32-bit value per key, with 4 or 8 bit digits (8 or 4 passes).
+//
+// Every pass builds a per-work-group digit histogram in shared memory,
+// scans all of them at once with Scan, and scatters with stable in-tile
+// ranks. Passes ping-pong between the caller's buffers and buffers the
+// sorter allocates from the engine in reserve(); the pass count is even, so
+// the result always ends up in the caller's buffers. destroy() frees them.
+//
+//   auto sort = RadixSort::create(engine).getValue();
+//   sort.reserve(n);
+//   sort.record(stream, keys, values, n);
+//   stream.submit();
+//   sort.destroy();
+class RadixSort {
+public:
+  static engine::Result<RadixSort> create(engine::Engine &engine,
+                                          uint32_t radixBits = 8,
+                                          SortKey keyType = SortKey::UINT32);
+
+  // ping-pong, histogram and scan buffers for up to capacity keys
+  VkResult reserve(uint64_t capacity, bool withValues = true);
+  void destroy();
+  uint64_t capacity() const { return m_capacity; }
+
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &keys,
+                  uint64_t count) const;
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &keys,
+                  const engine::Buffer &values, uint64_t count) const;
+
+  uint32_t radixBits() const { return m_radixBits; }
+
+private:
+  struct Blocks {
+    uint32_t _keysPerBlock;
+    uint32_t _count;
+  };
+
+  Blocks blocksFor(uint64_t count) const;
+  VkResult recordPasses(engine::CommandStream &stream,
+                        const engine::Buffer &keys,
+                        const engine::Buffer *values, uint64_t count) const;
+
+  engine::Engine *m_engine = nullptr;
+  engine::Kernel m_histogram;
+  engine::Kernel m_scatterKeys;
+  engine::Kernel m_scatterPairs;
+  Scan m_scan;
+  uint32_t m_radixBits = 8;
+  SortKey m_keyType = SortKey::UINT32;
+  uint32_t m_tileSize = 1024;
+
+  uint64_t m_capacity = 0;
+  bool m_withValues = false;
+  engine::Buffer m_keys;
+  engine::Buffer m_values;
+  engine::Buffer m_histogramBuffer;
+  engine::Buffer m_scanScratch;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
@@ -0,0 +1,124 @@
+#include "radix_sort.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters for the sort, not a multiple of the tile
+  const uint32_t N = 1000003;
+
+  Engine engine("vk_radix_sort");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  // few distinct keys, so stability is actually tested
+  std::mt19937 rng(7);
+  std::vector<uint32_t> keys(N);
+  std::vector<uint32_t> values(N);
+  std::vector<float> floats(N);
+  for (uint32_t i = 0; i < N; i++) {
+    keys[i] = rng() % 5000 * 0x10001u;
+    values[i] = i;
+    floats[i] = float(int32_t(rng() % 20001) - 10000) * 0.25f;
+  }
+
+  std::vector<uint32_t> expectedKeys = keys;
+  std::vector<uint32_t> expectedValues(N);
+  {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs(N);
+    for (uint32_t i = 0; i < N; i++) {
+      pairs[i] = {keys[i], values[i]};
+    }
+    std::stable_sort(pairs.begin(), pairs.end(),
+                     [](const auto &a, const auto &b) {
+                       return a.first < b.first;
+                     });
+    for (uint32_t i = 0; i < N; i++) {
+      expectedKeys[i] = pairs[i].first;
+      expectedValues[i] = pairs[i].second;
+    }
+  }
+  std::vector<float> expectedFloats = floats;
+  std::sort(expectedFloats.begin(), expectedFloats.end());
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  const VkDeviceSize bytes = VkDeviceSize(N) * sizeof(uint32_t);
+  Buffer keyBuffer = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+  Buffer valueBuffer =
+      engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+
+  bool ok = true;
+  CommandStream stream(engine);
+  std::vector<uint32_t> resultKeys(N);
+  std::vector<uint32_t> resultValues(N);
+  for (uint32_t bits : {4u, 8u}) {
+    auto sortResult = RadixSort::create(engine, bits);
+    auto floatResult = RadixSort::create(engine, bits, SortKey::FLOAT32);
+    if (!sortResult.isValid() || !floatResult.isValid()) {
+      std::cerr << "RadixSort::create failed\n";
+      return 1;
+    }
+    RadixSort sort = sortResult.getValue();
+    RadixSort floatSort = floatResult.getValue();
+    if (sort.reserve(N) != VK_SUCCESS ||
+        floatSort.reserve(N, false) != VK_SUCCESS) {
+      std::cerr << "RadixSort::reserve failed\n";
+      return 1;
+    }
+
+    stream.upload(keyBuffer, keys.data(), bytes);
+    stream.upload(valueBuffer, values.data(), bytes);
+    VkResult r = sort.record(stream, keyBuffer, valueBuffer, N);
+    stream.readback(keyBuffer, resultKeys.data(), bytes);
+    stream.readback(valueBuffer, resultValues.data(), bytes);
+    if (r == VK_SUCCESS) {
+      r = stream.submit();
+    }
+    if (r != VK_SUCCESS) {
+      std::cerr << "sort failed: " << r << "\n";
+      return 1;
+    }
+    bool match = resultKeys == expectedKeys && resultValues == expectedValues;
+    std::cout << "  " << bits << "-bit key/value"
+              << (match ? " OK" : " FAILED") << "\n";
+    ok &= match;
+
+    stream.upload(keyBuffer, floats.data(), bytes);
+    r = floatSort.record(stream, keyBuffer, N);
+    stream.readback(keyBuffer, resultKeys.data(), bytes);
+    if (r == VK_SUCCESS) {
+      r = stream.submit();
+    }
+    if (r != VK_SUCCESS) {
+      std::cerr << "sort failed: " << r << "\n";
+      return 1;
+    }
+    match = std::memcmp(resultKeys.data(), expectedFloats.data(), bytes) == 0;
+    std::cout << "  " << bits << "-bit float keys"
+              << (match ? " OK" : " FAILED") << "\n";
+    ok &= match;
+
+    sort.destroy();
+    floatSort.destroy();
+  }
+
+  engine.destroyBuffer(keyBuffer);
+  engine.destroyBuffer(valueBuffer);
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "OK: sorts match.\n";
+  return 0;
+}
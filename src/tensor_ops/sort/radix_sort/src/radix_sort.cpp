@@ -0,0 +1,223 @@
+#include "../include/radix_sort.hpp"
+
+#include <algorithm>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant blocks of radix_histogram.comp and
+// radix_scatter.comp
+struct PushConstants {
+  uint32_t count;
+  uint32_t shift;
+  uint32_t keysPerBlock;
+  uint32_t blocks;
+  uint32_t flags;
+};
+
+constexpr uint32_t FLIP_IN = 1;
+constexpr uint32_t FLIP_OUT = 2;
+
+constexpr uint32_t kThreads = 256;
+constexpr uint32_t kItems = 4;
+// work groups per pass; blocks get more tiles instead of more groups, which
+// keeps the histogram at most buckets * kMaxBlocks entries
+constexpr uint32_t kMaxBlocks = 1024;
+
+} // namespace
+
+Result<RadixSort> RadixSort::create(Engine &engine, uint32_t radixBits,
+                                    SortKey keyType) {
+  if (radixBits != 4 && radixBits != 8) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  Specialization histogramSpec;
+  histogramSpec.set(0, radixBits);
+  auto histogram = engine.createKernel(
+      "radix_histogram.spv",
+      {{STORAGE_READ, STORAGE_WRITE}, sizeof(PushConstants)}, histogramSpec);
+  if (!histogram.isValid()) {
+    return {histogram.getError()};
+  }
+
+  const KernelSignature scatterSignature{
+      {STORAGE_READ, STORAGE_READ, STORAGE_READ, STORAGE_WRITE, STORAGE_WRITE},
+      sizeof(PushConstants)};
+  Specialization keysSpec;
+  keysSpec.set(0, kThreads).set(1, kItems).set(2, radixBits).set(3, 0u);
+  auto scatterKeys =
+      engine.createKernel("radix_scatter.spv", scatterSignature, keysSpec);
+  if (!scatterKeys.isValid()) {
+    return {scatterKeys.getError()};
+  }
+  Specialization pairsSpec;
+  pairsSpec.set(0, kThreads).set(1, kItems).set(2, radixBits).set(3, 1u);
+  auto scatterPairs =
+      engine.createKernel("radix_scatter.spv", scatterSignature, pairsSpec);
+  if (!scatterPairs.isValid()) {
+    return {scatterPairs.getError()};
+  }
+
+  auto scan = Scan::create(engine);
+  if (!scan.isValid()) {
+    return {scan.getError()};
+  }
+
+  RadixSort sort;
+  sort.m_engine = &engine;
+  sort.m_histogram = histogram.getValue();
+  sort.m_scatterKeys = scatterKeys.getValue();
+  sort.m_scatterPairs = scatterPairs.getValue();
+  sort.m_scan = scan.getValue();
+  sort.m_radixBits = radixBits;
+  sort.m_keyType = keyType;
+  sort.m_tileSize = kThreads * kItems;
+  return {sort};
+}
+
+VkResult RadixSort::reserve(uint64_t capacity, bool withValues) {
+  if (m_engine == nullptr || capacity > UINT32_MAX) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  if (capacity <= m_capacity && (!withValues || m_withValues)) {
+    return VK_SUCCESS;
+  }
+  destroy();
+
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  const VkDeviceSize bytes = std::max<uint64_t>(capacity, 1) * 4;
+  const uint64_t entries =
+      uint64_t(1u << m_radixBits) * blocksFor(capacity)._count;
+
+  auto keys = m_engine->createBuffer(bytes, usage, MEM_GPU_ONLY);
+  auto values = withValues ? m_engine->createBuffer(bytes, usage, MEM_GPU_ONLY)
+                           : keys;
+  auto histogram = m_engine->createBuffer(std::max<uint64_t>(entries, 1) * 4,
+                                          usage, MEM_GPU_ONLY);
+  auto scratch = m_engine->createBuffer(m_scan.scratchSize(entries), usage,
+                                        MEM_GPU_ONLY);
+  if (!keys.isValid() || !values.isValid() || !histogram.isValid() ||
+      !scratch.isValid()) {
+    VkResult error = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    for (auto *buffer : {&keys, &histogram, &scratch}) {
+      if (buffer->isValid()) {
+        m_engine->destroyBuffer(buffer->getValue());
+      } else {
+        error = buffer->getError();
+      }
+    }
+    if (withValues && values.isValid()) {
+      m_engine->destroyBuffer(values.getValue());
+    }
+    return error;
+  }
+
+  m_keys = keys.getValue();
+  m_values = values.getValue();
+  m_histogramBuffer = histogram.getValue();
+  m_scanScratch = scratch.getValue();
+  m_capacity = capacity;
+  m_withValues = withValues;
+  return VK_SUCCESS;
+}
+
+void RadixSort::destroy() {
+  if (m_engine == nullptr || m_capacity == 0) {
+    return;
+  }
+  m_engine->destroyBuffer(m_keys);
+  if (m_withValues) {
+    m_engine->destroyBuffer(m_values);
+  }
+  m_engine->destroyBuffer(m_histogramBuffer);
+  m_engine->destroyBuffer(m_scanScratch);
+  m_keys = {};
+  m_values = {};
+  m_histogramBuffer = {};
+  m_scanScratch = {};
+  m_capacity = 0;
+  m_withValues = false;
+}
+
+RadixSort::Blocks RadixSort::blocksFor(uint64_t count) const {
+  const uint64_t tiles = std::max<uint64_t>(1, groupCount(count, m_tileSize));
+  const uint64_t tilesPerBlock = (tiles + kMaxBlocks - 1) / kMaxBlocks;
+  const uint32_t keysPerBlock =
+      static_cast<uint32_t>(tilesPerBlock * m_tileSize);
+  return {keysPerBlock, std::max(1u, groupCount(count, keysPerBlock))};
+}
+
+VkResult RadixSort::record(CommandStream &stream, const Buffer &keys,
+                           uint64_t count) const {
+  return recordPasses(stream, keys, nullptr, count);
+}
+
+VkResult RadixSort::record(CommandStream &stream, const Buffer &keys,
+                           const Buffer &values, uint64_t count) const {
+  if (!m_withValues || values._size < count * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  return recordPasses(stream, keys, &values, count);
+}
+
+VkResult RadixSort::recordPasses(CommandStream &stream, const Buffer &keys,
+                                 const Buffer *values, uint64_t count) const {
+  if (count > m_capacity || keys._size < count * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  if (count < 2) {
+    return stream.getState();
+  }
+
+  const Blocks blocks = blocksFor(count);
+  const uint32_t buckets = 1u << m_radixBits;
+  const uint64_t entries = uint64_t(buckets) * blocks._count;
+  const WorkGroups groups = spread(blocks._count, 1, m_engine->maxGroupsX());
+  const uint32_t passes = 32 / m_radixBits;
+  const bool flip = m_keyType == SortKey::FLOAT32;
+  const uint64_t keyBytes = count * sizeof(uint32_t);
+  const uint64_t valueBytes = values ? keyBytes : 0;
+
+  for (uint32_t pass = 0; pass < passes; pass++) {
+    // even passes read the caller's buffers, odd ones the sorter's
+    const bool fromCaller = pass % 2 == 0;
+    const Buffer &keysIn = fromCaller ? keys : m_keys;
+    const Buffer &keysOut = fromCaller ? m_keys : keys;
+    const Buffer &valuesIn =
+        values ? (fromCaller ? *values : m_values) : keysIn;
+    const Buffer &valuesOut =
+        values ? (fromCaller ? m_values : *values) : keysOut;
+
+    uint32_t flags = 0;
+    if (flip && pass == 0) {
+      flags |= FLIP_IN;
+    }
+    if (flip && pass + 1 == passes) {
+      flags |= FLIP_OUT;
+    }
+    const PushConstants pc{static_cast<uint32_t>(count), pass * m_radixBits,
+                           blocks._keysPerBlock, blocks._count, flags};
+
+    stream.dispatch(m_histogram, {keysIn, m_histogramBuffer}, pc, groups,
+                    {keyBytes + entries * sizeof(uint32_t), count});
+    VkResult result =
+        m_scan.record(stream, m_histogramBuffer, m_histogramBuffer,
+                      m_scanScratch, entries, true);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+    stream.dispatch(values ? m_scatterPairs : m_scatterKeys,
+                    {keysIn, valuesIn, m_histogramBuffer, keysOut, valuesOut},
+                    pc, groups,
+                    {2 * (keyBytes + valueBytes) +
+                         entries * sizeof(uint32_t),
+                     count * m_radixBits});
+  }
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops
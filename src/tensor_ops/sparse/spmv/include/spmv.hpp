@@ -0,0 +1,155 @@
+#ifndef MELKIOR_SPMV_HPP
+#define MELKIOR_SPMV_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+#include "radix_sort.hpp"
+#include "scan.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+// fp32 CSR matrix in engine buffers: _rowPtr holds _rows + 1 uint offsets,
+// _colIdx and _values _nnz entries each. The buffers belong to whoever
+// created them; allocate() and upload() ones are freed with destroy().
+struct CsrMatrix {
+  uint32_t _rows = 0;
+  uint32_t _cols = 0;
+  uint32_t _nnz = 0;
+  engine::Buffer _rowPtr;
+  engine::Buffer _colIdx;
+  engine::Buffer _values;
+
+  // uninitialized buffers for a matrix of that shape, e.g. for CooToCsr
+  static engine::Result<CsrMatrix> allocate(engine::Engine &engine,
+                                            uint32_t rows, uint32_t cols,
+                                            uint32_t nnz);
+  static engine::Result<CsrMatrix>
+  upload(engine::Engine &engine, uint32_t rows, uint32_t cols,
+         const std::vector<uint32_t> &rowPtr,
+         const std::vector<uint32_t> &colIdx,
+         const std::vector<float> &values);
+  void destroy(engine::Engine &engine);
+};
+
+// Row length statistics an Spmv picks its kernel from.
+struct CsrStats {
+  uint32_t _maxRow = 0;
+  uint32_t _emptyRows = 0;
+  double _meanRow = 0.0;
+  double _stddevRow = 0.0;
+
+  static CsrStats analyze(const std::vector<uint32_t> &rowPtr);
+};
+
+// SCALAR runs a thread per row, VECTOR a subgroup slice of 2-32 threads per
+// row, MERGE_PATH splits rows + non-zeros evenly over threads whatever the
+// row lengths.
+enum class SpmvKernel : uint8_t { AUTO, SCALAR, VECTOR, MERGE_PATH };
+
+// y = A x for a CSR matrix.
+//
+// create() reads the row offsets back once, computes CsrStats from them
+// and, for AUTO, picks the kernel: MERGE_PATH when row lengths are skewed
+// (power-law graphs, where one thread or one subgroup per row would wait on
+// the longest rows), VECTOR when rows are long enough to share, SCALAR
+// otherwise. VECTOR reduces with subgroup shuffles when the device has
+// them. MERGE_PATH keeps per-thread carries in buffers allocated from the
+// engine and freed by destroy().
+//
+//   auto spmv = Spmv::create(engine, matrix).getValue();
+//   spmv.record(stream, x, y);
+//   stream.submit();
+class Spmv {
+public:
+  // matrix must outlive the Spmv and keep its sparsity pattern; values may
+  // change between calls
+  static engine::Result<Spmv> create(engine::Engine &engine,
+                                     const CsrMatrix &matrix,
+                                     SpmvKernel kernel = SpmvKernel::AUTO);
+
+  // the AUTO choice; lanes receives the threads per row for VECTOR
+  static SpmvKernel choose(const CsrStats &stats, uint32_t &lanes);
+
+  // x holds cols floats, y rows
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &x,
+                  const engine::Buffer &y) const;
+
+  void destroy();
+
+  SpmvKernel kernel() const { return m_kernelType; }
+  const CsrStats &stats() const { return m_stats; }
+  // threads per row of VECTOR
+  uint32_t lanes() const { return m_lanes; }
+  double flops() const { return 2.0 * m_matrix._nnz; }
+  // matrix, x and y each touched once, the traffic bandwidth is quoted in
+  uint64_t bytes() const;
+
+private:
+  engine::Engine *m_engine = nullptr;
+  CsrMatrix m_matrix;
+  CsrStats m_stats;
+  SpmvKernel m_kernelType = SpmvKernel::SCALAR;
+  uint32_t m_lanes = 1;
+  engine::Kernel m_kernel;
+  uint32_t m_maxGroupsX = 65535;
+
+  // MERGE_PATH
+  engine::Kernel m_fixup;
+  Scan m_scan;
+  uint32_t m_threads = 0;
+  engine::Buffer m_carryRows;
+  engine::Buffer m_carryValues;
+  engine::Buffer m_heads;
+  engine::Buffer m_scanScratch;
+};
+
+// COO -> CSR assembly on the device. Entries end up sorted by row, then by
+// column; duplicates are kept.
+//
+// Two stable radix sorts of a permutation, by column and then by row, the
+// permutation applied to columns and values, and the row offsets as an
+// exclusive scan of atomic row counts. The sorter, permutation and count
+// buffers come from the engine in reserve() and are freed by destroy().
+//
+//   auto assemble = CooToCsr::create(engine).getValue();
+//   assemble.reserve(nnz, rows);
+//   auto csr = CsrMatrix::allocate(engine, rows, cols, nnz).getValue();
+//   assemble.record(stream, cooRows, cooCols, cooValues, csr);
+//   stream.submit();
+class CooToCsr {
+public:
+  static engine::Result<CooToCsr> create(engine::Engine &engine);
+
+  VkResult reserve(uint64_t nnz, uint32_t rows);
+  void destroy();
+
+  // rows, cols and values hold csr._nnz entries; every row index must be
+  // below csr._rows. The inputs are left untouched and only need storage
+  // usage.
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &rows,
+                  const engine::Buffer &cols, const engine::Buffer &values,
+                  const CsrMatrix &csr) const;
+
+private:
+  engine::Engine *m_engine = nullptr;
+  engine::Kernel m_count;
+  engine::Kernel m_gather;
+  RadixSort m_sort;
+  Scan m_scan;
+  uint32_t m_maxGroupsX = 65535;
+
+  uint64_t m_capacity = 0;
+  uint32_t m_rowCapacity = 0;
+  engine::Buffer m_perm;
+  engine::Buffer m_keys;
+  engine::Buffer m_counts;
+  engine::Buffer m_scanScratch;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
@@ -0,0 +1,174 @@
+#include "spmv.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <tuple>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+using namespace melkior::engine;
+using namespace melkior::tensor_ops;
+
+int main() {
+  // --- Parameters: a power-law matrix, a few rows far longer than the rest
+  const uint32_t rows = 20000;
+  const uint32_t cols = 15000;
+
+  Engine engine("vk_spmv");
+  if (!engine.getEngineState()._ready) {
+    std::cerr << "Engine init failed: " << engine.getEngineState()._result
+              << "\n";
+    return 1;
+  }
+
+  // shuffled COO triplets with duplicates allowed
+  std::mt19937 rng(21);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<std::tuple<uint32_t, uint32_t, float>> entries;
+  for (uint32_t r = 0; r < rows; r++) {
+    const uint32_t length = uint32_t(std::pow(unit(rng), 12.0) * 2000.0);
+    for (uint32_t i = 0; i < length; i++) {
+      entries.emplace_back(r, rng() % cols, dist(rng));
+    }
+  }
+  std::shuffle(entries.begin(), entries.end(), rng);
+  const uint32_t nnz = static_cast<uint32_t>(entries.size());
+  std::vector<uint32_t> cooRows(nnz);
+  std::vector<uint32_t> cooCols(nnz);
+  std::vector<float> cooValues(nnz);
+  for (uint32_t i = 0; i < nnz; i++) {
+    std::tie(cooRows[i], cooCols[i], cooValues[i]) = entries[i];
+  }
+
+  // host CSR: stable sort by (row, column)
+  std::vector<uint32_t> order(nnz);
+  std::iota(order.begin(), order.end(), 0u);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return std::tie(cooRows[a], cooCols[a]) <
+           std::tie(cooRows[b], cooCols[b]);
+  });
+  std::vector<uint32_t> rowPtr(rows + 1, 0);
+  std::vector<uint32_t> colIdx(nnz);
+  std::vector<float> values(nnz);
+  for (uint32_t i = 0; i < nnz; i++) {
+    rowPtr[cooRows[order[i]] + 1]++;
+    colIdx[i] = cooCols[order[i]];
+    values[i] = cooValues[order[i]];
+  }
+  std::partial_sum(rowPtr.begin(), rowPtr.end(), rowPtr.begin());
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  auto makeBuffer = [&](const void *data, VkDeviceSize bytes,
+                        CommandStream &stream) {
+    Buffer buffer = engine.createBuffer(bytes, usage, MEM_GPU_ONLY).getValue();
+    if (data != nullptr) {
+      stream.upload(buffer, data, bytes);
+    }
+    return buffer;
+  };
+
+  CommandStream stream(engine);
+  Buffer rowsBuf = makeBuffer(cooRows.data(), nnz * 4ull, stream);
+  Buffer colsBuf = makeBuffer(cooCols.data(), nnz * 4ull, stream);
+  Buffer valuesBuf = makeBuffer(cooValues.data(), nnz * 4ull, stream);
+
+  // --- COO -> CSR on the device
+  auto assembleResult = CooToCsr::create(engine);
+  auto csrResult = CsrMatrix::allocate(engine, rows, cols, nnz);
+  if (!assembleResult.isValid() || !csrResult.isValid()) {
+    std::cerr << "CooToCsr setup failed\n";
+    return 1;
+  }
+  CooToCsr assemble = assembleResult.getValue();
+  CsrMatrix csr = csrResult.getValue();
+  VkResult r = assemble.reserve(nnz, rows);
+  if (r == VK_SUCCESS) {
+    r = assemble.record(stream, rowsBuf, colsBuf, valuesBuf, csr);
+  }
+  std::vector<uint32_t> gotRowPtr(rows + 1);
+  std::vector<uint32_t> gotColIdx(nnz);
+  std::vector<float> gotValues(nnz);
+  stream.readback(csr._rowPtr, gotRowPtr.data(), gotRowPtr.size() * 4);
+  stream.readback(csr._colIdx, gotColIdx.data(), nnz * 4ull);
+  stream.readback(csr._values, gotValues.data(), nnz * 4ull);
+  if (r == VK_SUCCESS) {
+    r = stream.submit();
+  }
+  if (r != VK_SUCCESS) {
+    std::cerr << "coo -> csr failed: " << r << "\n";
+    return 1;
+  }
+  bool ok = gotRowPtr == rowPtr && gotColIdx == colIdx && gotValues == values;
+  std::cout << "  coo -> csr, " << nnz << " non-zeros: "
+            << (ok ? "OK" : "FAILED") << "\n";
+
+  // --- y = A x with every kernel
+  std::vector<float> x(cols);
+  for (float &v : x) {
+    v = dist(rng);
+  }
+  std::vector<double> expected(rows, 0.0);
+  for (uint32_t row = 0; row < rows; row++) {
+    for (uint32_t i = rowPtr[row]; i < rowPtr[row + 1]; i++) {
+      expected[row] += double(values[i]) * x[colIdx[i]];
+    }
+  }
+  Buffer xBuf = makeBuffer(x.data(), cols * 4ull, stream);
+  Buffer yBuf = makeBuffer(nullptr, rows * 4ull, stream);
+
+  const char *names[] = {"auto", "scalar", "vector", "merge path"};
+  for (SpmvKernel kernel : {SpmvKernel::SCALAR, SpmvKernel::VECTOR,
+                            SpmvKernel::MERGE_PATH, SpmvKernel::AUTO}) {
+    auto spmvResult = Spmv::create(engine, csr, kernel);
+    if (!spmvResult.isValid()) {
+      std::cerr << "Spmv::create failed: " << spmvResult.getError() << "\n";
+      return 1;
+    }
+    Spmv spmv = spmvResult.getValue();
+    std::vector<float> y(rows);
+    stream.fill(yBuf, 0);
+    r = spmv.record(stream, xBuf, yBuf);
+    stream.readback(yBuf, y.data(), rows * 4ull);
+    if (r == VK_SUCCESS) {
+      r = stream.submit();
+    }
+    if (r != VK_SUCCESS) {
+      std::cerr << "spmv failed: " << r << "\n";
+      return 1;
+    }
+    double maxError = 0.0;
+    for (uint32_t row = 0; row < rows; row++) {
+      const double scale = 1.0 + std::sqrt(rowPtr[row + 1] - rowPtr[row]);
+      maxError = std::max(maxError, std::abs(y[row] - expected[row]) / scale);
+    }
+    bool match = maxError < 1e-4;
+    std::cout << "  " << names[int(kernel)] << " -> "
+              << names[int(spmv.kernel())] << ": max error " << maxError
+              << (match ? " OK" : " FAILED") << "\n";
+    if (kernel == SpmvKernel::AUTO) {
+      const CsrStats &stats = spmv.stats();
+      std::cout << "  rows: mean " << stats._meanRow << ", stddev "
+                << stats._stddevRow << ", max " << stats._maxRow << ", "
+                << stats._emptyRows << " empty\n";
+    }
+    ok &= match;
+    spmv.destroy();
+  }
+
+  for (Buffer buffer : {rowsBuf, colsBuf, valuesBuf, xBuf, yBuf}) {
+    engine.destroyBuffer(buffer);
+  }
+  csr.destroy(engine);
+  assemble.destroy();
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "OK: SpMV matches.\n";
+  return 0;
+}
@@ -0,0 +1,33 @@
+// CSR matrix, vectors and push constants of the SpMV kernels.
+
+layout(set = 0, binding = 0, std430) readonly buffer RowPtrBuf {
+    uint rowPtr[]; // rows + 1
+};
+
+layout(set = 0, binding = 1, std430) readonly buffer ColIdxBuf {
+    uint colIdx[];
+};
+
+layout(set = 0, binding = 2, std430) readonly buffer ValueBuf {
+    float values[];
+};
+
+layout(set = 0, binding = 3, std430) readonly buffer XBuf {
+    float x[];
+};
+
+layout(set = 0, binding = 4, std430) writeonly buffer YBuf {
+    float y[];
+};
+
+layout(push_constant) uniform PC {
+    uint rows;
+    uint nnz;
+    // merge path threads
+    uint threads;
+} pc;
+
+// grids past maxComputeWorkGroupCount[0] continue in Y
+uint groupIndex() {
+    return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+}
@@ -0,0 +1,439 @@
+#include "../include/spmv.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of spmv_common.glsl / spmv_fixup.comp
+struct SpmvPushConstants {
+  uint32_t rows;
+  uint32_t nnz;
+  uint32_t threads;
+};
+
+// matches the push constant block of coo_count.comp / coo_gather.comp
+struct CooPushConstants {
+  uint32_t count;
+};
+
+constexpr uint32_t kThreads = 256;
+// merge path items (row ends + non-zeros) per thread
+constexpr uint32_t kMergeItems = 8;
+constexpr uint32_t kMaxLanes = 32;
+
+} // namespace
+
+Result<CsrMatrix> CsrMatrix::allocate(Engine &engine, uint32_t rows,
+                                      uint32_t cols, uint32_t nnz) {
+  if (rows == 0 || cols == 0 || uint64_t(rows) + nnz > UINT32_MAX) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  CsrMatrix matrix;
+  matrix._rows = rows;
+  matrix._cols = cols;
+  matrix._nnz = nnz;
+  auto rowPtr = createStorage(engine, uint64_t(rows) + 1);
+  auto colIdx = createStorage(engine, nnz);
+  auto values = createStorage(engine, nnz);
+  if (rowPtr.isValid()) {
+    matrix._rowPtr = rowPtr.getValue();
+  }
+  if (colIdx.isValid()) {
+    matrix._colIdx = colIdx.getValue();
+  }
+  if (values.isValid()) {
+    matrix._values = values.getValue();
+  }
+  if (!rowPtr.isValid() || !colIdx.isValid() || !values.isValid()) {
+    matrix.destroy(engine);
+    return {VK_ERROR_OUT_OF_DEVICE_MEMORY};
+  }
+  return {matrix};
+}
+
+Result<CsrMatrix> CsrMatrix::upload(Engine &engine, uint32_t rows,
+                                    uint32_t cols,
+                                    const std::vector<uint32_t> &rowPtr,
+                                    const std::vector<uint32_t> &colIdx,
+                                    const std::vector<float> &values) {
+  if (rowPtr.size() != size_t(rows) + 1 || rowPtr.front() != 0 ||
+      rowPtr.back() != colIdx.size() || colIdx.size() != values.size() ||
+      colIdx.size() > UINT32_MAX) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+  auto allocated = allocate(engine, rows, cols,
+                            static_cast<uint32_t>(colIdx.size()));
+  if (!allocated.isValid()) {
+    return allocated;
+  }
+  CsrMatrix matrix = allocated.getValue();
+  CommandStream stream(engine);
+  stream.upload(matrix._rowPtr, rowPtr.data(),
+                rowPtr.size() * sizeof(uint32_t));
+  if (!colIdx.empty()) {
+    stream.upload(matrix._colIdx, colIdx.data(),
+                  colIdx.size() * sizeof(uint32_t));
+    stream.upload(matrix._values, values.data(),
+                  values.size() * sizeof(float));
+  }
+  VkResult result = stream.submit();
+  if (result != VK_SUCCESS) {
+    matrix.destroy(engine);
+    return {result};
+  }
+  return {matrix};
+}
+
+void CsrMatrix::destroy(Engine &engine) {
+  destroyIfSet(engine, _rowPtr);
+  destroyIfSet(engine, _colIdx);
+  destroyIfSet(engine, _values);
+}
+
+CsrStats CsrStats::analyze(const std::vector<uint32_t> &rowPtr) {
+  CsrStats stats;
+  if (rowPtr.size() < 2) {
+    return stats;
+  }
+  const size_t rows = rowPtr.size() - 1;
+  double sumSquares = 0.0;
+  for (size_t r = 0; r < rows; r++) {
+    const uint32_t length = rowPtr[r + 1] - rowPtr[r];
+    stats._maxRow = std::max(stats._maxRow, length);
+    stats._emptyRows += length == 0 ? 1 : 0;
+    sumSquares += double(length) * length;
+  }
+  stats._meanRow = double(rowPtr.back() - rowPtr.front()) / rows;
+  stats._stddevRow = std::sqrt(
+      std::max(0.0, sumSquares / rows - stats._meanRow * stats._meanRow));
+  return stats;
+}
+
+SpmvKernel Spmv::choose(const CsrStats &stats, uint32_t &lanes) {
+  // about two non-zeros per lane, a power of two from 2 to 32
+  lanes = 2;
+  while (lanes < kMaxLanes && 2.0 * lanes * 2 <= stats._meanRow) {
+    lanes *= 2;
+  }
+  // a few rows far longer than the rest leave most lanes idle whichever
+  // way rows are mapped to threads
+  const bool skewed =
+      stats._maxRow > 64 && (stats._maxRow > 16.0 * stats._meanRow ||
+                             stats._stddevRow > 2.0 * stats._meanRow);
+  if (skewed) {
+    return SpmvKernel::MERGE_PATH;
+  }
+  return stats._meanRow >= 6.0 ? SpmvKernel::VECTOR : SpmvKernel::SCALAR;
+}
+
+uint64_t Spmv::bytes() const {
+  return (uint64_t(m_matrix._rows) + 1) * sizeof(uint32_t) +
+         uint64_t(m_matrix._nnz) * (sizeof(uint32_t) + sizeof(float)) +
+         uint64_t(m_matrix._cols) * sizeof(float) +
+         uint64_t(m_matrix._rows) * sizeof(float);
+}
+
+Result<Spmv> Spmv::create(Engine &engine, const CsrMatrix &matrix,
+                          SpmvKernel kernel) {
+  if (matrix._rows == 0 || matrix._rowPtr._buffer == VK_NULL_HANDLE ||
+      uint64_t(matrix._rows) + matrix._nnz > UINT32_MAX) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  // the only readback: rows + 1 offsets, once per matrix
+  std::vector<uint32_t> rowPtr(size_t(matrix._rows) + 1);
+  CommandStream stream(engine);
+  stream.readback(matrix._rowPtr, rowPtr.data(),
+                  rowPtr.size() * sizeof(uint32_t));
+  VkResult result = stream.submit();
+  if (result != VK_SUCCESS) {
+    return {result};
+  }
+
+  Spmv spmv;
+  spmv.m_engine = &engine;
+  spmv.m_matrix = matrix;
+  spmv.m_stats = CsrStats::analyze(rowPtr);
+  spmv.m_maxGroupsX = engine.maxGroupsX();
+  uint32_t lanes = 1;
+  const SpmvKernel chosen = choose(spmv.m_stats, lanes);
+  if (kernel == SpmvKernel::AUTO) {
+    kernel = chosen;
+  }
+  spmv.m_kernelType = kernel;
+
+  const KernelSignature signature{{STORAGE_READ, STORAGE_READ, STORAGE_READ,
+                                   STORAGE_READ, STORAGE_WRITE},
+                                  sizeof(SpmvPushConstants)};
+  Result<Kernel> created{VK_ERROR_INITIALIZATION_FAILED};
+  if (kernel == SpmvKernel::SCALAR) {
+    created = engine.createKernel("spmv_scalar.spv", signature);
+  } else if (kernel == SpmvKernel::VECTOR) {
+    // shuffles stay inside a subgroup, so lanes can't exceed it
+    const bool subgroups =
+        (engine.subgroupFeatures() & VK_SUBGROUP_FEATURE_SHUFFLE_BIT) != 0 &&
+        engine.subgroupSize() >= 2;
+    if (subgroups) {
+      lanes = std::min(lanes, engine.subgroupSize());
+    }
+    spmv.m_lanes = lanes;
+    Specialization spec;
+    spec.set(0, lanes);
+    created = engine.createKernel(
+        subgroups ? "spmv_vector_subgroup.spv" : "spmv_vector.spv", signature,
+        spec);
+  } else {
+    Specialization spec;
+    spec.set(0, kMergeItems);
+    created = engine.createKernel(
+        "spmv_merge.spv",
+        {{STORAGE_READ, STORAGE_READ, STORAGE_READ, STORAGE_READ,
+          STORAGE_WRITE, STORAGE_WRITE, STORAGE_WRITE, STORAGE_WRITE},
+         sizeof(SpmvPushConstants)},
+        spec);
+  }
+  if (!created.isValid()) {
+    return {created.getError()};
+  }
+  spmv.m_kernel = created.getValue();
+  if (kernel != SpmvKernel::MERGE_PATH) {
+    return {spmv};
+  }
+
+  auto fixup = engine.createKernel(
+      "spmv_fixup.spv",
+      {{STORAGE_READ, STORAGE_READ, STORAGE_READ_WRITE},
+       sizeof(SpmvPushConstants)});
+  if (!fixup.isValid()) {
+    return {fixup.getError()};
+  }
+  auto scan = Scan::create(engine, ScanType::FLOAT32);
+  if (!scan.isValid()) {
+    return {scan.getError()};
+  }
+  spmv.m_fixup = fixup.getValue();
+  spmv.m_scan = scan.getValue();
+  spmv.m_threads = groupCount(uint64_t(matrix._rows) + matrix._nnz,
+                              kMergeItems);
+
+  auto carryRows = createStorage(engine, spmv.m_threads);
+  auto carryValues = createStorage(engine, spmv.m_threads);
+  auto heads = createStorage(engine, spmv.m_threads);
+  auto scratch = engine.createBuffer(spmv.m_scan.scratchSize(spmv.m_threads),
+                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                     MEM_GPU_ONLY);
+  if (carryRows.isValid()) {
+    spmv.m_carryRows = carryRows.getValue();
+  }
+  if (carryValues.isValid()) {
+    spmv.m_carryValues = carryValues.getValue();
+  }
+  if (heads.isValid()) {
+    spmv.m_heads = heads.getValue();
+  }
+  if (scratch.isValid()) {
+    spmv.m_scanScratch = scratch.getValue();
+  }
+  if (!carryRows.isValid() || !carryValues.isValid() || !heads.isValid() ||
+      !scratch.isValid()) {
+    spmv.destroy();
+    return {VK_ERROR_OUT_OF_DEVICE_MEMORY};
+  }
+  return {spmv};
+}
+
+void Spmv::destroy() {
+  if (m_engine == nullptr) {
+    return;
+  }
+  destroyIfSet(*m_engine, m_carryRows);
+  destroyIfSet(*m_engine, m_carryValues);
+  destroyIfSet(*m_engine, m_heads);
+  destroyIfSet(*m_engine, m_scanScratch);
+}
+
+VkResult Spmv::record(CommandStream &stream, const Buffer &x,
+                      const Buffer &y) const {
+  if (m_engine == nullptr ||
+      x._size < VkDeviceSize(m_matrix._cols) * sizeof(float) ||
+      y._size < VkDeviceSize(m_matrix._rows) * sizeof(float)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const SpmvPushConstants pc{m_matrix._rows, m_matrix._nnz, m_threads};
+  const Cost cost{bytes(), 2ull * m_matrix._nnz};
+  const std::vector<Buffer> buffers{m_matrix._rowPtr, m_matrix._colIdx,
+                                    m_matrix._values, x, y};
+
+  switch (m_kernelType) {
+  case SpmvKernel::VECTOR:
+    stream.dispatch(m_kernel, buffers, pc,
+                    spread(uint64_t(m_matrix._rows) * m_lanes, kThreads,
+                           m_maxGroupsX),
+                    cost);
+    break;
+  case SpmvKernel::MERGE_PATH: {
+    stream.dispatch(m_kernel,
+                    {m_matrix._rowPtr, m_matrix._colIdx, m_matrix._values, x,
+                     y, m_carryRows, m_carryValues, m_heads},
+                    pc, spread(m_threads, kThreads, m_maxGroupsX), cost);
+    // carries summed per row; the last of every run holds the total
+    VkResult result =
+        m_scan.recordSegmented(stream, m_carryValues, m_heads, m_carryValues,
+                               m_scanScratch, m_threads);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+    stream.dispatch(m_fixup, {m_carryRows, m_carryValues, y}, pc,
+                    spread(m_threads, kThreads, m_maxGroupsX),
+                    {uint64_t(m_threads) * 3 * sizeof(uint32_t), m_threads});
+    break;
+  }
+  default:
+    stream.dispatch(m_kernel, buffers, pc,
+                    spread(m_matrix._rows, kThreads, m_maxGroupsX), cost);
+    break;
+  }
+  return stream.getState();
+}
+
+Result<CooToCsr> CooToCsr::create(Engine &engine) {
+  auto count = engine.createKernel(
+      "coo_count.spv",
+      {{STORAGE_READ, STORAGE_WRITE, STORAGE_READ_WRITE},
+       sizeof(CooPushConstants)});
+  if (!count.isValid()) {
+    return {count.getError()};
+  }
+  auto gather = engine.createKernel(
+      "coo_gather.spv",
+      {{STORAGE_READ, STORAGE_READ, STORAGE_WRITE}, sizeof(CooPushConstants)});
+  if (!gather.isValid()) {
+    return {gather.getError()};
+  }
+  auto sort = RadixSort::create(engine);
+  if (!sort.isValid()) {
+    return {sort.getError()};
+  }
+  auto scan = Scan::create(engine);
+  if (!scan.isValid()) {
+    return {scan.getError()};
+  }
+
+  CooToCsr assemble;
+  assemble.m_engine = &engine;
+  assemble.m_count = count.getValue();
+  assemble.m_gather = gather.getValue();
+  assemble.m_sort = sort.getValue();
+  assemble.m_scan = scan.getValue();
+  assemble.m_maxGroupsX = engine.maxGroupsX();
+  return {assemble};
+}
+
+VkResult CooToCsr::reserve(uint64_t nnz, uint32_t rows) {
+  if (m_engine == nullptr || nnz + rows >= UINT32_MAX) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  nnz = std::max<uint64_t>(nnz, 1);
+  rows = std::max(rows, 1u);
+  if (nnz <= m_capacity && rows <= m_rowCapacity) {
+    return VK_SUCCESS;
+  }
+  nnz = std::max(nnz, m_capacity);
+  rows = std::max(rows, m_rowCapacity);
+  destroy();
+
+  VkResult result = m_sort.reserve(nnz, true);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  auto perm = createStorage(*m_engine, nnz);
+  auto keys = createStorage(*m_engine, nnz);
+  auto counts = createStorage(*m_engine, uint64_t(rows) + 1);
+  auto scratch = m_engine->createBuffer(m_scan.scratchSize(uint64_t(rows) + 1),
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                        MEM_GPU_ONLY);
+  if (perm.isValid()) {
+    m_perm = perm.getValue();
+  }
+  if (keys.isValid()) {
+    m_keys = keys.getValue();
+  }
+  if (counts.isValid()) {
+    m_counts = counts.getValue();
+  }
+  if (scratch.isValid()) {
+    m_scanScratch = scratch.getValue();
+  }
+  m_capacity = nnz;
+  m_rowCapacity = rows;
+  if (!perm.isValid() || !keys.isValid() || !counts.isValid() ||
+      !scratch.isValid()) {
+    destroy();
+    return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+  }
+  return VK_SUCCESS;
+}
+
+void CooToCsr::destroy() {
+  if (m_engine == nullptr || m_capacity == 0) {
+    return;
+  }
+  m_sort.destroy();
+  destroyIfSet(*m_engine, m_perm);
+  destroyIfSet(*m_engine, m_keys);
+  destroyIfSet(*m_engine, m_counts);
+  destroyIfSet(*m_engine, m_scanScratch);
+  m_capacity = 0;
+  m_rowCapacity = 0;
+}
+
+VkResult CooToCsr::record(CommandStream &stream, const Buffer &rows,
+                          const Buffer &cols, const Buffer &values,
+                          const CsrMatrix &csr) const {
+  const uint32_t n = csr._nnz;
+  const VkDeviceSize bytes = VkDeviceSize(n) * sizeof(uint32_t);
+  if (m_capacity == 0 || n > m_capacity || csr._rows == 0 ||
+      csr._rows > m_rowCapacity || rows._size < bytes || cols._size < bytes ||
+      values._size < bytes || csr._colIdx._size < bytes ||
+      csr._values._size < bytes ||
+      csr._rowPtr._size < (VkDeviceSize(csr._rows) + 1) * sizeof(uint32_t)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  const uint32_t offsets = csr._rows + 1;
+  const CooPushConstants pc{n};
+  const WorkGroups grid = spread(n, kThreads, m_maxGroupsX);
+  const Cost gatherCost{3 * bytes, 0};
+
+  stream.fill(m_counts, 0, 0, VkDeviceSize(offsets) * sizeof(uint32_t));
+  if (n > 0) {
+    stream.dispatch(m_count, {rows, m_perm, m_counts}, pc, grid,
+                    {3 * bytes, n});
+    // stable LSD over (row, column): by column first, then by row. perm is
+    // still the identity, so this gather is a copy that only needs storage
+    // usage on cols
+    stream.dispatch(m_gather, {m_perm, cols, m_keys}, pc, grid, gatherCost);
+    VkResult result = m_sort.record(stream, m_keys, m_perm, n);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+    stream.dispatch(m_gather, {m_perm, rows, m_keys}, pc, grid, gatherCost);
+    result = m_sort.record(stream, m_keys, m_perm, n);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+    stream.dispatch(m_gather, {m_perm, cols, csr._colIdx}, pc, grid,
+                    gatherCost);
+    stream.dispatch(m_gather, {m_perm, values, csr._values}, pc, grid,
+                    gatherCost);
+  }
+  // counts[rows] stays 0, so the exclusive scan ends in nnz
+  return m_scan.record(stream, m_counts, csr._rowPtr, m_scanScratch, offsets,
+                       true);
+}
+
+} // namespace melkior::tensor_ops
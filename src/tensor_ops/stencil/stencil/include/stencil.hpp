@@ -0,0 +1,137 @@
+#ifndef MELKIOR_STENCIL_HPP
+#define MELKIOR_STENCIL_HPP
+
+#include "command_stream.hpp"
+#include "engine.hpp"
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace melkior::tensor_ops {
+
+// Row-major fp32 grid, x fastest. _depth 1 is a 2D grid swept with the
+// 5-point stencil, anything larger a 3D grid swept with the 7-point one.
+struct StencilShape {
+  uint32_t _width = 1;
+  uint32_t _height = 1;
+  uint32_t _depth = 1;
+
+  bool is3d() const { return _depth > 1; }
+  uint64_t count() const { return uint64_t(_width) * _height * _depth; }
+};
+
+// u' = center u + x (W + E) + y (N + S) + z (B + F) + source f
+struct StencilWeights {
+  float _center = 0.0f;
+  float _x = 0.25f;
+  float _y = 0.25f;
+  float _z = 0.0f;
+  float _source = 0.0f;
+
+  // Jacobi iteration for -laplace(u) = f on a grid of spacing h
+  static StencilWeights jacobi(const StencilShape &shape, float h);
+  // explicit heat equation step, alpha = diffusivity * dt / h^2; stable up
+  // to 1/4 in 2D and 1/6 in 3D
+  static StencilWeights heat(const StencilShape &shape, float alpha);
+};
+
+struct StencilOptions {
+  // time steps per sweep dispatch (temporal blocking), 2D only: the tile
+  // is staged with a halo this wide and stepped in shared memory
+  uint32_t _timeSteps = 1;
+  // sweeps between convergence checks; a checked sweep also reduces the
+  // largest change of its last step
+  uint32_t _checkInterval = 1;
+  // stop once the largest change of a checked step is below this; 0 runs
+  // every step
+  float _tolerance = 0.0f;
+};
+
+// Device-side loop state of a Stencil, matches stencil_common.glsl.
+struct StencilState {
+  uint32_t _args[4];
+  uint32_t _converged;
+  // sweeps and time steps done at the last check
+  uint32_t _sweeps;
+  uint32_t _steps;
+  uint32_t _change;
+  // largest change of the last checked step
+  float _residual;
+};
+
+// Iterative 2D 5-point / 3D 7-point stencil with fixed (Dirichlet)
+// boundary cells, for Jacobi-style solvers and explicit time stepping.
+//
+// The 2D kernel stages a shared memory tile per work group, each thread
+// computing several rows (coarsening along y), and with _timeSteps > 1
+// runs that many steps per dispatch on a tile widened by the same halo.
+// The 3D kernel marches a 2D tile along z, keeping the z neighbours in
+// registers. Sweeps ping-pong between two grids owned by the Stencil, and
+// record() puts all of them into one command buffer: checked sweeps fold
+// their largest change into a state buffer, and once it drops below the
+// tolerance the device empties the sweeps recorded after it, so a solve
+// stops early without the grid, or anything else, being read back. A last
+// dispatch copies whichever grid the final sweep wrote to the output. The
+// grids and the state buffer come from the engine and are freed by
+// destroy().
+//
+//   StencilShape shape{1024, 1024};
+//   auto stencil = Stencil::create(engine, shape,
+//                                  StencilWeights::jacobi(shape, h),
+//                                  {4, 8, 1e-5f})
+//                      .getValue();
+//   stencil.record(stream, grid, rhs, grid, 10000);
+//   stream.readback(stencil.state(), &state, sizeof(state));
+//   stream.submit();
+class Stencil {
+public:
+  static engine::Result<Stencil> create(engine::Engine &engine,
+                                        const StencilShape &shape,
+                                        const StencilWeights &weights,
+                                        const StencilOptions &options = {});
+
+  // input holds the initial grid including its boundary, output receives
+  // the grid after up to steps time steps; they may be the same buffer.
+  // input seeds both grids with a copy, so it needs USAGE_TRANSFER_SRC
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &input,
+                  const engine::Buffer &output, uint32_t steps) const;
+  // with the source term f, a float per cell
+  VkResult record(engine::CommandStream &stream, const engine::Buffer &input,
+                  const engine::Buffer &source, const engine::Buffer &output,
+                  uint32_t steps) const;
+
+  void destroy();
+
+  // a StencilState, for readback
+  const engine::Buffer &state() const { return m_state; }
+  uint32_t timeSteps() const { return m_timeSteps; }
+  // output rows per thread of the 2D kernel, planes per group of the 3D one
+  uint32_t coarsening() const { return m_coarsening; }
+  // one global read and write per cell and sweep
+  uint64_t bytesPerSweep() const { return 2 * m_shape.count() * 4; }
+
+private:
+  VkResult recordSweeps(engine::CommandStream &stream,
+                        const engine::Buffer &input,
+                        const engine::Buffer *source,
+                        const engine::Buffer &output, uint32_t steps) const;
+
+  engine::Engine *m_engine = nullptr;
+  StencilShape m_shape;
+  StencilWeights m_weights;
+  StencilOptions m_options;
+  uint32_t m_timeSteps = 1;
+  uint32_t m_coarsening = 1;
+  uint32_t m_maxGroupsX = 65535;
+  engine::WorkGroups m_groups;
+  engine::Kernel m_sweep;
+  engine::Kernel m_sourceSweep;
+  engine::Kernel m_check;
+  engine::Kernel m_finish;
+  engine::Buffer m_grids[2];
+  engine::Buffer m_state;
+};
+
+} // namespace melkior::tensor_ops
+
+#endif
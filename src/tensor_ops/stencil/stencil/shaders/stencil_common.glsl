@@ -0,0 +1,48 @@
+// Loop state, push constants and change reduction of the stencil kernels,
+// included after THREADS; the state matches StencilState in stencil.hpp.
+
+layout(set = 0, binding = 0, std430) buffer StateBuf {
+    // VkDispatchIndirectCommand of the sweeps, emptied once converged
+    uvec4 args;
+    uint converged;
+    // sweeps and time steps done at the last check
+    uint sweeps;
+    uint steps;
+    // largest |change| of the sweep being checked, as float bits: atomicMax
+    // on the bits orders non-negative floats correctly
+    uint change;
+    float residual;
+} state;
+
+layout(push_constant) uniform PC {
+    float center;
+    float wx;
+    float wy;
+    float wz;
+    float source;
+    // time steps of this sweep, at most HALO for the 2D kernel
+    uint steps;
+    // nonzero when this sweep feeds a convergence check
+    uint residual;
+} pc;
+
+shared float scratch[THREADS];
+
+// folds the largest change of the group into state.change when this sweep
+// is checked; every invocation has to call it
+void reduceChange(uint lid, float value) {
+    if (pc.residual == 0) {
+        return;
+    }
+    scratch[lid] = value;
+    barrier();
+    for (uint stride = THREADS / 2; stride > 0; stride /= 2) {
+        if (lid < stride) {
+            scratch[lid] = max(scratch[lid], scratch[lid + stride]);
+        }
+        barrier();
+    }
+    if (lid == 0) {
+        atomicMax(state.change, floatBitsToUint(scratch[0]));
+    }
+}
@@ -0,0 +1,263 @@
+#include "../include/stencil.hpp"
+
+#include <algorithm>
+
+namespace melkior::tensor_ops {
+
+using namespace melkior::engine;
+
+namespace {
+
+// matches the push constant block of stencil_common.glsl
+struct SweepPushConstants {
+  float center;
+  float wx;
+  float wy;
+  float wz;
+  float source;
+  uint32_t steps;
+  uint32_t residual;
+};
+
+// matches the push constant block of stencil_check.comp
+struct CheckPushConstants {
+  uint32_t sweeps;
+  uint32_t steps;
+  float tolerance;
+};
+
+// matches the push constant block of stencil_finish.comp
+struct FinishPushConstants {
+  uint32_t count;
+  uint32_t sweeps;
+};
+
+constexpr uint32_t kThreads = 256;
+constexpr uint32_t kTileX = 32;
+constexpr uint32_t kTileY = 8;
+// output rows per thread of the 2D kernel before shared memory limits
+constexpr uint32_t kRows = 4;
+// planes per work group of the 3D kernel
+constexpr uint32_t kPlanes = 16;
+
+// shared memory of stencil2d.comp: two copies of the widened tile plus the
+// reduction scratch
+uint64_t tileBytes(uint32_t tileX, uint32_t tileY, uint32_t rows,
+                   uint32_t halo) {
+  const uint64_t cells =
+      uint64_t(tileX + 2 * halo) * (uint64_t(tileY) * rows + 2 * halo);
+  return (2 * cells + uint64_t(tileX) * tileY) * sizeof(float);
+}
+
+} // namespace
+
+StencilWeights StencilWeights::jacobi(const StencilShape &shape, float h) {
+  const float neighbours = shape.is3d() ? 6.0f : 4.0f;
+  StencilWeights weights;
+  weights._center = 0.0f;
+  weights._x = 1.0f / neighbours;
+  weights._y = 1.0f / neighbours;
+  weights._z = shape.is3d() ? 1.0f / neighbours : 0.0f;
+  weights._source = h * h / neighbours;
+  return weights;
+}
+
+StencilWeights StencilWeights::heat(const StencilShape &shape, float alpha) {
+  StencilWeights weights;
+  weights._center = 1.0f - (shape.is3d() ? 6.0f : 4.0f) * alpha;
+  weights._x = alpha;
+  weights._y = alpha;
+  weights._z = shape.is3d() ? alpha : 0.0f;
+  weights._source = 0.0f;
+  return weights;
+}
+
+Result<Stencil> Stencil::create(Engine &engine, const StencilShape &shape,
+                                const StencilWeights &weights,
+                                const StencilOptions &options) {
+  if (shape._width == 0 || shape._height == 0 || shape._depth == 0 ||
+      shape.count() > UINT32_MAX || options._timeSteps == 0 ||
+      options._checkInterval == 0 ||
+      (shape.is3d() && options._timeSteps > 1)) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  VkPhysicalDeviceProperties props{};
+  vkGetPhysicalDeviceProperties(engine.physicalDevice(), &props);
+  const auto &limits = props.limits;
+
+  uint32_t tileX = kTileX;
+  uint32_t tileY = kTileY;
+  while (tileX * tileY > limits.maxComputeWorkGroupInvocations && tileY > 1) {
+    tileY /= 2;
+  }
+  uint32_t coarsening = 1;
+  WorkGroups groups;
+  if (shape.is3d()) {
+    coarsening = std::min(kPlanes, shape._depth);
+    groups = {groupCount(shape._width, tileX), groupCount(shape._height, tileY),
+              groupCount(shape._depth, coarsening)};
+  } else {
+    // fewer rows per thread until the widened tile fits
+    const uint32_t halo = options._timeSteps;
+    coarsening = kRows;
+    while (tileBytes(tileX, tileY, coarsening, halo) >
+               limits.maxComputeSharedMemorySize &&
+           coarsening > 1) {
+      coarsening /= 2;
+    }
+    if (tileBytes(tileX, tileY, coarsening, halo) >
+        limits.maxComputeSharedMemorySize) {
+      return {VK_ERROR_INITIALIZATION_FAILED};
+    }
+    groups = {groupCount(shape._width, tileX),
+              groupCount(shape._height, tileY * coarsening), 1};
+  }
+  if (groups._x > limits.maxComputeWorkGroupCount[0] ||
+      groups._y > limits.maxComputeWorkGroupCount[1] ||
+      groups._z > limits.maxComputeWorkGroupCount[2]) {
+    return {VK_ERROR_INITIALIZATION_FAILED};
+  }
+
+  const char *sweepFile = shape.is3d() ? "stencil3d.spv" : "stencil2d.spv";
+  const KernelSignature sweepSignature{
+      {STORAGE_READ_WRITE, STORAGE_READ, STORAGE_WRITE, STORAGE_READ},
+      sizeof(SweepPushConstants)};
+  Specialization spec;
+  spec.set(0, tileX)
+      .set(1, tileY)
+      .set(2, coarsening)
+      .set(3, options._timeSteps)
+      .set(4, shape._width)
+      .set(5, shape._height)
+      .set(6, 0u)
+      .set(7, shape._depth);
+  auto sweep = engine.createKernel(sweepFile, sweepSignature, spec);
+  if (!sweep.isValid()) {
+    return {sweep.getError()};
+  }
+  spec.set(6, 1u);
+  auto sourceSweep = engine.createKernel(sweepFile, sweepSignature, spec);
+  if (!sourceSweep.isValid()) {
+    return {sourceSweep.getError()};
+  }
+  auto check = engine.createKernel(
+      "stencil_check.spv", {{STORAGE_READ_WRITE}, sizeof(CheckPushConstants)});
+  if (!check.isValid()) {
+    return {check.getError()};
+  }
+  auto finish = engine.createKernel(
+      "stencil_finish.spv",
+      {{STORAGE_READ, STORAGE_READ, STORAGE_READ, STORAGE_WRITE},
+       sizeof(FinishPushConstants)});
+  if (!finish.isValid()) {
+    return {finish.getError()};
+  }
+
+  Stencil stencil;
+  stencil.m_engine = &engine;
+  stencil.m_shape = shape;
+  stencil.m_weights = weights;
+  stencil.m_options = options;
+  stencil.m_timeSteps = options._timeSteps;
+  stencil.m_coarsening = coarsening;
+  stencil.m_maxGroupsX = engine.maxGroupsX();
+  stencil.m_groups = groups;
+  stencil.m_sweep = sweep.getValue();
+  stencil.m_sourceSweep = sourceSweep.getValue();
+  stencil.m_check = check.getValue();
+  stencil.m_finish = finish.getValue();
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | USAGE_TRANSFER_SRC_DST;
+  auto even =
+      engine.createBuffer(shape.count() * sizeof(float), usage, MEM_GPU_ONLY);
+  auto odd =
+      engine.createBuffer(shape.count() * sizeof(float), usage, MEM_GPU_ONLY);
+  // also read as the sweeps' indirect arguments
+  auto state = engine.createBuffer(sizeof(StencilState),
+                                   usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                   MEM_GPU_ONLY);
+  if (even.isValid()) {
+    stencil.m_grids[0] = even.getValue();
+  }
+  if (odd.isValid()) {
+    stencil.m_grids[1] = odd.getValue();
+  }
+  if (state.isValid()) {
+    stencil.m_state = state.getValue();
+  }
+  if (!even.isValid() || !odd.isValid() || !state.isValid()) {
+    stencil.destroy();
+    return {VK_ERROR_OUT_OF_DEVICE_MEMORY};
+  }
+  return {stencil};
+}
+
+void Stencil::destroy() {
+  if (m_engine == nullptr) {
+    return;
+  }
+  destroyIfSet(*m_engine, m_grids[0]);
+  destroyIfSet(*m_engine, m_grids[1]);
+  destroyIfSet(*m_engine, m_state);
+}
+
+VkResult Stencil::record(CommandStream &stream, const Buffer &input,
+                         const Buffer &output, uint32_t steps) const {
+  return recordSweeps(stream, input, nullptr, output, steps);
+}
+
+VkResult Stencil::record(CommandStream &stream, const Buffer &input,
+                         const Buffer &source, const Buffer &output,
+                         uint32_t steps) const {
+  return recordSweeps(stream, input, &source, output, steps);
+}
+
+VkResult Stencil::recordSweeps(CommandStream &stream, const Buffer &input,
+                               const Buffer *source, const Buffer &output,
+                               uint32_t steps) const {
+  const VkDeviceSize bytes = m_shape.count() * sizeof(float);
+  if (m_engine == nullptr || input._size < bytes || output._size < bytes ||
+      (source != nullptr && source->_size < bytes)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  // boundary cells are never written, so both grids start as the input;
+  // a transfer rather than a sweep, hence input needs USAGE_TRANSFER_SRC
+  stream.copy(input, m_grids[0], bytes);
+  stream.copy(input, m_grids[1], bytes);
+  const StencilState initial{
+      {m_groups._x, m_groups._y, m_groups._z, 0}, 0, 0, 0, 0, 0.0f};
+  stream.upload(m_state, &initial, sizeof(initial));
+
+  const Kernel &sweep = source != nullptr ? m_sourceSweep : m_sweep;
+  const uint32_t sweeps = groupCount(steps, m_timeSteps);
+  SweepPushConstants pc{m_weights._center, m_weights._x, m_weights._y,
+                        m_weights._z,      m_weights._source, 0, 0};
+  for (uint32_t i = 0; i < sweeps; i++) {
+    const Buffer &from = m_grids[i & 1];
+    const Buffer &to = m_grids[(i + 1) & 1];
+    const uint32_t done = std::min(steps, (i + 1) * m_timeSteps);
+    const bool checked =
+        (i + 1) % m_options._checkInterval == 0 || i + 1 == sweeps;
+    pc.steps = done - i * m_timeSteps;
+    pc.residual = checked ? 1 : 0;
+    // emptied by stencil_check once converged
+    stream.dispatchIndirect(sweep,
+                            {m_state, from, to, source ? *source : from}, pc,
+                            m_state);
+    if (checked) {
+      stream.dispatch(m_check, {m_state},
+                      CheckPushConstants{i + 1, done, m_options._tolerance},
+                      WorkGroups{1}, {sizeof(StencilState), 0});
+    }
+  }
+  stream.dispatch(m_finish, {m_state, m_grids[0], m_grids[1], output},
+                  FinishPushConstants{static_cast<uint32_t>(m_shape.count()),
+                                      sweeps},
+                  spread(m_shape.count(), kThreads, m_maxGroupsX),
+                  {2 * bytes, 0});
+  return stream.getState();
+}
+
+} // namespace melkior::tensor_ops